@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../includes/alloc_tracker.h"
+#include "../includes/clock.h"
+#include "../includes/perf_counters.h"
+#include "../includes/types.h"
+
+/*
+   Shared helpers for the benchmark executables: per-op latency samples
+   taken with the TSC, percentile summaries and a tiny JSON writer.
+*/
+
+/*
+   Result file layout version, bumped whenever fields change meaning.
+   1: top-level "format_version"; each result carries "repetitions",
+      median summary fields and per-run samples under "runs".
+*/
+constexpr uint64_t BENCH_FORMAT_VERSION = 1;
+
+struct latency_summary_t {
+   uint64_t samples = 0;
+   double mean_ns = 0;
+   double p50_ns = 0;
+   double p99_ns = 0;
+   double p999_ns = 0;
+   double p9999_ns = 0;
+   double max_ns = 0;
+
+   // filled only when latency_recorder::perf is set (bench --perf)
+   bool has_counters = false;
+   perf_totals_t counters;
+
+   // allocations inside the timed regions; heap ones only seen with alloc_hooks linked
+   bool has_allocations = false;
+   uint64_t allocations = 0;
+   uint64_t ops = 0;
+};
+
+// Collects raw tick deltas; `batch` ops per sample for calls too short to time one by one.
+class latency_recorder {
+public:
+   explicit latency_recorder(size_t expected_samples = 0, uint32_t batch = 1)
+      : batch_(batch)
+   {
+      ticks_.reserve(expected_samples);
+   }
+
+   /*
+      Optional counter group shared by every recorder (set by --perf).
+      Each sample then also reads the counters around the timed region;
+      the counter reads sit outside the tick window but still perturb the
+      caches, so compare latency only between runs with the same setting.
+   */
+   static inline perf_counter_group* perf = nullptr;
+
+   inline uint64_t start() {
+      if (perf) {
+         perf->read(perf_before_);
+      }
+      allocations_before_ = alloc_tracker::counts.allocations();
+      return tsc_clock::read_ticks();
+   }
+
+   inline void stop(uint64_t started) {
+      uint64_t ticks = tsc_clock::read_ticks() - started;
+      allocations_ += alloc_tracker::counts.allocations() - allocations_before_;
+      ticks_.push_back(ticks);
+      if (perf) {
+         perf_sample_t after;
+         perf->read(after);
+         counters_.add(perf_before_, after, perf->read_overhead(), batch_);
+      }
+   }
+
+   uint32_t batch() const { return batch_; }
+   uint64_t ops() const { return ticks_.size() * batch_; }
+
+   latency_summary_t summarise() {
+      latency_summary_t s;
+      if (ticks_.empty()) {
+         return s;
+      }
+      std::sort(ticks_.begin(), ticks_.end());
+
+      double scale = default_clock().ns_per_tick() / batch_;
+      double total = 0;
+      for (uint64_t t : ticks_) {
+         total += static_cast<double>(t);
+      }
+      s.samples = ticks_.size();
+      s.mean_ns = total * scale / static_cast<double>(ticks_.size());
+      s.p50_ns = percentile(0.50) * scale;
+      s.p99_ns = percentile(0.99) * scale;
+      s.p999_ns = percentile(0.999) * scale;
+      s.p9999_ns = percentile(0.9999) * scale;
+      s.max_ns = static_cast<double>(ticks_.back()) * scale;
+      s.has_counters = perf && perf->available();
+      s.counters = counters_;
+      s.has_allocations = alloc_tracker::hooks_installed();
+      s.allocations = allocations_;
+      s.ops = ops();
+      return s;
+   }
+
+private:
+   uint32_t batch_;
+   std::vector<uint64_t> ticks_;
+   perf_sample_t perf_before_;
+   perf_totals_t counters_;
+   uint64_t allocations_before_ = 0;
+   uint64_t allocations_ = 0;
+
+   double percentile(double q) const {
+      size_t idx = static_cast<size_t>(q * static_cast<double>(ticks_.size() - 1) + 0.5);
+      return static_cast<double>(ticks_[ std::min(idx, ticks_.size() - 1) ]);
+   }
+};
+
+// Wall-clock span for throughput, independent of per-op sampling.
+struct wall_timer {
+   uint64_t started_ns = monotonic_ns();
+   double seconds() const { return static_cast<double>(monotonic_ns() - started_ns) / 1e9; }
+};
+
+// Deterministic 16-byte numeric IDs: "<prefix><zero padded n>".
+static inline void bench_order_id(char* out, char prefix, uint64_t n) {
+   std::memset(out, '0', ORDER_ID_LEN);
+   out[0] = prefix;
+   for (int i = ORDER_ID_LEN - 1; i > 0 && n; i--, n /= 10) {
+      out[ i ] = static_cast<char>('0' + (n % 10));
+   }
+}
+
+static inline order_id_key bench_key(const order_t& o) {
+   order_id_key k;
+   std::memcpy(k.order_id, o.order_id, ORDER_ID_LEN);
+   return k;
+}
+
+// xorshift64*: cheap, seedable, good enough for workload shaping
+struct bench_rng {
+   uint64_t state;
+   explicit bench_rng(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+   inline uint64_t next() {
+      state ^= state >> 12;
+      state ^= state << 25;
+      state ^= state >> 27;
+      return state * 2685821657736338717ULL;
+   }
+   inline uint64_t below(uint64_t n) { return next() % n; }
+};
+
+/*
+   Median with a distribution-free ~95% confidence interval from order
+   statistics (normal approximation to the binomial). With five or fewer
+   samples the interval is simply [min, max].
+*/
+struct median_ci_t {
+   double median = 0;
+   double low = 0;
+   double high = 0;
+};
+
+static inline median_ci_t median_ci(std::vector<double> v) {
+   median_ci_t out;
+   if (v.empty()) {
+      return out;
+   }
+   std::sort(v.begin(), v.end());
+   size_t n = v.size();
+   out.median = n % 2 ? v[ n / 2 ] : (v[ n / 2 - 1 ] + v[ n / 2 ]) / 2;
+
+   double half = 1.96 * std::sqrt(static_cast<double>(n)) / 2;
+   double lo = std::floor(static_cast<double>(n) / 2 - half);
+   double hi = std::ceil(static_cast<double>(n) / 2 + half) - 1;
+   out.low = v[ lo < 0 ? 0 : static_cast<size_t>(lo) ];
+   out.high = v[ hi > static_cast<double>(n - 1) ? n - 1 : static_cast<size_t>(hi) ];
+   return out;
+}
+
+static inline std::vector<size_t> parse_size_list(const char* arg) {
+   std::vector<size_t> out;
+   const char* p = arg;
+   while (*p) {
+      char* end = nullptr;
+      out.push_back(static_cast<size_t>(std::strtoull(p, &end, 10)));
+      if (end == p) {
+         break;
+      }
+      p = (*end == ',') ? end + 1 : end;
+   }
+   return out;
+}
+
+/*
+   Minimal streaming JSON writer; enough for flat result records.
+*/
+class json_writer {
+public:
+   explicit json_writer(std::FILE* out) : out_(out) {}
+
+   void begin_object(const char* key = nullptr) { open(key, '{'); }
+   void end_object() { close('}'); }
+   void begin_array(const char* key = nullptr) { open(key, '['); }
+   void end_array() { close(']'); }
+
+   void field(const char* key, const std::string& v) {
+      prefix(key);
+      std::fputc('"', out_);
+      for (char c : v) {
+         if (c == '"' || c == '\\') {
+            std::fputc('\\', out_);
+         }
+         std::fputc(c, out_);
+      }
+      std::fputc('"', out_);
+   }
+   void field(const char* key, const char* v) { field(key, std::string(v)); }
+   void field(const char* key, double v) { prefix(key); std::fprintf(out_, "%.3f", v); }
+   void field(const char* key, uint64_t v) { prefix(key); std::fprintf(out_, "%llu", static_cast<unsigned long long>(v)); }
+   void field(const char* key, int64_t v) { prefix(key); std::fprintf(out_, "%lld", static_cast<long long>(v)); }
+   void field(const char* key, bool v) { prefix(key); std::fputs(v ? "true" : "false", out_); }
+
+   void finish() { std::fputc('\n', out_); std::fflush(out_); }
+
+private:
+   std::FILE* out_;
+   std::vector<bool> first_;
+
+   void prefix(const char* key) {
+      if (!first_.empty()) {
+         if (!first_.back()) {
+            std::fputc(',', out_);
+         }
+         first_.back() = false;
+      }
+      if (key) {
+         std::fprintf(out_, "\"%s\":", key);
+      }
+   }
+   void open(const char* key, char c) {
+      prefix(key);
+      std::fputc(c, out_);
+      first_.push_back(true);
+   }
+   void close(char c) {
+      first_.pop_back();
+      std::fputc(c, out_);
+   }
+};
+
+static inline void write_latency(json_writer& w, const latency_summary_t& s) {
+   w.begin_object("latency_ns");
+   w.field("samples", s.samples);
+   w.field("mean", s.mean_ns);
+   w.field("p50", s.p50_ns);
+   w.field("p99", s.p99_ns);
+   w.field("p99.9", s.p999_ns);
+   w.field("p99.99", s.p9999_ns);
+   w.field("max", s.max_ns);
+   w.end_object();
+
+   if (s.has_allocations) {
+      w.field("allocations_per_op", s.ops ? static_cast<double>(s.allocations) / static_cast<double>(s.ops) : 0.0);
+   }
+
+   if (s.has_counters) {
+      w.begin_object("counters_per_op");
+      for (size_t i = 0; i < PERF_COUNTERS; i++) {
+         w.field(perf_counter_name(i), s.counters.per_op(i));
+      }
+      w.end_object();
+   }
+}
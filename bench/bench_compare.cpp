@@ -0,0 +1,213 @@
+/*
+   bench-compare: flags regressions between two bench-orderbook result files.
+
+   usage: bench-compare baseline.json current.json
+                        [--threshold 0.05] [--tail-threshold 0.10] [--allow-missing]
+                        [--allow-few-runs]
+
+   Results are matched by (name, depth, live_orders). For each match the
+   median and ~95% CI of throughput, p99 and p99.9 are computed from the
+   per-run samples. A metric regresses when its median is worse than the
+   baseline by more than the threshold *and* the two intervals do not
+   overlap, so single noisy runs do not fail the build.
+
+   With fewer than MIN_SAMPLES runs on either side there is no real
+   interval, so a metric past the threshold is reported as "few runs"
+   rather than judged, and fails the comparison unless --allow-few-runs
+   is given; record with --repeat 3 or more. A baseline scenario missing
+   from the current run (crashed or filtered out) fails the comparison
+   unless --allow-missing is given.
+
+   Exit status: 0 no regressions, 1 at least one regression, missing
+   scenario or few-runs metric, 2 bad input.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "bench_common.h"
+#include "json_reader.h"
+
+struct metric_t {
+   const char* label;
+   const char* series;        // key under "runs"
+   const char* summary_path;  // fallback for results without runs
+   bool higher_is_better;
+   bool tail;
+};
+
+static const metric_t METRICS[] = {
+   { "throughput", "throughput_ops_per_sec", "throughput_ops_per_sec", true,  false },
+   { "p99",        "p99",                    "p99",                    false, true },
+   { "p99.9",      "p99.9",                  "p99.9",                  false, true },
+};
+
+using result_key = std::tuple<std::string, uint64_t, uint64_t>;
+
+static constexpr size_t MIN_SAMPLES = 3;
+
+static std::vector<double> samples_for(const json_value& result, const metric_t& m) {
+   std::vector<double> out;
+   const json_value* runs = result.find("runs");
+   const json_value* series = runs ? runs->find(m.series) : nullptr;
+   if (series && series->type == json_value::type_t::ARRAY) {
+      for (const json_value& v : series->items) {
+         out.push_back(v.number);
+      }
+      return out;
+   }
+
+   // pre-versioned files: one summary value per result
+   if (m.higher_is_better) {
+      out.push_back(result.number_or(m.summary_path, 0));
+   } else if (const json_value* lat = result.find("latency_ns")) {
+      out.push_back(lat->number_or(m.summary_path, 0));
+   }
+   return out;
+}
+
+static bool load_results(const std::string& path, std::map<result_key, json_value>& out) {
+   json_value root;
+   std::string error;
+   if (!load_json_file(path, root, error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return false;
+   }
+
+   uint64_t version = static_cast<uint64_t>(root.number_or("format_version", 0));
+   if (version > BENCH_FORMAT_VERSION) {
+      std::fprintf(stderr, "%s: format_version %llu is newer than this tool (%llu)\n", path.c_str(),
+                   static_cast<unsigned long long>(version),
+                   static_cast<unsigned long long>(BENCH_FORMAT_VERSION));
+      return false;
+   }
+
+   const json_value* results = root.find("results");
+   if (!results || results->type != json_value::type_t::ARRAY) {
+      std::fprintf(stderr, "%s: no results array\n", path.c_str());
+      return false;
+   }
+   for (const json_value& r : results->items) {
+      result_key key { r.string_or("name", ""),
+                       static_cast<uint64_t>(r.number_or("depth", 0)),
+                       static_cast<uint64_t>(r.number_or("live_orders", 0)) };
+      out[ key ] = r;
+   }
+   return true;
+}
+
+int main(int argc, char** argv) {
+   std::vector<std::string> files;
+   double threshold = 0.05;
+   double tail_threshold = 0.10;
+   bool allow_missing = false;
+   bool allow_few_runs = false;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[ i ];
+      bool has_value = i + 1 < argc;
+      if (arg == "--threshold" && has_value) {
+         threshold = std::strtod(argv[ ++i ], nullptr);
+      } else if (arg == "--tail-threshold" && has_value) {
+         tail_threshold = std::strtod(argv[ ++i ], nullptr);
+      } else if (arg == "--allow-missing") {
+         allow_missing = true;
+      } else if (arg == "--allow-few-runs") {
+         allow_few_runs = true;
+      } else if (!arg.empty() && arg[ 0 ] != '-') {
+         files.push_back(arg);
+      } else {
+         files.clear();
+         break;
+      }
+   }
+   if (files.size() != 2) {
+      std::fprintf(stderr,
+         "usage: %s baseline.json current.json [--threshold 0.05] [--tail-threshold 0.10] [--allow-missing] "
+         "[--allow-few-runs]\n",
+         argv[ 0 ]);
+      return 2;
+   }
+
+   std::map<result_key, json_value> baseline, current;
+   if (!load_results(files[ 0 ], baseline) || !load_results(files[ 1 ], current)) {
+      return 2;
+   }
+
+   size_t regressions = 0;
+   size_t missing = 0;
+   size_t few_runs = 0;
+   std::printf("%-26s %6s %8s %-10s %24s %24s %8s  %s\n",
+               "scenario", "depth", "live", "metric", "baseline [ci]", "current [ci]", "change", "verdict");
+
+   for (const auto& [key, cur] : current) {
+      auto it = baseline.find(key);
+      const auto& [name, depth, live] = key;
+      if (it == baseline.end()) {
+         std::printf("%-26s %6llu %8llu %-10s %24s %24s %8s  new\n", name.c_str(),
+                     static_cast<unsigned long long>(depth), static_cast<unsigned long long>(live),
+                     "-", "-", "-", "-");
+         continue;
+      }
+
+      for (const metric_t& m : METRICS) {
+         std::vector<double> bs = samples_for(it->second, m);
+         std::vector<double> cs = samples_for(cur, m);
+         median_ci_t b = median_ci(bs);
+         median_ci_t c = median_ci(cs);
+         if (b.median <= 0) {
+            continue;
+         }
+         bool enough = bs.size() >= MIN_SAMPLES && cs.size() >= MIN_SAMPLES;
+
+         // positive = worse
+         double change = (c.median - b.median) / b.median;
+         double worse = m.higher_is_better ? -change : change;
+         bool separated = m.higher_is_better ? c.high < b.low : c.low > b.high;
+         bool improved_separated = m.higher_is_better ? c.low > b.high : c.high < b.low;
+         double limit = m.tail ? tail_threshold : threshold;
+
+         const char* verdict = "ok";
+         if (worse > limit && !enough) {
+            verdict = "few runs";
+            few_runs++;
+         } else if (worse > limit && separated) {
+            verdict = "REGRESSION";
+            regressions++;
+         } else if (worse > limit) {
+            verdict = "noise";
+         } else if (-worse > limit && improved_separated) {
+            verdict = "improved";
+         }
+
+         char bbuf[ 64 ], cbuf[ 64 ];
+         std::snprintf(bbuf, sizeof(bbuf), "%.1f [%.1f,%.1f]", b.median, b.low, b.high);
+         std::snprintf(cbuf, sizeof(cbuf), "%.1f [%.1f,%.1f]", c.median, c.low, c.high);
+         std::printf("%-26s %6llu %8llu %-10s %24s %24s %+7.1f%%  %s\n", name.c_str(),
+                     static_cast<unsigned long long>(depth), static_cast<unsigned long long>(live),
+                     m.label, bbuf, cbuf, change * 100, verdict);
+      }
+   }
+
+   for (const auto& [key, base] : baseline) {
+      if (!current.count(key)) {
+         std::printf("%-26s %6llu %8llu missing from current run%s\n", std::get<0>(key).c_str(),
+                     static_cast<unsigned long long>(std::get<1>(key)),
+                     static_cast<unsigned long long>(std::get<2>(key)),
+                     allow_missing ? "" : "  MISSING");
+         missing++;
+      }
+   }
+
+   if (few_runs) {
+      std::fprintf(stderr, "%s: %zu metric(s) past the threshold with fewer than %zu runs on a side; "
+                   "rerun with --repeat %zu or more to judge them\n", allow_few_runs ? "warning" : "error",
+                   few_runs, MIN_SAMPLES, MIN_SAMPLES);
+   }
+   std::printf("%zu regression(s), %zu missing, %zu few runs\n", regressions, missing, few_runs);
+   return regressions || (missing && !allow_missing) || (few_runs && !allow_few_runs) ? 1 : 0;
+}
@@ -0,0 +1,275 @@
+/*
+   bench-jitter: wake-up and processing jitter of the matching thread
+   under different placements and idle strategies.
+
+   usage: bench-jitter [--seconds S] [--rate msgs/s] [--cpus M,L,I]
+                       [--fifo PRIO] [--filter substring] [--out file.json]
+
+   An io thread timestamps messages into an SPSC ring at a fixed rate; the
+   matching thread waits with the configured idle strategy, turns each
+   message into an add that crosses the previous one (so the logger gets
+   ADD and MATCH events) and records ring-push to match-done time. The
+   rate (default 10000/s) must stay below what the matching thread
+   sustains, or the numbers are queueing delay; ring overruns are
+   reported. Each configuration runs for S seconds:
+
+     block_unpinned / yield_unpinned / busy_unpinned   idle strategy only
+     busy_pinned                  matching, logger and io on CPUs M, L, I
+     busy_pinned_fifo             plus SCHED_FIFO PRIO on matching
+     busy_pinned_shared_logger    logger moved onto the matching CPU
+
+   The default CPUs are the last three online ones. Placement warnings
+   (shared cores, missing privileges) are printed per configuration; the
+   FIFO case is skipped when matching shares a CPU with another thread,
+   since it would starve it. Output uses the bench-orderbook JSON layout.
+*/
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "../includes/latency_histogram.h"
+#include "../includes/spsc_ring.h"
+#include "../includes/thread_affinity.h"
+#include "../src/orderbook.h"
+
+struct jitter_case_t {
+   const char* name;
+   idle_strategy idle;
+   bool pinned;
+   bool fifo;
+   bool shared_logger;
+};
+
+struct jitter_result_t {
+   std::string name;
+   orderbook_config_t placement;
+   placement_result_t matching;
+   uint64_t messages = 0;
+   uint64_t overruns = 0;        // io found the ring full: rate above what matching sustains
+   double seconds = 0;
+   latency_summary_t latency;
+};
+
+static latency_summary_t summarise(const latency_histogram_snapshot& h) {
+   double scale = default_clock().ns_per_tick();
+   latency_summary_t s;
+   s.samples = h.count();
+   s.mean_ns = h.mean() * scale;
+   s.p50_ns = static_cast<double>(h.value_at(0.50)) * scale;
+   s.p99_ns = static_cast<double>(h.value_at(0.99)) * scale;
+   s.p999_ns = static_cast<double>(h.value_at(0.999)) * scale;
+   s.p9999_ns = static_cast<double>(h.value_at(0.9999)) * scale;
+   s.max_ns = static_cast<double>(h.max()) * scale;
+   return s;
+}
+
+static jitter_result_t run_case(const jitter_case_t& c, const orderbook_config_t& placement,
+                                double seconds, uint64_t rate) {
+   jitter_result_t r;
+   r.name = c.name;
+   r.placement = placement;
+
+   logger_config_t lc;
+   lc.format = log_format::BINARY;
+   lc.thread = placement.logger;
+   std::string journal = "/tmp/bench-jitter-" + std::to_string(::getpid()) + ".bin";
+   auto log = std::make_unique<logger>(journal, lc);
+
+   auto ring = std::make_unique<spsc_ring<uint64_t, 4096>>();
+   ring->init();
+   auto hist = std::make_unique<latency_histogram>();
+   std::atomic<bool> stop{false};
+
+   std::thread matching([&] {
+      r.matching = apply_thread_placement(placement.matching, "ob-matching");
+      auto ob = std::make_unique<orderbook>(log.get());
+      idle_waiter waiter(placement.idle);
+      uint64_t n = 0;
+      uint64_t sent;
+      while (!stop.load(std::memory_order_relaxed)) {
+         if (!ring->try_pop(sent)) {
+            waiter.idle();
+            continue;
+         }
+         waiter.reset();
+         char id[ ORDER_ID_LEN ];
+         bench_order_id(id, 'J', ++n);
+         order_side side = (n & 1) ? order_side::BUY : order_side::SELL;
+         order_t o(tsc_clock::read_ticks(), id, "JITR", order_kind::LMT, side, order_status::NEW, 100, 10, false);
+         ob->add(o);
+         ob->execute();
+         hist->record(tsc_clock::read_ticks() - sent);
+      }
+      r.messages = n;
+   });
+
+   std::thread io([&] {
+      apply_thread_placement(placement.io.empty() ? thread_placement_t{} : placement.io[ 0 ], "ob-io");
+      double ticks_per_ns = 1.0 / default_clock().ns_per_tick();
+      uint64_t interval = static_cast<uint64_t>(1e9 / static_cast<double>(rate) * ticks_per_ns);
+      uint64_t next = tsc_clock::read_ticks();
+      while (!stop.load(std::memory_order_relaxed)) {
+         uint64_t now = tsc_clock::read_ticks();
+         if (now < next) {
+            // sleep through most of the gap, pause-spin the last few microseconds
+            if (static_cast<double>(next - now) * default_clock().ns_per_tick() > 60000) {
+               timespec ts { 0, 50000 };
+               ::nanosleep(&ts, nullptr);
+            } else {
+               cpu_relax();
+            }
+            continue;
+         }
+         next += interval;
+         if (!ring->try_push(tsc_clock::read_ticks())) {
+            r.overruns++;
+         }
+      }
+   });
+
+   wall_timer wall;
+   timespec span { static_cast<time_t>(seconds), static_cast<long>((seconds - static_cast<double>(static_cast<time_t>(seconds))) * 1e9) };
+   ::nanosleep(&span, nullptr);
+   stop.store(true);
+   io.join();
+   matching.join();
+   r.seconds = wall.seconds();
+
+   log.reset();
+   ::unlink(journal.c_str());
+
+   latency_histogram_snapshot snap;
+   hist->snapshot(snap);
+   r.latency = summarise(snap);
+   return r;
+}
+
+int main(int argc, char** argv) {
+   double seconds = 1.0;
+   uint64_t rate = 10000;
+   int online = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+   std::vector<size_t> cpus;
+   int fifo = 10;
+   std::string filter;
+   std::string out_path;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[ i ];
+      bool has_value = i + 1 < argc;
+      if (arg == "--seconds" && has_value) {
+         seconds = std::strtod(argv[ ++i ], nullptr);
+      } else if (arg == "--rate" && has_value) {
+         rate = std::max<uint64_t>(1, std::strtoull(argv[ ++i ], nullptr, 10));
+      } else if (arg == "--cpus" && has_value) {
+         cpus = parse_size_list(argv[ ++i ]);
+      } else if (arg == "--fifo" && has_value) {
+         fifo = std::atoi(argv[ ++i ]);
+      } else if (arg == "--filter" && has_value) {
+         filter = argv[ ++i ];
+      } else if (arg == "--out" && has_value) {
+         out_path = argv[ ++i ];
+      } else {
+         std::fprintf(stderr,
+            "usage: %s [--seconds S] [--rate msgs/s] [--cpus M,L,I] [--fifo PRIO] [--filter substring] [--out file.json]\n",
+            argv[ 0 ]);
+         return 2;
+      }
+   }
+   while (cpus.size() < 3) {
+      cpus.push_back(static_cast<size_t>(std::max(0, online - 1 - static_cast<int>(cpus.size())) % online));
+   }
+   if (online < 3) {
+      std::fprintf(stderr, "note: only %d CPU(s) online; pinned cases share cores and mostly measure the scheduler\n", online);
+   }
+
+   const jitter_case_t cases[] = {
+      { "block_unpinned",            idle_strategy::BLOCK,     false, false, false },
+      { "yield_unpinned",            idle_strategy::YIELD,     false, false, false },
+      { "busy_unpinned",             idle_strategy::BUSY_POLL, false, false, false },
+      { "busy_pinned",               idle_strategy::BUSY_POLL, true,  false, false },
+      { "busy_pinned_fifo",          idle_strategy::BUSY_POLL, true,  true,  false },
+      { "busy_pinned_shared_logger", idle_strategy::BUSY_POLL, true,  false, true  },
+   };
+
+   std::vector<jitter_result_t> results;
+   for (const jitter_case_t& c : cases) {
+      if (!filter.empty() && std::string(c.name).find(filter) == std::string::npos) {
+         continue;
+      }
+      orderbook_config_t placement;
+      placement.idle = c.idle;
+      placement.io.resize(1);
+      if (c.pinned) {
+         placement.matching.cpu = static_cast<int>(cpus[ 0 ]);
+         placement.logger.cpu = static_cast<int>(c.shared_logger ? cpus[ 0 ] : cpus[ 1 ]);
+         placement.io[ 0 ].cpu = static_cast<int>(cpus[ 2 ]);
+      }
+      if (c.fifo) {
+         if (cpus[ 0 ] == cpus[ 1 ] || cpus[ 0 ] == cpus[ 2 ]) {
+            std::fprintf(stderr, "%s: skipped, matching would share a CPU under SCHED_FIFO busy-poll\n", c.name);
+            continue;
+         }
+         placement.matching.fifo_priority = fifo;
+      }
+      for (const std::string& w : placement_warnings(placement)) {
+         std::fprintf(stderr, "%s: warning: %s\n", c.name, w.c_str());
+      }
+
+      jitter_result_t r = run_case(c, placement, seconds, rate);
+      if (!r.matching.error.empty()) {
+         std::fprintf(stderr, "%s: warning: %s\n", c.name, r.matching.error.c_str());
+      }
+      if (r.overruns) {
+         std::fprintf(stderr, "%s: warning: %llu messages found the ring full; lower --rate\n",
+                      c.name, static_cast<unsigned long long>(r.overruns));
+      }
+      std::fprintf(stderr, "%-28s idle=%-9s msgs=%-8llu p50=%8.0fns p99=%9.0fns p99.9=%9.0fns max=%9.0fns\n",
+                   c.name, idle_strategy_name(c.idle), static_cast<unsigned long long>(r.messages),
+                   r.latency.p50_ns, r.latency.p99_ns, r.latency.p999_ns, r.latency.max_ns);
+      results.push_back(std::move(r));
+   }
+
+   std::FILE* out = out_path.empty() ? stdout : std::fopen(out_path.c_str(), "w");
+   if (!out) {
+      std::fprintf(stderr, "cannot open %s\n", out_path.c_str());
+      return 1;
+   }
+   json_writer w(out);
+   w.begin_object();
+   w.field("format_version", BENCH_FORMAT_VERSION);
+   w.field("suite", "bench-jitter");
+   w.field("ns_per_tick", default_clock().ns_per_tick());
+   w.field("cpus_online", static_cast<uint64_t>(online));
+   w.begin_array("results");
+   for (const jitter_result_t& r : results) {
+      w.begin_object();
+      w.field("name", r.name);
+      w.field("depth", static_cast<uint64_t>(1));
+      w.field("live_orders", static_cast<uint64_t>(0));
+      w.field("ops", r.messages);
+      w.field("overruns", r.overruns);
+      w.field("repetitions", static_cast<uint64_t>(1));
+      w.field("seconds", r.seconds);
+      w.field("throughput_ops_per_sec", static_cast<double>(r.messages) / r.seconds);
+      w.field("idle", idle_strategy_name(r.placement.idle));
+      w.field("matching_cpu", static_cast<int64_t>(r.placement.matching.cpu));
+      w.field("logger_cpu", static_cast<int64_t>(r.placement.logger.cpu));
+      w.field("io_cpu", static_cast<int64_t>(r.placement.io[ 0 ].cpu));
+      w.field("pinned", r.matching.pinned);
+      w.field("realtime", r.matching.realtime);
+      write_latency(w, r.latency);
+      w.end_object();
+   }
+   w.end_array();
+   w.end_object();
+   w.finish();
+   if (out != stdout) {
+      std::fclose(out);
+   }
+   return 0;
+}
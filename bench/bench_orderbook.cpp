@@ -0,0 +1,838 @@
+/*
+   bench-orderbook: microbenchmarks for the orderbook hot paths.
+
+   Every scenario runs over a grid of book depths (price levels per side)
+   and live-order counts, keeps the book at that shape while it runs, and
+   reports throughput plus p50/p99/p99.9/p99.99/max latency as JSON.
+   Adversarial scenarios use fixed shapes built to hit data-dependent
+   worst cases and run once each, ignoring --depths/--orders.
+
+   usage: bench-orderbook [--depths 1,10,100] [--orders 1000,100000]
+                          [--ops N] [--filter substring] [--out file.json]
+                          [--perf] [--repeat N]
+                          [--pages system|4k|thp|2m|1g] [--reserve-mb N]
+                          [--cpu N] [--numa] [--numa-node N] [--reserve]
+
+   --perf adds per-op hardware counters (cycles, instructions, cache,
+   branch and dTLB misses) where perf_event_open is permitted.
+   --repeat runs every case N times (fresh fixture each time) and reports
+   medians plus the per-run samples bench-compare needs for its
+   confidence intervals.
+   --pages puts every book (ladders, hives, id index) in the book_memory
+   pool on that page size; compare dtlb_misses with --perf against a
+   system run. The page kind actually obtained is recorded in the JSON.
+   --cpu pins the benchmark thread. --numa gives book memory per-node
+   pools, so books land on the pinned CPU's node; --numa-node N forces
+   them onto node N instead (pin elsewhere to measure remote placement).
+   Either way the JSON gets a "numa" section: where the book pages really
+   are relative to the benchmark thread, plus per-case local/remote DRAM
+   loads where the PMU exposes the NODE events.
+   Every result carries allocations_per_op: heap and book_memory
+   allocations inside the timed calls (the binary links the counting
+   malloc hooks). --reserve calls orderbook::reserve() on each fixture
+   book for its shape first; the steady-state cases should then show 0.
+   fork_sweep times execute_sweep's order on a book_fork (fork, add,
+   execute; the fork is torn down untimed) against an unchanged book.
+   first_orders_cold / first_orders_warm time the first few thousand
+   calls on a fresh book without and with orderbook::warmup(); run them
+   alone (--filter first_orders) so earlier cases have not warmed the
+   code already.
+*/
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "../includes/numa.h"
+#include "../includes/thread_affinity.h"
+#include "../src/book_fork.h"
+#include "../src/orderbook.h"
+
+static constexpr uint32_t MID_PRICE = 10000;
+
+struct bench_params_t {
+   size_t depth;
+   size_t live_orders;
+   size_t ops;
+};
+
+struct bench_result_t {
+   std::string name;
+   bench_params_t params;
+   uint64_t ops = 0;
+   double seconds = 0;
+   latency_summary_t latency;
+   node_traffic_t node_traffic {};   // whole run, fixture set-up included
+};
+
+struct resident_t {
+   order_id_key key;
+   uint32_t price;
+   order_side side;
+};
+
+/*
+   Book kept at a fixed shape: `depth` levels each side around MID_PRICE,
+   live_orders spread evenly across them, never crossing.
+*/
+class book_fixture {
+public:
+   // set by --reserve
+   static inline bool reserve_books = false;
+
+   explicit book_fixture(const bench_params_t& p, uint64_t seed = 42)
+      : book(std::make_unique<orderbook>(nullptr)),
+        rng(seed),
+        depth_(p.depth)
+   {
+      if (reserve_books) {
+         // random adds and cancels drift around the mean level size; leave headroom
+         book_capacity_t c;
+         c.orders = p.live_orders + 1;
+         c.min_price = level_price(order_side::BUY, depth_ - 1);
+         c.max_price = level_price(order_side::SELL, depth_ - 1);
+         c.orders_per_level = std::min<size_t>(8192, p.live_orders / depth_ + 64);
+         book->reserve(c);
+      }
+      residents.reserve(p.live_orders + 1);
+      for (size_t i = 0; i < p.live_orders; i++) {
+         order_side side = (i % 2) ? order_side::SELL : order_side::BUY;
+         add_resident(side, level_price(side, (i / 2) % depth_), 10);
+      }
+   }
+
+   uint32_t level_price(order_side side, size_t level) const {
+      return side == order_side::BUY
+         ? MID_PRICE - 1 - static_cast<uint32_t>(level)
+         : MID_PRICE + 1 + static_cast<uint32_t>(level);
+   }
+
+   uint32_t random_price(order_side side) {
+      return level_price(side, rng.below(depth_));
+   }
+
+   order_side random_side() {
+      return (rng.next() & 1) ? order_side::SELL : order_side::BUY;
+   }
+
+   order_t make_order(order_side side, uint32_t price, size_t qty) {
+      char id[ ORDER_ID_LEN ];
+      bench_order_id(id, 'B', next_id_++);
+      return order_t(next_id_, id, "BNCH", order_kind::LMT, side, order_status::NEW, price, qty, false);
+   }
+
+   void add_resident(order_side side, uint32_t price, size_t qty) {
+      order_t o = make_order(side, price, qty);
+      book->add(o);
+      residents.push_back({ bench_key(o), price, side });
+   }
+
+   size_t random_resident() { return rng.below(residents.size()); }
+
+   void drop_resident(size_t i) {
+      residents[ i ] = residents.back();
+      residents.pop_back();
+   }
+
+   std::unique_ptr<orderbook> book;
+   std::vector<resident_t> residents;
+   bench_rng rng;
+
+private:
+   size_t depth_;
+   uint64_t next_id_ = 1;
+};
+
+static volatile uint64_t g_sink = 0;
+
+/*
+   Scenarios
+*/
+static bench_result_t bench_add(const bench_params_t& p) {
+   book_fixture f(p);
+   latency_recorder rec(p.ops);
+
+   // pre-build so ID formatting stays out of the timed region
+   std::vector<order_t> orders;
+   orders.reserve(p.ops);
+   for (size_t i = 0; i < p.ops; i++) {
+      order_side side = f.random_side();
+      orders.push_back(f.make_order(side, f.random_price(side), 10));
+   }
+
+   wall_timer wall;
+   for (size_t i = 0; i < p.ops; i++) {
+      const order_t& o = orders[ i ];
+      uint64_t t = rec.start();
+      f.book->add(o);
+      rec.stop(t);
+
+      // keep the live count constant
+      size_t victim = f.random_resident();
+      f.book->cancel(f.residents[ victim ].key);
+      f.residents[ victim ] = { bench_key(o), o.price, static_cast<order_side>(o.side) };
+   }
+   return { "add", p, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+static bench_result_t bench_cancel(const bench_params_t& p) {
+   book_fixture f(p);
+   latency_recorder rec(p.ops);
+
+   wall_timer wall;
+   for (size_t i = 0; i < p.ops; i++) {
+      size_t victim = f.random_resident();
+      order_id_key key = f.residents[ victim ].key;
+
+      uint64_t t = rec.start();
+      f.book->cancel(key);
+      rec.stop(t);
+
+      f.drop_resident(victim);
+      order_side side = f.random_side();
+      f.add_resident(side, f.random_price(side), 10);
+   }
+   return { "cancel", p, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+static bench_result_t bench_modify(const bench_params_t& p, bool change_price) {
+   book_fixture f(p);
+   latency_recorder rec(p.ops);
+
+   wall_timer wall;
+   for (size_t i = 0; i < p.ops; i++) {
+      resident_t& r = f.residents[ f.random_resident() ];
+      uint32_t price = change_price ? f.random_price(r.side) : r.price;
+
+      order_t o(i, r.key.order_id, "BNCH", order_kind::LMT, r.side, order_status::NEW,
+                price, 5 + f.rng.below(10), false);
+
+      uint64_t t = rec.start();
+      f.book->modify(r.key, o);
+      rec.stop(t);
+
+      r.price = price;
+   }
+   return { change_price ? "modify_price_change" : "modify_same_price",
+            p, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+/*
+   Each op: an aggressive order reaching `sweep` levels into the far side
+   is added (untimed) and execute() is timed. The order is capped at
+   MAX_SWEEP_FILLS resting orders so deep levels don't turn one op into
+   thousands of fills; the touched levels are then refilled (untimed).
+*/
+static constexpr size_t MAX_SWEEP_FILLS = 16;
+
+static bench_result_t bench_execute(const bench_params_t& p) {
+   book_fixture f(p);
+   latency_recorder rec(p.ops);
+
+   size_t sweep = p.depth < 5 ? p.depth : 5;
+
+   std::vector<size_t> target_qty[ 2 ];
+   for (order_side side : { order_side::BUY, order_side::SELL }) {
+      for (size_t l = 0; l < sweep; l++) {
+         target_qty[ static_cast<int>(side) ].push_back(f.book->level_qty(side, f.level_price(side, l)));
+      }
+   }
+
+   wall_timer wall;
+   for (size_t i = 0; i < p.ops; i++) {
+      order_side aggressor = f.random_side();
+      order_side resting = aggressor == order_side::BUY ? order_side::SELL : order_side::BUY;
+
+      size_t qty = 0;
+      for (size_t l = 0; l < sweep; l++) {
+         qty += f.book->level_qty(resting, f.level_price(resting, l));
+      }
+      if (qty > MAX_SWEEP_FILLS * 10) {
+         qty = MAX_SWEEP_FILLS * 10;
+      }
+      f.book->add(f.make_order(aggressor, f.level_price(resting, sweep - 1), qty));
+
+      uint64_t t = rec.start();
+      f.book->execute();
+      rec.stop(t);
+
+      for (size_t l = 0; l < sweep; l++) {
+         uint32_t price = f.level_price(resting, l);
+         size_t target = target_qty[ static_cast<int>(resting) ][ l ];
+         for (size_t have = f.book->level_qty(resting, price); have < target; have += 10) {
+            f.book->add(f.make_order(resting, price, 10));
+         }
+      }
+   }
+   return { "execute_sweep", p, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+/*
+   What-if sweep: the same aggressive order as execute_sweep, but each op
+   forks the book, adds the order to the fork and executes it there, all
+   timed; the book itself never changes, so nothing is refilled. The gap
+   to execute_sweep is the copy-on-write cost of the touched levels.
+*/
+static bench_result_t bench_fork_sweep(const bench_params_t& p) {
+   book_fixture f(p);
+   latency_recorder rec(p.ops);
+
+   size_t sweep = p.depth < 5 ? p.depth : 5;
+
+   wall_timer wall;
+   for (size_t i = 0; i < p.ops; i++) {
+      order_side aggressor = f.random_side();
+      order_side resting = aggressor == order_side::BUY ? order_side::SELL : order_side::BUY;
+
+      size_t qty = 0;
+      for (size_t l = 0; l < sweep; l++) {
+         qty += f.book->level_qty(resting, f.level_price(resting, l));
+      }
+      if (qty > MAX_SWEEP_FILLS * 10) {
+         qty = MAX_SWEEP_FILLS * 10;
+      }
+      order_t o = f.make_order(aggressor, f.level_price(resting, sweep - 1), qty);
+
+      uint64_t t = rec.start();
+      {
+         book_fork what_if = f.book->fork();
+         what_if.add(o);
+         g_sink = g_sink + what_if.execute();
+         rec.stop(t);
+      }
+   }
+   return { "fork_sweep", p, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+static bench_result_t bench_best_prices(const bench_params_t& p) {
+   book_fixture f(p);
+   constexpr uint32_t BATCH = 64;
+   latency_recorder rec(p.ops / BATCH + 1, BATCH);
+
+   wall_timer wall;
+   for (size_t i = 0; i < p.ops / BATCH; i++) {
+      uint64_t acc = 0;
+      uint64_t t = rec.start();
+      for (uint32_t b = 0; b < BATCH; b++) {
+         acc += f.book->best_bid().value_or(0) + f.book->best_ask().value_or(0);
+      }
+      rec.stop(t);
+      g_sink = g_sink + acc;
+   }
+   return { "best_bid_ask", p, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+static bench_result_t bench_contains(const bench_params_t& p, bool hit) {
+   book_fixture f(p);
+   constexpr uint32_t BATCH = 16;
+   latency_recorder rec(p.ops / BATCH + 1, BATCH);
+
+   std::vector<order_id_key> keys(BATCH);
+   wall_timer wall;
+   for (size_t i = 0; i < p.ops / BATCH; i++) {
+      for (uint32_t b = 0; b < BATCH; b++) {
+         if (hit) {
+            keys[ b ] = f.residents[ f.random_resident() ].key;
+         } else {
+            bench_order_id(keys[ b ].order_id, 'M', f.rng.next());
+         }
+      }
+      uint64_t acc = 0;
+      uint64_t t = rec.start();
+      for (uint32_t b = 0; b < BATCH; b++) {
+         acc += f.book->contains(keys[ b ]);
+      }
+      rec.stop(t);
+      g_sink = g_sink + acc;
+   }
+   return { hit ? "contains_hit" : "contains_miss", p, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+/*
+   Adversarial scenarios
+*/
+
+/*
+   Sparse book: one anchor order at each extreme of the ladder. A touch
+   order is added at the far end of the *other* side and cancelled, so
+   every cancel walks update_best_*_on_cancel across ~MAX_PRICE empty
+   levels to find the anchor.
+*/
+static bench_result_t bench_touch_flicker(const bench_params_t& p) {
+   size_t ops = std::min<size_t>(p.ops, 20000);
+   book_fixture f({ 1, 0, ops });
+   f.add_resident(order_side::BUY, 1, 10);
+   f.add_resident(order_side::SELL, MAX_PRICE, 10);
+   latency_recorder rec(ops);
+
+   wall_timer wall;
+   for (size_t i = 0; i < ops; i++) {
+      order_side side = (i & 1) ? order_side::SELL : order_side::BUY;
+      order_t o = f.make_order(side, side == order_side::BUY ? MAX_PRICE - 1 : 2, 10);
+      f.book->add(o);
+
+      uint64_t t = rec.start();
+      f.book->cancel(bench_key(o));
+      rec.stop(t);
+   }
+   return { "touch_flicker_sparse", { 2, 2, ops }, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+/*
+   WIDE_SWEEP_LEVELS levels per side, one order each. Every execute()
+   clears the whole resting side, one fill and one touch move per level;
+   unlike execute_sweep there is no fill cap. The side is refilled untimed.
+*/
+static constexpr size_t WIDE_SWEEP_LEVELS = 1000;
+
+static bench_result_t bench_wide_sweep(const bench_params_t& p) {
+   bench_params_t shape { WIDE_SWEEP_LEVELS, 2 * WIDE_SWEEP_LEVELS, std::min<size_t>(p.ops, 5000) };
+   book_fixture f(shape);
+   latency_recorder rec(shape.ops);
+
+   wall_timer wall;
+   for (size_t i = 0; i < shape.ops; i++) {
+      order_side aggressor = f.random_side();
+      order_side resting = aggressor == order_side::BUY ? order_side::SELL : order_side::BUY;
+      f.book->add(f.make_order(aggressor, f.level_price(resting, WIDE_SWEEP_LEVELS - 1),
+                               WIDE_SWEEP_LEVELS * 10));
+
+      uint64_t t = rec.start();
+      f.book->execute();
+      rec.stop(t);
+
+      for (size_t l = 0; l < WIDE_SWEEP_LEVELS; l++) {
+         f.book->add(f.make_order(resting, f.level_price(resting, l), 10));
+      }
+   }
+   return { "wide_sweep", shape, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+/*
+   One million live orders under random add/cancel churn: hive slots are
+   recycled out of order and the id index stays near its load limit.
+   Adds and cancels are timed individually into the same summary.
+*/
+static constexpr size_t CHURN_LIVE_ORDERS = 1000000;
+
+static bench_result_t bench_churn(const bench_params_t& p) {
+   bench_params_t shape { 1000, CHURN_LIVE_ORDERS, p.ops };
+   book_fixture f(shape);
+   latency_recorder rec(2 * p.ops);
+
+   wall_timer wall;
+   for (size_t i = 0; i < p.ops; i++) {
+      size_t victim = f.random_resident();
+      order_id_key key = f.residents[ victim ].key;
+
+      uint64_t t = rec.start();
+      f.book->cancel(key);
+      rec.stop(t);
+      f.drop_resident(victim);
+
+      order_side side = f.random_side();
+      order_t o = f.make_order(side, f.random_price(side), 10);
+
+      t = rec.start();
+      f.book->add(o);
+      rec.stop(t);
+      f.residents.push_back({ bench_key(o), o.price, side });
+   }
+   return { "churn_1m", shape, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+/*
+   IDs with a 13-byte shared prefix and the counter packed into bytes
+   13..15, the shape of "<desk><account><seq>" client IDs. Times adds
+   into an empty book (including index growth) and then hit lookups, to
+   catch order_id_hasher / index regressions on low-entropy keys.
+*/
+static void shared_prefix_id(char* out, uint64_t n) {
+   std::memcpy(out, "DESK07ACCT42-", 13);
+   out[ 13 ] = static_cast<char>((n >> 16) & 0xff);
+   out[ 14 ] = static_cast<char>((n >> 8) & 0xff);
+   out[ 15 ] = static_cast<char>(n & 0xff);
+}
+
+static bench_result_t bench_shared_prefix(const bench_params_t& p, bool lookup) {
+   size_t n = std::min<size_t>(p.ops, 1ULL << 24);
+   auto book = std::make_unique<orderbook>(nullptr);
+   bench_rng rng(7);
+   latency_recorder rec(n);
+
+   std::vector<order_t> orders;
+   orders.reserve(n);
+   for (size_t i = 0; i < n; i++) {
+      char id[ ORDER_ID_LEN ];
+      shared_prefix_id(id, i);
+      order_side side = (i & 1) ? order_side::SELL : order_side::BUY;
+      uint32_t price = side == order_side::BUY ? MID_PRICE - 1 - static_cast<uint32_t>(i % 100)
+                                               : MID_PRICE + 1 + static_cast<uint32_t>(i % 100);
+      orders.emplace_back(i, id, "BNCH", order_kind::LMT, side, order_status::NEW, price, 10, false);
+   }
+
+   wall_timer wall;
+   if (!lookup) {
+      for (const order_t& o : orders) {
+         uint64_t t = rec.start();
+         book->add(o);
+         rec.stop(t);
+      }
+      return { "id_shared_prefix_add", { 100, n, n }, rec.ops(), wall.seconds(), rec.summarise() };
+   }
+
+   for (const order_t& o : orders) {
+      book->add(o);
+   }
+   wall = wall_timer();
+   uint64_t acc = 0;
+   for (size_t i = 0; i < n; i++) {
+      order_id_key key = bench_key(orders[ rng.below(n) ]);
+      uint64_t t = rec.start();
+      acc += book->contains(key);
+      rec.stop(t);
+   }
+   g_sink = g_sink + acc;
+   return { "id_shared_prefix_contains", { 100, n, n }, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+/*
+   The first min(ops, 5000) calls a brand-new book sees: resting adds
+   around MID_PRICE with every tenth order crossing (add + execute). A
+   64MB buffer is streamed first so the previous case's data is out of
+   the caches; the book's own pages are untouched unless `warm`, which
+   also reserves the traded band.
+*/
+static bench_result_t bench_first_orders(const bench_params_t& p, bool warm) {
+   size_t n = std::min<size_t>(p.ops, 5000);
+   bench_rng rng(11);
+   std::vector<order_t> orders;
+   orders.reserve(n);
+   for (size_t i = 0; i < n; i++) {
+      char id[ ORDER_ID_LEN ];
+      bench_order_id(id, 'F', i + 1);
+      order_side side = (rng.next() & 1) ? order_side::SELL : order_side::BUY;
+      uint32_t offset = 1 + static_cast<uint32_t>(rng.below(50));
+      uint32_t price = i % 10 == 9 ? (side == order_side::BUY ? MID_PRICE + 50 : MID_PRICE - 50)
+                                   : (side == order_side::BUY ? MID_PRICE - offset : MID_PRICE + offset);
+      orders.emplace_back(i, id, "BNCH", order_kind::LMT, side, order_status::NEW, price, 10, false);
+   }
+
+   std::vector<char> evict(64 << 20, 1);
+   for (size_t i = 0; i < evict.size(); i += 64) {
+      evict[ i ] = static_cast<char>(evict[ i ] + 1);
+   }
+   g_sink = g_sink + static_cast<uint64_t>(evict[ evict.size() / 2 ]);
+
+   auto book = std::make_unique<orderbook>(nullptr);
+   if (warm) {
+      warmup_options_t options;
+      options.min_price = MID_PRICE - 100;
+      options.max_price = MID_PRICE + 100;
+      options.expected_orders = n;
+      options.capacity = { n, MID_PRICE - 100, MID_PRICE + 100, 64 };
+      book->warmup(options);
+   }
+
+   latency_recorder rec(n);
+   wall_timer wall;
+   for (size_t i = 0; i < n; i++) {
+      uint64_t t = rec.start();
+      book->add(orders[ i ]);
+      if (i % 10 == 9) {
+         book->execute();
+      }
+      rec.stop(t);
+   }
+   return { warm ? "first_orders_warm" : "first_orders_cold", { 100, 0, n }, rec.ops(), wall.seconds(), rec.summarise() };
+}
+
+/*
+   Driver
+*/
+struct bench_case_t {
+   const char* name;
+   bench_result_t (*run)(const bench_params_t&);
+   bool adversarial = false;
+};
+
+static const bench_case_t BENCH_CASES[] = {
+   { "add",                 bench_add },
+   { "cancel",              bench_cancel },
+   { "modify_same_price",   [](const bench_params_t& p) { return bench_modify(p, false); } },
+   { "modify_price_change", [](const bench_params_t& p) { return bench_modify(p, true); } },
+   { "execute_sweep",       bench_execute },
+   { "fork_sweep",          bench_fork_sweep },
+   { "best_bid_ask",        bench_best_prices },
+   { "contains_hit",        [](const bench_params_t& p) { return bench_contains(p, true); } },
+   { "contains_miss",       [](const bench_params_t& p) { return bench_contains(p, false); } },
+
+   { "touch_flicker_sparse",      bench_touch_flicker, true },
+   { "wide_sweep",                bench_wide_sweep, true },
+   { "churn_1m",                  bench_churn, true },
+   { "id_shared_prefix_add",      [](const bench_params_t& p) { return bench_shared_prefix(p, false); }, true },
+   { "id_shared_prefix_contains", [](const bench_params_t& p) { return bench_shared_prefix(p, true); }, true },
+   { "first_orders_cold",         [](const bench_params_t& p) { return bench_first_orders(p, false); }, true },
+   { "first_orders_warm",         [](const bench_params_t& p) { return bench_first_orders(p, true); }, true },
+};
+
+static double median_of(const std::vector<bench_result_t>& runs, double (*get)(const bench_result_t&)) {
+   std::vector<double> v;
+   for (const bench_result_t& r : runs) {
+      v.push_back(get(r));
+   }
+   return median_ci(v).median;
+}
+
+static double throughput(const bench_result_t& r) {
+   return r.seconds > 0 ? static_cast<double>(r.ops) / r.seconds : 0.0;
+}
+
+/*
+   Where the pool's pages are resident, relative to `home` (the node the
+   benchmark thread runs on): the cross-node placement a sharded engine
+   has to avoid.
+*/
+static void write_numa_placement(json_writer& w, int home) {
+   std::vector<uint64_t> per_node;
+   uint64_t missing = 0;
+   for (const page_mapping_t& m : book_memory::instance().mappings()) {
+      missing += numa_page_nodes(m.base, m.bytes, page_bytes(m.kind), per_node);
+   }
+   uint64_t local = static_cast<size_t>(home) < per_node.size() ? per_node[ static_cast<size_t>(home) ] : 0;
+   uint64_t total = 0;
+   for (uint64_t n : per_node) {
+      total += n;
+   }
+   w.begin_object("numa");
+   w.field("nodes", static_cast<uint64_t>(numa_node_count()));
+   w.field("thread_node", static_cast<int64_t>(home));
+   w.field("book_pages_local", local);
+   w.field("book_pages_remote", total - local);
+   w.field("book_pages_not_resident", missing);
+   w.begin_array("book_pages_per_node");
+   for (uint64_t n : per_node) {
+      w.field(nullptr, n);
+   }
+   w.end_array();
+   w.end_object();
+   std::fprintf(stderr, "numa: thread on node %d of %d; book pages local=%llu remote=%llu not_resident=%llu\n",
+                home, numa_node_count(), static_cast<unsigned long long>(local),
+                static_cast<unsigned long long>(total - local), static_cast<unsigned long long>(missing));
+}
+
+/*
+   The median over repetitions of every figure that is reported, so the
+   JSON and the stderr summary agree; counters and allocations are those
+   of the first run.
+*/
+static bench_result_t median_result(const std::vector<bench_result_t>& runs) {
+   bench_result_t m = runs.front();
+   m.latency.mean_ns = median_of(runs, [](const bench_result_t& r) { return r.latency.mean_ns; });
+   m.latency.p50_ns = median_of(runs, [](const bench_result_t& r) { return r.latency.p50_ns; });
+   m.latency.p99_ns = median_of(runs, [](const bench_result_t& r) { return r.latency.p99_ns; });
+   m.latency.p999_ns = median_of(runs, [](const bench_result_t& r) { return r.latency.p999_ns; });
+   m.latency.p9999_ns = median_of(runs, [](const bench_result_t& r) { return r.latency.p9999_ns; });
+   m.latency.max_ns = median_of(runs, [](const bench_result_t& r) { return r.latency.max_ns; });
+   m.seconds = median_of(runs, [](const bench_result_t& r) { return r.seconds; });
+   m.node_traffic.local_loads = static_cast<uint64_t>(
+      median_of(runs, [](const bench_result_t& r) { return static_cast<double>(r.node_traffic.local_loads); }));
+   m.node_traffic.remote_loads = static_cast<uint64_t>(
+      median_of(runs, [](const bench_result_t& r) { return static_cast<double>(r.node_traffic.remote_loads); }));
+   return m;
+}
+
+static void write_result(json_writer& w, const std::vector<bench_result_t>& runs, bool node_traffic_available) {
+   const bench_result_t& first = runs.front();
+   const bench_result_t median = median_result(runs);
+
+   w.begin_object();
+   w.field("name", first.name);
+   w.field("depth", static_cast<uint64_t>(first.params.depth));
+   w.field("live_orders", static_cast<uint64_t>(first.params.live_orders));
+   w.field("ops", first.ops);
+   w.field("repetitions", static_cast<uint64_t>(runs.size()));
+   w.field("seconds", median.seconds);
+   w.field("throughput_ops_per_sec", median_of(runs, throughput));
+   write_latency(w, median.latency);
+   if (node_traffic_available) {
+      const node_traffic_t& t = median.node_traffic;
+      w.begin_object("node_traffic");
+      w.field("local_loads", t.local_loads);
+      w.field("remote_loads", t.remote_loads);
+      w.field("remote_per_op", first.ops ? static_cast<double>(t.remote_loads) / static_cast<double>(first.ops) : 0.0);
+      w.end_object();
+   }
+
+   w.begin_object("runs");
+   auto series = [&](const char* key, double (*get)(const bench_result_t&)) {
+      w.begin_array(key);
+      for (const bench_result_t& r : runs) {
+         w.field(nullptr, get(r));
+      }
+      w.end_array();
+   };
+   series("throughput_ops_per_sec", throughput);
+   series("p50", [](const bench_result_t& r) { return r.latency.p50_ns; });
+   series("p99", [](const bench_result_t& r) { return r.latency.p99_ns; });
+   series("p99.9", [](const bench_result_t& r) { return r.latency.p999_ns; });
+   series("p99.99", [](const bench_result_t& r) { return r.latency.p9999_ns; });
+   series("max", [](const bench_result_t& r) { return r.latency.max_ns; });
+   w.end_object();
+
+   w.end_object();
+}
+
+int main(int argc, char** argv) {
+   std::vector<size_t> depths = { 1, 10, 100, 1000 };
+   std::vector<size_t> orders = { 1000, 100000 };
+   size_t ops = 200000;
+   std::string filter;
+   std::string out_path;
+   bool perf = false;
+   size_t repeat = 3;
+   book_memory_config_t memory;
+   thread_placement_t placement;
+   int numa_node = NUMA_LOCAL;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[ i ];
+      bool has_value = i + 1 < argc;
+      if (arg == "--depths" && has_value) {
+         depths = parse_size_list(argv[ ++i ]);
+      } else if (arg == "--orders" && has_value) {
+         orders = parse_size_list(argv[ ++i ]);
+      } else if (arg == "--ops" && has_value) {
+         ops = std::strtoull(argv[ ++i ], nullptr, 10);
+      } else if (arg == "--filter" && has_value) {
+         filter = argv[ ++i ];
+      } else if (arg == "--out" && has_value) {
+         out_path = argv[ ++i ];
+      } else if (arg == "--repeat" && has_value) {
+         repeat = std::max<size_t>(1, std::strtoull(argv[ ++i ], nullptr, 10));
+      } else if (arg == "--perf") {
+         perf = true;
+      } else if (arg == "--pages" && has_value && parse_page_kind(argv[ i + 1 ], memory.pages)) {
+         i++;
+      } else if (arg == "--reserve-mb" && has_value) {
+         memory.reserve_bytes = std::strtoull(argv[ ++i ], nullptr, 10) << 20;
+      } else if (arg == "--cpu" && has_value) {
+         placement.cpu = std::atoi(argv[ ++i ]);
+      } else if (arg == "--reserve") {
+         book_fixture::reserve_books = true;
+      } else if (arg == "--numa") {
+         memory.numa = true;
+      } else if (arg == "--numa-node" && has_value) {
+         memory.numa = true;
+         numa_node = std::atoi(argv[ ++i ]);
+      } else {
+         std::fprintf(stderr,
+            "usage: %s [--depths 1,10,100] [--orders 1000,100000] [--ops N] "
+            "[--filter substring] [--out file.json] [--perf] [--repeat N] "
+            "[--pages system|4k|thp|2m|1g] [--reserve-mb N] [--cpu N] [--numa] [--numa-node N] [--reserve]\n", argv[ 0 ]);
+         return 2;
+      }
+   }
+
+   std::FILE* out = out_path.empty() ? stdout : std::fopen(out_path.c_str(), "w");
+   if (!out) {
+      std::fprintf(stderr, "cannot open %s\n", out_path.c_str());
+      return 1;
+   }
+
+   std::unique_ptr<perf_counter_group> counters;
+   if (perf) {
+      counters = std::make_unique<perf_counter_group>();
+      if (counters->available()) {
+         latency_recorder::perf = counters.get();
+      } else {
+         std::fprintf(stderr, "perf counters unavailable (%s); continuing without them\n",
+                      counters->unavailable_reason());
+      }
+   }
+
+   placement_result_t placed = apply_thread_placement(placement, "bench-orderbook");
+   if (!placed.error.empty()) {
+      std::fprintf(stderr, "warning: %s\n", placed.error.c_str());
+   }
+   // every book below (and the reserve) goes to this node; NUMA_LOCAL follows the thread
+   book_memory::node_scope numa_scope(numa_node);
+   book_memory::instance().configure(memory);
+   node_traffic_counters node_traffic;
+
+   json_writer w(out);
+   w.begin_object();
+   w.field("format_version", BENCH_FORMAT_VERSION);
+   w.field("suite", "bench-orderbook");
+   w.field("repetitions", static_cast<uint64_t>(repeat));
+   w.field("ns_per_tick", default_clock().ns_per_tick());
+   w.field("perf_counters", latency_recorder::perf != nullptr);
+   w.field("pages", page_kind_name(memory.pages));
+   w.field("numa_pools", memory.numa);
+   w.field("node_traffic_counters", node_traffic.available());
+   w.begin_array("results");
+
+   auto run_case = [&](const bench_case_t& c, const bench_params_t& params) {
+      std::vector<bench_result_t> runs;
+      for (size_t rep = 0; rep < repeat; rep++) {
+         node_traffic_t before = node_traffic.read();
+         runs.push_back(c.run(params));
+         node_traffic_t after = node_traffic.read();
+         runs.back().node_traffic = { after.local_loads - before.local_loads, after.remote_loads - before.remote_loads };
+      }
+      const bench_result_t r = median_result(runs);
+      std::fprintf(stderr, "%-26s depth=%-6zu live=%-8zu %.2f Mops/s p50=%.0fns p99=%.0fns p99.99=%.0fns max=%.0fns "
+                   "allocs/op=%.4f\n",
+                   c.name, r.params.depth, r.params.live_orders,
+                   median_of(runs, throughput) / 1e6, r.latency.p50_ns, r.latency.p99_ns,
+                   r.latency.p9999_ns, r.latency.max_ns,
+                   r.latency.ops ? static_cast<double>(r.latency.allocations) / static_cast<double>(r.latency.ops) : 0.0);
+      if (r.latency.has_counters) {
+         std::fprintf(stderr, "%-26s per op: cycles=%.0f instructions=%.0f branch_misses=%.2f "
+                      "l1d_misses=%.2f llc_misses=%.2f dtlb_misses=%.2f\n", "",
+                      r.latency.counters.per_op(0), r.latency.counters.per_op(1),
+                      r.latency.counters.per_op(2), r.latency.counters.per_op(3),
+                      r.latency.counters.per_op(4), r.latency.counters.per_op(5));
+      }
+      if (node_traffic.available()) {
+         std::fprintf(stderr, "%-26s node loads: local=%llu remote=%llu\n", "",
+                      static_cast<unsigned long long>(r.node_traffic.local_loads),
+                      static_cast<unsigned long long>(r.node_traffic.remote_loads));
+      }
+      write_result(w, runs, node_traffic.available());
+   };
+
+   for (const bench_case_t& c : BENCH_CASES) {
+      if (!filter.empty() && std::string(c.name).find(filter) == std::string::npos) {
+         continue;
+      }
+      if (c.adversarial) {
+         run_case(c, { 0, 0, ops });
+         continue;
+      }
+      for (size_t depth : depths) {
+         for (size_t live : orders) {
+            if (depth == 0 || depth >= MID_PRICE || live < 2 * depth) {
+               continue;
+            }
+            run_case(c, { depth, live, ops });
+         }
+      }
+   }
+
+   w.end_array();
+   w.field("pages_obtained", page_kind_name(book_memory::instance().config().pages == page_kind::SYSTEM
+                                            ? page_kind::SYSTEM : book_memory::instance().stats().backing));
+   if (memory.numa) {
+      write_numa_placement(w, current_numa_node());
+   }
+   w.end_object();
+   w.finish();
+
+   if (out != stdout) {
+      std::fclose(out);
+   }
+   return 0;
+}
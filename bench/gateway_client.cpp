@@ -0,0 +1,247 @@
+/*
+   gateway-client: load generator and round-trip latency probe for gateway.
+
+   usage: gateway-client [--host 127.0.0.1] [--port 9100] [--orders N]
+                         [--window W] [--repeat 3] [--out file.json]
+
+   Sends N Enter Order messages, alternating buy and sell at one price so
+   every second order trades, keeping at most W unacknowledged at a time
+   (W=1 measures pure round trips). Round trip is TSC time from send()
+   to the Accepted/Rejected for that token. Executions are counted.
+   The pass is repeated R times on one session with fresh tokens; output
+   uses the bench-orderbook JSON layout (medians plus per-run "runs"), so
+   bench-compare can judge it.
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "../src/ouch.h"
+
+struct pass_result_t {
+   size_t orders = 0;
+   double seconds = 0;
+   latency_summary_t latency;
+   uint64_t rejected = 0;
+   uint64_t executions = 0;
+
+   double throughput() const { return seconds > 0 ? static_cast<double>(orders) / seconds : 0.0; }
+};
+
+int main(int argc, char** argv) {
+   std::string host = "127.0.0.1";
+   uint16_t port = 9100;
+   size_t orders = 100000;
+   size_t window = 1;
+   size_t repeat = 3;
+   std::string out_path;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[ i ];
+      bool has_value = i + 1 < argc;
+      if (arg == "--host" && has_value) {
+         host = argv[ ++i ];
+      } else if (arg == "--port" && has_value) {
+         port = static_cast<uint16_t>(std::strtoul(argv[ ++i ], nullptr, 10));
+      } else if (arg == "--orders" && has_value) {
+         orders = std::strtoull(argv[ ++i ], nullptr, 10);
+      } else if (arg == "--window" && has_value) {
+         window = std::max<size_t>(1, std::strtoull(argv[ ++i ], nullptr, 10));
+      } else if (arg == "--repeat" && has_value) {
+         repeat = std::max<size_t>(1, std::strtoull(argv[ ++i ], nullptr, 10));
+      } else if (arg == "--out" && has_value) {
+         out_path = argv[ ++i ];
+      } else {
+         std::fprintf(stderr,
+            "usage: %s [--host addr] [--port N] [--orders N] [--window W] [--repeat N] [--out file.json]\n", argv[ 0 ]);
+         return 2;
+      }
+   }
+
+   int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+   sockaddr_in addr;
+   std::memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons(port);
+   if (fd < 0 || ::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+       ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+      std::fprintf(stderr, "cannot connect to %s:%u: %s\n", host.c_str(), static_cast<unsigned>(port), std::strerror(errno));
+      return 1;
+   }
+   int one = 1;
+   ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+   char rx[ 1 << 16 ];
+   size_t rx_len = 0;
+
+   // one pass of `orders` orders with tokens base+1..base+orders; false if the session broke
+   auto run_pass = [&](uint64_t base, pass_result_t& r) {
+      std::vector<uint64_t> sent_at(orders + 1, 0);
+      std::vector<uint64_t> rtt;
+      rtt.reserve(orders);
+      size_t next = 1, acked = 0;
+      r.orders = orders;
+
+      wall_timer wall;
+      while (acked < orders) {
+         while (next <= orders && next - 1 - acked < window) {
+            auto m = ouch::make<ouch::enter_order_t>(ouch::ENTER_ORDER);
+            m.token = base + next;
+            m.side = (next & 1) ? ouch::SIDE_BUY : ouch::SIDE_SELL;
+            m.qty = 10;
+            std::memcpy(m.ticker, "GWAY", TICKER_LEN);
+            m.price = 100;
+
+            sent_at[ next ] = tsc_clock::read_ticks();
+            if (::send(fd, &m, sizeof(m), 0) != static_cast<ssize_t>(sizeof(m))) {
+               std::fprintf(stderr, "send failed: %s\n", std::strerror(errno));
+               return false;
+            }
+            next++;
+         }
+
+         ssize_t got = ::recv(fd, rx + rx_len, sizeof(rx) - rx_len, 0);
+         if (got <= 0) {
+            std::fprintf(stderr, "gateway closed the session\n");
+            return false;
+         }
+         uint64_t now = tsc_clock::read_ticks();
+         rx_len += static_cast<size_t>(got);
+
+         size_t off = 0;
+         while (rx_len - off >= sizeof(ouch::msg_header_t)) {
+            ouch::msg_header_t h;
+            std::memcpy(&h, rx + off, sizeof(h));
+            if (h.length < sizeof(h) || rx_len - off < h.length) {
+               break;
+            }
+            uint64_t token;
+            std::memcpy(&token, rx + off + sizeof(h), sizeof(token));
+            if (h.type == ouch::ACCEPTED || h.type == ouch::REJECTED) {
+               if (token > base && token <= base + orders && sent_at[ token - base ]) {
+                  rtt.push_back(now - sent_at[ token - base ]);
+                  sent_at[ token - base ] = 0;
+                  acked++;
+               }
+               r.rejected += h.type == ouch::REJECTED;
+            } else if (h.type == ouch::EXECUTED) {
+               r.executions++;
+            }
+            off += h.length;
+         }
+         std::memmove(rx, rx + off, rx_len - off);
+         rx_len -= off;
+      }
+      r.seconds = wall.seconds();
+
+      std::vector<double> ns;
+      double scale = default_clock().ns_per_tick();
+      for (uint64_t t : rtt) {
+         ns.push_back(static_cast<double>(t) * scale);
+      }
+      std::sort(ns.begin(), ns.end());
+      auto pct = [&](double q) { return ns[ static_cast<size_t>(q * static_cast<double>(ns.size() - 1) + 0.5) ]; };
+      double total = 0;
+      for (double v : ns) {
+         total += v;
+      }
+      latency_summary_t& lat = r.latency;
+      lat.samples = ns.size();
+      lat.mean_ns = ns.empty() ? 0 : total / static_cast<double>(ns.size());
+      if (!ns.empty()) {
+         lat.p50_ns = pct(0.50);
+         lat.p99_ns = pct(0.99);
+         lat.p999_ns = pct(0.999);
+         lat.p9999_ns = pct(0.9999);
+         lat.max_ns = ns.back();
+      }
+
+      std::fprintf(stderr, "orders=%zu window=%zu rejected=%llu executions=%llu %.0f orders/s "
+                   "rtt p50=%.0fns p99=%.0fns p99.9=%.0fns max=%.0fns\n",
+                   orders, window, static_cast<unsigned long long>(r.rejected),
+                   static_cast<unsigned long long>(r.executions), r.throughput(),
+                   lat.p50_ns, lat.p99_ns, lat.p999_ns, lat.max_ns);
+      return true;
+   };
+
+   std::vector<pass_result_t> runs(repeat);
+   for (size_t rep = 0; rep < repeat; rep++) {
+      if (!run_pass(rep * orders, runs[ rep ])) {
+         return 1;
+      }
+   }
+   ::close(fd);
+
+   auto median_of = [&](double (*get)(const pass_result_t&)) {
+      std::vector<double> v;
+      for (const pass_result_t& r : runs) {
+         v.push_back(get(r));
+      }
+      return median_ci(v).median;
+   };
+   latency_summary_t lat = runs.front().latency;
+   lat.mean_ns = median_of([](const pass_result_t& r) { return r.latency.mean_ns; });
+   lat.p50_ns = median_of([](const pass_result_t& r) { return r.latency.p50_ns; });
+   lat.p99_ns = median_of([](const pass_result_t& r) { return r.latency.p99_ns; });
+   lat.p999_ns = median_of([](const pass_result_t& r) { return r.latency.p999_ns; });
+   lat.p9999_ns = median_of([](const pass_result_t& r) { return r.latency.p9999_ns; });
+   lat.max_ns = median_of([](const pass_result_t& r) { return r.latency.max_ns; });
+   uint64_t executions = 0;
+   for (const pass_result_t& r : runs) {
+      executions += r.executions;
+   }
+
+   std::FILE* out = out_path.empty() ? stdout : std::fopen(out_path.c_str(), "w");
+   if (!out) {
+      std::fprintf(stderr, "cannot open %s\n", out_path.c_str());
+      return 1;
+   }
+   json_writer w(out);
+   w.begin_object();
+   w.field("format_version", BENCH_FORMAT_VERSION);
+   w.field("suite", "gateway-client");
+   w.field("repetitions", static_cast<uint64_t>(repeat));
+   w.field("ns_per_tick", default_clock().ns_per_tick());
+   w.begin_array("results");
+   w.begin_object();
+   w.field("name", "round_trip");
+   w.field("depth", static_cast<uint64_t>(window));
+   w.field("live_orders", static_cast<uint64_t>(0));
+   w.field("ops", static_cast<uint64_t>(orders));
+   w.field("repetitions", static_cast<uint64_t>(repeat));
+   w.field("seconds", median_of([](const pass_result_t& r) { return r.seconds; }));
+   w.field("throughput_ops_per_sec", median_of([](const pass_result_t& r) { return r.throughput(); }));
+   w.field("executions", executions);
+   write_latency(w, lat);
+   w.begin_object("runs");
+   auto series = [&](const char* key, double (*get)(const pass_result_t&)) {
+      w.begin_array(key);
+      for (const pass_result_t& r : runs) {
+         w.field(nullptr, get(r));
+      }
+      w.end_array();
+   };
+   series("throughput_ops_per_sec", [](const pass_result_t& r) { return r.throughput(); });
+   series("p50", [](const pass_result_t& r) { return r.latency.p50_ns; });
+   series("p99", [](const pass_result_t& r) { return r.latency.p99_ns; });
+   series("p99.9", [](const pass_result_t& r) { return r.latency.p999_ns; });
+   series("p99.99", [](const pass_result_t& r) { return r.latency.p9999_ns; });
+   series("max", [](const pass_result_t& r) { return r.latency.max_ns; });
+   w.end_object();
+   w.end_object();
+   w.end_array();
+   w.end_object();
+   w.finish();
+   if (out != stdout) {
+      std::fclose(out);
+   }
+   return 0;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+   Minimal JSON reader for loading benchmark results back in (the
+   counterpart of json_writer). No \u escapes beyond pass-through, no
+   streaming; result files are small.
+*/
+struct json_value {
+   enum class type_t { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+   type_t type = type_t::NUL;
+   bool boolean = false;
+   double number = 0;
+   std::string string;
+   std::vector<json_value> items;
+   std::vector<std::pair<std::string, json_value>> members;
+
+   const json_value* find(const char* key) const {
+      for (const auto& m : members) {
+         if (m.first == key) {
+            return &m.second;
+         }
+      }
+      return nullptr;
+   }
+
+   double number_or(const char* key, double fallback) const {
+      const json_value* v = find(key);
+      return v && v->type == type_t::NUMBER ? v->number : fallback;
+   }
+
+   std::string string_or(const char* key, const std::string& fallback) const {
+      const json_value* v = find(key);
+      return v && v->type == type_t::STRING ? v->string : fallback;
+   }
+};
+
+class json_reader {
+public:
+   explicit json_reader(const std::string& text) : s_(text) {}
+
+   bool parse(json_value& out) {
+      pos_ = 0;
+      if (!value(out)) {
+         return false;
+      }
+      skip_ws();
+      return pos_ == s_.size();
+   }
+
+   size_t error_offset() const { return pos_; }
+
+private:
+   const std::string& s_;
+   size_t pos_ = 0;
+
+   void skip_ws() {
+      while (pos_ < s_.size() && (s_[ pos_ ] == ' ' || s_[ pos_ ] == '\n' || s_[ pos_ ] == '\r' || s_[ pos_ ] == '\t')) {
+         pos_++;
+      }
+   }
+
+   bool literal(const char* lit) {
+      size_t n = std::char_traits<char>::length(lit);
+      if (s_.compare(pos_, n, lit) != 0) {
+         return false;
+      }
+      pos_ += n;
+      return true;
+   }
+
+   bool string(std::string& out) {
+      if (pos_ >= s_.size() || s_[ pos_ ] != '"') {
+         return false;
+      }
+      pos_++;
+      while (pos_ < s_.size() && s_[ pos_ ] != '"') {
+         if (s_[ pos_ ] == '\\' && pos_ + 1 < s_.size()) {
+            pos_++;
+            char c = s_[ pos_ ];
+            out.push_back(c == 'n' ? '\n' : c == 't' ? '\t' : c);
+         } else {
+            out.push_back(s_[ pos_ ]);
+         }
+         pos_++;
+      }
+      if (pos_ >= s_.size()) {
+         return false;
+      }
+      pos_++;
+      return true;
+   }
+
+   bool value(json_value& out) {
+      skip_ws();
+      if (pos_ >= s_.size()) {
+         return false;
+      }
+      char c = s_[ pos_ ];
+      if (c == '{') {
+         out.type = json_value::type_t::OBJECT;
+         pos_++;
+         skip_ws();
+         if (pos_ < s_.size() && s_[ pos_ ] == '}') {
+            pos_++;
+            return true;
+         }
+         for (;;) {
+            skip_ws();
+            std::pair<std::string, json_value> m;
+            if (!string(m.first)) {
+               return false;
+            }
+            skip_ws();
+            if (pos_ >= s_.size() || s_[ pos_ ] != ':') {
+               return false;
+            }
+            pos_++;
+            if (!value(m.second)) {
+               return false;
+            }
+            out.members.push_back(std::move(m));
+            skip_ws();
+            if (pos_ < s_.size() && s_[ pos_ ] == ',') {
+               pos_++;
+               continue;
+            }
+            if (pos_ < s_.size() && s_[ pos_ ] == '}') {
+               pos_++;
+               return true;
+            }
+            return false;
+         }
+      }
+      if (c == '[') {
+         out.type = json_value::type_t::ARRAY;
+         pos_++;
+         skip_ws();
+         if (pos_ < s_.size() && s_[ pos_ ] == ']') {
+            pos_++;
+            return true;
+         }
+         for (;;) {
+            json_value item;
+            if (!value(item)) {
+               return false;
+            }
+            out.items.push_back(std::move(item));
+            skip_ws();
+            if (pos_ < s_.size() && s_[ pos_ ] == ',') {
+               pos_++;
+               continue;
+            }
+            if (pos_ < s_.size() && s_[ pos_ ] == ']') {
+               pos_++;
+               return true;
+            }
+            return false;
+         }
+      }
+      if (c == '"') {
+         out.type = json_value::type_t::STRING;
+         return string(out.string);
+      }
+      if (literal("true")) {
+         out.type = json_value::type_t::BOOL;
+         out.boolean = true;
+         return true;
+      }
+      if (literal("false")) {
+         out.type = json_value::type_t::BOOL;
+         return true;
+      }
+      if (literal("null")) {
+         return true;
+      }
+      const char* start = s_.c_str() + pos_;
+      char* end = nullptr;
+      out.number = std::strtod(start, &end);
+      if (end == start) {
+         return false;
+      }
+      out.type = json_value::type_t::NUMBER;
+      pos_ += static_cast<size_t>(end - start);
+      return true;
+   }
+};
+
+static inline bool load_json_file(const std::string& path, json_value& out, std::string& error) {
+   std::ifstream in(path);
+   if (!in) {
+      error = "cannot open " + path;
+      return false;
+   }
+   std::stringstream ss;
+   ss << in.rdbuf();
+   std::string text = ss.str();
+   json_reader reader(text);
+   if (!reader.parse(out)) {
+      error = path + ": parse error near offset " + std::to_string(reader.error_offset());
+      return false;
+   }
+   return true;
+}
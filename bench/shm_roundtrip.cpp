@@ -0,0 +1,152 @@
+/*
+   bench-shm: round-trip latency of the shared-memory order-entry path.
+
+   usage: bench-shm [--orders N] [--window W] [--name /segment] [--yield]
+                    [--out file.json]
+
+   Starts an shm_engine on its own thread and a client that maps the
+   segment separately, so the two sides share only the /dev/shm pages
+   exactly as a co-located process would. The client sends N orders,
+   alternating buy and sell at one price so every second order trades,
+   keeping at most W unacknowledged (W=1 measures pure round trips).
+   Round trip is TSC time from the ring push to popping the Accepted /
+   Rejected for that token. Both threads spin, so results are only
+   meaningful with two otherwise idle cores; --yield (the default on a
+   single-CPU host) makes both sides yield when idle, which keeps the run
+   finishing but measures the scheduler instead. Output uses the
+   bench-orderbook JSON layout, so bench-compare works.
+*/
+
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "../src/shm_transport.h"
+
+int main(int argc, char** argv) {
+   std::string name = "/orderbook-bench-shm";
+   size_t orders = 1000000;
+   size_t window = 1;
+   bool yield = std::thread::hardware_concurrency() < 2;
+   std::string out_path;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[ i ];
+      bool has_value = i + 1 < argc;
+      if (arg == "--orders" && has_value) {
+         orders = std::strtoull(argv[ ++i ], nullptr, 10);
+      } else if (arg == "--window" && has_value) {
+         window = std::clamp<size_t>(std::strtoull(argv[ ++i ], nullptr, 10), 1, shm::RING_SLOTS / 2);
+      } else if (arg == "--name" && has_value) {
+         name = argv[ ++i ];
+      } else if (arg == "--yield") {
+         yield = true;
+      } else if (arg == "--out" && has_value) {
+         out_path = argv[ ++i ];
+      } else {
+         std::fprintf(stderr, "usage: %s [--orders N] [--window W] [--name /segment] [--yield] [--out file.json]\n", argv[ 0 ]);
+         return 2;
+      }
+   }
+
+   shm_engine_config_t config;
+   config.name = name;
+   config.max_clients = 1;
+   config.idle = yield ? idle_strategy::YIELD : idle_strategy::BUSY_POLL;
+   std::unique_ptr<shm_engine> engine;
+   try {
+      engine = std::make_unique<shm_engine>(config);
+   } catch (const std::exception& e) {
+      std::fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+
+   std::atomic<bool> stop{false};
+   std::thread engine_thread([&] { engine->run(stop); });
+
+   shm_client client(name);
+
+   std::vector<uint64_t> sent_at(orders + 1, 0);
+   latency_recorder rtt(orders);
+   size_t next = 1, acked = 0;
+   uint64_t rejected = 0, executions = 0;
+
+   char id[ ORDER_ID_LEN ] = {};
+   order_t o(0, id, "SHMB", order_kind::LMT, order_side::BUY, order_status::NEW, 100, 10, false);
+
+   wall_timer wall;
+   while (acked < orders) {
+      while (next <= orders && next - 1 - acked < window) {
+         o.side = static_cast<uint8_t>((next & 1) ? order_side::BUY : order_side::SELL);
+         sent_at[ next ] = rtt.start();
+         if (!client.enter(next, o)) {
+            break;
+         }
+         next++;
+      }
+
+      shm::report_t r;
+      if (!client.poll(r)) {
+         if (yield) {
+            std::this_thread::yield();
+         }
+         continue;
+      }
+      do {
+         if (r.type == shm::ACCEPTED || r.type == shm::REJECTED) {
+            if (r.token >= 1 && r.token <= orders && sent_at[ r.token ]) {
+               rtt.stop(sent_at[ r.token ]);
+               sent_at[ r.token ] = 0;
+               acked++;
+            }
+            rejected += r.type == shm::REJECTED;
+         } else if (r.type == shm::EXECUTED) {
+            executions++;
+         }
+      } while (client.poll(r));
+   }
+   double seconds = wall.seconds();
+
+   stop.store(true, std::memory_order_relaxed);
+   engine_thread.join();
+
+   latency_summary_t lat = rtt.summarise();
+   std::fprintf(stderr, "orders=%zu window=%zu rejected=%llu executions=%llu dropped=%llu %.0f orders/s "
+                "rtt p50=%.0fns p99=%.0fns p99.9=%.0fns max=%.0fns\n",
+                orders, window, static_cast<unsigned long long>(rejected),
+                static_cast<unsigned long long>(executions),
+                static_cast<unsigned long long>(engine->stats().reports_dropped),
+                static_cast<double>(orders) / seconds,
+                lat.p50_ns, lat.p99_ns, lat.p999_ns, lat.max_ns);
+
+   std::FILE* out = out_path.empty() ? stdout : std::fopen(out_path.c_str(), "w");
+   if (!out) {
+      std::fprintf(stderr, "cannot open %s\n", out_path.c_str());
+      return 1;
+   }
+   json_writer w(out);
+   w.begin_object();
+   w.field("format_version", BENCH_FORMAT_VERSION);
+   w.field("suite", "bench-shm");
+   w.field("ns_per_tick", default_clock().ns_per_tick());
+   w.begin_array("results");
+   w.begin_object();
+   w.field("name", "shm_round_trip");
+   w.field("depth", static_cast<uint64_t>(window));
+   w.field("live_orders", static_cast<uint64_t>(0));
+   w.field("ops", static_cast<uint64_t>(orders));
+   w.field("repetitions", static_cast<uint64_t>(1));
+   w.field("seconds", seconds);
+   w.field("throughput_ops_per_sec", static_cast<double>(orders) / seconds);
+   w.field("executions", executions);
+   w.field("yield", yield);
+   write_latency(w, lat);
+   w.end_object();
+   w.end_array();
+   w.end_object();
+   w.finish();
+   if (out != stdout) {
+      std::fclose(out);
+   }
+   return 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+   Per-thread allocation counters, for proving that the matching path
+   does not allocate once a book is reserved (orderbook::reserve()).
+
+   Two sources feed them:
+     heap  malloc, calloc, realloc and the aligned variants, which also
+           covers operator new and moodycamel's blocks. Counted only in
+           binaries that link the alloc_hooks object library, which
+           interposes the malloc family; hooks_installed() says whether
+           that happened.
+     pool  blocks handed out by a pooled book_memory (never malloc).
+           Always counted.
+
+   The counters are plain thread_locals with constant initialisation, so
+   the hooks can touch them from inside malloc without recursing.
+*/
+
+struct alloc_counts_t {
+   uint64_t heap_allocations = 0;
+   uint64_t heap_frees = 0;
+   uint64_t heap_bytes = 0;
+   uint64_t pool_allocations = 0;
+
+   uint64_t allocations() const { return heap_allocations + pool_allocations; }
+};
+
+namespace alloc_tracker {
+   inline constinit thread_local alloc_counts_t counts {};
+   inline std::atomic<bool> installed { false };
+
+   static inline bool hooks_installed() { return installed.load(std::memory_order_relaxed); }
+
+   // called by a reserved book that allocated inside add/modify/cancel/reduce/execute
+   using violation_handler = void (*)(const char* op, uint64_t allocations);
+
+   static inline void abort_on_violation(const char* op, uint64_t allocations) {
+      std::fprintf(stderr, "orderbook: %s made %llu allocation(s) on a reserved book\n",
+                   op, static_cast<unsigned long long>(allocations));
+      std::abort();
+   }
+
+   inline std::atomic<violation_handler> on_violation { abort_on_violation };
+}
+
+// Allocations made by the calling thread since construction.
+class alloc_scope {
+public:
+   alloc_scope() : start_(alloc_tracker::counts) {}
+
+   uint64_t allocations() const { return alloc_tracker::counts.allocations() - start_.allocations(); }
+   uint64_t heap_allocations() const { return alloc_tracker::counts.heap_allocations - start_.heap_allocations; }
+   uint64_t pool_allocations() const { return alloc_tracker::counts.pool_allocations - start_.pool_allocations; }
+
+private:
+   alloc_counts_t start_;
+};
@@ -0,0 +1,658 @@
+#pragma once
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "./alloc_tracker.h"
+#include "./numa.h"
+#include "./types.h"
+
+#ifndef MAP_HUGE_SHIFT
+   #define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+   #define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+   #define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+/*
+   Process-wide allocator for book memory: the orderbook object (its two
+   price ladders), the order hives and the robin_hood id index.
+
+   With the default page_kind::SYSTEM every call goes straight to
+   malloc. Any other kind turns it into a pool over anonymous mappings
+   of that page size: blocks are carved from the current mapping and
+   recycled through per-size-class free lists (four classes per power of
+   two, so at most 25% rounding), and mappings are never returned. Each
+   thread keeps a small cache of free blocks in front of its pool, so
+   shards allocate and free without a lock in the steady state; the pool
+   lock is only taken to refill or drain a cache. Freeing anything that
+   is not a live block (a double free, a foreign pointer) aborts. Huge
+   pages fall back transparently 1GB -> 2MB -> THP -> 4K when the kernel
+   has none to give; stats() says what was actually used.
+
+   configure() maps and pre-faults reserve_bytes up front, so a book
+   whose memory fits in the reserve never takes a page fault on the
+   matching thread. Mappings made later (stats().late_chunks) are
+   faulted in by whichever thread needed them. Call configure() before
+   creating books; blocks allocated under an earlier setting are still
+   freed correctly.
+
+   With config.numa there is one pool per NUMA node, each with its own
+   lock, and every mapping prefers its node's memory. An allocation goes
+   to the node named by the innermost node_scope on the calling thread,
+   otherwise to the node the thread was on at its first pooled
+   allocation, so a book built and driven by a pinned shard thread stays
+   on that thread's socket without any extra plumbing. configure()
+   reserves on the calling thread's node; pin first.
+*/
+
+struct page_mapping_t {
+   void* base = nullptr;
+   size_t bytes = 0;
+   page_kind kind = page_kind::SYSTEM;
+   bool locked = false;
+   int node = NUMA_LOCAL;                   // preferred node, NUMA_LOCAL when unbound
+};
+
+struct book_memory_stats_t {
+   page_kind requested = page_kind::SYSTEM;
+   page_kind backing = page_kind::SYSTEM;   // page size of the most recent mapping
+   uint64_t mapped_bytes = 0;
+   uint64_t chunks = 0;
+   uint64_t late_chunks = 0;                // mapped after configure()
+   uint64_t fallbacks = 0;                  // mappings that got smaller pages than requested
+   uint64_t lock_failures = 0;
+   uint64_t in_use_bytes = 0;               // pooled blocks currently handed out
+   uint64_t peak_bytes = 0;                 // carved from mappings so far: the pools' high-water mark
+   uint64_t allocations = 0;                // pooled
+   uint64_t system_allocations = 0;         // via malloc
+   uint64_t numa_bind_failures = 0;         // mappings left on the default policy
+   std::array<uint64_t, MAX_NUMA_NODES> node_mapped_bytes {};
+};
+
+static inline const char* page_kind_name(page_kind k) {
+   switch (k) {
+      case page_kind::SYSTEM:      return "system";
+      case page_kind::SMALL:       return "4k";
+      case page_kind::TRANSPARENT: return "thp";
+      case page_kind::HUGE_2M:     return "2m";
+      case page_kind::HUGE_1G:     return "1g";
+   }
+   return "?";
+}
+
+static inline bool parse_page_kind(const std::string& s, page_kind& out) {
+   for (page_kind k : { page_kind::SYSTEM, page_kind::SMALL, page_kind::TRANSPARENT,
+                        page_kind::HUGE_2M, page_kind::HUGE_1G }) {
+      if (s == page_kind_name(k)) {
+         out = k;
+         return true;
+      }
+   }
+   return false;
+}
+
+static inline size_t page_bytes(page_kind k) {
+   switch (k) {
+      case page_kind::HUGE_1G:     return 1ULL << 30;
+      case page_kind::HUGE_2M:
+      case page_kind::TRANSPARENT: return 1ULL << 21;
+      default:                     return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+   }
+}
+
+namespace book_memory_detail {
+   static inline size_t round_up(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+   static inline void touch_pages(void* base, size_t bytes) {
+      volatile char* p = static_cast<volatile char*>(base);
+      size_t step = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+      for (size_t off = 0; off < bytes; off += step) {
+         p[ off ] = 0;
+      }
+   }
+
+   static inline page_mapping_t try_map(size_t bytes, page_kind kind, bool prefault) {
+      page_mapping_t m;
+      m.kind = kind;
+      m.bytes = round_up(bytes, page_bytes(kind));
+      int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+      if (kind == page_kind::HUGE_1G || kind == page_kind::HUGE_2M) {
+         flags |= MAP_HUGETLB | (kind == page_kind::HUGE_1G ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+         // hugetlb pages are reserved at mmap time; populate so none is missing later
+         void* p = ::mmap(nullptr, m.bytes, PROT_READ | PROT_WRITE, flags | MAP_POPULATE, -1, 0);
+         m.base = p == MAP_FAILED ? nullptr : p;
+         return m;
+      }
+
+      if (kind == page_kind::TRANSPARENT) {
+         // over-map so the block can start on a 2MB boundary, then trim
+         size_t align = page_bytes(kind);
+         void* p = ::mmap(nullptr, m.bytes + align, PROT_READ | PROT_WRITE, flags, -1, 0);
+         if (p == MAP_FAILED) {
+            return m;
+         }
+         uintptr_t start = round_up(reinterpret_cast<uintptr_t>(p), align);
+         size_t head = start - reinterpret_cast<uintptr_t>(p);
+         if (head) {
+            ::munmap(p, head);
+         }
+         if (align - head) {
+            ::munmap(reinterpret_cast<char*>(start) + m.bytes, align - head);
+         }
+         m.base = reinterpret_cast<void*>(start);
+         ::madvise(m.base, m.bytes, MADV_HUGEPAGE);
+         if (prefault) {
+            touch_pages(m.base, m.bytes);
+         }
+         return m;
+      }
+
+      void* p = ::mmap(nullptr, m.bytes, PROT_READ | PROT_WRITE, flags | (prefault ? MAP_POPULATE : 0), -1, 0);
+      m.base = p == MAP_FAILED ? nullptr : p;
+      return m;
+   }
+}
+
+/*
+   Maps at least `bytes` of anonymous memory with the largest page kind
+   available, starting at `want`. Returns base == nullptr only when even
+   4K pages cannot be mapped. With a `node`, pages are faulted in under a
+   preferred-node policy and the range keeps that policy for later faults.
+*/
+static inline page_mapping_t map_book_pages(size_t bytes, page_kind want, bool prefault, bool lock,
+                                            int node = NUMA_LOCAL) {
+   numa_policy_scope policy(node);
+   static constexpr page_kind order[] = { page_kind::HUGE_1G, page_kind::HUGE_2M,
+                                          page_kind::TRANSPARENT, page_kind::SMALL };
+   page_mapping_t m;
+   bool started = false;
+   for (page_kind k : order) {
+      started |= k == want || want == page_kind::SYSTEM;
+      if (!started) {
+         continue;
+      }
+      m = book_memory_detail::try_map(bytes, k, prefault);
+      if (m.base) {
+         break;
+      }
+   }
+   if (m.base && node >= 0 && numa_bind(m.base, m.bytes, node)) {
+      m.node = node;
+   }
+   if (m.base && lock) {
+      m.locked = ::mlock(m.base, m.bytes) == 0;
+   }
+   return m;
+}
+
+namespace book_memory_detail {
+   // 64 bytes, then four classes per power of two: 80, 96, 112, 128, 160, ...
+   constexpr uint32_t class_of(size_t n) {
+      if (n <= 64) {
+         return 0;
+      }
+      size_t e = 63 - static_cast<size_t>(__builtin_clzll(n - 1));
+      size_t sub = (n - 1 - (size_t{1} << e)) >> (e - 2);
+      return static_cast<uint32_t>(1 + (e - 6) * 4 + sub);
+   }
+
+   constexpr size_t class_bytes(size_t cls) {
+      if (cls == 0) {
+         return 64;
+      }
+      size_t e = 6 + (cls - 1) / 4;
+      size_t sub = (cls - 1) % 4;
+      return (size_t{1} << e) + (sub + 1) * (size_t{1} << (e - 2));
+   }
+
+   constexpr uint32_t CLASSES = 256;
+   // classes up to 64KB are cached per thread; larger blocks always go to their pool
+   constexpr uint32_t CACHED_CLASSES = class_of(size_t{64} << 10) + 1;
+   constexpr uint32_t NO_ARENA = 0xFFFFFFFFu;
+
+   /*
+      Free blocks a thread keeps for its home arena (the node it runs on,
+      or arena 0), so a shard thread allocates and frees without taking
+      any lock until a class runs dry or overflows. The counters are
+      written by the owning thread only and summed by stats().
+   */
+   struct thread_cache_t {
+      uint32_t arena = NO_ARENA;     // NO_ARENA until registered, and again once retired
+      bool registered = false;
+      std::array<void*, CACHED_CLASSES> free {};
+      std::array<uint32_t, CACHED_CLASSES> count {};
+      std::atomic<int64_t> in_use { 0 };
+      std::atomic<uint64_t> allocations { 0 };
+      thread_cache_t* next = nullptr;
+   };
+}
+
+class book_memory {
+public:
+   static book_memory& instance() {
+      static book_memory memory;
+      return memory;
+   }
+
+   /*
+      Routes this thread's allocations to `node` until destroyed (NUMA
+      pools only). NUMA_LOCAL leaves the enclosing choice in place, so a
+      book without a node can be driven inside another book's scope.
+   */
+   class node_scope {
+   public:
+      explicit node_scope(int node) : saved_(scope_node_), active_(node >= 0) {
+         if (active_) {
+            scope_node_ = node;
+         }
+      }
+      ~node_scope() {
+         if (active_) {
+            scope_node_ = saved_;
+         }
+      }
+      node_scope(const node_scope&) = delete;
+      node_scope& operator=(const node_scope&) = delete;
+
+   private:
+      int saved_;
+      bool active_;
+   };
+
+   void configure(const book_memory_config_t& config) {
+      book_memory_config_t c = config;
+      if (c.numa && c.pages == page_kind::SYSTEM) {
+         // per-node pools need mappings of their own; malloc cannot be steered
+         c.pages = page_kind::SMALL;
+      }
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         config_ = c;
+         stats_.requested = c.pages;
+         configured_ = false;
+      }
+      numa_.store(c.numa, std::memory_order_relaxed);
+      pages_.store(c.pages, std::memory_order_release);
+      if (c.pages != page_kind::SYSTEM && c.reserve_bytes) {
+         arena_t& a = arenas_[ arena_for(allocation_node()) ];
+         std::lock_guard<std::mutex> lock(a.lock);
+         map_chunk(a, c.reserve_bytes, true);
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      configured_ = true;
+   }
+
+   // as last configured; read it while no book is being built
+   const book_memory_config_t& config() const { return config_; }
+
+   book_memory_stats_t stats() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      book_memory_stats_t s = stats_;
+      s.system_allocations = system_allocations_.load(std::memory_order_relaxed);
+      int64_t in_use = retired_in_use_.load(std::memory_order_relaxed);
+      s.allocations = retired_allocations_.load(std::memory_order_relaxed);
+      for (const thread_cache_t* c = caches_; c; c = c->next) {
+         in_use += c->in_use.load(std::memory_order_relaxed);
+         s.allocations += c->allocations.load(std::memory_order_relaxed);
+      }
+      s.in_use_bytes = static_cast<uint64_t>(in_use);
+      for (const arena_t& a : arenas_) {
+         s.peak_bytes += a.carved_bytes.load(std::memory_order_relaxed);
+      }
+      return s;
+   }
+
+   // Every pool mapping so far, for placement reports (numa_page_nodes()).
+   std::vector<page_mapping_t> mappings() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return mappings_;
+   }
+
+   /*
+      Node the calling thread's next pooled allocation goes to; NUMA_LOCAL
+      without config.numa. Outside a node_scope that is the node the
+      thread ran on at its first pooled allocation, read once and kept:
+      pin threads before they allocate book memory.
+   */
+   int allocation_node() const {
+      if (!numa_.load(std::memory_order_relaxed)) {
+         return NUMA_LOCAL;
+      }
+      return scope_node_ >= 0 ? scope_node_ : thread_node();
+   }
+
+   // 16-byte aligned; never returns nullptr (throws std::bad_alloc).
+   void* allocate(size_t bytes) {
+      if (pages_.load(std::memory_order_acquire) == page_kind::SYSTEM) {
+         void* raw = std::malloc(bytes + HEADER_BYTES);
+         if (!raw) {
+            throw std::bad_alloc();
+         }
+         header_t* h = static_cast<header_t*>(raw);
+         h->size_class = SYSTEM_CLASS;
+         h->magic = MAGIC;
+         system_allocations_.fetch_add(1, std::memory_order_relaxed);
+         return h + 1;
+      }
+
+      alloc_tracker::counts.pool_allocations++;
+      uint32_t cls = book_memory_detail::class_of(bytes + HEADER_BYTES);
+      uint32_t arena = arena_for(allocation_node());
+      thread_cache_t& c = cache();
+
+      void* block;
+      if (arena == c.arena && cls < CACHED_CLASSES && c.free[ cls ]) {
+         block = c.free[ cls ];
+         c.free[ cls ] = next_free(block);
+         c.count[ cls ]--;
+      } else {
+         block = allocate_from(arena, cls, c);
+      }
+      header_t* h = static_cast<header_t*>(block);
+      h->size_class = cls;
+      h->magic = MAGIC;
+      h->arena = arena;
+      count(c, static_cast<int64_t>(book_memory_detail::class_bytes(cls)), 1);
+      return h + 1;
+   }
+
+   // Blocks go back to the pool they came from, whichever thread frees them.
+   void deallocate(void* p) {
+      if (!p) {
+         return;
+      }
+      header_t* h = static_cast<header_t*>(p) - 1;
+      if (h->magic != MAGIC || (h->size_class != SYSTEM_CLASS &&
+                                (h->size_class >= CLASSES || h->arena >= arenas_.size()))) {
+         bad_free(p);
+      }
+      h->magic = FREED;
+      if (h->size_class == SYSTEM_CLASS) {
+         std::free(h);
+         return;
+      }
+
+      uint32_t cls = h->size_class;
+      thread_cache_t& c = cache();
+      count(c, -static_cast<int64_t>(book_memory_detail::class_bytes(cls)), 0);
+      if (h->arena == c.arena && cls < CACHED_CLASSES) {
+         if (c.count[ cls ] >= CACHE_LIMIT) {
+            spill(c, cls, CACHE_LIMIT / 2);
+         }
+         next_free(h) = c.free[ cls ];
+         c.free[ cls ] = h;
+         c.count[ cls ]++;
+         return;
+      }
+      arena_t& a = arenas_[ h->arena ];
+      std::lock_guard<std::mutex> lock(a.lock);
+      next_free(h) = a.free[ cls ];
+      a.free[ cls ] = h;
+   }
+
+private:
+   struct header_t {
+      uint32_t size_class;
+      uint32_t magic;
+      uint32_t arena;
+      uint32_t reserved;
+   };
+   static_assert(sizeof(header_t) == 16, "book_memory header must keep 16-byte alignment");
+
+   static constexpr size_t HEADER_BYTES = sizeof(header_t);
+   static constexpr uint32_t SYSTEM_CLASS = 0xFFFFFFFFu;
+   static constexpr uint32_t MAGIC = 0x4B4F4F42u;   // "BOOK", while handed out
+   static constexpr uint32_t FREED = 0x45455246u;   // "FREE", once given back
+   static constexpr int NODE_UNKNOWN = -2;
+
+   using thread_cache_t = book_memory_detail::thread_cache_t;
+   static constexpr uint32_t CLASSES = book_memory_detail::CLASSES;
+   static constexpr uint32_t CACHED_CLASSES = book_memory_detail::CACHED_CLASSES;
+   static constexpr uint32_t NO_ARENA = book_memory_detail::NO_ARENA;
+   static constexpr uint32_t CACHE_LIMIT = 64;    // blocks per class before half go back
+   static constexpr uint32_t REFILL = 16;         // blocks per class taken from the pool at once
+
+   // one per NUMA node plus arena 0, unbound (no config.numa, or a node beyond
+   // MAX_NUMA_NODES); node n is arena n + 1. Each has its own lock.
+   struct arena_t {
+      std::mutex lock;
+      char* cursor = nullptr;
+      char* end = nullptr;
+      std::array<void*, CLASSES> free {};
+      std::atomic<uint64_t> carved_bytes { 0 };
+   };
+
+   // trivially destructible and constant-initialised: no TLS guard, and
+   // still usable by frees that run after the thread was retired
+   static inline constinit thread_local thread_cache_t cache_ {};
+   static inline thread_local int scope_node_ = NUMA_LOCAL;
+   static inline thread_local int thread_node_ = NODE_UNKNOWN;
+
+   mutable std::mutex mutex_;   // config_, stats_, mappings_ and the cache list
+   book_memory_config_t config_;
+   book_memory_stats_t stats_;
+   std::atomic<page_kind> pages_ { page_kind::SYSTEM };
+   std::atomic<bool> numa_ { false };
+   std::atomic<uint64_t> system_allocations_ { 0 };
+   std::atomic<int64_t> retired_in_use_ { 0 };
+   std::atomic<uint64_t> retired_allocations_ { 0 };
+   bool configured_ = false;
+   thread_cache_t* caches_ = nullptr;
+   pthread_key_t exit_key_;
+
+   std::array<arena_t, MAX_NUMA_NODES + 1> arenas_ {};
+   std::vector<page_mapping_t> mappings_;
+
+   // a pthread key destructor retires a thread's cache without allocating,
+   // unlike a thread_local destructor; the main thread's is never retired
+   book_memory() {
+      ::pthread_key_create(&exit_key_, [](void* c) {
+         book_memory::instance().retire(*static_cast<thread_cache_t*>(c));
+      });
+   }
+
+   static uint32_t arena_for(int node) {
+      return node >= 0 && node < MAX_NUMA_NODES ? static_cast<uint32_t>(node) + 1 : 0;
+   }
+
+   static int thread_node() {
+      if (thread_node_ == NODE_UNKNOWN) {
+         thread_node_ = current_numa_node();
+      }
+      return thread_node_;
+   }
+
+   // free blocks link through their first body word; the header stays intact
+   static void*& next_free(void* block) {
+      return *reinterpret_cast<void**>(static_cast<header_t*>(block) + 1);
+   }
+
+   [[noreturn]] static void bad_free(void* p) {
+      std::fprintf(stderr, "book_memory: free of %p, which is not a live block (double free?)\n", p);
+      std::abort();
+   }
+
+   // the calling thread's cache, registered and bound to its home arena
+   thread_cache_t& cache() {
+      thread_cache_t& c = cache_;
+      if (!c.registered) {
+         std::lock_guard<std::mutex> lock(mutex_);
+         c.registered = true;
+         c.next = caches_;
+         caches_ = &c;
+         ::pthread_setspecific(exit_key_, &c);
+      }
+      uint32_t home = numa_.load(std::memory_order_relaxed) ? arena_for(thread_node()) : 0;
+      if (c.arena != home && c.registered && !retired(c)) {
+         flush(c);
+         c.arena = home;
+      }
+      return c;
+   }
+
+   bool retired(const thread_cache_t& c) const { return c.registered && c.next == &c; }
+
+   void count(thread_cache_t& c, int64_t bytes, uint64_t allocations) {
+      if (retired(c)) {
+         retired_in_use_.fetch_add(bytes, std::memory_order_relaxed);
+         retired_allocations_.fetch_add(allocations, std::memory_order_relaxed);
+         return;
+      }
+      // single writer: plain load/store, no locked RMW
+      c.in_use.store(c.in_use.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+      c.allocations.store(c.allocations.load(std::memory_order_relaxed) + allocations, std::memory_order_relaxed);
+   }
+
+   // slow path: a block from the arena, topping up the cache when it is the home arena
+   void* allocate_from(uint32_t arena, uint32_t cls, thread_cache_t& c) {
+      arena_t& a = arenas_[ arena ];
+      std::lock_guard<std::mutex> lock(a.lock);
+      void* block = a.free[ cls ];
+      if (!block) {
+         return carve(a, book_memory_detail::class_bytes(cls));
+      }
+      a.free[ cls ] = next_free(block);
+      if (arena == c.arena && cls < CACHED_CLASSES) {
+         for (uint32_t i = 1; i < REFILL && a.free[ cls ]; i++) {
+            void* more = a.free[ cls ];
+            a.free[ cls ] = next_free(more);
+            next_free(more) = c.free[ cls ];
+            c.free[ cls ] = more;
+            c.count[ cls ]++;
+         }
+      }
+      return block;
+   }
+
+   // hands all but `keep` of a class back to the cache's arena
+   void spill(thread_cache_t& c, uint32_t cls, uint32_t keep) {
+      arena_t& a = arenas_[ c.arena ];
+      std::lock_guard<std::mutex> lock(a.lock);
+      while (c.count[ cls ] > keep) {
+         void* block = c.free[ cls ];
+         c.free[ cls ] = next_free(block);
+         c.count[ cls ]--;
+         next_free(block) = a.free[ cls ];
+         a.free[ cls ] = block;
+      }
+   }
+
+   void flush(thread_cache_t& c) {
+      if (c.arena == NO_ARENA) {
+         return;
+      }
+      for (uint32_t cls = 0; cls < CACHED_CLASSES; cls++) {
+         if (c.count[ cls ]) {
+            spill(c, cls, 0);
+         }
+      }
+   }
+
+   // thread exit: blocks back to the arena, counters into the retired totals
+   void retire(thread_cache_t& c) {
+      flush(c);
+      c.arena = NO_ARENA;
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (thread_cache_t** p = &caches_; *p; p = &(*p)->next) {
+         if (*p == &c) {
+            *p = c.next;
+            break;
+         }
+      }
+      retired_in_use_.fetch_add(c.in_use.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      retired_allocations_.fetch_add(c.allocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      c.next = &c;   // marks it retired
+   }
+
+   // arena lock held
+   void* carve(arena_t& a, size_t bytes) {
+      if (static_cast<size_t>(a.end - a.cursor) < bytes) {
+         map_chunk(a, bytes, false);
+      }
+      void* block = a.cursor;
+      a.cursor += bytes;
+      a.carved_bytes.fetch_add(bytes, std::memory_order_relaxed);
+      return block;
+   }
+
+   // replaces the arena's current chunk, its unused tail abandoned; arena lock held
+   void map_chunk(arena_t& a, size_t bytes, bool reserve) {
+      int node = &a == &arenas_[ 0 ] ? NUMA_LOCAL : static_cast<int>(&a - &arenas_[ 1 ]);
+      book_memory_config_t c;
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         c = config_;
+      }
+      if (!reserve) {
+         size_t chunk = c.chunk_bytes ? c.chunk_bytes
+                      : c.pages == page_kind::HUGE_1G ? (1ULL << 30) : (1ULL << 21);
+         bytes = bytes > chunk ? bytes : chunk;
+      }
+      page_mapping_t m = map_book_pages(bytes, c.pages, c.prefault, c.lock, node);
+      if (!m.base) {
+         throw std::bad_alloc();
+      }
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         stats_.backing = m.kind;
+         stats_.mapped_bytes += m.bytes;
+         stats_.chunks++;
+         stats_.late_chunks += configured_;
+         stats_.fallbacks += m.kind != c.pages;
+         stats_.lock_failures += c.lock && !m.locked;
+         stats_.numa_bind_failures += node >= 0 && m.node != node;
+         if (node >= 0) {
+            stats_.node_mapped_bytes[ static_cast<size_t>(node) ] += m.bytes;
+         }
+         mappings_.push_back(m);
+      }
+      a.cursor = static_cast<char*>(m.base);
+      a.end = a.cursor + m.bytes;
+   }
+};
+
+// Stateless std-style allocator over book_memory, for the order hives.
+template <typename T>
+struct book_allocator {
+   using value_type = T;
+
+   book_allocator() noexcept = default;
+   template <typename U>
+   book_allocator(const book_allocator<U>&) noexcept {}
+
+   T* allocate(size_t n) {
+      return static_cast<T*>(book_memory::instance().allocate(n * sizeof(T)));
+   }
+
+   void deallocate(T* p, size_t) noexcept {
+      book_memory::instance().deallocate(p);
+   }
+
+   template <typename U>
+   bool operator==(const book_allocator<U>&) const noexcept { return true; }
+   template <typename U>
+   bool operator!=(const book_allocator<U>&) const noexcept { return false; }
+};
+
+// Raw allocator for robin_hood tables (their RawAllocator parameter): the book's id index.
+struct book_raw_allocator {
+   static void* allocate(size_t bytes) { return book_memory::instance().allocate(bytes); }
+   static void deallocate(void* p) noexcept { book_memory::instance().deallocate(p); }
+};
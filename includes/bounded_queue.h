@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+/*
+   Bounded multi-producer / multi-consumer ring (Vyukov style).
+
+   All cells are allocated once at construction, so enqueue and dequeue
+   never touch the heap. Each cell carries a sequence number that tells a
+   producer whether the slot is free and a consumer whether it is filled.
+   Capacity is rounded up to the next power of two.
+*/
+template <typename T>
+class bounded_queue {
+public:
+   explicit bounded_queue(size_t capacity)
+      : mask_(round_up_pow2(capacity) - 1),
+        cells_(new cell_t[mask_ + 1])
+   {
+      if (capacity == 0) {
+         throw std::invalid_argument("bounded_queue capacity must be non-zero");
+      }
+      for (size_t i = 0; i <= mask_; i++) {
+         cells_[ i ].sequence.store(i, std::memory_order_relaxed);
+      }
+      enqueue_pos_.store(0, std::memory_order_relaxed);
+      dequeue_pos_.store(0, std::memory_order_relaxed);
+   }
+
+   bounded_queue(const bounded_queue&) = delete;
+   bounded_queue& operator=(const bounded_queue&) = delete;
+
+   bool try_enqueue(const T& value) {
+      cell_t* cell;
+      size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+      for (;;) {
+         cell = &cells_[ pos & mask_ ];
+         size_t seq = cell->sequence.load(std::memory_order_acquire);
+         intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+         if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+               break;
+            }
+         } else if (diff < 0) {
+            return false; // full
+         } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+         }
+      }
+      cell->data = value;
+      cell->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+   }
+
+   bool try_dequeue(T& out) {
+      cell_t* cell;
+      size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+      for (;;) {
+         cell = &cells_[ pos & mask_ ];
+         size_t seq = cell->sequence.load(std::memory_order_acquire);
+         intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+         if (diff == 0) {
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+               break;
+            }
+         } else if (diff < 0) {
+            return false; // empty
+         } else {
+            pos = dequeue_pos_.load(std::memory_order_relaxed);
+         }
+      }
+      out = cell->data;
+      cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+      return true;
+   }
+
+   // Approximate under concurrency; exact when quiescent.
+   size_t size_approx() const {
+      size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+      size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+      return tail > head ? tail - head : 0;
+   }
+
+   size_t capacity() const { return mask_ + 1; }
+
+private:
+   struct alignas(64) cell_t {
+      std::atomic<size_t> sequence;
+      T data;
+   };
+
+   static size_t round_up_pow2(size_t v) {
+      size_t p = 1;
+      while (p < v) {
+         p <<= 1;
+      }
+      return p;
+   }
+
+   const size_t mask_;
+   std::unique_ptr<cell_t[]> cells_;
+
+   alignas(64) std::atomic<size_t> enqueue_pos_;
+   alignas(64) std::atomic<size_t> dequeue_pos_;
+};
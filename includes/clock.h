@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+   #include <x86intrin.h>
+#endif
+
+/*
+   Clock sources used for engine-generated timestamps.
+
+   now() returns raw ticks in whatever unit is cheapest for the source;
+   to_ns() converts them and is only meant to be called off the hot path
+   (e.g. by the logger when it serialises a record). A clock must outlive
+   any logger that may still hold events stamped with it.
+*/
+class clock_source {
+public:
+   virtual ~clock_source() = default;
+
+   virtual uint64_t now() = 0;
+   virtual uint64_t to_ns(uint64_t ticks) = 0;
+};
+
+static inline uint64_t monotonic_ns() {
+   timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// steady_clock, ticks are already nanoseconds
+class steady_clock_source final : public clock_source {
+public:
+   uint64_t now() override {
+      using namespace std::chrono;
+      return static_cast<uint64_t>(
+         duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count()
+      );
+   }
+
+   uint64_t to_ns(uint64_t ticks) override { return ticks; }
+};
+
+// Manually driven clock for tests and deterministic replays.
+class virtual_clock final : public clock_source {
+public:
+   explicit virtual_clock(uint64_t start_ns = 0) : now_ns_(start_ns) {}
+
+   uint64_t now() override {
+      reads_++;
+      return now_ns_;
+   }
+
+   uint64_t to_ns(uint64_t ticks) override { return ticks; }
+
+   void set(uint64_t ns) { now_ns_ = ns; }
+   void advance(uint64_t ns) { now_ns_ += ns; }
+   uint64_t reads() const { return reads_; }
+
+private:
+   uint64_t now_ns_;
+   uint64_t reads_ = 0;
+};
+
+/*
+   Invariant TSC (or the ARM virtual counter) calibrated against
+   CLOCK_MONOTONIC.
+
+   The tick->ns rate is measured once at construction and then refined
+   every recalibrate_interval_ns of converted time, always against the
+   original anchor so the estimate improves as the baseline grows.
+   Recalibrating never steps converted time: the new anchor is the old
+   mapping of the current tick, and any gap to CLOCK_MONOTONIC is slewed
+   off over the next interval, so to_ns() of a later tick never returns
+   less than that of an earlier one. The conversion parameters are
+   published under a seqlock, so to_ns() may run on any thread while
+   another one recalibrates.
+*/
+class tsc_clock final : public clock_source {
+public:
+   explicit tsc_clock(uint64_t recalibrate_interval_ns = 1000000000ULL)
+      : recalibrate_interval_ns_(recalibrate_interval_ns)
+   {
+      origin_ticks_ = read_ticks();
+      origin_ns_ = monotonic_ns();
+
+      // short busy window to get a first rate estimate
+      uint64_t t0 = origin_ticks_;
+      uint64_t n0 = origin_ns_;
+      uint64_t n1 = n0;
+      while (n1 - n0 < 10000000ULL) {
+         std::this_thread::yield();
+         n1 = monotonic_ns();
+      }
+      uint64_t t1 = read_ticks();
+      publish(t1, n1, rate_q32(t1 - t0, n1 - n0));
+   }
+
+   uint64_t now() override { return read_ticks(); }
+
+   // Serialising read: waits for prior instructions to retire.
+   uint64_t now_ordered() {
+#if defined(__x86_64__) || defined(__i386__)
+      unsigned int aux;
+      return __rdtscp(&aux);
+#else
+      return read_ticks();
+#endif
+   }
+
+   uint64_t to_ns(uint64_t ticks) override {
+      uint64_t base_ticks, base_ns, mult;
+      load(base_ticks, base_ns, mult);
+
+      if (ticks >= base_ticks) {
+         uint64_t delta_ns = scale(ticks - base_ticks, mult);
+         if (delta_ns > recalibrate_interval_ns_) {
+            recalibrate();
+         }
+         return base_ns + delta_ns;
+      }
+      uint64_t back = scale(base_ticks - ticks, mult);
+      return back < base_ns ? base_ns - back : 0;
+   }
+
+   // Refine the rate and steer toward CLOCK_MONOTONIC without a step. Safe to call from any thread.
+   void recalibrate() {
+      bool expected = false;
+      if (!recalibrating_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+         return;
+      }
+      uint64_t t = read_ticks();
+      uint64_t n = monotonic_ns();
+      uint64_t base_ticks, base_ns, mult;
+      load(base_ticks, base_ns, mult);
+      if (t > origin_ticks_ && n > origin_ns_ && t >= base_ticks) {
+         uint64_t anchor_ns = base_ns + scale(t - base_ticks, mult);
+         uint64_t rate = rate_q32(t - origin_ticks_, n - origin_ns_);
+
+         // gain or lose the gap over the next interval, at most half of it
+         int64_t interval = static_cast<int64_t>(std::min<uint64_t>(recalibrate_interval_ns_, INT64_MAX / 4));
+         if (interval > 0) {
+            int64_t gap = std::clamp(static_cast<int64_t>(n - anchor_ns), -interval / 2, interval / 2);
+            rate = static_cast<uint64_t>(static_cast<unsigned __int128>(rate) *
+                                         static_cast<uint64_t>(interval + gap) / static_cast<uint64_t>(interval));
+         }
+         publish(t, anchor_ns, rate);
+      }
+      recalibrating_.store(false, std::memory_order_release);
+   }
+
+   // ns per tick, for diagnostics
+   double ns_per_tick() const {
+      return static_cast<double>(mult_q32_.load(std::memory_order_relaxed)) / 4294967296.0;
+   }
+
+   static uint64_t read_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#elif defined(__aarch64__)
+      uint64_t v;
+      asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+      return v;
+#else
+      return monotonic_ns();
+#endif
+   }
+
+private:
+   const uint64_t recalibrate_interval_ns_;
+
+   uint64_t origin_ticks_;
+   uint64_t origin_ns_;
+
+   std::atomic<uint64_t> seq_{0};
+   std::atomic<uint64_t> base_ticks_{0};
+   std::atomic<uint64_t> base_ns_{0};
+   std::atomic<uint64_t> mult_q32_{0};
+   std::atomic<bool> recalibrating_{false};
+
+   static uint64_t rate_q32(uint64_t ticks, uint64_t ns) {
+      if (ticks == 0) {
+         return 1ULL << 32;
+      }
+      return static_cast<uint64_t>((static_cast<unsigned __int128>(ns) << 32) / ticks);
+   }
+
+   static uint64_t scale(uint64_t ticks, uint64_t mult) {
+      return static_cast<uint64_t>((static_cast<unsigned __int128>(ticks) * mult) >> 32);
+   }
+
+   void publish(uint64_t ticks, uint64_t ns, uint64_t mult) {
+      uint64_t s = seq_.load(std::memory_order_relaxed);
+      seq_.store(s + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      base_ticks_.store(ticks, std::memory_order_relaxed);
+      base_ns_.store(ns, std::memory_order_relaxed);
+      mult_q32_.store(mult, std::memory_order_relaxed);
+      seq_.store(s + 2, std::memory_order_release);
+   }
+
+   void load(uint64_t& ticks, uint64_t& ns, uint64_t& mult) const {
+      uint64_t s0, s1;
+      do {
+         s0 = seq_.load(std::memory_order_acquire);
+         ticks = base_ticks_.load(std::memory_order_relaxed);
+         ns = base_ns_.load(std::memory_order_relaxed);
+         mult = mult_q32_.load(std::memory_order_relaxed);
+         std::atomic_thread_fence(std::memory_order_acquire);
+         s1 = seq_.load(std::memory_order_relaxed);
+      } while (s0 != s1 || (s0 & 1));
+   }
+};
+
+// Process-wide clock used when a component is not given one explicitly.
+inline tsc_clock& default_clock() {
+   static tsc_clock clock;
+   return clock;
+}
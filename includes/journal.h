@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "./types.h"
+
+/*
+   On-disk journal written by logger and read back by journal_replayer.
+
+   Binary journals start with a journal_file_header_t followed by
+   fixed-size journal_record_t entries. Text journals are one
+   "KEY=value" line per event (see parse_journal_line), with the IDs and
+   ticker hex-encoded since they may hold any byte. Sequence numbers
+   are assigned in logger::push(), so they increase in file order for
+   each producing thread.
+*/
+
+constexpr char JOURNAL_MAGIC[8] = { 'O','B','J','R','N','L','0','1' };
+constexpr uint32_t JOURNAL_VERSION = 1;
+
+enum class log_format : uint8_t { TEXT=0, BINARY=1 };
+
+BEGIN_PACKED
+PACKED_STRUCT journal_file_header_t {
+   char magic[8];
+   uint32_t version;
+   uint32_t record_size;
+};
+END_PACKED
+
+BEGIN_PACKED
+PACKED_STRUCT journal_record_t {
+   uint64_t sequence;
+   uint64_t timestamp;    // ns
+
+   uint8_t kind;          // log_event_kind
+   uint8_t side;
+   uint8_t side_secondary;
+   uint8_t reserved;
+   char ticker[ TICKER_LEN ];
+
+   char order_id[ ORDER_ID_LEN ];
+   char order_id_secondary[ ORDER_ID_LEN ];
+
+   uint32_t price;
+   uint32_t price_secondary;
+   uint64_t qty;
+   uint64_t qty_secondary;
+};
+END_PACKED
+
+static_assert(sizeof(journal_record_t) == 80, "journal_record_t layout changed");
+
+// Packs a ticker into an integer key, used to shard books by symbol.
+static inline uint32_t ticker_key(const char* ticker) {
+   uint32_t k;
+   std::memcpy(&k, ticker, TICKER_LEN);
+   return k;
+}
+
+namespace journal_detail {
+   static inline const char* find_field(const std::string& line, const char* key) {
+      size_t pos = line.find(key);
+      return pos == std::string::npos ? nullptr : line.c_str() + pos + std::strlen(key);
+   }
+
+   static inline bool read_uint(const std::string& line, const char* key, uint64_t& out) {
+      const char* p = find_field(line, key);
+      if (!p) {
+         return false;
+      }
+      char* end = nullptr;
+      out = std::strtoull(p, &end, 10);
+      return end != p;
+   }
+
+   static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+   // len bytes as 2 * len lowercase hex digits
+   static inline void write_hex(const char* in, size_t len, char* out) {
+      for (size_t i = 0; i < len; i++) {
+         unsigned char b = static_cast<unsigned char>(in[ i ]);
+         out[ 2 * i ] = HEX_DIGITS[ b >> 4 ];
+         out[ 2 * i + 1 ] = HEX_DIGITS[ b & 0xf ];
+      }
+   }
+
+   static inline int hex_value(char c) {
+      if (c >= '0' && c <= '9') {
+         return c - '0';
+      }
+      if (c >= 'a' && c <= 'f') {
+         return c - 'a' + 10;
+      }
+      return -1;
+   }
+
+   static inline bool read_hex(const std::string& line, const char* key, char* out, size_t len) {
+      const char* p = find_field(line, key);
+      if (!p || static_cast<size_t>(line.c_str() + line.size() - p) < 2 * len) {
+         return false;
+      }
+      for (size_t i = 0; i < len; i++) {
+         int hi = hex_value(p[ 2 * i ]);
+         int lo = hex_value(p[ 2 * i + 1 ]);
+         if (hi < 0 || lo < 0) {
+            return false;
+         }
+         out[ i ] = static_cast<char>((hi << 4) | lo);
+      }
+      return true;
+   }
+
+   static inline bool read_fixed(const std::string& line, const char* key, char* out, size_t len) {
+      const char* p = find_field(line, key);
+      if (!p || static_cast<size_t>(line.c_str() + line.size() - p) < len) {
+         return false;
+      }
+      std::memcpy(out, p, len);
+      return true;
+   }
+}
+
+/*
+   Parses one line of a text journal. IDs and ticker are hex in
+   ORDIDX/ORDID2X/TICKERX; journals written before that hold them as raw
+   fixed-width bytes in ORDID/ORDID2/TICKER, read by length rather than
+   up to the next space. Lines from journals written before SEQ/TICKER
+   existed parse with sequence=0 and a blank ticker.
+*/
+static inline bool parse_journal_line(const std::string& line, journal_record_t& rec) {
+   using namespace journal_detail;
+
+   std::memset(&rec, 0, sizeof(rec));
+   std::memset(rec.ticker, ' ', TICKER_LEN);
+
+   uint64_t ts, kind, price, qty, side, price2, qty2, side2;
+   if (!read_uint(line, "TIMESTAMP=", ts) ||
+       !read_uint(line, " KIND=", kind) ||
+       !read_uint(line, " PRICE=", price) ||
+       !read_uint(line, " QTY=", qty) ||
+       !read_uint(line, " SIDE=", side) ||
+       !read_uint(line, " PRICE2=", price2) ||
+       !read_uint(line, " QTY2=", qty2) ||
+       !read_uint(line, " SIDE2=", side2)) {
+      return false;
+   }
+   bool hex = find_field(line, " ORDIDX=") != nullptr;
+   if (hex ? !read_hex(line, " ORDIDX=", rec.order_id, ORDER_ID_LEN) ||
+             !read_hex(line, " ORDID2X=", rec.order_id_secondary, ORDER_ID_LEN)
+           : !read_fixed(line, " ORDID=", rec.order_id, ORDER_ID_LEN) ||
+             !read_fixed(line, " ORDID2=", rec.order_id_secondary, ORDER_ID_LEN)) {
+      return false;
+   }
+
+   rec.timestamp = ts;
+   rec.kind = static_cast<uint8_t>(kind);
+   rec.price = static_cast<uint32_t>(price);
+   rec.qty = qty;
+   rec.side = static_cast<uint8_t>(side);
+   rec.price_secondary = static_cast<uint32_t>(price2);
+   rec.qty_secondary = qty2;
+   rec.side_secondary = static_cast<uint8_t>(side2);
+
+   uint64_t seq = 0;
+   if (hex) {
+      read_hex(line, " TICKERX=", rec.ticker, TICKER_LEN);
+   } else {
+      read_fixed(line, " TICKER=", rec.ticker, TICKER_LEN);
+   }
+   read_uint(line, " SEQ=", seq);
+   rec.sequence = seq;
+   return true;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/*
+   Fixed-memory log-linear (HDR-style) latency histogram.
+
+   Values below 2^LATENCY_SUB_BITS get one bucket each; above that every
+   power of two is split into 2^LATENCY_SUB_BITS linear sub-buckets, so
+   the relative error is bounded by 1/16 regardless of magnitude. Values
+   at or above 2^LATENCY_MAX_BITS are clamped into the last bucket.
+
+   record() is meant for a single writer and uses plain relaxed
+   load/store (no locked RMW). snapshot() may run concurrently on any
+   thread; a snapshot taken mid-record can miss that one sample but is
+   otherwise consistent, since count() is derived from the buckets.
+*/
+
+constexpr unsigned LATENCY_SUB_BITS = 4;
+constexpr unsigned LATENCY_MAX_BITS = 36;
+constexpr uint64_t LATENCY_SUB_COUNT = 1ULL << LATENCY_SUB_BITS;
+constexpr size_t LATENCY_BUCKETS = (LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_COUNT;
+
+static inline size_t latency_bucket(uint64_t v) {
+   if (v >= (1ULL << LATENCY_MAX_BITS)) {
+      v = (1ULL << LATENCY_MAX_BITS) - 1;
+   }
+   if (v < LATENCY_SUB_COUNT) {
+      return static_cast<size_t>(v);
+   }
+   unsigned shift = static_cast<unsigned>(std::bit_width(v)) - 1 - LATENCY_SUB_BITS;
+   return static_cast<size_t>((shift + 1) * LATENCY_SUB_COUNT + ((v >> shift) - LATENCY_SUB_COUNT));
+}
+
+// smallest value that maps to bucket idx
+static inline uint64_t latency_bucket_lower(size_t idx) {
+   if (idx < LATENCY_SUB_COUNT) {
+      return idx;
+   }
+   uint64_t block = idx >> LATENCY_SUB_BITS;
+   uint64_t sub = idx & (LATENCY_SUB_COUNT - 1);
+   return (LATENCY_SUB_COUNT + sub) << (block - 1);
+}
+
+// largest value that maps to bucket idx
+static inline uint64_t latency_bucket_upper(size_t idx) {
+   if (idx < LATENCY_SUB_COUNT) {
+      return idx;
+   }
+   uint64_t block = idx >> LATENCY_SUB_BITS;
+   return latency_bucket_lower(idx) + (1ULL << (block - 1)) - 1;
+}
+
+struct latency_histogram_snapshot {
+   std::array<uint64_t, LATENCY_BUCKETS> counts{};
+   uint64_t sum = 0;
+
+   uint64_t count() const {
+      uint64_t n = 0;
+      for (uint64_t c : counts) {
+         n += c;
+      }
+      return n;
+   }
+
+   double mean() const {
+      uint64_t n = count();
+      return n ? static_cast<double>(sum) / static_cast<double>(n) : 0.0;
+   }
+
+   // upper bound of the bucket holding the q-th quantile (q in [0, 1])
+   uint64_t value_at(double q) const {
+      uint64_t n = count();
+      if (n == 0) {
+         return 0;
+      }
+      uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(n - 1)) + 1;
+      uint64_t seen = 0;
+      for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+         seen += counts[ i ];
+         if (seen >= rank) {
+            return latency_bucket_upper(i);
+         }
+      }
+      return latency_bucket_upper(LATENCY_BUCKETS - 1);
+   }
+
+   uint64_t max() const { return value_at(1.0); }
+
+   void merge(const latency_histogram_snapshot& other) {
+      for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+         counts[ i ] += other.counts[ i ];
+      }
+      sum += other.sum;
+   }
+
+   // turns a cumulative snapshot into the delta since `earlier`
+   void subtract(const latency_histogram_snapshot& earlier) {
+      for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+         counts[ i ] -= earlier.counts[ i ];
+      }
+      sum -= earlier.sum;
+   }
+};
+
+class latency_histogram {
+public:
+   void record(uint64_t value) {
+      std::atomic<uint64_t>& c = counts_[ latency_bucket(value) ];
+      c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+   }
+
+   void snapshot(latency_histogram_snapshot& out) const {
+      for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+         out.counts[ i ] = counts_[ i ].load(std::memory_order_relaxed);
+      }
+      out.sum = sum_.load(std::memory_order_relaxed);
+   }
+
+private:
+   std::array<std::atomic<uint64_t>, LATENCY_BUCKETS> counts_{};
+   std::atomic<uint64_t> sum_{0};
+};
@@ -8,9 +8,14 @@
 #include <stdexcept>
 #include <mutex>
 #include <condition_variable>
+#include <memory>
+#include <string_view>
 
 #include "./types.h"
-#include "./concurrentqueue.h"
+#include "./bounded_queue.h"
+#include "./clock.h"
+#include "./journal.h"
+#include "./thread_affinity.h"
 
 enum class log_event_kind : uint8_t { ADD, CANCEL, MODIFY, MATCH };
 
@@ -21,12 +26,19 @@ struct log_event_t {
    uint32_t price;
    size_t qty;
    order_side side;
+   char ticker [ TICKER_LEN ];
 
    char order_id_secondary [ ORDER_ID_LEN ];
    uint32_t price_secondary;
    size_t qty_secondary;
    order_side side_secondary;
 
+   // when set, timestamp holds raw ticks of this clock and is converted at write time
+   clock_source* ts_clock = nullptr;
+
+   // journal sequence, assigned by logger::push()
+   uint64_t sequence = 0;
+
    log_event_t() = default;
 
    log_event_t(
@@ -35,7 +47,8 @@ struct log_event_t {
       log_event_kind k,
       uint32_t p,
       size_t q,
-      order_side s
+      order_side s,
+      const char* tkr = nullptr
    )
       : timestamp(ts)
       , kind(k)
@@ -47,30 +60,104 @@ struct log_event_t {
       , side_secondary(order_side::BUY) // default
    {
       std::memcpy(order_id, id, ORDER_ID_LEN);
+      std::memset(order_id_secondary, 0, ORDER_ID_LEN);
+      if (tkr) {
+         std::memcpy(ticker, tkr, TICKER_LEN);
+      } else {
+         std::memset(ticker, ' ', TICKER_LEN);
+      }
    }
 };
 
+enum class overflow_policy : uint8_t {
+   BLOCK=0,   // wait on a condition variable until the writer frees a slot
+   SPIN=1,    // busy-wait until the writer frees a slot
+   DROP=2,    // discard the event and count it
+   SPILL=3    // divert to a preallocated secondary ring, drop if that fills too
+};
+
+struct logger_config_t {
+   size_t queue_capacity = 1 << 16;
+   overflow_policy on_full = overflow_policy::BLOCK;
+   size_t spill_capacity = 1 << 18;
+   log_format format = log_format::TEXT;
+   thread_placement_t thread;   // writer thread CPU / priority, see placement()
+};
+
+struct logger_stats_t {
+   uint64_t enqueued = 0;
+   uint64_t dropped = 0;
+   uint64_t spilled = 0;
+   uint64_t full_waits = 0;
+   size_t high_water_mark = 0;
+};
+
 class logger {
 public:
-   explicit logger(const std::string& filename)
-      : out_file_(filename),
+   explicit logger(const std::string& filename, const logger_config_t& config = {})
+      : out_file_(filename, config.format == log_format::BINARY
+                               ? std::ios::out | std::ios::binary
+                               : std::ios::out),
+        config_(config),
+        queue_(config.queue_capacity),
         running_(true)
    {
       if (!out_file_.is_open()) {
          throw std::runtime_error("Failed to open log file: " + filename);
       }
+      if (config_.format == log_format::BINARY) {
+         journal_file_header_t header;
+         std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+         header.version = JOURNAL_VERSION;
+         header.record_size = sizeof(journal_record_t);
+         out_file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      }
+      if (config_.on_full == overflow_policy::SPILL) {
+         spill_ = std::make_unique<bounded_queue<log_event_t>>(config_.spill_capacity);
+      }
       thread_ = std::thread(&logger::run, this);
+      placement_ = apply_thread_placement(thread_.native_handle(), config_.thread, "ob-logger");
    }
 
-   void push(const log_event_t& event) {
-      queue_.enqueue(event);
+   /*
+      Never allocates. What happens when the primary ring is full is
+      decided by config_.on_full; see overflow_policy. Returns the journal
+      sequence number assigned to the event (also when it is dropped).
+   */
+   uint64_t push(log_event_t event) {
+      event.sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+
+      if (spill_pending_.load(std::memory_order_acquire) > 0) {
+         // keep FIFO order: once spilling, stay on the spill ring until drained
+         push_spill(event);
+      } else if (queue_.try_enqueue(event)) {
+         on_enqueued(queue_.size_approx());
+      } else {
+         push_full(event);
+      }
 
       {
          std::lock_guard<std::mutex> lock(mutex_);
       }
       cv_.notify_one();
+      return event.sequence;
    }
 
+   logger_stats_t stats() const {
+      logger_stats_t s;
+      s.enqueued = enqueued_.load(std::memory_order_relaxed);
+      s.dropped = dropped_.load(std::memory_order_relaxed);
+      s.spilled = spilled_.load(std::memory_order_relaxed);
+      s.full_waits = full_waits_.load(std::memory_order_relaxed);
+      s.high_water_mark = high_water_mark_.load(std::memory_order_relaxed);
+      return s;
+   }
+
+   const logger_config_t& config() const { return config_; }
+
+   // Outcome of applying config().thread to the writer thread.
+   const placement_result_t& placement() const { return placement_; }
+
    ~logger() {
       {
          std::lock_guard<std::mutex> lock(mutex_);
@@ -86,29 +173,141 @@ public:
 
 private:
    std::ofstream out_file_;
-   moodycamel::ConcurrentQueue<log_event_t> queue_;
+   logger_config_t config_;
+   bounded_queue<log_event_t> queue_;
+   std::unique_ptr<bounded_queue<log_event_t>> spill_;
    std::atomic<bool> running_;
    std::thread thread_;
+   placement_result_t placement_;
 
    std::mutex mutex_;
    std::condition_variable cv_;
 
+   std::mutex space_mutex_;
+   std::condition_variable space_cv_;
+   std::atomic<uint32_t> space_waiters_{0};
+
+   std::atomic<uint64_t> next_sequence_{1};
+
+   std::atomic<uint64_t> spill_pending_{0};
+   std::atomic<uint64_t> enqueued_{0};
+   std::atomic<uint64_t> dropped_{0};
+   std::atomic<uint64_t> spilled_{0};
+   std::atomic<uint64_t> full_waits_{0};
+   std::atomic<size_t> high_water_mark_{0};
+
+   void on_enqueued(size_t depth) {
+      enqueued_.fetch_add(1, std::memory_order_relaxed);
+      size_t hwm = high_water_mark_.load(std::memory_order_relaxed);
+      while (depth > hwm &&
+             !high_water_mark_.compare_exchange_weak(hwm, depth, std::memory_order_relaxed)) {
+      }
+   }
+
+   void push_full(const log_event_t& event) {
+      switch (config_.on_full) {
+         case overflow_policy::BLOCK:
+            full_waits_.fetch_add(1, std::memory_order_relaxed);
+            space_waiters_.fetch_add(1, std::memory_order_acq_rel);
+            while (!queue_.try_enqueue(event)) {
+               cv_.notify_one();
+               std::unique_lock<std::mutex> lock(space_mutex_);
+               space_cv_.wait_for(lock, std::chrono::microseconds(100));
+            }
+            space_waiters_.fetch_sub(1, std::memory_order_acq_rel);
+            on_enqueued(queue_.size_approx());
+            break;
+         case overflow_policy::SPIN:
+            full_waits_.fetch_add(1, std::memory_order_relaxed);
+            while (!queue_.try_enqueue(event)) {
+               cv_.notify_one();
+            }
+            on_enqueued(queue_.size_approx());
+            break;
+         case overflow_policy::DROP:
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            break;
+         case overflow_policy::SPILL:
+            push_spill(event);
+            break;
+      }
+   }
+
+   void push_spill(const log_event_t& event) {
+      spill_pending_.fetch_add(1, std::memory_order_acq_rel);
+      if (spill_->try_enqueue(event)) {
+         spilled_.fetch_add(1, std::memory_order_relaxed);
+         on_enqueued(queue_.capacity() + spill_->size_approx());
+      } else {
+         spill_pending_.fetch_sub(1, std::memory_order_acq_rel);
+         dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+   }
+
+   void write_event(const log_event_t& ev) {
+      uint64_t seq = ev.sequence;
+      uint64_t ts = ev.ts_clock ? ev.ts_clock->to_ns(ev.timestamp) : ev.timestamp;
+
+      if (config_.format == log_format::BINARY) {
+         journal_record_t rec;
+         rec.sequence = seq;
+         rec.timestamp = ts;
+         rec.kind = static_cast<uint8_t>(ev.kind);
+         rec.side = static_cast<uint8_t>(ev.side);
+         rec.side_secondary = static_cast<uint8_t>(ev.side_secondary);
+         rec.reserved = 0;
+         std::memcpy(rec.ticker, ev.ticker, TICKER_LEN);
+         std::memcpy(rec.order_id, ev.order_id, ORDER_ID_LEN);
+         std::memcpy(rec.order_id_secondary, ev.order_id_secondary, ORDER_ID_LEN);
+         rec.price = ev.price;
+         rec.price_secondary = ev.price_secondary;
+         rec.qty = ev.qty;
+         rec.qty_secondary = ev.qty_secondary;
+         out_file_.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+         return;
+      }
+
+      // hex, so an ID byte that is a newline cannot split the line
+      char order_id[ 2 * ORDER_ID_LEN ], order_id2[ 2 * ORDER_ID_LEN ], ticker[ 2 * TICKER_LEN ];
+      journal_detail::write_hex(ev.order_id, ORDER_ID_LEN, order_id);
+      journal_detail::write_hex(ev.order_id_secondary, ORDER_ID_LEN, order_id2);
+      journal_detail::write_hex(ev.ticker, TICKER_LEN, ticker);
+
+      out_file_ << "TIMESTAMP=" << ts
+                << " KIND=" << static_cast<int>(ev.kind)
+                << " PRICE=" << ev.price
+                << " QTY=" << ev.qty
+                << " SIDE=" << static_cast<int>(ev.side)
+                << " PRICE2=" << ev.price_secondary
+                << " QTY2=" << ev.qty_secondary
+                << " SIDE2=" << static_cast<int>(ev.side_secondary)
+                << " ORDIDX=" << std::string_view(order_id, sizeof(order_id))
+                << " ORDID2X=" << std::string_view(order_id2, sizeof(order_id2))
+                << " TICKERX=" << std::string_view(ticker, sizeof(ticker))
+                << " SEQ=" << seq
+                << "\n";
+   }
+
+   // Primary ring first, then anything diverted to the spill ring.
+   void drain() {
+      log_event_t ev;
+      while (queue_.try_dequeue(ev)) {
+         write_event(ev);
+         if (space_waiters_.load(std::memory_order_acquire) > 0) {
+            space_cv_.notify_all();
+         }
+      }
+      if (spill_) {
+         while (spill_->try_dequeue(ev)) {
+            write_event(ev);
+            spill_pending_.fetch_sub(1, std::memory_order_acq_rel);
+         }
+      }
+   }
+
    void run() {
       while (true) {
-         log_event_t ev;
-         while (queue_.try_dequeue(ev)) {
-            out_file_ << "TIMESTAMP=" << ev.timestamp
-                      << " KIND=" << static_cast<int>(ev.kind)
-                      << " PRICE=" << ev.price
-                      << " QTY=" << ev.qty
-                      << " SIDE=" << static_cast<int>(ev.side)
-                      << " PRICE2=" << ev.price_secondary
-                      << " QTY2=" << ev.qty_secondary
-                      << " SIDE2=" << static_cast<int>(ev.side_secondary)
-                      << " ORDID=" << std::string(ev.order_id, ORDER_ID_LEN)
-                      << " ORDID2=" << std::string(ev.order_id_secondary, ORDER_ID_LEN)
-                      << "\n";
-         }
+         drain();
          out_file_.flush();
 
          std::unique_lock<std::mutex> lock(mutex_);
@@ -118,20 +317,7 @@ private:
          cv_.wait_for(lock, std::chrono::milliseconds(500));
       }
 
-      log_event_t ev;
-      while (queue_.try_dequeue(ev)) {
-         out_file_ << "TIMESTAMP=" << ev.timestamp
-                   << " KIND=" << static_cast<int>(ev.kind)
-                   << " PRICE=" << ev.price
-                   << " QTY=" << ev.qty
-                   << " SIDE=" << static_cast<int>(ev.side)
-                   << " PRICE2=" << ev.price_secondary
-                   << " QTY2=" << ev.qty_secondary
-                   << " SIDE2=" << static_cast<int>(ev.side_secondary)
-                   << " ORDID=" << std::string(ev.order_id, ORDER_ID_LEN)
-                   << " ORDID2=" << std::string(ev.order_id_secondary, ORDER_ID_LEN)
-                   << "\n";
-      }
+      drain();
       out_file_.flush();
    }
 };
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <dirent.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+   NUMA topology and page placement for book memory, read from sysfs and
+   driven through the raw set_mempolicy / mbind / move_pages syscalls so
+   libnuma is not a dependency.
+
+   Placement is a preference, not a hard binding: a node that runs out of
+   (huge) pages falls back to another instead of failing the mapping or
+   raising SIGBUS on a later fault. numa_page_nodes() shows where pages
+   really ended up. Without NUMA support every CPU is on node 0 and the
+   policy calls quietly do nothing.
+*/
+
+static constexpr int NUMA_LOCAL = -1;        // the node the calling thread is running on
+static constexpr int MAX_NUMA_NODES = 8;     // book_memory keeps one pool per node up to this
+
+namespace numa_detail {
+   static constexpr int MPOL_DEFAULT_ = 0;
+   static constexpr int MPOL_PREFERRED_ = 1;
+   static constexpr unsigned MPOL_MF_MOVE_ = 1u << 1;
+   static constexpr unsigned long MASK_BITS = 8 * sizeof(unsigned long);
+
+   // node of every configured CPU; 0 where sysfs has no nodeN link
+   static inline std::vector<int> build_cpu_nodes() {
+      std::vector<int> nodes;
+      int cpus = static_cast<int>(::sysconf(_SC_NPROCESSORS_CONF));
+      for (int cpu = 0; cpu < cpus; cpu++) {
+         std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+         int node = 0;
+         if (DIR* dir = ::opendir(path.c_str())) {
+            while (dirent* e = ::readdir(dir)) {
+               if (std::strncmp(e->d_name, "node", 4) == 0 && e->d_name[ 4 ] >= '0' && e->d_name[ 4 ] <= '9') {
+                  node = std::atoi(e->d_name + 4);
+                  break;
+               }
+            }
+            ::closedir(dir);
+         }
+         nodes.push_back(node);
+      }
+      return nodes;
+   }
+
+   static inline const std::vector<int>& cpu_nodes() {
+      static const std::vector<int> nodes = build_cpu_nodes();
+      return nodes;
+   }
+
+   static inline long set_policy(int mode, const unsigned long* mask) {
+      return ::syscall(SYS_set_mempolicy, mode, mask, mask ? MASK_BITS + 1 : 0);
+   }
+}
+
+// Highest online node + 1 ("0-1" -> 2); 1 when the kernel has no NUMA sysfs.
+static inline int numa_node_count() {
+   std::FILE* f = std::fopen("/sys/devices/system/node/online", "r");
+   if (!f) {
+      return 1;
+   }
+   char buf[ 256 ];
+   int highest = 0;
+   if (std::fgets(buf, sizeof(buf), f)) {
+      // a list like "0-3,6": the last number is the highest node
+      for (const char* p = buf; *p; p++) {
+         if (*p >= '0' && *p <= '9' && (p == buf || p[ -1 ] < '0' || p[ -1 ] > '9')) {
+            highest = std::atoi(p);
+         }
+      }
+   }
+   std::fclose(f);
+   return highest + 1;
+}
+
+static inline int numa_node_of_cpu(int cpu) {
+   const std::vector<int>& nodes = numa_detail::cpu_nodes();
+   return cpu >= 0 && static_cast<size_t>(cpu) < nodes.size() ? nodes[ static_cast<size_t>(cpu) ] : 0;
+}
+
+// Node of the CPU the calling thread is on right now; stable only for a pinned thread.
+static inline int current_numa_node() {
+   return numa_node_of_cpu(::sched_getcpu());
+}
+
+/*
+   Makes the calling thread's page faults prefer `node` until destroyed,
+   so memory that is mapped and touched inside the scope (MAP_POPULATE
+   included) comes from that node. NUMA_LOCAL does nothing.
+*/
+class numa_policy_scope {
+public:
+   explicit numa_policy_scope(int node) {
+      if (node < 0 || static_cast<unsigned long>(node) >= numa_detail::MASK_BITS) {
+         return;
+      }
+      unsigned long mask = 1UL << node;
+      active_ = numa_detail::set_policy(numa_detail::MPOL_PREFERRED_, &mask) == 0;
+   }
+
+   ~numa_policy_scope() {
+      if (active_) {
+         numa_detail::set_policy(numa_detail::MPOL_DEFAULT_, nullptr);
+      }
+   }
+
+   numa_policy_scope(const numa_policy_scope&) = delete;
+   numa_policy_scope& operator=(const numa_policy_scope&) = delete;
+
+   bool active() const { return active_; }
+
+private:
+   bool active_ = false;
+};
+
+// Sets a preferred-node policy on [base, base + bytes) and moves pages already faulted in.
+static inline bool numa_bind(void* base, size_t bytes, int node) {
+   if (node < 0 || static_cast<unsigned long>(node) >= numa_detail::MASK_BITS) {
+      return false;
+   }
+   unsigned long mask = 1UL << node;
+   return ::syscall(SYS_mbind, base, bytes, numa_detail::MPOL_PREFERRED_, &mask,
+                    numa_detail::MASK_BITS + 1, numa_detail::MPOL_MF_MOVE_) == 0;
+}
+
+/*
+   Counts the resident pages of [base, base + bytes) per node, probing
+   every `step` bytes (the mapping's page size). pages_per_node grows to
+   the highest node seen. Returns how many pages are not resident, which
+   is all of them when move_pages is unavailable.
+*/
+static inline size_t numa_page_nodes(const void* base, size_t bytes, size_t step,
+                                     std::vector<uint64_t>& pages_per_node) {
+   static constexpr size_t BATCH = 512;
+   const char* p = static_cast<const char*>(base);
+   size_t total = step ? bytes / step : 0;
+   size_t missing = 0;
+   void* pages[ BATCH ];
+   int status[ BATCH ];
+   for (size_t done = 0; done < total; ) {
+      size_t n = total - done < BATCH ? total - done : BATCH;
+      for (size_t i = 0; i < n; i++) {
+         pages[ i ] = const_cast<char*>(p + (done + i) * step);
+      }
+      if (::syscall(SYS_move_pages, 0, n, pages, nullptr, status, 0) != 0) {
+         return missing + (total - done);
+      }
+      for (size_t i = 0; i < n; i++) {
+         if (status[ i ] < 0) {
+            missing++;
+            continue;
+         }
+         size_t node = static_cast<size_t>(status[ i ]);
+         if (node >= pages_per_node.size()) {
+            pages_per_node.resize(node + 1, 0);
+         }
+         pages_per_node[ node ]++;
+      }
+      done += n;
+   }
+   return missing;
+}
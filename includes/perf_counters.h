@@ -0,0 +1,274 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+   #include <linux/perf_event.h>
+   #include <sys/ioctl.h>
+   #include <sys/syscall.h>
+   #include <unistd.h>
+#endif
+
+/*
+   Hardware performance counters for the calling thread, opened as one
+   perf_event_open group so every counter covers the same window.
+
+   Only user-space events are counted. Counters the kernel or container
+   refuses (no PMU, perf_event_paranoid, seccomp) are simply marked
+   missing; if none can be opened the group reports !available() and
+   read() returns zeros, so callers never need a separate code path.
+
+   read() is a syscall (~1 us). read_overhead() is the smallest delta of
+   two back-to-back reads and is subtracted by perf_totals_t.
+*/
+
+enum class perf_counter : uint8_t {
+   CYCLES=0,
+   INSTRUCTIONS=1,
+   BRANCH_MISSES=2,
+   L1D_READ_MISSES=3,
+   LLC_MISSES=4,
+   DTLB_READ_MISSES=5
+};
+
+constexpr size_t PERF_COUNTERS = 6;
+
+static inline const char* perf_counter_name(size_t i) {
+   static const char* const NAMES[ PERF_COUNTERS ] = {
+      "cycles", "instructions", "branch_misses", "l1d_read_misses", "llc_misses", "dtlb_read_misses"
+   };
+   return i < PERF_COUNTERS ? NAMES[ i ] : "?";
+}
+
+struct perf_sample_t {
+   std::array<uint64_t, PERF_COUNTERS> values{};
+};
+
+class perf_counter_group {
+public:
+   perf_counter_group() {
+      fds_.fill(-1);
+#if defined(__linux__)
+      for (size_t i = 0; i < PERF_COUNTERS; i++) {
+         perf_event_attr attr;
+         std::memset(&attr, 0, sizeof(attr));
+         attr.size = sizeof(attr);
+         config_for(static_cast<perf_counter>(i), attr.type, attr.config);
+         attr.disabled = leader_ < 0 ? 1 : 0;
+         attr.exclude_kernel = 1;
+         attr.exclude_hv = 1;
+         attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+         int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+         if (fd < 0) {
+            if (leader_ < 0 && !error_) {
+               error_ = errno;
+            }
+            continue;
+         }
+         fds_[ i ] = fd;
+         slot_[ i ] = opened_++;
+         if (leader_ < 0) {
+            leader_ = fd;
+         }
+      }
+
+      if (leader_ >= 0) {
+         ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+         ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+         calibrate();
+      }
+#else
+      error_ = ENOSYS;
+#endif
+   }
+
+   ~perf_counter_group() {
+#if defined(__linux__)
+      for (int fd : fds_) {
+         if (fd >= 0) {
+            close(fd);
+         }
+      }
+#endif
+   }
+
+   perf_counter_group(const perf_counter_group&) = delete;
+   perf_counter_group& operator=(const perf_counter_group&) = delete;
+
+   bool available() const { return leader_ >= 0; }
+   bool has(perf_counter c) const { return fds_[ static_cast<size_t>(c) ] >= 0; }
+
+   // why the first counter failed to open, for diagnostics
+   const char* unavailable_reason() const { return error_ ? std::strerror(error_) : ""; }
+
+   // Running totals since construction, scaled up if the kernel multiplexed the group.
+   bool read(perf_sample_t& out) const {
+      out.values.fill(0);
+#if defined(__linux__)
+      if (leader_ < 0) {
+         return false;
+      }
+      uint64_t buf[ 3 + PERF_COUNTERS ];
+      ssize_t n = ::read(leader_, buf, sizeof(buf));
+      if (n < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+         return false;
+      }
+      uint64_t nr = buf[ 0 ];
+      uint64_t enabled = buf[ 1 ];
+      uint64_t running = buf[ 2 ];
+      for (size_t i = 0; i < PERF_COUNTERS; i++) {
+         if (fds_[ i ] < 0 || slot_[ i ] >= nr) {
+            continue;
+         }
+         uint64_t v = buf[ 3 + slot_[ i ] ];
+         if (running && running < enabled) {
+            v = static_cast<uint64_t>(static_cast<double>(v) * static_cast<double>(enabled) / static_cast<double>(running));
+         }
+         out.values[ i ] = v;
+      }
+      return true;
+#else
+      return false;
+#endif
+   }
+
+   const perf_sample_t& read_overhead() const { return overhead_; }
+
+private:
+   std::array<int, PERF_COUNTERS> fds_;
+   std::array<uint64_t, PERF_COUNTERS> slot_{};
+   uint64_t opened_ = 0;
+   int leader_ = -1;
+   int error_ = 0;
+   perf_sample_t overhead_;
+
+#if defined(__linux__)
+   static void config_for(perf_counter c, __u32& type, __u64& config) {
+      auto cache = [](uint64_t id, uint64_t op, uint64_t result) {
+         return id | (op << 8) | (result << 16);
+      };
+      type = PERF_TYPE_HARDWARE;
+      switch (c) {
+         case perf_counter::CYCLES:        config = PERF_COUNT_HW_CPU_CYCLES; break;
+         case perf_counter::INSTRUCTIONS:  config = PERF_COUNT_HW_INSTRUCTIONS; break;
+         case perf_counter::BRANCH_MISSES: config = PERF_COUNT_HW_BRANCH_MISSES; break;
+         case perf_counter::LLC_MISSES:    config = PERF_COUNT_HW_CACHE_MISSES; break;
+         case perf_counter::L1D_READ_MISSES:
+            type = PERF_TYPE_HW_CACHE;
+            config = cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+         case perf_counter::DTLB_READ_MISSES:
+            type = PERF_TYPE_HW_CACHE;
+            config = cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+      }
+   }
+
+   void calibrate() {
+      overhead_.values.fill(~0ULL);
+      perf_sample_t a, b;
+      for (int i = 0; i < 64; i++) {
+         read(a);
+         read(b);
+         for (size_t c = 0; c < PERF_COUNTERS; c++) {
+            uint64_t d = b.values[ c ] - a.values[ c ];
+            if (d < overhead_.values[ c ]) {
+               overhead_.values[ c ] = d;
+            }
+         }
+      }
+   }
+#endif
+};
+
+// Accumulated counter deltas for one operation, normalised per op on demand.
+struct perf_totals_t {
+   uint64_t ops = 0;
+   perf_sample_t sum;
+
+   void add(const perf_sample_t& before, const perf_sample_t& after, const perf_sample_t& overhead, uint64_t op_count = 1) {
+      ops += op_count;
+      for (size_t i = 0; i < PERF_COUNTERS; i++) {
+         uint64_t d = after.values[ i ] - before.values[ i ];
+         sum.values[ i ] += d > overhead.values[ i ] ? d - overhead.values[ i ] : 0;
+      }
+   }
+
+   double per_op(size_t counter) const {
+      return ops ? static_cast<double>(sum.values[ counter ]) / static_cast<double>(ops) : 0.0;
+   }
+};
+
+/*
+   Cross-socket memory traffic of the calling thread, from the generic
+   NODE cache events: on Intel, read accesses are loads served by the
+   local node's DRAM and read misses loads served by another node. Kept
+   out of perf_counter_group so that group still fits the PMU's
+   programmable counters. Most VMs and non-Intel parts do not expose these
+   events; available() then stays false and read() returns zeros.
+*/
+struct node_traffic_t {
+   uint64_t local_loads = 0;
+   uint64_t remote_loads = 0;
+};
+
+class node_traffic_counters {
+public:
+   node_traffic_counters() {
+#if defined(__linux__)
+      for (size_t i = 0; i < 2; i++) {
+         perf_event_attr attr;
+         std::memset(&attr, 0, sizeof(attr));
+         attr.size = sizeof(attr);
+         attr.type = PERF_TYPE_HW_CACHE;
+         attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       ((i ? PERF_COUNT_HW_CACHE_RESULT_MISS : PERF_COUNT_HW_CACHE_RESULT_ACCESS) << 16);
+         attr.disabled = i == 0 ? 1 : 0;
+         attr.exclude_kernel = 1;
+         attr.exclude_hv = 1;
+         attr.read_format = PERF_FORMAT_GROUP;
+         fds_[ i ] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i ? fds_[ 0 ] : -1, 0));
+         if (fds_[ i ] < 0) {
+            return;
+         }
+      }
+      ioctl(fds_[ 0 ], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(fds_[ 0 ], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+   }
+
+   ~node_traffic_counters() {
+#if defined(__linux__)
+      for (int fd : fds_) {
+         if (fd >= 0) {
+            close(fd);
+         }
+      }
+#endif
+   }
+
+   node_traffic_counters(const node_traffic_counters&) = delete;
+   node_traffic_counters& operator=(const node_traffic_counters&) = delete;
+
+   bool available() const { return fds_[ 0 ] >= 0 && fds_[ 1 ] >= 0; }
+
+   // running totals since construction
+   node_traffic_t read() const {
+      node_traffic_t t;
+#if defined(__linux__)
+      uint64_t buf[ 3 ];
+      if (available() && ::read(fds_[ 0 ], buf, sizeof(buf)) == static_cast<ssize_t>(sizeof(buf)) && buf[ 0 ] == 2) {
+         t.local_loads = buf[ 1 ];
+         t.remote_loads = buf[ 2 ];
+      }
+#endif
+      return t;
+   }
+
+private:
+   std::array<int, 2> fds_ { -1, -1 };
+};
@@ -360,10 +360,22 @@ inline T unaligned_load(void const* ptr) noexcept {
     return t;
 }
 
+// Local change: where a table gets its raw memory. Any type with static
+// allocate(bytes) / deallocate(ptr) will do; maps default to this one.
+struct malloc_raw_allocator {
+    static void* allocate(size_t bytes) noexcept {
+        return std::malloc(bytes);
+    }
+    static void deallocate(void* ptr) noexcept {
+        std::free(ptr);
+    }
+};
+
 // Allocates bulks of memory for objects of type T. This deallocates the memory in the destructor,
 // and keeps a linked list of the allocated memory around. Overhead per allocation is the size of a
 // pointer.
-template <typename T, size_t MinNumAllocs = 4, size_t MaxNumAllocs = 256>
+template <typename T, size_t MinNumAllocs = 4, size_t MaxNumAllocs = 256,
+          typename RawAllocator = malloc_raw_allocator>
 class BulkPoolAllocator {
 public:
     BulkPoolAllocator() noexcept = default;
@@ -405,7 +417,7 @@ public:
         while (mListForFree) {
             T* tmp = *mListForFree;
             ROBIN_HOOD_LOG("std::free")
-            std::free(mListForFree);
+            RawAllocator::deallocate(mListForFree);
             mListForFree = reinterpret_cast_no_cast_align_warning<T**>(tmp);
         }
         mHead = nullptr;
@@ -441,7 +453,7 @@ public:
         if (numBytes < ALIGNMENT + ALIGNED_SIZE) {
             // not enough data for at least one element. Free and return.
             ROBIN_HOOD_LOG("std::free")
-            std::free(ptr);
+            RawAllocator::deallocate(ptr);
         } else {
             ROBIN_HOOD_LOG("add to buffer")
             add(ptr, numBytes);
@@ -510,7 +522,7 @@ private:
         size_t const bytes = ALIGNMENT + ALIGNED_SIZE * numElementsToAlloc;
         ROBIN_HOOD_LOG("std::malloc " << bytes << " = " << ALIGNMENT << " + " << ALIGNED_SIZE
                                       << " * " << numElementsToAlloc)
-        add(assertNotNull<std::bad_alloc>(std::malloc(bytes)), bytes);
+        add(assertNotNull<std::bad_alloc>(RawAllocator::allocate(bytes)), bytes);
         return mHead;
     }
 
@@ -537,22 +549,23 @@ private:
     T** mListForFree{nullptr};
 };
 
-template <typename T, size_t MinSize, size_t MaxSize, bool IsFlat>
+template <typename T, size_t MinSize, size_t MaxSize, bool IsFlat, typename RawAllocator>
 struct NodeAllocator;
 
 // dummy allocator that does nothing
-template <typename T, size_t MinSize, size_t MaxSize>
-struct NodeAllocator<T, MinSize, MaxSize, true> {
+template <typename T, size_t MinSize, size_t MaxSize, typename RawAllocator>
+struct NodeAllocator<T, MinSize, MaxSize, true, RawAllocator> {
 
     // we are not using the data, so just free it.
     void addOrFree(void* ptr, size_t ROBIN_HOOD_UNUSED(numBytes) /*unused*/) noexcept {
         ROBIN_HOOD_LOG("std::free")
-        std::free(ptr);
+        RawAllocator::deallocate(ptr);
     }
 };
 
-template <typename T, size_t MinSize, size_t MaxSize>
-struct NodeAllocator<T, MinSize, MaxSize, false> : public BulkPoolAllocator<T, MinSize, MaxSize> {};
+template <typename T, size_t MinSize, size_t MaxSize, typename RawAllocator>
+struct NodeAllocator<T, MinSize, MaxSize, false, RawAllocator>
+    : public BulkPoolAllocator<T, MinSize, MaxSize, RawAllocator> {};
 
 // c++14 doesn't have is_nothrow_swappable, and clang++ 6.0.1 doesn't like it either, so I'm making
 // my own here.
@@ -905,7 +918,7 @@ struct WrapKeyEqual : public T {
 // boolean to the front.
 // https://www.reddit.com/r/cpp/comments/ahp6iu/compile_time_binary_size_reductions_and_cs_future/eeguck4/
 template <bool IsFlat, size_t MaxLoadFactor100, typename Key, typename T, typename Hash,
-          typename KeyEqual>
+          typename KeyEqual, typename RawAllocator = malloc_raw_allocator>
 class Table
     : public WrapHash<Hash>,
       public WrapKeyEqual<KeyEqual>,
@@ -913,7 +926,7 @@ class Table
           typename std::conditional<
               std::is_void<T>::value, Key,
               robin_hood::pair<typename std::conditional<IsFlat, Key, Key const>::type, T>>::type,
-          4, 16384, IsFlat> {
+          4, 16384, IsFlat, RawAllocator> {
 public:
     static constexpr bool is_flat = IsFlat;
     static constexpr bool is_map = !std::is_void<T>::value;
@@ -929,7 +942,8 @@ public:
     using size_type = size_t;
     using hasher = Hash;
     using key_equal = KeyEqual;
-    using Self = Table<IsFlat, MaxLoadFactor100, key_type, mapped_type, hasher, key_equal>;
+    using Self =
+        Table<IsFlat, MaxLoadFactor100, key_type, mapped_type, hasher, key_equal, RawAllocator>;
 
 private:
     static_assert(MaxLoadFactor100 > 10 && MaxLoadFactor100 < 100,
@@ -946,7 +960,7 @@ private:
     static constexpr uint8_t InitialInfoInc = 1U << InitialInfoNumBits;
     static constexpr size_t InfoMask = InitialInfoInc - 1U;
     static constexpr uint8_t InitialInfoHashShift = 0;
-    using DataPool = detail::NodeAllocator<value_type, 4, 16384, IsFlat>;
+    using DataPool = detail::NodeAllocator<value_type, 4, 16384, IsFlat, RawAllocator>;
 
     // type needs to be wider than uint8_t.
     using InfoType = uint32_t;
@@ -1334,7 +1348,8 @@ private:
 #endif
         }
 
-        friend class Table<IsFlat, MaxLoadFactor100, key_type, mapped_type, hasher, key_equal>;
+        friend class Table<IsFlat, MaxLoadFactor100, key_type, mapped_type, hasher, key_equal,
+                           RawAllocator>;
         NodePtr mKeyVals{nullptr};
         uint8_t const* mInfo{nullptr};
     };
@@ -1594,7 +1609,7 @@ public:
                                           << numElementsWithBuffer << ")")
             mHashMultiplier = o.mHashMultiplier;
             mKeyVals = static_cast<Node*>(
-                detail::assertNotNull<std::bad_alloc>(std::malloc(numBytesTotal)));
+                detail::assertNotNull<std::bad_alloc>(RawAllocator::allocate(numBytesTotal)));
             // no need for calloc because clonData does memcpy
             mInfo = reinterpret_cast<uint8_t*>(mKeyVals + numElementsWithBuffer);
             mNumElements = o.mNumElements;
@@ -1643,7 +1658,7 @@ public:
             if (0 != mMask) {
                 // only deallocate if we actually have data!
                 ROBIN_HOOD_LOG("std::free")
-                std::free(mKeyVals);
+                RawAllocator::deallocate(mKeyVals);
             }
 
             auto const numElementsWithBuffer = calcNumElementsWithBuffer(o.mMask + 1);
@@ -1651,7 +1666,7 @@ public:
             ROBIN_HOOD_LOG("std::malloc " << numBytesTotal << " = calcNumBytesTotal("
                                           << numElementsWithBuffer << ")")
             mKeyVals = static_cast<Node*>(
-                detail::assertNotNull<std::bad_alloc>(std::malloc(numBytesTotal)));
+                detail::assertNotNull<std::bad_alloc>(RawAllocator::allocate(numBytesTotal)));
 
             // no need for calloc here because cloneData performs a memcpy.
             mInfo = reinterpret_cast<uint8_t*>(mKeyVals + numElementsWithBuffer);
@@ -2240,7 +2255,7 @@ private:
             if (oldKeyVals != reinterpret_cast_no_cast_align_warning<Node*>(&mMask)) {
                 // don't destroy old data: put it into the pool instead
                 if (forceFree) {
-                    std::free(oldKeyVals);
+                    RawAllocator::deallocate(oldKeyVals);
                 } else {
                     DataPool::addOrFree(oldKeyVals, calcNumBytesTotal(oldMaxElementsWithBuffer));
                 }
@@ -2327,7 +2342,7 @@ private:
         ROBIN_HOOD_LOG("std::calloc " << numBytesTotal << " = calcNumBytesTotal("
                                       << numElementsWithBuffer << ")")
         mKeyVals = reinterpret_cast<Node*>(
-            detail::assertNotNull<std::bad_alloc>(std::malloc(numBytesTotal)));
+            detail::assertNotNull<std::bad_alloc>(RawAllocator::allocate(numBytesTotal)));
         mInfo = reinterpret_cast<uint8_t*>(mKeyVals + numElementsWithBuffer);
         std::memset(mInfo, 0, numBytesTotal - numElementsWithBuffer * sizeof(Node));
 
@@ -2476,7 +2491,7 @@ private:
         // [-Werror=free-nonheap-object]
         if (mKeyVals != reinterpret_cast_no_cast_align_warning<Node*>(&mMask)) {
             ROBIN_HOOD_LOG("std::free")
-            std::free(mKeyVals);
+            RawAllocator::deallocate(mKeyVals);
         }
     }
 
@@ -2507,37 +2522,44 @@ private:
 // map
 
 template <typename Key, typename T, typename Hash = hash<Key>,
-          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80>
-using unordered_flat_map = detail::Table<true, MaxLoadFactor100, Key, T, Hash, KeyEqual>;
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          typename RawAllocator = detail::malloc_raw_allocator>
+using unordered_flat_map =
+    detail::Table<true, MaxLoadFactor100, Key, T, Hash, KeyEqual, RawAllocator>;
 
 template <typename Key, typename T, typename Hash = hash<Key>,
-          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80>
-using unordered_node_map = detail::Table<false, MaxLoadFactor100, Key, T, Hash, KeyEqual>;
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          typename RawAllocator = detail::malloc_raw_allocator>
+using unordered_node_map =
+    detail::Table<false, MaxLoadFactor100, Key, T, Hash, KeyEqual, RawAllocator>;
 
 template <typename Key, typename T, typename Hash = hash<Key>,
-          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80>
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          typename RawAllocator = detail::malloc_raw_allocator>
 using unordered_map =
     detail::Table<sizeof(robin_hood::pair<Key, T>) <= sizeof(size_t) * 6 &&
                       std::is_nothrow_move_constructible<robin_hood::pair<Key, T>>::value &&
                       std::is_nothrow_move_assignable<robin_hood::pair<Key, T>>::value,
-                  MaxLoadFactor100, Key, T, Hash, KeyEqual>;
+                  MaxLoadFactor100, Key, T, Hash, KeyEqual, RawAllocator>;
 
 // set
 
 template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
-          size_t MaxLoadFactor100 = 80>
-using unordered_flat_set = detail::Table<true, MaxLoadFactor100, Key, void, Hash, KeyEqual>;
+          size_t MaxLoadFactor100 = 80, typename RawAllocator = detail::malloc_raw_allocator>
+using unordered_flat_set =
+    detail::Table<true, MaxLoadFactor100, Key, void, Hash, KeyEqual, RawAllocator>;
 
 template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
-          size_t MaxLoadFactor100 = 80>
-using unordered_node_set = detail::Table<false, MaxLoadFactor100, Key, void, Hash, KeyEqual>;
+          size_t MaxLoadFactor100 = 80, typename RawAllocator = detail::malloc_raw_allocator>
+using unordered_node_set =
+    detail::Table<false, MaxLoadFactor100, Key, void, Hash, KeyEqual, RawAllocator>;
 
 template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
-          size_t MaxLoadFactor100 = 80>
+          size_t MaxLoadFactor100 = 80, typename RawAllocator = detail::malloc_raw_allocator>
 using unordered_set = detail::Table<sizeof(Key) <= sizeof(size_t) * 6 &&
                                         std::is_nothrow_move_constructible<Key>::value &&
                                         std::is_nothrow_move_assignable<Key>::value,
-                                    MaxLoadFactor100, Key, void, Hash, KeyEqual>;
+                                    MaxLoadFactor100, Key, void, Hash, KeyEqual, RawAllocator>;
 
 } // namespace robin_hood
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "./thread_affinity.h"
+
+/*
+   Single-writer sequence lock over a small trivially copyable record,
+   on its own cache line.
+
+   The writer never waits: store() bumps the version to odd, writes the
+   record and bumps it to even again. Readers copy the record and keep
+   it only if the version was even and unchanged around the copy;
+   try_load() makes exactly one such attempt (wait-free, may fail while
+   a store is in flight), load() retries until it succeeds. The record
+   is kept in relaxed atomic words, so a torn read is a discarded retry
+   rather than a data race.
+*/
+template <typename T>
+class alignas(64) seqlock {
+   static_assert(std::is_trivially_copyable_v<T>, "seqlock payload must be trivially copyable");
+   static_assert(sizeof(T) % sizeof(uint64_t) == 0, "seqlock payload must be a whole number of 64-bit words");
+
+   static constexpr size_t WORDS = sizeof(T) / sizeof(uint64_t);
+
+public:
+   // writer thread only
+   void store(const T& value) {
+      uint64_t v = version_.load(std::memory_order_relaxed);
+      version_.store(v + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      uint64_t words[ WORDS ];
+      std::memcpy(words, &value, sizeof(T));
+      for (size_t i = 0; i < WORDS; i++) {
+         data_[ i ].store(words[ i ], std::memory_order_relaxed);
+      }
+      version_.store(v + 2, std::memory_order_release);
+   }
+
+   bool try_load(T& out) const {
+      uint64_t before = version_.load(std::memory_order_acquire);
+      if (before & 1) {
+         return false;
+      }
+      uint64_t words[ WORDS ];
+      for (size_t i = 0; i < WORDS; i++) {
+         words[ i ] = data_[ i ].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (version_.load(std::memory_order_relaxed) != before) {
+         return false;
+      }
+      std::memcpy(&out, words, sizeof(T));
+      return true;
+   }
+
+   T load() const {
+      T out;
+      while (!try_load(out)) {
+         cpu_relax();
+      }
+      return out;
+   }
+
+   // even and unchanged between two calls: nothing was stored in between
+   uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+private:
+   std::atomic<uint64_t> version_ { 0 };
+   std::atomic<uint64_t> data_[ WORDS ] {};
+};
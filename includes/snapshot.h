@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "./types.h"
+
+/*
+   Point-in-time book image written by orderbook::capture_snapshot().
+
+   Layout: snapshot_header_t, then for each non-empty level a
+   snapshot_level_t followed by that level's orders as raw order_t
+   records in priority order. Levels come bids from the best bid down,
+   then asks from the best ask up, except that a stepped capture writes
+   a level early when the book is about to change it. last_sequence is
+   the journal sequence of the last event the book had logged, so
+   recovery replays only records after it.
+*/
+
+constexpr char SNAPSHOT_MAGIC[8] = { 'O','B','S','N','A','P','0','1' };
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+BEGIN_PACKED
+PACKED_STRUCT snapshot_header_t {
+   char magic[8];
+   uint32_t version;
+   char ticker[ TICKER_LEN ];
+   uint64_t last_sequence;
+   uint64_t order_count;
+   uint32_t level_count;
+   uint32_t order_size;
+};
+END_PACKED
+
+BEGIN_PACKED
+PACKED_STRUCT snapshot_level_t {
+   uint8_t side;
+   uint8_t reserved[3];
+   uint32_t price;
+   uint64_t order_count;
+   uint64_t total_qty;
+};
+END_PACKED
+
+// Checks an image's header; throws std::runtime_error when it is truncated or not this format.
+static inline snapshot_header_t read_snapshot_header(const char* data, size_t len) {
+   snapshot_header_t header;
+   if (len < sizeof(header)) {
+      throw std::runtime_error("Snapshot image truncated");
+   }
+   std::memcpy(&header, data, sizeof(header));
+   if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != SNAPSHOT_VERSION ||
+       header.order_size != sizeof(order_t)) {
+      throw std::runtime_error("Unsupported snapshot image");
+   }
+   if (header.order_count > (len - sizeof(header)) / sizeof(order_t)) {
+      throw std::runtime_error("Snapshot image truncated");
+   }
+   return header;
+}
+
+/*
+   Walks the level records after a checked header, calling
+   on_level(level, orders) with each level and its raw order_t records.
+   Throws std::runtime_error on a truncated image or a corrupt level: a
+   price above max_price, an unknown side, no orders (which would move
+   the best price) or more orders than bytes left.
+*/
+template <typename OnLevel>
+static inline void read_snapshot_levels(const char* data, size_t len, const snapshot_header_t& header,
+                                        uint32_t max_price, OnLevel&& on_level) {
+   const char* cursor = data + sizeof(header);
+   const char* end = data + len;
+
+   for (uint32_t l = 0; l < header.level_count; l++) {
+      snapshot_level_t lvl;
+      if (static_cast<size_t>(end - cursor) < sizeof(lvl)) {
+         throw std::runtime_error("Snapshot image truncated");
+      }
+      std::memcpy(&lvl, cursor, sizeof(lvl));
+      cursor += sizeof(lvl);
+
+      // divide rather than multiply: a corrupt count must not wrap
+      if (lvl.price > max_price || lvl.side > static_cast<uint8_t>(order_side::SELL) || lvl.order_count == 0 ||
+          lvl.order_count > static_cast<size_t>(end - cursor) / sizeof(order_t)) {
+         throw std::runtime_error("Corrupt snapshot level");
+      }
+      on_level(lvl, cursor);
+      cursor += lvl.order_count * sizeof(order_t);
+   }
+}
+
+// Writes to "<path>.tmp" and renames, so a crash never leaves a torn snapshot.
+static inline void write_snapshot_file(const std::string& path, const std::vector<char>& image) {
+   std::string tmp = path + ".tmp";
+   {
+      std::ofstream out(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+      if (!out.is_open()) {
+         throw std::runtime_error("Failed to open snapshot file: " + tmp);
+      }
+      out.write(image.data(), static_cast<std::streamsize>(image.size()));
+      out.flush();
+      if (!out) {
+         throw std::runtime_error("Failed to write snapshot file: " + tmp);
+      }
+   }
+   if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+      throw std::runtime_error("Failed to rename snapshot file: " + path);
+   }
+}
+
+static inline std::vector<char> read_snapshot_file(const std::string& path) {
+   std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+   if (!in.is_open()) {
+      throw std::runtime_error("Failed to open snapshot file: " + path);
+   }
+   std::vector<char> image(static_cast<size_t>(in.tellg()));
+   in.seekg(0);
+   in.read(image.data(), static_cast<std::streamsize>(image.size()));
+   if (!in) {
+      throw std::runtime_error("Failed to read snapshot file: " + path);
+   }
+   return image;
+}
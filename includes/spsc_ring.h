@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/*
+   Single-producer / single-consumer ring with a fixed in-place layout,
+   so it can live in memory shared between processes (no pointers, no
+   constructor run in the mapping, only address-free lock-free atomics).
+
+   Each side keeps a private copy of the other side's index and only
+   re-reads the shared one when the copy says the ring is full / empty,
+   which keeps the index cache lines from bouncing on every message.
+   init() must run once before either side uses the ring.
+*/
+template <typename T, size_t N>
+struct spsc_ring {
+   static_assert((N & (N - 1)) == 0, "spsc_ring size must be a power of two");
+   static_assert(std::is_trivially_copyable_v<T>, "spsc_ring payload must be trivially copyable");
+   static_assert(std::atomic<uint64_t>::is_always_lock_free, "spsc_ring needs lock-free 64-bit atomics");
+
+   alignas(64) std::atomic<uint64_t> head;   // next slot the producer writes
+   uint64_t cached_tail;                     // producer's view of tail
+
+   alignas(64) std::atomic<uint64_t> tail;   // next slot the consumer reads
+   uint64_t cached_head;                     // consumer's view of head
+
+   alignas(64) T slots[ N ];
+
+   void init() {
+      head.store(0, std::memory_order_relaxed);
+      tail.store(0, std::memory_order_relaxed);
+      cached_tail = 0;
+      cached_head = 0;
+      std::atomic_thread_fence(std::memory_order_release);
+   }
+
+   bool try_push(const T& value) {
+      uint64_t h = head.load(std::memory_order_relaxed);
+      if (h - cached_tail >= N) {
+         cached_tail = tail.load(std::memory_order_acquire);
+         if (h - cached_tail >= N) {
+            return false;
+         }
+      }
+      slots[ h & (N - 1) ] = value;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+   }
+
+   // Zero-copy push: the producer fills the slot try_claim() returns, then
+   // commit() publishes it. nullptr when full; nothing is claimed then.
+   T* try_claim() {
+      uint64_t h = head.load(std::memory_order_relaxed);
+      if (h - cached_tail >= N) {
+         cached_tail = tail.load(std::memory_order_acquire);
+         if (h - cached_tail >= N) {
+            return nullptr;
+         }
+      }
+      return &slots[ h & (N - 1) ];
+   }
+
+   void commit() {
+      head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+   }
+
+   bool try_pop(T& out) {
+      uint64_t t = tail.load(std::memory_order_relaxed);
+      if (t == cached_head) {
+         cached_head = head.load(std::memory_order_acquire);
+         if (t == cached_head) {
+            return false;
+         }
+      }
+      out = slots[ t & (N - 1) ];
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+   }
+
+   // Approximate from either side; exact when quiescent.
+   size_t size_approx() const {
+      return static_cast<size_t>(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+   }
+
+   static constexpr size_t capacity() { return N; }
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+   #include <immintrin.h>
+#endif
+
+#include "./numa.h"
+#include "./types.h"
+
+/*
+   Thread placement (CPU affinity, SCHED_FIFO) and idle strategies for
+   the engine's polling threads.
+
+   Placement is best effort: a CPU that is not in the process's allowed
+   set, or SCHED_FIFO without CAP_SYS_NICE / an RLIMIT_RTPRIO budget,
+   is reported in placement_result_t and the thread keeps running where
+   and how it was. Callers print the error; nothing throws.
+*/
+
+struct placement_result_t {
+   bool pinned = false;
+   bool realtime = false;
+   std::string error;
+};
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+   _mm_pause();
+#elif defined(__aarch64__)
+   asm volatile("yield");
+#endif
+}
+
+// Applies `p` to `thread` (any thread of this process, e.g. std::thread::native_handle()).
+static inline placement_result_t apply_thread_placement(pthread_t thread, const thread_placement_t& p,
+                                                        const char* name = nullptr) {
+   placement_result_t r;
+   if (name) {
+      char short_name[ 16 ];
+      std::snprintf(short_name, sizeof(short_name), "%s", name);
+      pthread_setname_np(thread, short_name);
+   }
+
+   if (p.cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(p.cpu, &set);
+      int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+      if (err == 0) {
+         r.pinned = true;
+      } else {
+         r.error = "cannot pin to CPU " + std::to_string(p.cpu) + ": " + std::strerror(err);
+      }
+   }
+
+   if (p.fifo_priority > 0) {
+      sched_param sp;
+      std::memset(&sp, 0, sizeof(sp));
+      sp.sched_priority = p.fifo_priority;
+      int err = pthread_setschedparam(thread, SCHED_FIFO, &sp);
+      if (err == 0) {
+         r.realtime = true;
+      } else {
+         if (!r.error.empty()) {
+            r.error += "; ";
+         }
+         r.error += "SCHED_FIFO " + std::to_string(p.fifo_priority) + " not permitted: " + std::strerror(err);
+      }
+   }
+   return r;
+}
+
+static inline placement_result_t apply_thread_placement(const thread_placement_t& p, const char* name = nullptr) {
+   return apply_thread_placement(pthread_self(), p, name);
+}
+
+namespace affinity_detail {
+   static inline bool read_sysfs_int(const std::string& path, int& out) {
+      std::FILE* f = std::fopen(path.c_str(), "r");
+      if (!f) {
+         return false;
+      }
+      bool ok = std::fscanf(f, "%d", &out) == 1;
+      std::fclose(f);
+      return ok;
+   }
+
+   // parses a sysfs CPU list such as "2-5,8"
+   static inline std::vector<int> read_cpu_list(const char* path) {
+      std::vector<int> cpus;
+      std::FILE* f = std::fopen(path, "r");
+      if (!f) {
+         return cpus;
+      }
+      char buf[ 1024 ];
+      if (std::fgets(buf, sizeof(buf), f)) {
+         const char* p = buf;
+         while (*p >= '0' && *p <= '9') {
+            char* end;
+            int lo = static_cast<int>(std::strtol(p, &end, 10));
+            int hi = lo;
+            if (*end == '-') {
+               hi = static_cast<int>(std::strtol(end + 1, &end, 10));
+            }
+            for (int c = lo; c <= hi; c++) {
+               cpus.push_back(c);
+            }
+            p = *end == ',' ? end + 1 : end;
+         }
+      }
+      std::fclose(f);
+      return cpus;
+   }
+}
+
+// Physical core of a logical CPU as (package << 16 | core_id); -1 when sysfs has no topology.
+static inline int64_t physical_core_of(int cpu) {
+   std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+   int package = 0, core = 0;
+   if (!affinity_detail::read_sysfs_int(base + "core_id", core)) {
+      return -1;
+   }
+   affinity_detail::read_sysfs_int(base + "physical_package_id", package);
+   return (static_cast<int64_t>(package) << 16) | static_cast<int64_t>(core);
+}
+
+/*
+   Human-readable problems with a placement: two threads on one CPU,
+   threads on SMT siblings of one physical core, CPUs that do not exist,
+   a pinned busy-polling matching thread on a CPU the kernel still
+   schedules other work on (not in isolcpus), SCHED_FIFO busy-polling
+   sharing a CPU with another engine thread (which it would starve), and
+   io threads on a different NUMA node from matching.
+*/
+static inline std::vector<std::string> placement_warnings(const orderbook_config_t& c) {
+   struct role_t { std::string name; thread_placement_t p; };
+   std::vector<role_t> roles = { { "matching", c.matching }, { "logger", c.logger } };
+   for (size_t i = 0; i < c.io.size(); i++) {
+      roles.push_back({ "io" + std::to_string(i), c.io[ i ] });
+   }
+
+   std::vector<std::string> out;
+   int online = static_cast<int>(std::thread::hardware_concurrency());
+   for (const role_t& r : roles) {
+      if (r.p.cpu >= 0 && online > 0 && r.p.cpu >= online) {
+         out.push_back(r.name + " is pinned to CPU " + std::to_string(r.p.cpu) +
+                       " but only " + std::to_string(online) + " CPUs are online");
+      }
+   }
+
+   for (size_t i = 0; i < roles.size(); i++) {
+      for (size_t j = i + 1; j < roles.size(); j++) {
+         const role_t& a = roles[ i ];
+         const role_t& b = roles[ j ];
+         if (a.p.cpu < 0 || b.p.cpu < 0) {
+            continue;
+         }
+         if (a.p.cpu == b.p.cpu) {
+            std::string msg = a.name + " and " + b.name + " share CPU " + std::to_string(a.p.cpu);
+            bool busy = c.idle == idle_strategy::BUSY_POLL;
+            if (busy && (a.name == "matching" || b.name == "matching") && c.matching.fifo_priority > 0) {
+               msg += " (SCHED_FIFO busy-poll will starve the other thread)";
+            }
+            out.push_back(msg);
+            continue;
+         }
+         int64_t core_a = physical_core_of(a.p.cpu);
+         if (core_a >= 0 && core_a == physical_core_of(b.p.cpu)) {
+            out.push_back(a.name + " (CPU " + std::to_string(a.p.cpu) + ") and " + b.name + " (CPU " +
+                          std::to_string(b.p.cpu) + ") are SMT siblings on one physical core");
+         }
+      }
+   }
+
+   if (c.matching.cpu >= 0) {
+      int home = numa_node_of_cpu(c.matching.cpu);
+      for (const role_t& r : roles) {
+         if (r.p.cpu >= 0 && numa_node_of_cpu(r.p.cpu) != home) {
+            out.push_back(r.name + " (CPU " + std::to_string(r.p.cpu) + ", node " +
+                          std::to_string(numa_node_of_cpu(r.p.cpu)) + ") is on a different NUMA node from matching (node " +
+                          std::to_string(home) + "); its hand-offs cross the interconnect");
+         }
+      }
+   }
+
+   if (c.matching.cpu >= 0 && c.idle == idle_strategy::BUSY_POLL) {
+      std::vector<int> isolated = affinity_detail::read_cpu_list("/sys/devices/system/cpu/isolated");
+      bool found = false;
+      for (int cpu : isolated) {
+         found |= cpu == c.matching.cpu;
+      }
+      if (!found) {
+         out.push_back("matching busy-polls on CPU " + std::to_string(c.matching.cpu) +
+                       ", which is not in isolcpus; expect scheduler and IRQ jitter");
+      }
+   }
+   return out;
+}
+
+static inline const char* idle_strategy_name(idle_strategy s) {
+   switch (s) {
+      case idle_strategy::BUSY_POLL: return "busy-poll";
+      case idle_strategy::YIELD:     return "yield";
+      case idle_strategy::BLOCK:     return "block";
+   }
+   return "?";
+}
+
+static inline bool parse_idle_strategy(const std::string& s, idle_strategy& out) {
+   if (s == "busy-poll" || s == "busy") {
+      out = idle_strategy::BUSY_POLL;
+   } else if (s == "yield") {
+      out = idle_strategy::YIELD;
+   } else if (s == "block") {
+      out = idle_strategy::BLOCK;
+   } else {
+      return false;
+   }
+   return true;
+}
+
+/*
+   Waits between empty polling passes according to an idle_strategy.
+   BLOCK backs off: a few hundred pause-spins, then yields, then sleeps
+   in growing steps up to max_sleep_ns, so a briefly idle loop does not
+   pay a kernel wake-up. reset() after every pass that found work.
+*/
+class idle_waiter {
+public:
+   explicit idle_waiter(idle_strategy strategy, uint64_t max_sleep_ns = 100000)
+      : strategy_(strategy), max_sleep_ns_(max_sleep_ns) {}
+
+   void idle() {
+      switch (strategy_) {
+         case idle_strategy::BUSY_POLL:
+            cpu_relax();
+            return;
+         case idle_strategy::YIELD:
+            std::this_thread::yield();
+            return;
+         case idle_strategy::BLOCK:
+            break;
+      }
+      if (idle_passes_ < SPIN_PASSES) {
+         idle_passes_++;
+         cpu_relax();
+      } else if (idle_passes_ < SPIN_PASSES + YIELD_PASSES) {
+         idle_passes_++;
+         std::this_thread::yield();
+      } else {
+         sleep_ns_ = sleep_ns_ ? std::min(sleep_ns_ * 2, max_sleep_ns_) : 1000;
+         timespec ts { 0, static_cast<long>(sleep_ns_) };
+         ::nanosleep(&ts, nullptr);
+      }
+   }
+
+   void reset() {
+      idle_passes_ = 0;
+      sleep_ns_ = 0;
+   }
+
+   idle_strategy strategy() const { return strategy_; }
+
+private:
+   static constexpr uint32_t SPIN_PASSES = 256;
+   static constexpr uint32_t YIELD_PASSES = 16;
+
+   idle_strategy strategy_;
+   uint64_t max_sleep_ns_;
+   uint32_t idle_passes_ = 0;
+   uint64_t sleep_ns_ = 0;
+};
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <vector>
 
 
 constexpr size_t TICKER_LEN = 4;
@@ -91,7 +92,52 @@ PACKED_STRUCT order_t {
 };
 END_PACKED
 
+// What a polling thread does when a pass finds no work.
+enum class idle_strategy : uint8_t {
+   BUSY_POLL=0,   // spin with a pause hint; lowest wake-up latency, burns the core
+   YIELD=1,       // sched_yield between passes
+   BLOCK=2        // sleep in the kernel (epoll timeout, backoff sleep)
+};
+
+// Where one thread runs; see includes/thread_affinity.h.
+struct thread_placement_t {
+   int cpu = -1;               // -1 = leave to the scheduler
+   int fifo_priority = 0;      // > 0: SCHED_FIFO at this priority, when permitted
+};
+
+// Pages behind book memory (ladders, order hives, id index); see includes/book_memory.h.
+enum class page_kind : uint8_t {
+   SYSTEM=0,        // plain malloc, nothing pooled
+   SMALL=1,         // pooled 4K mappings
+   TRANSPARENT=2,   // pooled, 2MB-aligned and madvise(MADV_HUGEPAGE)
+   HUGE_2M=3,       // pooled MAP_HUGETLB 2MB pages
+   HUGE_1G=4        // pooled MAP_HUGETLB 1GB pages
+};
+
+struct book_memory_config_t {
+   page_kind pages = page_kind::SYSTEM;
+   size_t reserve_bytes = 0;   // mapped by configure(), before any book exists
+   size_t chunk_bytes = 0;     // size of later mappings; 0 = 2MB (1GB for HUGE_1G)
+   bool prefault = true;       // fault every page in when it is mapped
+   bool lock = false;          // mlock mappings; needs RLIMIT_MEMLOCK
+   bool numa = false;          // one pool per NUMA node, filled from that node (implies SMALL over SYSTEM)
+};
+
+/*
+   Runtime configuration for an engine process: placement of the thread
+   that owns the books (matching), the journal writer (logger) and any
+   network or transport threads (io), and the pages book memory comes
+   from. Applied by the binaries at startup; see placement_warnings() for
+   the shared-core checks and book_memory::configure().
+*/
 struct orderbook_config_t {
-   bool enable_logging;
+   bool enable_logging = false;
    std::string log_filename;
+
+   thread_placement_t matching;
+   thread_placement_t logger;
+   std::vector<thread_placement_t> io;
+   idle_strategy idle = idle_strategy::BLOCK;
+
+   book_memory_config_t memory;
 };
\ No newline at end of file
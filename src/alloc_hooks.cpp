@@ -0,0 +1,74 @@
+/*
+   Counting malloc hooks for alloc_tracker. Linking this file into an
+   executable interposes the malloc family: every call bumps the calling
+   thread's alloc_tracker::counts and forwards to glibc's own allocator.
+   Meant for tests and benchmarks, not production binaries. Outside glibc
+   it compiles to nothing and alloc_tracker::hooks_installed() stays false.
+*/
+
+#include <cerrno>
+#include <cstddef>
+
+#include "../includes/alloc_tracker.h"
+
+#if defined(__GLIBC__)
+
+extern "C" {
+   void* __libc_malloc(size_t bytes);
+   void* __libc_calloc(size_t count, size_t bytes);
+   void* __libc_realloc(void* p, size_t bytes);
+   void* __libc_memalign(size_t alignment, size_t bytes);
+   void __libc_free(void* p);
+
+   void* malloc(size_t bytes) {
+      alloc_tracker::counts.heap_allocations++;
+      alloc_tracker::counts.heap_bytes += bytes;
+      return __libc_malloc(bytes);
+   }
+
+   void* calloc(size_t count, size_t bytes) {
+      alloc_tracker::counts.heap_allocations++;
+      alloc_tracker::counts.heap_bytes += count * bytes;
+      return __libc_calloc(count, bytes);
+   }
+
+   // a realloc that moves is an allocation; counting every call keeps the hook cheap
+   void* realloc(void* p, size_t bytes) {
+      alloc_tracker::counts.heap_allocations++;
+      alloc_tracker::counts.heap_bytes += bytes;
+      return __libc_realloc(p, bytes);
+   }
+
+   void* memalign(size_t alignment, size_t bytes) {
+      alloc_tracker::counts.heap_allocations++;
+      alloc_tracker::counts.heap_bytes += bytes;
+      return __libc_memalign(alignment, bytes);
+   }
+
+   void* aligned_alloc(size_t alignment, size_t bytes) {
+      return memalign(alignment, bytes);
+   }
+
+   int posix_memalign(void** out, size_t alignment, size_t bytes) {
+      if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+         return EINVAL;
+      }
+      void* p = memalign(alignment, bytes);
+      if (!p) {
+         return ENOMEM;
+      }
+      *out = p;
+      return 0;
+   }
+
+   void free(void* p) {
+      if (p) {
+         alloc_tracker::counts.heap_frees++;
+      }
+      __libc_free(p);
+   }
+}
+
+[[maybe_unused]] static const bool hooks_registered = (alloc_tracker::installed.store(true), true);
+
+#endif
@@ -0,0 +1,323 @@
+#include "book_fork.h"
+
+#include <algorithm>
+
+book_fork orderbook::fork() const {
+   return book_fork(*this);
+}
+
+book_fork::book_fork(const orderbook& base)
+   : base_(&base),
+     best_bid_price_(base.best_bid_price_),
+     best_ask_price_(base.best_ask_price_),
+     order_count_(base.order_count())
+{
+}
+
+order_result book_fork::add(const order_t& order) {
+   order_id_key key = key_of(order);
+   located_t existing;
+   if (locate(key, existing)) {
+      return order_result::DUPLICATE_ID;
+   }
+   if (order.side != static_cast<uint8_t>(order_side::BUY) && order.side != static_cast<uint8_t>(order_side::SELL)) {
+      return order_result::INVALID_SIDE;
+   }
+   if (order.price > MAX_PRICE) {
+      return order_result::INVALID_PRICE;
+   }
+
+   insert_own(key, order);
+   order_count_++;
+   return order_result::SUCCESS;
+}
+
+// like orderbook::modify(): the order leaves its queue position and rejoins at the new price
+order_result book_fork::modify(const order_id_key& id, const order_t& new_order) {
+   located_t where;
+   if (!locate(id, where)) {
+      return order_result::ORDER_NOT_FOUND;
+   }
+   if (new_order.price > MAX_PRICE) {
+      return order_result::INVALID_PRICE;
+   }
+   order_side new_side = static_cast<order_side>(new_order.side);
+   if (new_side != order_side::BUY && new_side != order_side::SELL) {
+      return order_result::INVALID_SIDE;
+   }
+
+   remove(id, where);
+   insert_own(id, new_order);
+   return order_result::SUCCESS;
+}
+
+order_result book_fork::cancel(const order_id_key& id) {
+   located_t where;
+   if (!locate(id, where)) {
+      return order_result::ORDER_NOT_FOUND;
+   }
+   remove(id, where);
+   order_count_--;
+   return order_result::SUCCESS;
+}
+
+// same matching as orderbook::execute_impl(); a level's queue is its base orders from `next`, then its own
+size_t book_fork::execute() {
+   size_t fills = 0;
+
+   while (best_bid_price_ >= best_ask_price_) {
+      if (level_empty(order_side::BUY, best_bid_price_) ||
+          level_empty(order_side::SELL, best_ask_price_)) {
+         break;
+      }
+
+      fork_level& bid_level = touch_level(order_side::BUY, best_bid_price_);
+      fork_level& ask_level = touch_level(order_side::SELL, best_ask_price_);
+
+      bool bid_in_base = base_head(bid_level);
+      bool ask_in_base = base_head(ask_level);
+      order_t bid_order = bid_in_base ? *bid_level.next : *bid_level.own.begin();
+      order_t ask_order = ask_in_base ? *ask_level.next : *ask_level.own.begin();
+      if (bid_in_base) {
+         bid_order.qty = bid_level.next_qty;
+      }
+      if (ask_in_base) {
+         ask_order.qty = ask_level.next_qty;
+      }
+
+      size_t match_qty = (bid_order.qty < ask_order.qty
+                             ? bid_order.qty
+                             : ask_order.qty);
+
+      bid_order.qty -= match_qty;
+      ask_order.qty -= match_qty;
+      (bid_in_base ? bid_level.next_qty : bid_level.own.begin()->qty) = bid_order.qty;
+      (ask_in_base ? ask_level.next_qty : ask_level.own.begin()->qty) = ask_order.qty;
+      bid_level.total_qty -= match_qty;
+      ask_level.total_qty -= match_qty;
+      fills++;
+
+      if (fill_listener_) {
+         fill_listener_->on_fill(bid_order, ask_order, match_qty);
+      }
+
+      if (bid_order.qty == 0) {
+         if (bid_in_base) {
+            removed_.insert(key_of(bid_order));
+            ++bid_level.next;
+            settle(bid_level);
+         } else {
+            own_ids_.erase(key_of(bid_order));
+            bid_level.own.erase(bid_level.own.begin());
+         }
+         bid_level.count--;
+         order_count_--;
+      }
+      if (ask_order.qty == 0) {
+         if (ask_in_base) {
+            removed_.insert(key_of(ask_order));
+            ++ask_level.next;
+            settle(ask_level);
+         } else {
+            own_ids_.erase(key_of(ask_order));
+            ask_level.own.erase(ask_level.own.begin());
+         }
+         ask_level.count--;
+         order_count_--;
+      }
+
+      if (bid_level.count == 0) {
+         bid_level.total_qty = 0;
+         update_best_bid_on_cancel(best_bid_price_);
+      }
+      if (ask_level.count == 0) {
+         ask_level.total_qty = 0;
+         update_best_ask_on_cancel(best_ask_price_);
+      }
+   }
+   return fills;
+}
+
+std::optional<uint32_t> book_fork::best_bid() const {
+   if (best_bid_price_ == 0 && level_empty(order_side::BUY, 0)) {
+      return std::nullopt;
+   }
+   return best_bid_price_;
+}
+
+std::optional<uint32_t> book_fork::best_ask() const {
+   if (best_ask_price_ > MAX_PRICE || level_empty(order_side::SELL, best_ask_price_)) {
+      return std::nullopt;
+   }
+   return best_ask_price_;
+}
+
+bool book_fork::contains(const order_id_key& id) const {
+   located_t where;
+   return locate(id, where);
+}
+
+std::optional<order_t> book_fork::find(const order_id_key& id) const {
+   located_t where;
+   if (!locate(id, where)) {
+      return std::nullopt;
+   }
+   return where.order;
+}
+
+size_t book_fork::level_qty(order_side side, uint32_t price) const {
+   if (price > MAX_PRICE) {
+      return 0;
+   }
+   if (const fork_level* level = overlay(side, price)) {
+      return level->total_qty;
+   }
+   return base_->level_qty(side, price);
+}
+
+const book_fork::fork_level* book_fork::overlay(order_side side, uint32_t price) const {
+   int s = static_cast<int>(side);
+   if (price < touched_lo_[ s ] || price > touched_hi_[ s ]) {
+      return nullptr;
+   }
+   auto it = levels_.find(level_key(side, price));
+   return it == levels_.end() ? nullptr : &it->second;
+}
+
+book_fork::fork_level& book_fork::touch_level(order_side side, uint32_t price) {
+   auto [it, inserted] = levels_.try_emplace(level_key(side, price));
+   fork_level& level = it->second;
+   if (!inserted) {
+      return level;
+   }
+
+   int s = static_cast<int>(side);
+   touched_lo_[ s ] = std::min(touched_lo_[ s ], price);
+   touched_hi_[ s ] = std::max(touched_hi_[ s ], price);
+
+   level.base = base_->find_level(side, price);
+   if (level.base) {
+      level.next = level.base->orders.begin();
+      level.count = level.base->orders.size();
+      level.total_qty = level.base->total_qty;
+      settle(level);
+   }
+   return level;
+}
+
+// moves `next` past base orders the fork has removed and picks up the new head's qty
+void book_fork::settle(fork_level& level) {
+   auto end = level.base->orders.end();
+   if (!removed_.empty()) {
+      while (level.next != end && removed_.contains(key_of(*level.next))) {
+         ++level.next;
+      }
+   }
+   level.next_qty = level.next != end ? level.next->qty : 0;
+}
+
+bool book_fork::level_empty(order_side side, uint32_t price) const {
+   if (const fork_level* level = overlay(side, price)) {
+      return level->count == 0;
+   }
+   const price_level* level = base_->find_level(side, price);
+   return !level || level->orders.empty();
+}
+
+// the order as this fork sees it: one it added, else the base's unless the fork removed it
+bool book_fork::locate(const order_id_key& id, located_t& out) const {
+   auto own = own_ids_.find(id);
+   if (own != own_ids_.end()) {
+      out.order = *own->second.location_in_hive;
+      out.own = true;
+      return true;
+   }
+   auto it = base_->state_->order_id_lookup.find(id);
+   if (it == base_->state_->order_id_lookup.end() || (!removed_.empty() && removed_.contains(id))) {
+      return false;
+   }
+   const order_t& resting = *it->second.location_in_hive;
+   out.order = resting;
+   out.own = false;
+   // the queue head may be partly filled in the fork
+   const fork_level* level = overlay(static_cast<order_side>(resting.side), it->second.price);
+   if (level && base_head(*level) && &*level->next == &resting) {
+      out.order.qty = level->next_qty;
+   }
+   return true;
+}
+
+void book_fork::insert_own(const order_id_key& id, const order_t& order) {
+   order_side side = static_cast<order_side>(order.side);
+   fork_level& level = touch_level(side, order.price);
+
+   order_location loc;
+   loc.price = order.price;
+   loc.location_in_hive = level.own.insert(order);
+   own_ids_[ id ] = loc;
+   level.count++;
+   level.total_qty += order.qty;
+
+   if (side == order_side::BUY) {
+      if (order.price > best_bid_price_) {
+         best_bid_price_ = order.price;
+      }
+   } else if (order.price < best_ask_price_) {
+      best_ask_price_ = order.price;
+   }
+}
+
+// `where` is what locate(id) found
+void book_fork::remove(const order_id_key& id, const located_t& where) {
+   order_side side = static_cast<order_side>(where.order.side);
+   fork_level& level = touch_level(side, where.order.price);
+
+   if (where.own) {
+      auto it = own_ids_.find(id);
+      level.own.erase(it->second.location_in_hive);
+      own_ids_.erase(it);
+   } else {
+      removed_.insert(id);
+      if (base_head(level) && key_of(*level.next) == id) {
+         ++level.next;
+         settle(level);
+      }
+   }
+   level_removed(level, side, where.order.price, where.order.qty);
+}
+
+void book_fork::level_removed(fork_level& level, order_side side, uint32_t price, size_t qty) {
+   level.count--;
+   level.total_qty -= qty;
+   if (level.count == 0) {
+      level.total_qty = 0;
+      if (side == order_side::BUY) {
+         update_best_bid_on_cancel(price);
+      } else {
+         update_best_ask_on_cancel(price);
+      }
+   }
+}
+
+void book_fork::update_best_bid_on_cancel(uint32_t price) {
+   if (price == best_bid_price_) {
+      while (best_bid_price_ > 0 && level_empty(order_side::BUY, best_bid_price_)) {
+         best_bid_price_--;
+      }
+      if (level_empty(order_side::BUY, best_bid_price_)) {
+         best_bid_price_ = 0;
+      }
+   }
+}
+
+void book_fork::update_best_ask_on_cancel(uint32_t price) {
+   if (price == best_ask_price_) {
+      while (best_ask_price_ <= MAX_PRICE &&
+             level_empty(order_side::SELL, best_ask_price_)) {
+         best_ask_price_++;
+      }
+      if (best_ask_price_ > MAX_PRICE) {
+         best_ask_price_ = MAX_PRICE + 1;
+      }
+   }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#include "orderbook.h"
+
+/*
+   Copy-on-write fork of an orderbook, for pre-trade and risk what-ifs
+   ("what if this order arrives and execute() runs?") against a live
+   book without mutating or copying it.
+
+   Creating a fork is O(1): it only records the base's best prices and
+   order count. Untouched levels and orders are read straight from the
+   base. The first mutation at a price gives the fork an overlay for that
+   level: a cursor into the base level's queue (orders before it have
+   been filled in the fork), what is left of the order at the cursor, and
+   a fork-owned hive for orders the fork adds there, queued behind the
+   base ones. Base orders the fork cancels or moves are recorded by id.
+   Nothing is copied per order, so a sweep costs about what it costs on
+   the real book: one overlay per level it reaches plus one id per fill.
+
+   Matching follows orderbook::execute(), without logging or timestamps.
+   The base must outlive the fork and must not change while the fork is
+   in use; forks are single-threaded like the book itself.
+*/
+class book_fork {
+public:
+   explicit book_fork(const orderbook& base);
+
+   book_fork(book_fork&&) noexcept = default;
+   book_fork& operator=(book_fork&&) noexcept = default;
+   book_fork(const book_fork&) = delete;
+   book_fork& operator=(const book_fork&) = delete;
+
+   order_result add(const order_t& order);
+   order_result modify(const order_id_key& id, const order_t& new_order);
+   order_result cancel(const order_id_key& id);
+
+   // returns the number of fills; each one goes to the fill listener, if any
+   size_t execute();
+
+   std::optional<uint32_t> best_bid() const;
+   std::optional<uint32_t> best_ask() const;
+   bool contains(const order_id_key& id) const;
+   std::optional<order_t> find(const order_id_key& id) const;
+   size_t order_count() const { return order_count_; }
+   size_t level_qty(order_side side, uint32_t price) const;
+
+   // levels the fork has mutated, i.e. holds an overlay for
+   size_t touched_levels() const { return levels_.size(); }
+
+   void set_fill_listener(fill_listener* listener) { fill_listener_ = listener; }
+   const orderbook& base() const { return *base_; }
+
+private:
+   struct fork_level {
+      const price_level* base = nullptr;   // nullptr: nothing rests there in the base
+      order_hive::const_iterator next;     // first base order still resting in the fork
+      size_t next_qty = 0;                 // what the fork has left of *next
+      size_t count = 0;                    // orders resting here, base and own
+      size_t total_qty = 0;
+      order_hive own;                      // the fork's orders, behind the base ones
+   };
+
+   // where a visible order lives
+   struct located_t {
+      order_t order;                       // as the fork sees it, qty included
+      bool own = false;
+   };
+
+   static uint32_t level_key(order_side side, uint32_t price) {
+      return (static_cast<uint32_t>(side) << 31) | price;
+   }
+   static order_id_key key_of(const order_t& order) {
+      order_id_key key;
+      std::memcpy(key.order_id, order.order_id, ORDER_ID_LEN);
+      return key;
+   }
+
+   const fork_level* overlay(order_side side, uint32_t price) const;
+   fork_level& touch_level(order_side side, uint32_t price);
+   static bool base_head(const fork_level& level) { return level.base && level.next != level.base->orders.end(); }
+   void settle(fork_level& level);
+   bool level_empty(order_side side, uint32_t price) const;
+   bool locate(const order_id_key& id, located_t& out) const;
+
+   void insert_own(const order_id_key& id, const order_t& order);
+   void remove(const order_id_key& id, const located_t& where);
+   void level_removed(fork_level& level, order_side side, uint32_t price, size_t qty);
+
+   void update_best_bid_on_cancel(uint32_t price);
+   void update_best_ask_on_cancel(uint32_t price);
+
+   const orderbook* base_;
+
+   // node map: levels keep their address while others are added
+   robin_hood::unordered_node_map< uint32_t, fork_level > levels_;
+   // orders the fork added, by id; they live in their level's own hive
+   robin_hood::unordered_map< order_id_key, order_location, order_id_hasher > own_ids_;
+   // base orders no longer in the fork: filled, cancelled or moved away
+   robin_hood::unordered_set< order_id_key, order_id_hasher > removed_;
+
+   // overlaid price range per side; best-price scans only hash inside it
+   uint32_t touched_lo_[ 2 ] = { MAX_PRICE + 1, MAX_PRICE + 1 };
+   uint32_t touched_hi_[ 2 ] = { 0, 0 };
+
+   uint32_t best_bid_price_;
+   uint32_t best_ask_price_;
+   size_t order_count_;
+   fill_listener* fill_listener_ = nullptr;
+};
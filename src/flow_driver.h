@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "../includes/clock.h"
+#include "flow_generator.h"
+#include "orderbook.h"
+
+/*
+   Pushes a generated flow through any engine exposing the orderbook
+   surface (add / modify / cancel / execute). Aggressive adds are
+   followed by execute(), and the timed span covers both. on_latency is
+   called with (flow_msg_kind, raw ticks, order_result) for every message.
+*/
+struct flow_run_stats_t {
+   uint64_t messages = 0;
+   uint64_t rejected = 0;
+   uint64_t seconds_ns = 0;
+};
+
+template <typename engine_t, typename on_latency_t>
+flow_run_stats_t drive_flow(engine_t& engine, const flow_msg_t* msgs, size_t count, on_latency_t&& on_latency) {
+   flow_run_stats_t stats;
+   uint64_t started_ns = monotonic_ns();
+
+   for (size_t i = 0; i < count; i++) {
+      const flow_msg_t& msg = msgs[ i ];
+      flow_msg_kind kind = static_cast<flow_msg_kind>(msg.kind);
+      order_result r;
+
+      uint64_t t0 = tsc_clock::read_ticks();
+      switch (kind) {
+         case flow_msg_kind::ADD:
+            r = engine.add(msg.order);
+            if (msg.aggressive) {
+               engine.execute();
+            }
+            break;
+         case flow_msg_kind::CANCEL: {
+            order_id_key key;
+            std::memcpy(key.order_id, msg.order.order_id, ORDER_ID_LEN);
+            r = engine.cancel(key);
+            break;
+         }
+         case flow_msg_kind::MODIFY:
+         default: {
+            order_id_key key;
+            std::memcpy(key.order_id, msg.order.order_id, ORDER_ID_LEN);
+            r = engine.modify(key, msg.order);
+            break;
+         }
+      }
+      uint64_t t1 = tsc_clock::read_ticks();
+
+      if (r != order_result::SUCCESS) {
+         stats.rejected++;
+      }
+      on_latency(kind, t1 - t0, r);
+   }
+
+   stats.messages = count;
+   stats.seconds_ns = monotonic_ns() - started_ns;
+   return stats;
+}
@@ -0,0 +1,211 @@
+#include "flow_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+flow_generator::flow_generator(const flow_config_t& config)
+   : config_(config),
+     rng_state_(config.seed ? config.seed : 0x9E3779B97F4A7C15ULL),
+     mid_(config.initial_mid)
+{
+   live_.reserve(config.target_live_orders * 2);
+}
+
+// xorshift64*
+uint64_t flow_generator::next_u64() {
+   rng_state_ ^= rng_state_ >> 12;
+   rng_state_ ^= rng_state_ << 25;
+   rng_state_ ^= rng_state_ >> 27;
+   return rng_state_ * 2685821657736338717ULL;
+}
+
+double flow_generator::next_unit() {
+   return static_cast<double>(next_u64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// skewed towards small sizes, like most real order-size distributions
+uint32_t flow_generator::next_qty() {
+   double u = next_unit();
+   uint32_t span = config_.max_qty - config_.min_qty;
+   return config_.min_qty + static_cast<uint32_t>(u * u * u * span);
+}
+
+uint32_t flow_generator::passive_price(order_side side) {
+   // geometric distance from the touch => deep queues near mid, thin tails
+   uint32_t ticks = 0;
+   while (ticks < config_.max_depth_ticks && next_unit() < config_.depth_decay) {
+      ticks++;
+   }
+   int64_t price = side == order_side::BUY
+      ? static_cast<int64_t>(mid_) - 1 - ticks
+      : static_cast<int64_t>(mid_) + 1 + ticks;
+
+   if (price < config_.min_price) {
+      price = config_.min_price;
+   }
+   if (price > config_.max_price) {
+      price = config_.max_price;
+   }
+   return static_cast<uint32_t>(price);
+}
+
+void flow_generator::advance_time() {
+   if (burst_) {
+      burst_ = next_unit() >= config_.burst_exit_probability;
+   } else {
+      burst_ = next_unit() < config_.burst_enter_probability;
+   }
+   double mean = burst_ ? config_.burst_gap_ns : config_.calm_gap_ns;
+   double u = next_unit();
+   now_ns_ += static_cast<uint64_t>(-std::log(1.0 - u) * mean) + 1;
+
+   if (next_unit() < config_.mid_step_probability) {
+      if (next_u64() & 1) {
+         mid_ = mid_ + 1 < config_.max_price ? mid_ + 1 : mid_;
+      } else {
+         mid_ = mid_ - 1 > config_.min_price ? mid_ - 1 : mid_;
+      }
+   }
+}
+
+flow_msg_t flow_generator::make_add(bool aggressive) {
+   order_side side = (next_u64() & 1) ? order_side::SELL : order_side::BUY;
+
+   uint32_t price;
+   if (aggressive) {
+      // reach a few ticks through the far touch
+      uint32_t reach = 1 + static_cast<uint32_t>(next_u64() % 3);
+      price = side == order_side::BUY ? std::min(mid_ + reach, config_.max_price)
+                                      : std::max(mid_ > reach ? mid_ - reach : 0, config_.min_price);
+   } else {
+      price = passive_price(side);
+   }
+
+   char id[ ORDER_ID_LEN ];
+   std::memset(id, '0', ORDER_ID_LEN);
+   id[0] = 'G';
+   for (uint64_t n = next_id_++, i = ORDER_ID_LEN - 1; i > 0 && n; i--, n /= 10) {
+      id[ i ] = static_cast<char>('0' + (n % 10));
+   }
+
+   flow_msg_t msg;
+   std::memset(&msg, 0, sizeof(msg));
+   msg.kind = static_cast<uint8_t>(flow_msg_kind::ADD);
+   msg.aggressive = aggressive ? 1 : 0;
+   msg.order = order_t(now_ns_, id, "FLOW", order_kind::LMT, side, order_status::NEW,
+                       price, next_qty(), false);
+
+   if (!aggressive) {
+      live_order_t lo;
+      std::memcpy(lo.order_id, id, ORDER_ID_LEN);
+      lo.price = price;
+      lo.side = static_cast<uint8_t>(side);
+      live_.push_back(lo);
+   }
+   return msg;
+}
+
+flow_msg_t flow_generator::next() {
+   advance_time();
+
+   // lean towards adds below the target depth and towards cancels above it
+   double fill = static_cast<double>(live_.size()) / static_cast<double>(config_.target_live_orders);
+   double add_w = config_.add_weight * (fill < 1.0 ? 1.0 + (1.0 - fill) : 1.0 / fill);
+   double cancel_w = config_.cancel_weight * (fill > 1.0 ? fill : fill + 0.05);
+   double modify_w = config_.modify_weight;
+   double aggr_w = config_.aggressive_weight * (burst_ ? 4.0 : 1.0);
+
+   if (live_.empty()) {
+      cancel_w = 0;
+      modify_w = 0;
+   }
+
+   double pick = next_unit() * (add_w + cancel_w + modify_w + aggr_w);
+
+   if (pick < add_w) {
+      return make_add(false);
+   }
+   pick -= add_w;
+   if (pick < aggr_w) {
+      return make_add(true);
+   }
+   pick -= aggr_w;
+
+   size_t idx = static_cast<size_t>(next_u64() % live_.size());
+   live_order_t& lo = live_[ idx ];
+
+   flow_msg_t msg;
+   std::memset(&msg, 0, sizeof(msg));
+   std::memcpy(msg.order.order_id, lo.order_id, ORDER_ID_LEN);
+   std::memcpy(msg.order.ticker, "FLOW", TICKER_LEN);
+   msg.order.timestamp = now_ns_;
+   msg.order.side = lo.side;
+   msg.order.kind = static_cast<uint8_t>(order_kind::LMT);
+   msg.order.price = lo.price;
+
+   if (pick < cancel_w) {
+      msg.kind = static_cast<uint8_t>(flow_msg_kind::CANCEL);
+      lo = live_.back();
+      live_.pop_back();
+      return msg;
+   }
+
+   // modify: usually a size change in place, sometimes a re-price near mid
+   msg.kind = static_cast<uint8_t>(flow_msg_kind::MODIFY);
+   msg.order.status = static_cast<uint8_t>(order_status::NEW);
+   msg.order.qty = next_qty();
+   if (next_unit() < 0.3) {
+      lo.price = passive_price(static_cast<order_side>(lo.side));
+   }
+   msg.order.price = lo.price;
+   return msg;
+}
+
+void flow_generator::generate(size_t count, std::vector<flow_msg_t>& out) {
+   out.reserve(out.size() + count);
+   for (size_t i = 0; i < count; i++) {
+      out.push_back(next());
+   }
+}
+
+void write_flow_file(const std::string& path, const flow_config_t& config, const std::vector<flow_msg_t>& msgs) {
+   std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+   if (!out.is_open()) {
+      throw std::runtime_error("Failed to open flow file: " + path);
+   }
+   flow_file_header_t header;
+   std::memcpy(header.magic, FLOW_MAGIC, sizeof(header.magic));
+   header.record_size = sizeof(flow_msg_t);
+   header.reserved = 0;
+   header.seed = config.seed;
+   header.count = msgs.size();
+   out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   out.write(reinterpret_cast<const char*>(msgs.data()),
+             static_cast<std::streamsize>(msgs.size() * sizeof(flow_msg_t)));
+   if (!out) {
+      throw std::runtime_error("Failed to write flow file: " + path);
+   }
+}
+
+std::vector<flow_msg_t> read_flow_file(const std::string& path) {
+   std::ifstream in(path, std::ios::in | std::ios::binary);
+   if (!in.is_open()) {
+      throw std::runtime_error("Failed to open flow file: " + path);
+   }
+   flow_file_header_t header;
+   in.read(reinterpret_cast<char*>(&header), sizeof(header));
+   if (!in || std::memcmp(header.magic, FLOW_MAGIC, sizeof(header.magic)) != 0 ||
+       header.record_size != sizeof(flow_msg_t)) {
+      throw std::runtime_error("Not a flow file: " + path);
+   }
+   std::vector<flow_msg_t> msgs(header.count);
+   in.read(reinterpret_cast<char*>(msgs.data()),
+           static_cast<std::streamsize>(msgs.size() * sizeof(flow_msg_t)));
+   if (!in) {
+      throw std::runtime_error("Truncated flow file: " + path);
+   }
+   return msgs;
+}
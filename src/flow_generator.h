@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../includes/types.h"
+
+/*
+   Seeded synthetic order flow that looks roughly like a production feed:
+   passive prices cluster around a randomly drifting mid with a geometric
+   fall-off in distance, most orders are cancelled or modified rather than
+   traded, and arrivals alternate between a calm regime and short bursts.
+
+   The generator tracks the orders it believes are live so cancels and
+   modifies target real IDs. It cannot see fills, so a cancel may name an
+   order the engine already executed; consumers should expect a few
+   ORDER_NOT_FOUND results.
+*/
+
+enum class flow_msg_kind : uint8_t { ADD=0, CANCEL=1, MODIFY=2 };
+
+BEGIN_PACKED
+PACKED_STRUCT flow_msg_t {
+   uint8_t kind;              // flow_msg_kind
+   uint8_t aggressive;        // ADD crosses the spread; driver should execute()
+   uint8_t reserved[2];
+   order_t order;             // CANCEL only uses order_id
+};
+END_PACKED
+
+struct flow_config_t {
+   uint64_t seed = 1;
+   uint32_t initial_mid = 10000;
+   uint32_t min_price = 1;
+   uint32_t max_price = 20000;
+
+   /*
+      Message mix: cancel + modify is ~90% of all messages. Adds and
+      cancels are kept level so the book holds near target_live_orders;
+      the observed shares settle on these weights once it is there.
+   */
+   double add_weight = 0.08;
+   double cancel_weight = 0.08;
+   double modify_weight = 0.82;
+   double aggressive_weight = 0.02;
+
+   double mid_step_probability = 0.02;   // per message, mid moves by one tick
+   double depth_decay = 0.75;            // P(next tick further from touch)
+   uint32_t max_depth_ticks = 50;
+   size_t target_live_orders = 5000;     // adds/cancels are rebalanced around this
+
+   uint32_t min_qty = 1;
+   uint32_t max_qty = 500;
+
+   // arrival process (timestamps only): mean gap in calm vs burst regime
+   double calm_gap_ns = 2000;
+   double burst_gap_ns = 100;
+   double burst_enter_probability = 0.001;
+   double burst_exit_probability = 0.02;
+};
+
+class flow_generator {
+public:
+   explicit flow_generator(const flow_config_t& config = {});
+
+   flow_msg_t next();
+   void generate(size_t count, std::vector<flow_msg_t>& out);
+
+   uint32_t mid() const { return mid_; }
+   size_t live_orders() const { return live_.size(); }
+   bool in_burst() const { return burst_; }
+
+private:
+   struct live_order_t {
+      char order_id[ ORDER_ID_LEN ];
+      uint32_t price;
+      uint8_t side;
+   };
+
+   flow_config_t config_;
+   uint64_t rng_state_;
+   uint64_t next_id_ = 1;
+   uint64_t now_ns_ = 0;
+   uint32_t mid_;
+   bool burst_ = false;
+   std::vector<live_order_t> live_;
+
+   uint64_t next_u64();
+   double next_unit();
+   uint32_t next_qty();
+   uint32_t passive_price(order_side side);
+   void advance_time();
+   flow_msg_t make_add(bool aggressive);
+};
+
+/*
+   On-disk flow stream: flow_file_header_t then raw flow_msg_t records,
+   so a generated run can be replayed bit-for-bit.
+*/
+constexpr char FLOW_MAGIC[8] = { 'O','B','F','L','O','W','0','1' };
+
+BEGIN_PACKED
+PACKED_STRUCT flow_file_header_t {
+   char magic[8];
+   uint32_t record_size;
+   uint32_t reserved;
+   uint64_t seed;
+   uint64_t count;
+};
+END_PACKED
+
+void write_flow_file(const std::string& path, const flow_config_t& config, const std::vector<flow_msg_t>& msgs);
+std::vector<flow_msg_t> read_flow_file(const std::string& path);
@@ -0,0 +1,355 @@
+#include "gateway.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr int MAX_EVENTS = 64;
+
+// epoll user data for the listening socket; sessions use their id
+static constexpr uint64_t LISTEN_TAG = 0;
+
+static void set_nonblocking(int fd) {
+   int flags = ::fcntl(fd, F_GETFL, 0);
+   ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+gateway::gateway(const gateway_config_t& config)
+   : config_(config),
+     entry_(*this, config_.log)
+{
+   listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+   if (listen_fd_ < 0) {
+      throw std::runtime_error(std::string("gateway socket: ") + std::strerror(errno));
+   }
+   int one = 1;
+   ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+   sockaddr_in addr;
+   std::memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons(config_.port);
+   if (::inet_pton(AF_INET, config_.bind_address.c_str(), &addr.sin_addr) != 1 ||
+       ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+       ::listen(listen_fd_, 128) != 0) {
+      int err = errno;
+      ::close(listen_fd_);
+      throw std::runtime_error("gateway bind " + config_.bind_address + ": " + std::strerror(err));
+   }
+   set_nonblocking(listen_fd_);
+
+   socklen_t len = sizeof(addr);
+   ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+   port_ = ntohs(addr.sin_port);
+
+   epoll_fd_ = ::epoll_create1(0);
+   if (epoll_fd_ < 0) {
+      ::close(listen_fd_);
+      throw std::runtime_error(std::string("gateway epoll: ") + std::strerror(errno));
+   }
+   epoll_event ev;
+   ev.events = EPOLLIN;
+   ev.data.u64 = LISTEN_TAG;
+   ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+
+   dirty_.reserve(config_.max_sessions);
+}
+
+gateway::~gateway() {
+   for (auto& [id, s] : sessions_) {
+      ::close(s->fd);
+   }
+   ::close(epoll_fd_);
+   ::close(listen_fd_);
+}
+
+void gateway::run(const std::atomic<bool>& stop) {
+   int timeout = config_.idle == idle_strategy::BLOCK ? 100 : 0;
+   idle_waiter waiter(config_.idle);
+   while (!stop.load(std::memory_order_relaxed)) {
+      if (poll_once(timeout)) {
+         waiter.reset();
+      } else if (timeout == 0) {
+         waiter.idle();
+      }
+   }
+}
+
+size_t gateway::poll_once(int timeout_ms) {
+   epoll_event events[ MAX_EVENTS ];
+   int n = ::epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout_ms);
+   if (n <= 0) {
+      return 0;
+   }
+
+   for (int i = 0; i < n; i++) {
+      if (events[ i ].data.u64 == LISTEN_TAG) {
+         accept_sessions();
+         continue;
+      }
+      auto it = sessions_.find(static_cast<uint32_t>(events[ i ].data.u64));
+      if (it == sessions_.end()) {
+         continue;
+      }
+      session_t& s = *it->second;
+      if (events[ i ].events & (EPOLLERR | EPOLLHUP)) {
+         s.dead = true;
+      }
+      if (!s.dead && (events[ i ].events & EPOLLIN)) {
+         read_session(s);
+      }
+      if (!s.dead && (events[ i ].events & EPOLLOUT) && s.tx_len) {
+         flush(s);
+      }
+   }
+
+   flush_dirty();
+   return static_cast<size_t>(n);
+}
+
+void gateway::accept_sessions() {
+   for (;;) {
+      int fd = ::accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+         return;
+      }
+      if (sessions_.size() >= config_.max_sessions) {
+         ::close(fd);
+         continue;
+      }
+      set_nonblocking(fd);
+      int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+      auto s = std::make_unique<session_t>();
+      s->fd = fd;
+      s->id = next_session_id_++;
+
+      epoll_event ev;
+      ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+      ev.data.u64 = s->id;
+      ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+
+      sessions_.emplace(s->id, std::move(s));
+      stats_.sessions_accepted++;
+   }
+}
+
+void gateway::read_session(session_t& s) {
+   for (;;) {
+      ssize_t got = ::recv(s.fd, s.rx + s.rx_len, RX_BUFFER - s.rx_len, 0);
+      if (got == 0) {
+         s.dead = true;
+         return;
+      }
+      if (got < 0) {
+         if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            s.dead = true;
+         }
+         return;
+      }
+      s.rx_len += static_cast<size_t>(got);
+
+      size_t off = 0;
+      while (s.rx_len - off >= sizeof(ouch::msg_header_t)) {
+         ouch::msg_header_t header;
+         std::memcpy(&header, s.rx + off, sizeof(header));
+         if (header.length < sizeof(header) || header.length > ouch::MAX_MESSAGE) {
+            stats_.protocol_errors++;
+            s.dead = true;
+            return;
+         }
+         if (s.rx_len - off < header.length) {
+            break;
+         }
+         handle(s, s.rx + off, header.length);
+         off += header.length;
+         if (s.dead) {
+            return;
+         }
+      }
+
+      if (off) {
+         std::memmove(s.rx, s.rx + off, s.rx_len - off);
+         s.rx_len -= off;
+      }
+   }
+}
+
+void gateway::handle(session_t& s, const char* msg, uint16_t len) {
+   char type = msg[ sizeof(uint16_t) ];
+   if (len != ouch::expected_length(type)) {
+      stats_.protocol_errors++;
+      s.dead = true;
+      return;
+   }
+   stats_.messages_in++;
+   current_ = &s;
+
+   switch (type) {
+      case ouch::ENTER_ORDER: {
+         ouch::enter_order_t m;
+         std::memcpy(&m, msg, sizeof(m));
+         enter_order(s, m);
+         break;
+      }
+      case ouch::CANCEL_ORDER: {
+         ouch::cancel_order_t m;
+         std::memcpy(&m, msg, sizeof(m));
+         entry_.cancel(s.id, m.token, m.ticker);
+         break;
+      }
+      case ouch::REPLACE_ORDER: {
+         ouch::replace_order_t m;
+         std::memcpy(&m, msg, sizeof(m));
+         entry_.replace(s.id, m.token, m.ticker, m.qty, m.price);
+         break;
+      }
+      default:
+         stats_.protocol_errors++;
+         s.dead = true;
+         break;
+   }
+   current_ = nullptr;
+}
+
+void gateway::enter_order(session_t& s, const ouch::enter_order_t& m) {
+   order_side side;
+   if (m.side == ouch::SIDE_BUY) {
+      side = order_side::BUY;
+   } else if (m.side == ouch::SIDE_SELL) {
+      side = order_side::SELL;
+   } else {
+      rejected(s.id, m.token, order_result::INVALID_SIDE);
+      return;
+   }
+
+   // order_entry assigns the ID and timestamp
+   char id[ ORDER_ID_LEN ] = {};
+   entry_.enter(s.id, m.token, order_t(0, id, m.ticker, order_kind::LMT, side, order_status::NEW, m.price, m.qty, false));
+}
+
+gateway::session_t* gateway::live_session(uint64_t session) {
+   session_t* s = current_ && current_->id == session ? current_ : nullptr;
+   if (!s) {
+      auto it = sessions_.find(static_cast<uint32_t>(session));
+      s = it == sessions_.end() ? nullptr : it->second.get();
+   }
+   return s && !s->dead ? s : nullptr;
+}
+
+void gateway::accepted(uint64_t session, uint64_t token, uint64_t timestamp) {
+   if (session_t* s = live_session(session)) {
+      auto ack = ouch::make<ouch::accepted_t>(ouch::ACCEPTED);
+      ack.token = token;
+      ack.timestamp = timestamp;
+      send(*s, ack);
+   }
+}
+
+void gateway::rejected(uint64_t session, uint64_t token, order_result reason) {
+   if (session_t* s = live_session(session)) {
+      auto rej = ouch::make<ouch::rejected_t>(ouch::REJECTED);
+      rej.token = token;
+      rej.reason = static_cast<uint8_t>(reason);
+      send(*s, rej);
+   }
+}
+
+void gateway::canceled(uint64_t session, uint64_t token) {
+   if (session_t* s = live_session(session)) {
+      auto ack = ouch::make<ouch::canceled_t>(ouch::CANCELED);
+      ack.token = token;
+      send(*s, ack);
+   }
+}
+
+void gateway::replaced(uint64_t session, uint64_t token, size_t qty, uint32_t price) {
+   if (session_t* s = live_session(session)) {
+      auto ack = ouch::make<ouch::replaced_t>(ouch::REPLACED);
+      ack.token = token;
+      ack.qty = static_cast<uint32_t>(qty);
+      ack.price = price;
+      send(*s, ack);
+   }
+}
+
+void gateway::executed(uint64_t session, uint64_t token, uint64_t, uint64_t match_number,
+                       size_t qty, uint32_t price) {
+   if (session_t* s = live_session(session)) {
+      auto ex = ouch::make<ouch::executed_t>(ouch::EXECUTED);
+      ex.token = token;
+      ex.qty = static_cast<uint32_t>(qty);
+      ex.price = price;
+      ex.match_number = match_number;
+      send(*s, ex);
+   }
+}
+
+template <typename msg_t>
+void gateway::send(session_t& s, const msg_t& m) {
+   if (s.tx_len + sizeof(m) > TX_BUFFER) {
+      flush(s);
+      if (s.tx_len + sizeof(m) > TX_BUFFER) {
+         // peer is not reading; drop it rather than buffer without bound
+         s.dead = true;
+         return;
+      }
+   }
+   std::memcpy(s.tx + s.tx_len, &m, sizeof(m));
+   s.tx_len += sizeof(m);
+   stats_.messages_out++;
+   if (!s.dirty) {
+      s.dirty = true;
+      dirty_.push_back(&s);
+   }
+}
+
+void gateway::flush(session_t& s) {
+   size_t sent = 0;
+   while (sent < s.tx_len) {
+      ssize_t n = ::send(s.fd, s.tx + sent, s.tx_len - sent, MSG_NOSIGNAL);
+      if (n < 0) {
+         if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            s.dead = true;
+         }
+         break;
+      }
+      sent += static_cast<size_t>(n);
+   }
+   if (sent) {
+      std::memmove(s.tx, s.tx + sent, s.tx_len - sent);
+      s.tx_len -= sent;
+   }
+}
+
+// Dead sessions are only closed here, after the batch, so pointers queued in dirty_ stay valid.
+void gateway::flush_dirty() {
+   for (session_t* s : dirty_) {
+      s->dirty = false;
+      if (!s->dead) {
+         flush(*s);
+      }
+   }
+   dirty_.clear();
+
+   for (auto it = sessions_.begin(); it != sessions_.end();) {
+      if (it->second->dead) {
+         session_t& s = *it->second;
+         ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, s.fd, nullptr);
+         ::close(s.fd);
+         stats_.sessions_closed++;
+         it = sessions_.erase(it);
+      } else {
+         ++it;
+      }
+   }
+}
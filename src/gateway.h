@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "order_entry.h"
+#include "ouch.h"
+#include "../includes/thread_affinity.h"
+
+struct gateway_config_t {
+   std::string bind_address = "127.0.0.1";
+   uint16_t port = 0;             // 0 = pick an ephemeral port, see gateway::port()
+   idle_strategy idle = idle_strategy::BLOCK;   // BUSY_POLL / YIELD poll epoll_wait(0) instead of sleeping in it
+   size_t max_sessions = 256;
+   logger* log = nullptr;
+};
+
+struct gateway_stats_t {
+   uint64_t sessions_accepted = 0;
+   uint64_t sessions_closed = 0;
+   uint64_t messages_in = 0;
+   uint64_t messages_out = 0;
+   uint64_t protocol_errors = 0;
+   uint64_t fills = 0;
+};
+
+/*
+   Single-threaded TCP order-entry gateway speaking the ouch.h protocol.
+
+   Edge-triggered epoll: each readable session is drained until EAGAIN,
+   complete frames are decoded in place from its fixed receive buffer and
+   turned into book calls, and replies are appended to a fixed send
+   buffer that is flushed once per poll batch. Nothing is allocated per
+   message; sessions and books are allocated when they first appear.
+
+   Book calls go through order_entry with the session id as its session
+   key, so tokens only need to be unique per session. A session whose
+   send buffer stays full (a reader that stopped reading) is
+   disconnected. Resting orders survive their session; their fills are
+   then dropped.
+*/
+class gateway final : private order_entry_reports {
+public:
+   explicit gateway(const gateway_config_t& config = {});
+   ~gateway() override;
+
+   gateway(const gateway&) = delete;
+   gateway& operator=(const gateway&) = delete;
+
+   uint16_t port() const { return port_; }
+
+   // Event loop until `stop` is set; call from the thread that owns the books.
+   void run(const std::atomic<bool>& stop);
+
+   // One epoll batch; returns the number of events handled.
+   size_t poll_once(int timeout_ms);
+
+   gateway_stats_t stats() const {
+      gateway_stats_t s = stats_;
+      s.fills = entry_.fills();
+      return s;
+   }
+   orderbook* book(const char* ticker) { return entry_.book(ticker); }
+
+private:
+   static constexpr size_t RX_BUFFER = 1 << 16;
+   static constexpr size_t TX_BUFFER = 1 << 18;
+
+   struct session_t {
+      int fd = -1;
+      uint32_t id = 0;
+      size_t rx_len = 0;
+      size_t tx_len = 0;
+      bool dirty = false;
+      bool dead = false;
+      char rx[ RX_BUFFER ];
+      char tx[ TX_BUFFER ];
+   };
+
+   gateway_config_t config_;
+   int listen_fd_ = -1;
+   int epoll_fd_ = -1;
+   uint16_t port_ = 0;
+   uint32_t next_session_id_ = 1;
+   gateway_stats_t stats_;
+   order_entry entry_;
+
+   std::unordered_map<uint32_t, std::unique_ptr<session_t>> sessions_;
+   std::vector<session_t*> dirty_;
+
+   // the session whose message is being handled; most replies go to it
+   session_t* current_ = nullptr;
+
+   void accept_sessions();
+   void read_session(session_t& s);
+   void handle(session_t& s, const char* msg, uint16_t len);
+   void enter_order(session_t& s, const ouch::enter_order_t& m);
+   session_t* live_session(uint64_t session);
+
+   template <typename msg_t>
+   void send(session_t& s, const msg_t& m);
+   void flush(session_t& s);
+   void flush_dirty();
+
+   void accepted(uint64_t session, uint64_t token, uint64_t timestamp) override;
+   void rejected(uint64_t session, uint64_t token, order_result reason) override;
+   void canceled(uint64_t session, uint64_t token) override;
+   void replaced(uint64_t session, uint64_t token, size_t qty, uint32_t price) override;
+   void executed(uint64_t session, uint64_t token, uint64_t timestamp, uint64_t match_number,
+                 size_t qty, uint32_t price) override;
+};
@@ -0,0 +1,129 @@
+/*
+   gateway: TCP order-entry server in front of the orderbook.
+
+   gateway [--bind 127.0.0.1] [--port 9100] [--journal file]
+           [--idle busy-poll|yield|block] [--busy-poll]
+           [--cpu N] [--logger-cpu N] [--fifo PRIO]
+           [--pages system|4k|thp|2m|1g] [--reserve-mb N] [--mlock] [--numa]
+
+   Speaks the binary protocol in ouch.h; see bench/gateway_client.cpp for
+   a load generator. Ctrl-C stops the loop and prints session statistics.
+   The event loop is the matching thread: --cpu pins it and --fifo runs
+   it SCHED_FIFO when permitted; --logger-cpu pins the journal writer.
+   Placement problems (shared cores, missing privileges) are printed as
+   warnings and the gateway runs anyway. --pages and --reserve-mb put
+   the books on pre-faulted (huge) pages mapped before the loop starts.
+   --numa takes them (and the reserve) from the matching CPU's NUMA node.
+*/
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "gateway.h"
+
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) {
+   g_stop.store(true);
+}
+
+int main(int argc, char** argv) {
+   gateway_config_t config;
+   config.port = 9100;
+   orderbook_config_t runtime;
+   std::string journal;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[ i ];
+      bool has_value = i + 1 < argc;
+      if (arg == "--bind" && has_value) {
+         config.bind_address = argv[ ++i ];
+      } else if (arg == "--port" && has_value) {
+         config.port = static_cast<uint16_t>(std::strtoul(argv[ ++i ], nullptr, 10));
+      } else if (arg == "--busy-poll") {
+         runtime.idle = idle_strategy::BUSY_POLL;
+      } else if (arg == "--idle" && has_value && parse_idle_strategy(argv[ i + 1 ], runtime.idle)) {
+         i++;
+      } else if (arg == "--cpu" && has_value) {
+         runtime.matching.cpu = std::atoi(argv[ ++i ]);
+      } else if (arg == "--logger-cpu" && has_value) {
+         runtime.logger.cpu = std::atoi(argv[ ++i ]);
+      } else if (arg == "--fifo" && has_value) {
+         runtime.matching.fifo_priority = std::atoi(argv[ ++i ]);
+      } else if (arg == "--pages" && has_value && parse_page_kind(argv[ i + 1 ], runtime.memory.pages)) {
+         i++;
+      } else if (arg == "--reserve-mb" && has_value) {
+         runtime.memory.reserve_bytes = std::strtoull(argv[ ++i ], nullptr, 10) << 20;
+      } else if (arg == "--mlock") {
+         runtime.memory.lock = true;
+      } else if (arg == "--numa") {
+         runtime.memory.numa = true;
+      } else if (arg == "--journal" && has_value) {
+         journal = argv[ ++i ];
+      } else {
+         std::fprintf(stderr,
+            "usage: %s [--bind addr] [--port N] [--journal file] [--idle busy-poll|yield|block] [--busy-poll]\n"
+            "          [--cpu N] [--logger-cpu N] [--fifo PRIO]\n"
+            "          [--pages system|4k|thp|2m|1g] [--reserve-mb N] [--mlock] [--numa]\n", argv[ 0 ]);
+         return 2;
+      }
+   }
+   config.idle = runtime.idle;
+   runtime.enable_logging = !journal.empty();
+   runtime.log_filename = journal;
+
+   for (const std::string& w : placement_warnings(runtime)) {
+      std::fprintf(stderr, "warning: %s\n", w.c_str());
+   }
+   placement_result_t placed = apply_thread_placement(runtime.matching, "ob-matching");
+   try {
+      // after pinning, so first-touch puts the reserve next to the matching CPU
+      book_memory::instance().configure(runtime.memory);
+   } catch (const std::bad_alloc&) {
+      std::fprintf(stderr, "cannot map %zu bytes of book memory\n", runtime.memory.reserve_bytes);
+      return 1;
+   }
+   if (!placed.error.empty()) {
+      std::fprintf(stderr, "warning: matching thread: %s\n", placed.error.c_str());
+   }
+
+   std::unique_ptr<logger> log;
+   if (!journal.empty()) {
+      logger_config_t lc;
+      lc.format = log_format::BINARY;
+      lc.thread = runtime.logger;
+      log = std::make_unique<logger>(journal, lc);
+      config.log = log.get();
+      if (!log->placement().error.empty()) {
+         std::fprintf(stderr, "warning: logger thread: %s\n", log->placement().error.c_str());
+      }
+   }
+
+   std::signal(SIGINT, on_signal);
+   std::signal(SIGTERM, on_signal);
+
+   try {
+      gateway gw(config);
+      std::fprintf(stderr, "gateway listening on %s:%u (idle=%s%s%s)\n", config.bind_address.c_str(),
+                   static_cast<unsigned>(gw.port()), idle_strategy_name(config.idle),
+                   placed.pinned ? ", pinned" : "", placed.realtime ? ", SCHED_FIFO" : "");
+      gw.run(g_stop);
+
+      const gateway_stats_t& st = gw.stats();
+      std::fprintf(stderr, "sessions=%llu in=%llu out=%llu fills=%llu protocol_errors=%llu\n",
+                   static_cast<unsigned long long>(st.sessions_accepted),
+                   static_cast<unsigned long long>(st.messages_in),
+                   static_cast<unsigned long long>(st.messages_out),
+                   static_cast<unsigned long long>(st.fills),
+                   static_cast<unsigned long long>(st.protocol_errors));
+   } catch (const std::exception& e) {
+      std::fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,230 @@
+#include "itch_replay.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+itch_replayer::itch_replayer(const itch_replay_options_t& options)
+   : options_(options),
+     books_(LOCATES),
+     symbols_(LOCATES),
+     tracked_(LOCATES, 0)
+{
+   if (options_.price_divisor == 0) {
+      throw std::invalid_argument("itch_replayer price_divisor must be non-zero");
+   }
+   // store the filter space-padded to match ITCH alpha fields
+   for (std::string& s : options_.symbols) {
+      s.resize(itch::SYMBOL_LEN, ' ');
+   }
+}
+
+order_id_key itch_replayer::key_for(uint64_t ref) {
+   order_id_key key;
+   std::memcpy(key.order_id, &ref, sizeof(ref));
+   std::memset(key.order_id + sizeof(ref), 0, ORDER_ID_LEN - sizeof(ref));
+   return key;
+}
+
+orderbook* itch_replayer::book(uint16_t locate) {
+   return books_[ locate ].get();
+}
+
+orderbook* itch_replayer::book(const char* symbol) {
+   char padded[ itch::SYMBOL_LEN ];
+   std::memset(padded, ' ', itch::SYMBOL_LEN);
+   std::memcpy(padded, symbol, std::min(std::strlen(symbol), itch::SYMBOL_LEN));
+   for (size_t i = 0; i < LOCATES; i++) {
+      if (books_[ i ] && std::memcmp(symbols_[ i ].data(), padded, itch::SYMBOL_LEN) == 0) {
+         return books_[ i ].get();
+      }
+   }
+   return nullptr;
+}
+
+bool itch_replayer::tracked(uint16_t locate, const char* stock) {
+   if (tracked_[ locate ]) {
+      return tracked_[ locate ] == 1;
+   }
+   std::memcpy(symbols_[ locate ].data(), stock, itch::SYMBOL_LEN);
+
+   bool yes = options_.symbols.empty();
+   for (const std::string& s : options_.symbols) {
+      if (std::memcmp(s.data(), stock, itch::SYMBOL_LEN) == 0) {
+         yes = true;
+         break;
+      }
+   }
+   tracked_[ locate ] = yes ? 1 : 2;
+   return yes;
+}
+
+orderbook* itch_replayer::book_for_add(uint16_t locate, const char* stock) {
+   if (!tracked(locate, stock)) {
+      return nullptr;
+   }
+   std::unique_ptr<orderbook>& ob = books_[ locate ];
+   if (!ob) {
+      ob = std::make_unique<orderbook>(options_.log);
+      book_count_++;
+   }
+   return ob.get();
+}
+
+itch_replay_stats_t itch_replayer::replay(const char* data, size_t len) {
+   itch_replay_stats_t stats;
+   auto histograms = std::make_unique<std::array<latency_histogram, ITCH_KINDS>>();
+
+   const uint32_t divisor = options_.price_divisor;
+   uint64_t started_ns = monotonic_ns();
+
+   size_t pos = 0;
+   while (pos + 2 <= len) {
+      uint16_t frame = itch::be16(data + pos);
+      if (frame == 0 || pos + 2 + frame > len) {
+         break;
+      }
+      const char* m = data + pos + 2;
+      pos += 2 + static_cast<size_t>(frame);
+      stats.messages++;
+
+      char type = m[ 0 ];
+      if (frame < itch::min_length(type)) {
+         continue;
+      }
+      uint16_t locate = itch::locate(m);
+
+      if (type == itch::STOCK_DIRECTORY) {
+         tracked(locate, itch::directory_stock(m));
+         continue;
+      }
+
+      orderbook* ob;
+      itch_kind kind;
+      if (type == itch::ADD_ORDER || type == itch::ADD_ORDER_MPID) {
+         ob = book_for_add(locate, m + 24);
+         kind = itch_kind::ADD;
+      } else {
+         ob = books_[ locate ].get();
+         switch (type) {
+            case itch::ORDER_EXECUTED:
+            case itch::ORDER_EXECUTED_PX: kind = itch_kind::EXECUTED; break;
+            case itch::ORDER_CANCEL:      kind = itch_kind::CANCEL; break;
+            case itch::ORDER_DELETE:      kind = itch_kind::DELETE; break;
+            case itch::ORDER_REPLACE:     kind = itch_kind::REPLACE; break;
+            default:                      continue;
+         }
+      }
+      if (!ob) {
+         continue;
+      }
+      stats.book_messages++;
+
+      uint64_t t0 = tsc_clock::read_ticks();
+      order_result r = order_result::SUCCESS;
+
+      switch (kind) {
+         case itch_kind::ADD: {
+            itch::add_order a(m);
+            order_id_key key = key_for(a.ref);
+            order_t o(itch::timestamp(m), key.order_id, a.stock, order_kind::LMT,
+                      a.side == 'B' ? order_side::BUY : order_side::SELL, order_status::NEW,
+                      a.price / divisor, a.shares, false);
+            r = ob->add(o);
+            break;
+         }
+         case itch_kind::EXECUTED: {
+            itch::order_executed e(m);
+            r = ob->reduce(key_for(e.ref), e.shares);
+            break;
+         }
+         case itch_kind::CANCEL: {
+            itch::order_cancel x(m);
+            r = ob->reduce(key_for(x.ref), x.shares);
+            break;
+         }
+         case itch_kind::DELETE: {
+            itch::order_delete d(m);
+            r = ob->cancel(key_for(d.ref));
+            break;
+         }
+         case itch_kind::REPLACE: {
+            itch::order_replace u(m);
+            order_id_key old_key = key_for(u.original_ref);
+            std::optional<order_t> old_order = ob->find(old_key);
+            if (!old_order) {
+               r = order_result::ORDER_NOT_FOUND;
+               break;
+            }
+            ob->cancel(old_key);
+            order_id_key new_key = key_for(u.new_ref);
+            order_t o(itch::timestamp(m), new_key.order_id, old_order->ticker, order_kind::LMT,
+                      static_cast<order_side>(old_order->side), order_status::NEW,
+                      u.price / divisor, u.shares, false);
+            r = ob->add(o);
+            break;
+         }
+      }
+
+      (*histograms)[ static_cast<size_t>(kind) ].record(tsc_clock::read_ticks() - t0);
+      stats.count[ static_cast<size_t>(kind) ]++;
+
+      if (r == order_result::SUCCESS) {
+         stats.applied++;
+      } else if (r == order_result::ORDER_NOT_FOUND) {
+         stats.unknown_order++;
+      } else {
+         stats.rejected++;
+      }
+   }
+
+   stats.truncated = len - pos;
+   stats.elapsed_ns = monotonic_ns() - started_ns;
+   stats.books = book_count_;
+   for (size_t k = 0; k < ITCH_KINDS; k++) {
+      (*histograms)[ k ].snapshot(stats.latency[ k ]);
+   }
+   return stats;
+}
+
+itch_replay_stats_t itch_replayer::replay_file(const std::string& path) {
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0) {
+      throw std::runtime_error("Failed to open ITCH file: " + path);
+   }
+
+   struct stat st;
+   if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Failed to stat ITCH file: " + path);
+   }
+   size_t size = static_cast<size_t>(st.st_size);
+   if (size == 0) {
+      ::close(fd);
+      return {};
+   }
+
+   void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd);
+   if (map == MAP_FAILED) {
+      throw std::runtime_error("Failed to mmap ITCH file: " + path);
+   }
+   ::madvise(map, size, MADV_SEQUENTIAL);
+   ::madvise(map, size, MADV_WILLNEED);
+
+   itch_replay_stats_t stats;
+   try {
+      stats = replay(static_cast<const char*>(map), size);
+   } catch (...) {
+      ::munmap(map, size);
+      throw;
+   }
+   ::munmap(map, size);
+   return stats;
+}
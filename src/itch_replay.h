@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../includes/latency_histogram.h"
+#include "itch.h"
+#include "orderbook.h"
+
+struct itch_replay_options_t {
+   // symbols to build books for (space-padded or not); empty = every symbol
+   std::vector<std::string> symbols;
+
+   // ITCH prices carry 4 decimals; ticks = price / price_divisor (100 = cents)
+   uint32_t price_divisor = 100;
+
+   logger* log = nullptr;
+};
+
+// per ITCH message type that touches a book
+enum class itch_kind : uint8_t {
+   ADD=0,
+   EXECUTED=1,
+   CANCEL=2,
+   DELETE=3,
+   REPLACE=4
+};
+
+constexpr size_t ITCH_KINDS = 5;
+
+struct itch_replay_stats_t {
+   uint64_t messages = 0;         // every frame in the file
+   uint64_t book_messages = 0;    // A/F/E/C/X/D/U for a tracked symbol
+   uint64_t applied = 0;
+   uint64_t unknown_order = 0;    // E/C/X/D/U for a ref the book never accepted
+   uint64_t rejected = 0;         // add refused (price beyond MAX_PRICE, bad side, duplicate)
+   uint64_t truncated = 0;        // trailing bytes that do not form a whole frame
+   size_t books = 0;
+   uint64_t elapsed_ns = 0;
+
+   std::array<uint64_t, ITCH_KINDS> count{};
+   std::array<latency_histogram_snapshot, ITCH_KINDS> latency;   // TSC ticks per message
+
+   double messages_per_sec() const {
+      return elapsed_ns ? static_cast<double>(messages) * 1e9 / static_cast<double>(elapsed_ns) : 0.0;
+   }
+};
+
+/*
+   Replays a NASDAQ ITCH 5.0 file into one orderbook per stock locate.
+
+   The file is mmap'ed and decoded in place. Add Order (A/F) becomes
+   add(), Order Executed (E/C) and Order Cancel (X) become reduce(),
+   Order Delete (D) becomes cancel() and Order Replace (U) is cancel() of
+   the original ref plus add() of the new one on the same side. execute()
+   is never called: ITCH reports the venue's own fills.
+
+   Books are allocated on the first add for a locate. Each orderbook
+   carries two slot ladders (~85KB) plus the levels it has touched, so
+   restrict `symbols` on full-day files.
+*/
+class itch_replayer {
+public:
+   explicit itch_replayer(const itch_replay_options_t& options = {});
+
+   itch_replay_stats_t replay_file(const std::string& path);
+   itch_replay_stats_t replay(const char* data, size_t len);
+
+   // book for a stock locate, nullptr when none was built
+   orderbook* book(uint16_t locate);
+   orderbook* book(const char* symbol);
+
+   static order_id_key key_for(uint64_t ref);
+
+private:
+   static constexpr size_t LOCATES = 1 << 16;
+
+   itch_replay_options_t options_;
+   std::vector<std::unique_ptr<orderbook>> books_;
+   std::vector<std::array<char, itch::SYMBOL_LEN>> symbols_;   // from stock directory / adds
+   std::vector<uint8_t> tracked_;                               // 0 unknown, 1 yes, 2 no
+   size_t book_count_ = 0;
+
+   bool tracked(uint16_t locate, const char* stock);
+   orderbook* book_for_add(uint16_t locate, const char* stock);
+};
@@ -0,0 +1,211 @@
+#include "journal_replay.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// below this many records thread start-up costs more than it saves
+static constexpr size_t PARALLEL_REPLAY_MIN_RECORDS = 1 << 16;
+
+static inline size_t shard_of(uint32_t key, size_t shard_count) {
+   return static_cast<size_t>((key * 2654435761u) >> 7) % shard_count;
+}
+
+void journal_replayer::adopt(const char* ticker, std::unique_ptr<orderbook> book, uint64_t after_sequence) {
+   uint32_t key = ticker_key(ticker);
+   books_[ key ] = std::move(book);
+   sequence_floor_[ key ] = after_sequence;
+}
+
+uint64_t journal_replayer::load_snapshot_file(const std::string& path) {
+   std::vector<char> image = read_snapshot_file(path);
+
+   auto book = std::make_unique<orderbook>(nullptr);
+   uint64_t last_sequence = book->load_snapshot(image.data(), image.size());
+
+   snapshot_header_t header;
+   std::memcpy(&header, image.data(), sizeof(header));
+   adopt(header.ticker, std::move(book), last_sequence);
+   return last_sequence;
+}
+
+orderbook* journal_replayer::book(const char* ticker) {
+   auto it = books_.find(ticker_key(ticker));
+   return it == books_.end() ? nullptr : it->second.get();
+}
+
+void journal_replayer::replay_shard(
+   const journal_record_t* records,
+   size_t count,
+   size_t shard,
+   size_t shard_count,
+   book_map& shard_books,
+   replay_stats_t& stats
+) const {
+   uint32_t cached_key = 0;
+   orderbook* cached_book = nullptr;
+   uint64_t cached_floor = options_.after_sequence;
+
+   for (size_t i = 0; i < count; i++) {
+      const journal_record_t& rec = records[ i ];
+      uint32_t key = ticker_key(rec.ticker);
+
+      if (shard_count > 1 && shard_of(key, shard_count) != shard) {
+         continue;
+      }
+      if (!cached_book || key != cached_key) {
+         std::unique_ptr<orderbook>& slot = shard_books[ key ];
+         if (!slot) {
+            slot = std::make_unique<orderbook>(nullptr);
+         }
+         cached_key = key;
+         cached_book = slot.get();
+
+         auto floor = sequence_floor_.find(key);
+         cached_floor = options_.after_sequence;
+         if (floor != sequence_floor_.end() && floor->second > cached_floor) {
+            cached_floor = floor->second;
+         }
+      }
+
+      if (rec.sequence != 0 && rec.sequence <= cached_floor) {
+         continue;
+      }
+
+      apply(*cached_book, rec);
+      stats.applied++;
+      if (rec.sequence > stats.last_sequence) {
+         stats.last_sequence = rec.sequence;
+      }
+   }
+}
+
+replay_stats_t journal_replayer::replay(const journal_record_t* records, size_t count) {
+   size_t shard_count = options_.threads ? options_.threads : std::thread::hardware_concurrency();
+   if (shard_count == 0 || count < PARALLEL_REPLAY_MIN_RECORDS) {
+      shard_count = 1;
+   }
+
+   replay_stats_t total;
+   total.records = count;
+   total.threads = shard_count;
+
+   if (shard_count == 1) {
+      replay_shard(records, count, 0, 1, books_, total);
+      total.books = books_.size();
+      return total;
+   }
+
+   // hand existing books to the shard that owns their ticker
+   std::vector<book_map> shard_books(shard_count);
+   for (auto& [key, book] : books_) {
+      shard_books[ shard_of(key, shard_count) ][ key ] = std::move(book);
+   }
+   books_.clear();
+
+   std::vector<replay_stats_t> shard_stats(shard_count);
+   std::vector<std::thread> workers;
+   workers.reserve(shard_count);
+   for (size_t s = 0; s < shard_count; s++) {
+      workers.emplace_back([&, s]() {
+         replay_shard(records, count, s, shard_count, shard_books[ s ], shard_stats[ s ]);
+      });
+   }
+   for (auto& w : workers) {
+      w.join();
+   }
+
+   for (size_t s = 0; s < shard_count; s++) {
+      total.applied += shard_stats[ s ].applied;
+      if (shard_stats[ s ].last_sequence > total.last_sequence) {
+         total.last_sequence = shard_stats[ s ].last_sequence;
+      }
+      for (auto& [key, book] : shard_books[ s ]) {
+         books_[ key ] = std::move(book);
+      }
+   }
+   total.books = books_.size();
+   return total;
+}
+
+replay_stats_t journal_replayer::replay_file(const std::string& path) {
+   replay_stats_t stats;
+   uint64_t malformed = 0;
+   read_journal(path, options_.allow_malformed, malformed, [&](const journal_record_t* records, size_t count) {
+      stats = replay(records, count);
+   });
+   stats.malformed = malformed;
+   return stats;
+}
+
+void journal_replayer::read_journal(const std::string& path, bool allow_malformed, uint64_t& malformed,
+                                    const std::function<void(const journal_record_t*, size_t)>& fn) {
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0) {
+      throw std::runtime_error("Failed to open journal: " + path);
+   }
+
+   struct stat st;
+   if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Failed to stat journal: " + path);
+   }
+   size_t size = static_cast<size_t>(st.st_size);
+
+   journal_file_header_t header;
+   bool binary = size >= sizeof(header) &&
+                 ::pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                 std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) == 0;
+
+   if (!binary) {
+      ::close(fd);
+
+      std::ifstream in(path);
+      std::vector<journal_record_t> records;
+      std::string line;
+      journal_record_t rec;
+      uint64_t line_number = 0;
+      while (std::getline(in, line)) {
+         line_number++;
+         if (parse_journal_line(line, rec)) {
+            records.push_back(rec);
+         } else if (!line.empty()) {
+            if (!allow_malformed) {
+               throw std::runtime_error("Malformed journal line " + std::to_string(line_number) + ": " + path);
+            }
+            malformed++;
+         }
+      }
+      fn(records.data(), records.size());
+      return;
+   }
+
+   if (header.version != JOURNAL_VERSION || header.record_size != sizeof(journal_record_t)) {
+      ::close(fd);
+      throw std::runtime_error("Unsupported journal version: " + path);
+   }
+
+   void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd);
+   if (map == MAP_FAILED) {
+      throw std::runtime_error("Failed to mmap journal: " + path);
+   }
+   ::madvise(map, size, MADV_SEQUENTIAL);
+   ::madvise(map, size, MADV_WILLNEED);
+
+   const char* base = static_cast<const char*>(map);
+   size_t count = (size - sizeof(header)) / sizeof(journal_record_t);
+   try {
+      fn(reinterpret_cast<const journal_record_t*>(base + sizeof(header)), count);
+   } catch (...) {
+      ::munmap(map, size);
+      throw;
+   }
+   ::munmap(map, size);
+}
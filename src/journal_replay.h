@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../includes/journal.h"
+#include "orderbook.h"
+
+struct replay_options_t {
+   size_t threads = 0;            // 0 = std::thread::hardware_concurrency()
+   uint64_t after_sequence = 0;   // only apply records with sequence > after_sequence
+   bool allow_malformed = false;  // count text lines that do not parse instead of throwing
+};
+
+struct replay_stats_t {
+   uint64_t records = 0;
+   uint64_t applied = 0;
+   uint64_t last_sequence = 0;
+   uint64_t malformed = 0;        // text lines that did not parse (only with allow_malformed)
+   size_t books = 0;
+   size_t threads = 0;
+};
+
+/*
+   Rebuilds one orderbook per ticker from a journal written by logger.
+
+   Books are sharded across threads by ticker; every thread scans the
+   whole journal and applies only the records of its own symbols through
+   the orderbook replay_* fast path, so per-symbol order is preserved and
+   no records are copied or queued between threads. Binary journals are
+   mmap'ed; text journals are parsed into memory first, and a line that
+   does not parse throws unless allow_malformed is set.
+*/
+class journal_replayer {
+public:
+   using book_map = std::unordered_map< uint32_t, std::unique_ptr<orderbook> >;
+
+   explicit journal_replayer(const replay_options_t& options = {})
+      : options_(options) {}
+
+   replay_stats_t replay_file(const std::string& path);
+   replay_stats_t replay(const journal_record_t* records, size_t count);
+
+   /*
+      Seed a book before replaying; records for its ticker with
+      sequence <= after_sequence are skipped.
+   */
+   void adopt(const char* ticker, std::unique_ptr<orderbook> book, uint64_t after_sequence = 0);
+
+   // Loads a snapshot file and adopts it, so a following replay_file() applies only the tail.
+   uint64_t load_snapshot_file(const std::string& path);
+
+   orderbook* book(const char* ticker);
+   book_map& books() { return books_; }
+
+   /*
+      Applies one ticker's records with sequence > after_sequence to a
+      book of any type with orderbook's replay_* calls, serially; this is
+      how a mapped_orderbook is rebuilt after its file is refused.
+   */
+   template <typename Book>
+   static replay_stats_t replay_file_into(const std::string& path, const char* ticker, Book& book,
+                                          uint64_t after_sequence = 0, bool allow_malformed = false);
+
+   template <typename Book>
+   static void apply(Book& ob, const journal_record_t& rec);
+
+private:
+   replay_options_t options_;
+   book_map books_;
+   std::unordered_map< uint32_t, uint64_t > sequence_floor_;
+
+   /*
+      Calls fn with the journal's records: mapped when binary, parsed
+      when text. Unparseable text lines throw, or are counted in
+      malformed when allow_malformed is set.
+   */
+   static void read_journal(const std::string& path, bool allow_malformed, uint64_t& malformed,
+                            const std::function<void(const journal_record_t*, size_t)>& fn);
+
+   void replay_shard(const journal_record_t* records, size_t count,
+                     size_t shard, size_t shard_count,
+                     book_map& shard_books, replay_stats_t& stats) const;
+};
+
+static inline order_t order_from_record(const journal_record_t& rec, const char* id) {
+   return order_t(
+      rec.timestamp,
+      id,
+      rec.ticker,
+      order_kind::LMT,
+      static_cast<order_side>(rec.side),
+      order_status::NEW,
+      rec.price,
+      rec.qty,
+      false
+   );
+}
+
+template <typename Book>
+void journal_replayer::apply(Book& ob, const journal_record_t& rec) {
+   order_id_key key;
+
+   switch (static_cast<log_event_kind>(rec.kind)) {
+      case log_event_kind::ADD:
+         ob.replay_add(order_from_record(rec, rec.order_id));
+         break;
+      case log_event_kind::CANCEL:
+         std::memcpy(key.order_id, rec.order_id, ORDER_ID_LEN);
+         ob.replay_cancel(key);
+         break;
+      case log_event_kind::MODIFY:
+         // the book is keyed by the original ID, carried in the secondary fields
+         std::memcpy(key.order_id, rec.order_id_secondary, ORDER_ID_LEN);
+         ob.replay_modify(key, order_from_record(rec, rec.order_id));
+         break;
+      case log_event_kind::MATCH:
+         std::memcpy(key.order_id, rec.order_id, ORDER_ID_LEN);
+         ob.replay_fill(key, rec.qty);
+         std::memcpy(key.order_id, rec.order_id_secondary, ORDER_ID_LEN);
+         ob.replay_fill(key, rec.qty_secondary);
+         break;
+   }
+}
+
+template <typename Book>
+replay_stats_t journal_replayer::replay_file_into(const std::string& path, const char* ticker, Book& book,
+                                                  uint64_t after_sequence, bool allow_malformed) {
+   replay_stats_t stats;
+   stats.books = 1;
+   stats.threads = 1;
+   uint32_t key = ticker_key(ticker);
+
+   read_journal(path, allow_malformed, stats.malformed, [&](const journal_record_t* records, size_t count) {
+      for (size_t i = 0; i < count; i++) {
+         const journal_record_t& rec = records[ i ];
+         stats.records++;
+         if (ticker_key(rec.ticker) != key || (rec.sequence != 0 && rec.sequence <= after_sequence)) {
+            continue;
+         }
+         apply(book, rec);
+         stats.applied++;
+         if (rec.sequence > stats.last_sequence) {
+            stats.last_sequence = rec.sequence;
+         }
+      }
+   });
+   return stats;
+}
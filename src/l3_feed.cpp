@@ -0,0 +1,120 @@
+#include "l3_feed.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+l3_file_channel::l3_file_channel(const std::string& path, size_t capacity)
+   : path_(path), capacity_(capacity)
+{
+   if (capacity_ == 0) {
+      throw std::invalid_argument("l3_file_channel needs room for at least one frame");
+   }
+   fd_ = ::open(path_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+   if (fd_ < 0) {
+      throw std::runtime_error("open " + path_ + ": " + std::strerror(errno));
+   }
+   size_t bytes = capacity_ * sizeof(l3_frame_t);
+   void* p = MAP_FAILED;
+   if (::ftruncate(fd_, static_cast<off_t>(bytes)) == 0) {
+      p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+   }
+   if (p == MAP_FAILED) {
+      int err = errno;
+      ::close(fd_);
+      throw std::runtime_error("l3 file " + path_ + ": " + std::strerror(err));
+   }
+   frames_ = static_cast<l3_frame_t*>(p);
+}
+
+l3_file_channel::~l3_file_channel() {
+   ::munmap(frames_, capacity_ * sizeof(l3_frame_t));
+   // nothing useful to do about a failed trim in a destructor; the tail is zero frames
+   (void)::ftruncate(fd_, static_cast<off_t>(used_ * sizeof(l3_frame_t)));
+   ::close(fd_);
+}
+
+void l3_feed::on_event(const log_event_t& event, const order_t* queued_before) {
+   uint64_t sequence;
+   switch (event.kind) {
+      case log_event_kind::ADD: {
+         l3_add_t* m = open<l3_add_t>(l3_template::ADD, sequence);
+         if (!m) {
+            return;
+         }
+         m->sequence = sequence;
+         m->timestamp = event.timestamp;
+         std::memcpy(m->order_id, event.order_id, ORDER_ID_LEN);
+         if (queued_before) {
+            std::memcpy(m->queued_before, queued_before->order_id, ORDER_ID_LEN);
+         }
+         m->qty = event.qty;
+         m->price = event.price;
+         m->instrument = instrument_;
+         m->side = static_cast<uint8_t>(event.side);
+         break;
+      }
+      case log_event_kind::MODIFY: {
+         l3_modify_t* m = open<l3_modify_t>(l3_template::MODIFY, sequence);
+         if (!m) {
+            return;
+         }
+         m->sequence = sequence;
+         m->timestamp = event.timestamp;
+         std::memcpy(m->order_id, event.order_id, ORDER_ID_LEN);
+         if (queued_before) {
+            std::memcpy(m->queued_before, queued_before->order_id, ORDER_ID_LEN);
+         }
+         m->qty = event.qty;
+         m->price = event.price;
+         m->instrument = instrument_;
+         m->side = static_cast<uint8_t>(event.side);
+         break;
+      }
+      case log_event_kind::CANCEL: {
+         l3_delete_t* m = open<l3_delete_t>(l3_template::DELETE, sequence);
+         if (!m) {
+            return;
+         }
+         m->sequence = sequence;
+         m->timestamp = event.timestamp;
+         std::memcpy(m->order_id, event.order_id, ORDER_ID_LEN);
+         m->qty = event.qty;
+         m->price = event.price;
+         m->instrument = instrument_;
+         m->side = static_cast<uint8_t>(event.side);
+         break;
+      }
+      case log_event_kind::MATCH: {
+         // fills carry raw clock ticks, as they do for the logger
+         uint64_t ts = event.ts_clock ? event.ts_clock->to_ns(event.timestamp) : event.timestamp;
+         matches_++;
+         executed(event, ts, true);
+         executed(event, ts, false);
+         return;
+      }
+   }
+   channel_->end_frame();
+}
+
+// one side of a MATCH: the bid is the event's primary order, the ask its secondary
+void l3_feed::executed(const log_event_t& event, uint64_t timestamp, bool bid) {
+   uint64_t sequence;
+   l3_executed_t* m = open<l3_executed_t>(l3_template::EXECUTED, sequence);
+   if (!m) {
+      return;
+   }
+   m->sequence = sequence;
+   m->timestamp = timestamp;
+   std::memcpy(m->order_id, bid ? event.order_id : event.order_id_secondary, ORDER_ID_LEN);
+   m->match_number = matches_;
+   m->qty = bid ? event.qty : event.qty_secondary;
+   m->price = bid ? event.price : event.price_secondary;
+   m->instrument = instrument_;
+   m->side = static_cast<uint8_t>(bid ? event.side : event.side_secondary);
+   channel_->end_frame();
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+
+#include "../includes/logger.h"
+#include "../includes/spsc_ring.h"
+#include "../includes/types.h"
+
+/*
+   Order-by-order (L3) market data: one message per order event, enough
+   for a consumer to rebuild every price level's queue exactly.
+
+   The book hands its feed the same log_event_t it gives the logger, at
+   the same points (add, modify, cancel, reduce and each fill), plus the
+   resting order its order now sits in front of. Add and Modify carry
+   that order's id in queued_before (all NUL: the back of the level),
+   because the book's queues are not append-only: an order may take a
+   slot a departed one freed. A Modify moves the order there with its
+   new price, side and qty; a reduce is a Modify that stays put. Each
+   fill is two Executed messages, bid then ask, sharing a match number;
+   an order leaves the book when its executed qty reaches its qty.
+   Replay calls and snapshot loads publish nothing: consumers start from
+   a snapshot.
+
+   Messages are SBE-style: a fixed little-endian header (block_length,
+   template_id, schema_id, version), then a fixed-layout block, in one
+   L3_FRAME_BYTES frame. The encoder claims a frame in the channel and
+   writes the fields straight into it; nothing is built and copied.
+
+   Sequence numbers are per channel, from 1. A full channel drops the
+   message but still spends its sequence number, so consumers see the
+   gap and resynchronise from a snapshot.
+*/
+
+static constexpr uint16_t L3_SCHEMA_ID = 1;
+static constexpr uint16_t L3_SCHEMA_VERSION = 1;
+
+enum class l3_template : uint16_t {
+   ADD=1,
+   MODIFY=2,
+   DELETE=3,
+   EXECUTED=4
+};
+
+struct l3_message_header_t {
+   uint16_t block_length;    // bytes of the block that follows
+   uint16_t template_id;     // l3_template
+   uint16_t schema_id;
+   uint16_t version;
+};
+
+struct l3_add_t {
+   uint64_t sequence;
+   uint64_t timestamp;
+   char order_id [ ORDER_ID_LEN ];
+   char queued_before [ ORDER_ID_LEN ];
+   uint64_t qty;
+   uint32_t price;
+   uint32_t instrument;
+   uint8_t side;             // order_side
+   uint8_t reserved [ 7 ];
+};
+
+// same block as Add: where the order now rests
+struct l3_modify_t {
+   uint64_t sequence;
+   uint64_t timestamp;
+   char order_id [ ORDER_ID_LEN ];
+   char queued_before [ ORDER_ID_LEN ];
+   uint64_t qty;             // new qty
+   uint32_t price;           // new price
+   uint32_t instrument;
+   uint8_t side;             // new side
+   uint8_t reserved [ 7 ];
+};
+
+struct l3_delete_t {
+   uint64_t sequence;
+   uint64_t timestamp;
+   char order_id [ ORDER_ID_LEN ];
+   uint64_t qty;             // what was left
+   uint32_t price;
+   uint32_t instrument;
+   uint8_t side;
+   uint8_t reserved [ 7 ];
+};
+
+struct l3_executed_t {
+   uint64_t sequence;
+   uint64_t timestamp;       // ns
+   char order_id [ ORDER_ID_LEN ];
+   uint64_t match_number;    // per feed, from 1; shared by both sides of a fill
+   uint64_t qty;             // executed
+   uint32_t price;           // the order's level
+   uint32_t instrument;
+   uint8_t side;
+   uint8_t reserved [ 7 ];
+};
+
+static constexpr size_t L3_FRAME_BYTES = 80;
+
+struct alignas(8) l3_frame_t {
+   unsigned char bytes [ L3_FRAME_BYTES ];
+};
+
+static_assert(sizeof(l3_message_header_t) == 8, "l3 header is a fixed wire layout");
+static_assert(sizeof(l3_add_t) == 72 && sizeof(l3_modify_t) == 72, "l3 blocks are a fixed wire layout");
+static_assert(sizeof(l3_delete_t) == 56 && sizeof(l3_executed_t) == 64, "l3 blocks are a fixed wire layout");
+static_assert(sizeof(l3_message_header_t) + sizeof(l3_add_t) <= L3_FRAME_BYTES, "l3 messages must fit a frame");
+
+// consumer side: the header and block of a frame read from a channel
+inline const l3_message_header_t& l3_header(const l3_frame_t& frame) {
+   return *reinterpret_cast<const l3_message_header_t*>(frame.bytes);
+}
+
+template <typename Block>
+inline const Block& l3_block(const l3_frame_t& frame) {
+   return *reinterpret_cast<const Block*>(frame.bytes + sizeof(l3_message_header_t));
+}
+
+struct l3_channel_stats_t {
+   uint64_t messages = 0;    // committed
+   uint64_t dropped = 0;     // channel full
+};
+
+/*
+   Where frames go. Producer side only, from the matching thread; one
+   channel may carry several books' feeds if they share that thread.
+*/
+class l3_channel {
+public:
+   virtual ~l3_channel() = default;
+
+   // the frame to encode the next message into, or nullptr (counted as dropped)
+   l3_frame_t* begin_frame(uint64_t& sequence) {
+      sequence = ++sequence_;
+      l3_frame_t* frame = claim();
+      if (!frame) {
+         stats_.dropped++;
+      }
+      return frame;
+   }
+
+   void end_frame() {
+      commit();
+      stats_.messages++;
+   }
+
+   uint64_t sequence() const { return sequence_; }
+   const l3_channel_stats_t& stats() const { return stats_; }
+
+protected:
+   virtual l3_frame_t* claim() = 0;
+   virtual void commit() = 0;
+
+private:
+   uint64_t sequence_ = 0;
+   l3_channel_stats_t stats_;
+};
+
+static constexpr size_t L3_RING_SLOTS = 1 << 16;
+using l3_ring = spsc_ring<l3_frame_t, L3_RING_SLOTS>;
+
+// into an spsc_ring the caller owns, which may live in shared memory
+class l3_ring_channel final : public l3_channel {
+public:
+   explicit l3_ring_channel(l3_ring& ring) : ring_(&ring) {}
+
+protected:
+   l3_frame_t* claim() override { return ring_->try_claim(); }
+   void commit() override { ring_->commit(); }
+
+private:
+   l3_ring* ring_;
+};
+
+/*
+   Into a file of back-to-back frames, mapped up front at `capacity`
+   frames and trimmed to what was written on close; once full, messages
+   are dropped. For capture and offline replay: frames() says how many
+   are complete while it is open. Throws std::runtime_error when the
+   file cannot be created or mapped.
+*/
+class l3_file_channel final : public l3_channel {
+public:
+   l3_file_channel(const std::string& path, size_t capacity);
+   ~l3_file_channel() override;
+
+   l3_file_channel(const l3_file_channel&) = delete;
+   l3_file_channel& operator=(const l3_file_channel&) = delete;
+
+   size_t frames() const { return used_; }
+   size_t capacity() const { return capacity_; }
+
+protected:
+   l3_frame_t* claim() override { return used_ < capacity_ ? &frames_[ used_ ] : nullptr; }
+   void commit() override { used_++; }
+
+private:
+   std::string path_;
+   int fd_ = -1;
+   l3_frame_t* frames_ = nullptr;
+   size_t capacity_;
+   size_t used_ = 0;
+};
+
+/*
+   Encodes one book's events onto a channel. Set on the book with
+   orderbook::set_l3_feed(); runs on the matching thread inside the call.
+*/
+class l3_feed {
+public:
+   l3_feed(l3_channel& channel, uint32_t instrument) : channel_(&channel), instrument_(instrument) {}
+
+   // queued_before: the resting order an added or modified order now sits in front of, if any
+   void on_event(const log_event_t& event, const order_t* queued_before);
+
+   uint64_t match_count() const { return matches_; }
+   l3_channel& channel() const { return *channel_; }
+
+private:
+   // zeroed block behind a filled-in header, or nullptr if the channel is full
+   template <typename Block>
+   Block* open(l3_template id, uint64_t& sequence) {
+      l3_frame_t* frame = channel_->begin_frame(sequence);
+      if (!frame) {
+         return nullptr;
+      }
+      l3_message_header_t* header = new (frame->bytes) l3_message_header_t;
+      header->block_length = static_cast<uint16_t>(sizeof(Block));
+      header->template_id = static_cast<uint16_t>(id);
+      header->schema_id = L3_SCHEMA_ID;
+      header->version = L3_SCHEMA_VERSION;
+      return new (frame->bytes + sizeof(l3_message_header_t)) Block {};
+   }
+
+   void executed(const log_event_t& event, uint64_t timestamp, bool bid);
+
+   l3_channel* channel_;
+   uint32_t instrument_;
+   uint64_t matches_ = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+#include "../includes/clock.h"
+#include "../includes/latency_histogram.h"
+
+/*
+   Per-call latency instrumentation for orderbook, compiled in only when
+   ORDERBOOK_LATENCY_STATS is defined (cmake -DORDERBOOK_LATENCY_STATS=ON).
+
+   One histogram per (operation, order_result) pair, in raw TSC ticks.
+   The matching thread only ever writes counters; a monitoring thread
+   calls snapshot() for cumulative figures or scrape() for the delta
+   since its previous scrape. "Reset" is done on the reader side by
+   keeping the last scrape as a baseline, so the writer is never asked to
+   zero anything.
+*/
+
+enum class latency_op : uint8_t {
+   ADD=0,
+   MODIFY=1,
+   CANCEL=2,
+   EXECUTE=3,
+   REDUCE=4
+};
+
+constexpr size_t LATENCY_OPS = 5;
+
+// order_result codes are multiples of 10 (SUCCESS=0 ... BOOK_FULL=60)
+constexpr size_t LATENCY_RESULTS = 8;
+
+static inline size_t latency_result_slot(uint8_t result_code) {
+   size_t slot = result_code / 10;
+   return slot < LATENCY_RESULTS ? slot : LATENCY_RESULTS - 1;
+}
+
+struct orderbook_latency_snapshot {
+   std::array<std::array<latency_histogram_snapshot, LATENCY_RESULTS>, LATENCY_OPS> histograms;
+   double ns_per_tick = 1.0;
+
+   const latency_histogram_snapshot& at(latency_op op, uint8_t result_code) const {
+      return histograms[ static_cast<size_t>(op) ][ latency_result_slot(result_code) ];
+   }
+
+   // all result codes of one operation merged
+   latency_histogram_snapshot total(latency_op op) const {
+      latency_histogram_snapshot out;
+      for (const auto& h : histograms[ static_cast<size_t>(op) ]) {
+         out.merge(h);
+      }
+      return out;
+   }
+};
+
+class orderbook_latency_stats {
+public:
+   void record(latency_op op, uint8_t result_code, uint64_t ticks) {
+      histograms_[ static_cast<size_t>(op) ][ latency_result_slot(result_code) ].record(ticks);
+   }
+
+   void snapshot(orderbook_latency_snapshot& out) const {
+      for (size_t op = 0; op < LATENCY_OPS; op++) {
+         for (size_t r = 0; r < LATENCY_RESULTS; r++) {
+            histograms_[ op ][ r ].snapshot(out.histograms[ op ][ r ]);
+         }
+      }
+      out.ns_per_tick = default_clock().ns_per_tick();
+   }
+
+   // delta since the previous scrape(); the first call returns everything so far
+   void scrape(orderbook_latency_snapshot& out) {
+      std::lock_guard<std::mutex> lock(scrape_mutex_);
+      snapshot(out);
+      for (size_t op = 0; op < LATENCY_OPS; op++) {
+         for (size_t r = 0; r < LATENCY_RESULTS; r++) {
+            latency_histogram_snapshot& cur = out.histograms[ op ][ r ];
+            latency_histogram_snapshot& base = baseline_.histograms[ op ][ r ];
+            latency_histogram_snapshot next = cur;
+            cur.subtract(base);
+            base = next;
+         }
+      }
+   }
+
+private:
+   std::array<std::array<latency_histogram, LATENCY_RESULTS>, LATENCY_OPS> histograms_;
+
+   // reader side only
+   std::mutex scrape_mutex_;
+   orderbook_latency_snapshot baseline_;
+};
@@ -0,0 +1,400 @@
+/*
+   exchange: synthetic order-flow driver.
+
+   exchange generate --messages N [--seed S] --out flow.bin
+   exchange run [--in flow.bin | --messages N [--seed S]]
+                [--engine orderbook|mapped] [--book-file path] [--json report.json]
+   exchange itch --in file.itch [--symbols AAPL,MSFT] [--price-divisor 100]
+
+   run and itch also take [--pages system|4k|thp|2m|1g] [--reserve-mb N]
+   [--mlock] to put book memory on (pre-faulted) huge pages.
+
+   `run` streams the flow through the chosen engine and reports sustained
+   msgs/sec plus per-message-kind latency percentiles and histograms.
+   When orderbook is built with ORDERBOOK_LATENCY_STATS or
+   ORDERBOOK_PERF_COUNTERS, its per-operation figures (add, modify,
+   cancel and execute timed separately) are printed as well.
+
+   `itch` replays a NASDAQ ITCH 5.0 file into one book per symbol and
+   reports messages/sec plus per-message-type latency.
+
+   The mapped engine keeps its book in --book-file, which is replaced
+   and left in place; without it a temporary file is used and removed.
+
+   With --pages other than system, the pages actually obtained (after
+   any fallback) and how much of the pool the books used are printed at
+   the end; late chunks mean --reserve-mb was too small and some page
+   faults happened during the run.
+*/
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "flow_driver.h"
+#include "flow_generator.h"
+#include "itch_replay.h"
+#include "mapped_orderbook.h"
+#include "orderbook.h"
+
+static const char* KIND_NAMES[] = { "add", "cancel", "modify" };
+static constexpr int KIND_COUNT = 3;
+static constexpr int LOG2_BUCKETS = 32;
+
+// raw samples for percentiles plus power-of-two ns buckets for the histogram
+struct kind_latency_t {
+   std::vector<uint64_t> ticks;
+   uint64_t buckets[ LOG2_BUCKETS ] = {};
+   uint64_t rejected = 0;
+};
+
+static double percentile_ns(const std::vector<uint64_t>& sorted, double q, double ns_per_tick) {
+   if (sorted.empty()) {
+      return 0;
+   }
+   size_t idx = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+   return static_cast<double>(sorted[ idx ]) * ns_per_tick;
+}
+
+static void usage(const char* prog) {
+   std::fprintf(stderr,
+      "usage: %s generate --messages N [--seed S] --out flow.bin\n"
+      "       %s run [--in flow.bin | --messages N [--seed S]] [--engine orderbook|mapped] [--book-file path]\n"
+      "           [--json report.json]\n"
+      "       %s itch --in file.itch [--symbols AAPL,MSFT] [--price-divisor 100]\n"
+      "       (run, itch) [--pages system|4k|thp|2m|1g] [--reserve-mb N] [--mlock]\n",
+      prog, prog, prog);
+}
+
+static std::vector<std::string> split_list(const char* arg) {
+   std::vector<std::string> out;
+   std::string cur;
+   for (const char* p = arg; ; p++) {
+      if (*p == ',' || *p == '\0') {
+         if (!cur.empty()) {
+            out.push_back(cur);
+         }
+         cur.clear();
+         if (*p == '\0') {
+            break;
+         }
+      } else {
+         cur.push_back(*p);
+      }
+   }
+   return out;
+}
+
+static void report_memory() {
+   const book_memory_config_t& config = book_memory::instance().config();
+   if (config.pages == page_kind::SYSTEM) {
+      return;
+   }
+   book_memory_stats_t s = book_memory::instance().stats();
+   std::fprintf(stderr, "book memory: requested %s, got %s; mapped %.1f MB in %llu chunks (%llu late, %llu fallbacks%s), "
+                "peak %.1f MB\n",
+                page_kind_name(s.requested), page_kind_name(s.backing),
+                static_cast<double>(s.mapped_bytes) / 1048576.0,
+                static_cast<unsigned long long>(s.chunks), static_cast<unsigned long long>(s.late_chunks),
+                static_cast<unsigned long long>(s.fallbacks), s.lock_failures ? ", mlock failed" : "",
+                static_cast<double>(s.peak_bytes) / 1048576.0);
+}
+
+static int run_itch(const std::string& path, const itch_replay_options_t& options) {
+   static const char* KIND_LABELS[ ITCH_KINDS ] = { "add", "executed", "cancel", "delete", "replace" };
+
+   auto replayer = std::make_unique<itch_replayer>(options);
+   itch_replay_stats_t stats = replayer->replay_file(path);
+   double ns_per_tick = default_clock().ns_per_tick();
+
+   std::printf("messages=%llu book_messages=%llu applied=%llu unknown_order=%llu rejected=%llu books=%zu\n",
+               static_cast<unsigned long long>(stats.messages),
+               static_cast<unsigned long long>(stats.book_messages),
+               static_cast<unsigned long long>(stats.applied),
+               static_cast<unsigned long long>(stats.unknown_order),
+               static_cast<unsigned long long>(stats.rejected), stats.books);
+   std::printf("seconds=%.3f msgs_per_sec=%.0f\n",
+               static_cast<double>(stats.elapsed_ns) / 1e9, stats.messages_per_sec());
+   if (stats.truncated) {
+      std::printf("warning: %llu trailing bytes do not form a whole frame\n",
+                  static_cast<unsigned long long>(stats.truncated));
+   }
+
+   for (size_t k = 0; k < ITCH_KINDS; k++) {
+      const latency_histogram_snapshot& h = stats.latency[ k ];
+      std::printf("%-8s count=%-10llu p50=%.0fns p99=%.0fns p99.9=%.0fns max=%.0fns\n", KIND_LABELS[ k ],
+                  static_cast<unsigned long long>(stats.count[ k ]),
+                  static_cast<double>(h.value_at(0.5)) * ns_per_tick,
+                  static_cast<double>(h.value_at(0.99)) * ns_per_tick,
+                  static_cast<double>(h.value_at(0.999)) * ns_per_tick,
+                  static_cast<double>(h.max()) * ns_per_tick);
+   }
+   return 0;
+}
+
+// engines without built-in instrumentation
+template <typename engine_t>
+static void report_instrumentation(const engine_t&) {}
+
+static void report_instrumentation(const orderbook& ob) {
+   static const char* OP_NAMES[ LATENCY_OPS ] = { "add", "modify", "cancel", "execute", "reduce" };
+
+   if (orderbook_latency_stats* stats = ob.latency_stats()) {
+      auto snap = std::make_unique<orderbook_latency_snapshot>();
+      stats->snapshot(*snap);
+      for (size_t op = 0; op < LATENCY_OPS; op++) {
+         latency_histogram_snapshot h = snap->total(static_cast<latency_op>(op));
+         std::printf("book %-7s calls=%-9llu p50=%.0fns p99=%.0fns p99.9=%.0fns\n", OP_NAMES[ op ],
+                     static_cast<unsigned long long>(h.count()),
+                     static_cast<double>(h.value_at(0.5)) * snap->ns_per_tick,
+                     static_cast<double>(h.value_at(0.99)) * snap->ns_per_tick,
+                     static_cast<double>(h.value_at(0.999)) * snap->ns_per_tick);
+      }
+   }
+
+   if (const orderbook_perf_stats* perf = ob.perf_stats()) {
+      if (!perf->group || !perf->group->available()) {
+         std::printf("perf counters unavailable (%s)\n",
+                     perf->group ? perf->group->unavailable_reason() : "not opened");
+         return;
+      }
+      for (size_t op = 0; op < LATENCY_OPS; op++) {
+         const perf_totals_t& t = perf->at(static_cast<latency_op>(op));
+         std::printf("book %-7s per op:", OP_NAMES[ op ]);
+         for (size_t c = 0; c < PERF_COUNTERS; c++) {
+            std::printf(" %s=%.2f", perf_counter_name(c), t.per_op(c));
+         }
+         std::printf("\n");
+      }
+   }
+}
+
+template <typename engine_t>
+static int run_engine(engine_t& engine, const std::vector<flow_msg_t>& msgs, const std::string& json_path) {
+   kind_latency_t per_kind[ KIND_COUNT ];
+   for (auto& k : per_kind) {
+      k.ticks.reserve(msgs.size() / 2);
+   }
+   double ns_per_tick = default_clock().ns_per_tick();
+
+   flow_run_stats_t stats = drive_flow(engine, msgs.data(), msgs.size(),
+      [&](flow_msg_kind kind, uint64_t ticks, order_result r) {
+         kind_latency_t& k = per_kind[ static_cast<int>(kind) ];
+         k.ticks.push_back(ticks);
+         if (r != order_result::SUCCESS) {
+            k.rejected++;
+         }
+      });
+
+   double seconds = static_cast<double>(stats.seconds_ns) / 1e9;
+   std::printf("messages=%llu rejected=%llu seconds=%.3f msgs_per_sec=%.0f\n",
+               static_cast<unsigned long long>(stats.messages),
+               static_cast<unsigned long long>(stats.rejected),
+               seconds, static_cast<double>(stats.messages) / seconds);
+
+   std::FILE* json = json_path.empty() ? nullptr : std::fopen(json_path.c_str(), "w");
+   if (json) {
+      std::fprintf(json, "{\"messages\":%llu,\"rejected\":%llu,\"seconds\":%.6f,\"msgs_per_sec\":%.1f,\"kinds\":{",
+                   static_cast<unsigned long long>(stats.messages),
+                   static_cast<unsigned long long>(stats.rejected),
+                   seconds, static_cast<double>(stats.messages) / seconds);
+   }
+
+   for (int i = 0; i < KIND_COUNT; i++) {
+      kind_latency_t& k = per_kind[ i ];
+      for (uint64_t t : k.ticks) {
+         uint64_t ns = static_cast<uint64_t>(static_cast<double>(t) * ns_per_tick);
+         int b = 0;
+         while (b < LOG2_BUCKETS - 1 && (1ULL << (b + 1)) <= ns) {
+            b++;
+         }
+         k.buckets[ b ]++;
+      }
+      std::sort(k.ticks.begin(), k.ticks.end());
+
+      double p50 = percentile_ns(k.ticks, 0.50, ns_per_tick);
+      double p99 = percentile_ns(k.ticks, 0.99, ns_per_tick);
+      double p999 = percentile_ns(k.ticks, 0.999, ns_per_tick);
+      double max = percentile_ns(k.ticks, 1.0, ns_per_tick);
+
+      std::printf("%-7s count=%-9zu rejected=%-7llu p50=%.0fns p99=%.0fns p99.9=%.0fns max=%.0fns\n",
+                  KIND_NAMES[ i ], k.ticks.size(), static_cast<unsigned long long>(k.rejected),
+                  p50, p99, p999, max);
+      for (int b = 0; b < LOG2_BUCKETS; b++) {
+         if (k.buckets[ b ]) {
+            std::printf("   [%8llu ns, %8llu ns) %llu\n",
+                        b ? 1ULL << b : 0ULL, 1ULL << (b + 1),
+                        static_cast<unsigned long long>(k.buckets[ b ]));
+         }
+      }
+
+      if (json) {
+         std::fprintf(json, "%s\"%s\":{\"count\":%zu,\"rejected\":%llu,\"p50\":%.1f,\"p99\":%.1f,\"p99.9\":%.1f,\"max\":%.1f,\"log2_buckets\":[",
+                      i ? "," : "", KIND_NAMES[ i ], k.ticks.size(),
+                      static_cast<unsigned long long>(k.rejected), p50, p99, p999, max);
+         for (int b = 0; b < LOG2_BUCKETS; b++) {
+            std::fprintf(json, "%s%llu", b ? "," : "", static_cast<unsigned long long>(k.buckets[ b ]));
+         }
+         std::fprintf(json, "]}");
+      }
+   }
+
+   if (json) {
+      std::fprintf(json, "}}\n");
+      std::fclose(json);
+   }
+
+   report_instrumentation(engine);
+   return 0;
+}
+
+int main(int argc, char** argv) {
+   if (argc < 2) {
+      usage(argv[ 0 ]);
+      return 2;
+   }
+
+   std::string mode = argv[ 1 ];
+   std::string in_path, out_path, json_path, book_path, engine = "orderbook";
+   flow_config_t config;
+   size_t messages = 1000000;
+   itch_replay_options_t itch_options;
+   book_memory_config_t memory;
+
+   for (int i = 2; i < argc; i++) {
+      std::string arg = argv[ i ];
+      bool has_value = i + 1 < argc;
+      if (arg == "--messages" && has_value) {
+         messages = std::strtoull(argv[ ++i ], nullptr, 10);
+      } else if (arg == "--seed" && has_value) {
+         config.seed = std::strtoull(argv[ ++i ], nullptr, 10);
+      } else if (arg == "--in" && has_value) {
+         in_path = argv[ ++i ];
+      } else if (arg == "--out" && has_value) {
+         out_path = argv[ ++i ];
+      } else if (arg == "--json" && has_value) {
+         json_path = argv[ ++i ];
+      } else if (arg == "--book-file" && has_value) {
+         book_path = argv[ ++i ];
+      } else if (arg == "--engine" && has_value) {
+         engine = argv[ ++i ];
+      } else if (arg == "--symbols" && has_value) {
+         itch_options.symbols = split_list(argv[ ++i ]);
+      } else if (arg == "--price-divisor" && has_value) {
+         itch_options.price_divisor = static_cast<uint32_t>(std::strtoul(argv[ ++i ], nullptr, 10));
+      } else if (arg == "--pages" && has_value && parse_page_kind(argv[ i + 1 ], memory.pages)) {
+         i++;
+      } else if (arg == "--reserve-mb" && has_value) {
+         memory.reserve_bytes = std::strtoull(argv[ ++i ], nullptr, 10) << 20;
+      } else if (arg == "--mlock") {
+         memory.lock = true;
+      } else {
+         usage(argv[ 0 ]);
+         return 2;
+      }
+   }
+
+   try {
+      book_memory::instance().configure(memory);
+   } catch (const std::bad_alloc&) {
+      std::fprintf(stderr, "cannot map %zu bytes of book memory\n", memory.reserve_bytes);
+      return 1;
+   }
+
+   if (mode == "itch") {
+      if (in_path.empty() || itch_options.price_divisor == 0) {
+         usage(argv[ 0 ]);
+         return 2;
+      }
+      try {
+         int rc = run_itch(in_path, itch_options);
+         report_memory();
+         return rc;
+      } catch (const std::exception& e) {
+         std::fprintf(stderr, "%s\n", e.what());
+         return 1;
+      }
+   }
+
+   std::vector<flow_msg_t> msgs;
+   if (!in_path.empty()) {
+      try {
+         msgs = read_flow_file(in_path);
+      } catch (const std::exception& e) {
+         std::fprintf(stderr, "%s\n", e.what());
+         return 1;
+      }
+   } else {
+      flow_generator gen(config);
+      gen.generate(messages, msgs);
+   }
+
+   if (mode == "generate") {
+      if (out_path.empty()) {
+         usage(argv[ 0 ]);
+         return 2;
+      }
+      try {
+         write_flow_file(out_path, config, msgs);
+      } catch (const std::exception& e) {
+         std::fprintf(stderr, "%s\n", e.what());
+         return 1;
+      }
+      std::printf("wrote %zu messages to %s\n", msgs.size(), out_path.c_str());
+      return 0;
+   }
+
+   if (mode != "run") {
+      usage(argv[ 0 ]);
+      return 2;
+   }
+
+   if (engine == "orderbook") {
+      auto ob = std::make_unique<orderbook>(nullptr);
+      int rc = run_engine(*ob, msgs, json_path);
+      report_memory();
+      return rc;
+   }
+   if (engine == "mapped") {
+      bool temporary = book_path.empty();
+      if (temporary) {
+         const char* dir = std::getenv("TMPDIR");
+         std::string pattern = std::string(dir && *dir ? dir : "/tmp") + "/exchange_flow.XXXXXX";
+         int fd = ::mkstemp(pattern.data());
+         if (fd < 0) {
+            std::fprintf(stderr, "cannot create a temporary book file in %s: %s\n",
+                         dir && *dir ? dir : "/tmp", std::strerror(errno));
+            return 1;
+         }
+         ::close(fd);
+         book_path = pattern;
+      } else {
+         // a fresh book, not a recovery of whatever the file held
+         std::remove(book_path.c_str());
+      }
+
+      int rc;
+      try {
+         mapped_orderbook ob(book_path, msgs.size() + 1);
+         rc = run_engine(ob, msgs, json_path);
+      } catch (const std::exception& e) {
+         std::fprintf(stderr, "%s\n", e.what());
+         rc = 1;
+      }
+      if (temporary) {
+         std::remove(book_path.c_str());
+      }
+      return rc;
+   }
+
+   usage(argv[ 0 ]);
+   return 2;
+}
@@ -0,0 +1,650 @@
+#include "mapped_orderbook.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include "../includes/snapshot.h"
+
+static constexpr uint32_t NULL_SLOT = 0;
+
+static inline size_t align_up(size_t v, size_t a) {
+   return (v + a - 1) & ~(a - 1);
+}
+
+static inline size_t hash_id(const char* order_id) {
+   order_id_key key;
+   std::memcpy(key.order_id, order_id, ORDER_ID_LEN);
+   return order_id_hasher{}(key);
+}
+
+size_t mapped_orderbook::layout(size_t capacity, mapped_book_header_t& hdr) {
+   size_t index_slots = 1;
+   while (index_slots < capacity * 2) {
+      index_slots <<= 1;
+   }
+
+   size_t ladder_bytes = static_cast<size_t>(MAX_PRICE + 1) * sizeof(mapped_level_t);
+
+   hdr.capacity = capacity;
+   hdr.index_slots = index_slots;
+   hdr.bids_offset = align_up(sizeof(mapped_book_header_t), 64);
+   hdr.asks_offset = align_up(hdr.bids_offset + ladder_bytes, 64);
+   hdr.arena_offset = align_up(hdr.asks_offset + ladder_bytes, 64);
+   hdr.index_offset = align_up(hdr.arena_offset + capacity * sizeof(mapped_order_node_t), 64);
+   hdr.file_size = align_up(hdr.index_offset + index_slots * sizeof(uint32_t), 4096);
+   return hdr.file_size;
+}
+
+mapped_orderbook::mapped_orderbook(
+   const std::string& path,
+   size_t capacity,
+   logger* log_instance,
+   clock_source* clock
+)
+   : path_(path),
+     log_(log_instance),
+     clock_(clock ? clock : &default_clock())
+{
+   if (capacity == 0 || capacity >= UINT32_MAX / 2) {
+      throw std::invalid_argument("mapped_orderbook capacity out of range");
+   }
+
+   fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+   if (fd_ < 0) {
+      throw std::runtime_error("Failed to open book file: " + path);
+   }
+
+   struct stat st;
+   if (::fstat(fd_, &st) != 0) {
+      ::close(fd_);
+      throw std::runtime_error("Failed to stat book file: " + path);
+   }
+
+   mapped_book_header_t expected {};
+   size_t expected_size = layout(capacity, expected);
+   bool fresh = (st.st_size == 0);
+
+   if (fresh) {
+      // ftruncate zero-fills: empty ladders, empty index, all slots unused
+      if (::ftruncate(fd_, static_cast<off_t>(expected_size)) != 0) {
+         ::close(fd_);
+         throw std::runtime_error("Failed to size book file: " + path);
+      }
+      size_ = expected_size;
+   } else {
+      size_ = static_cast<size_t>(st.st_size);
+   }
+
+   void* map = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+   if (map == MAP_FAILED) {
+      ::close(fd_);
+      throw std::runtime_error("Failed to mmap book file: " + path);
+   }
+   base_ = static_cast<char*>(map);
+   hdr_ = reinterpret_cast<mapped_book_header_t*>(base_);
+
+   if (fresh) {
+      *hdr_ = expected;
+      std::memcpy(hdr_->magic, MAPPED_BOOK_MAGIC, sizeof(hdr_->magic));
+      hdr_->version = MAPPED_BOOK_VERSION;
+      hdr_->max_price = MAX_PRICE;
+      hdr_->best_bid = 0;
+      hdr_->best_ask = MAX_PRICE + 1;
+      hdr_->free_head = NULL_SLOT;
+      hdr_->next_unused = 1;
+      status_ = mapped_open_status::CREATED;
+   } else {
+      try {
+         validate(capacity);
+      } catch (...) {
+         ::munmap(base_, size_);
+         ::close(fd_);
+         throw;
+      }
+      status_ = mapped_open_status::RESUMED;
+   }
+
+   bind_sections();
+}
+
+mapped_orderbook::~mapped_orderbook() {
+   if (base_) {
+      ::munmap(base_, size_);
+   }
+   if (fd_ >= 0) {
+      ::close(fd_);
+   }
+}
+
+void mapped_orderbook::validate(size_t capacity) const {
+   mapped_book_header_t expected {};
+   layout(capacity, expected);
+
+   if (size_ < sizeof(mapped_book_header_t) ||
+       std::memcmp(hdr_->magic, MAPPED_BOOK_MAGIC, sizeof(hdr_->magic)) != 0) {
+      throw std::runtime_error("Not a mapped book file: " + path_);
+   }
+   if (hdr_->version != MAPPED_BOOK_VERSION || hdr_->max_price != MAX_PRICE) {
+      throw std::runtime_error("Unsupported mapped book version: " + path_);
+   }
+   if (hdr_->capacity != expected.capacity ||
+       hdr_->index_slots != expected.index_slots ||
+       hdr_->bids_offset != expected.bids_offset ||
+       hdr_->asks_offset != expected.asks_offset ||
+       hdr_->arena_offset != expected.arena_offset ||
+       hdr_->index_offset != expected.index_offset ||
+       hdr_->file_size != size_) {
+      throw std::runtime_error("Mapped book layout mismatch: " + path_);
+   }
+   if (hdr_->mutation_sequence != hdr_->committed_sequence) {
+      throw std::runtime_error("Mapped book has a torn update: " + path_);
+   }
+}
+
+void mapped_orderbook::bind_sections() {
+   bids_ = reinterpret_cast<mapped_level_t*>(base_ + hdr_->bids_offset);
+   asks_ = reinterpret_cast<mapped_level_t*>(base_ + hdr_->asks_offset);
+   arena_ = reinterpret_cast<mapped_order_node_t*>(base_ + hdr_->arena_offset);
+   index_ = reinterpret_cast<uint32_t*>(base_ + hdr_->index_offset);
+}
+
+void mapped_orderbook::sync() {
+   if (::msync(base_, size_, MS_SYNC) != 0) {
+      throw std::runtime_error("Failed to msync book file: " + path_);
+   }
+}
+
+void mapped_orderbook::log_event(const log_event_t& event) {
+   if (log_) {
+      hdr_->journal_sequence = log_->push(event);
+   }
+}
+
+/*
+   Arena
+*/
+uint32_t mapped_orderbook::alloc_slot() {
+   uint32_t slot = hdr_->free_head;
+   if (slot != NULL_SLOT) {
+      hdr_->free_head = node(slot).next;
+   } else if (hdr_->next_unused <= hdr_->capacity) {
+      slot = hdr_->next_unused++;
+   }
+   return slot;
+}
+
+void mapped_orderbook::free_slot(uint32_t slot) {
+   mapped_order_node_t& n = node(slot);
+   n.in_use = 0;
+   n.prev = NULL_SLOT;
+   n.next = hdr_->free_head;
+   hdr_->free_head = slot;
+}
+
+/*
+   Index: linear probing with backward-shift deletion, so no tombstones
+   build up under churn.
+*/
+uint32_t mapped_orderbook::index_find(const char* order_id) const {
+   size_t mask = hdr_->index_slots - 1;
+   for (size_t i = hash_id(order_id) & mask;; i = (i + 1) & mask) {
+      uint32_t slot = index_[ i ];
+      if (slot == NULL_SLOT) {
+         return NULL_SLOT;
+      }
+      if (std::memcmp(node(slot).order.order_id, order_id, ORDER_ID_LEN) == 0) {
+         return slot;
+      }
+   }
+}
+
+void mapped_orderbook::index_insert(const char* order_id, uint32_t slot) {
+   size_t mask = hdr_->index_slots - 1;
+   size_t i = hash_id(order_id) & mask;
+   while (index_[ i ] != NULL_SLOT) {
+      i = (i + 1) & mask;
+   }
+   index_[ i ] = slot;
+}
+
+void mapped_orderbook::index_erase(const char* order_id) {
+   size_t mask = hdr_->index_slots - 1;
+   size_t i = hash_id(order_id) & mask;
+   while (index_[ i ] != NULL_SLOT &&
+          std::memcmp(node(index_[ i ]).order.order_id, order_id, ORDER_ID_LEN) != 0) {
+      i = (i + 1) & mask;
+   }
+   if (index_[ i ] == NULL_SLOT) {
+      return;
+   }
+
+   size_t j = i;
+   for (;;) {
+      j = (j + 1) & mask;
+      if (index_[ j ] == NULL_SLOT) {
+         break;
+      }
+      size_t home = hash_id(node(index_[ j ]).order.order_id) & mask;
+      // move j into the hole unless its home lies cyclically in (i, j]
+      bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+      if (!stays) {
+         index_[ i ] = index_[ j ];
+         i = j;
+      }
+   }
+   index_[ i ] = NULL_SLOT;
+}
+
+/*
+   Level lists
+*/
+void mapped_orderbook::link_tail(uint32_t slot) {
+   mapped_order_node_t& n = node(slot);
+   mapped_level_t& level = level_for(static_cast<order_side>(n.order.side), n.price);
+
+   n.prev = level.tail;
+   n.next = NULL_SLOT;
+   if (level.tail != NULL_SLOT) {
+      node(level.tail).next = slot;
+   } else {
+      level.head = slot;
+   }
+   level.tail = slot;
+   level.count++;
+   level.total_qty += n.order.qty;
+
+   if (n.order.side == static_cast<uint8_t>(order_side::BUY)) {
+      if (n.price > hdr_->best_bid) {
+         hdr_->best_bid = n.price;
+      }
+   } else if (n.price < hdr_->best_ask) {
+      hdr_->best_ask = n.price;
+   }
+}
+
+void mapped_orderbook::unlink(uint32_t slot) {
+   mapped_order_node_t& n = node(slot);
+   order_side side = static_cast<order_side>(n.order.side);
+   mapped_level_t& level = level_for(side, n.price);
+
+   if (n.prev != NULL_SLOT) {
+      node(n.prev).next = n.next;
+   } else {
+      level.head = n.next;
+   }
+   if (n.next != NULL_SLOT) {
+      node(n.next).prev = n.prev;
+   } else {
+      level.tail = n.prev;
+   }
+   level.count--;
+   level.total_qty -= n.order.qty;
+
+   if (level.count == 0) {
+      level.total_qty = 0;
+      if (side == order_side::BUY) {
+         update_best_bid_on_cancel(n.price);
+      } else {
+         update_best_ask_on_cancel(n.price);
+      }
+   }
+}
+
+void mapped_orderbook::remove_order(uint32_t slot) {
+   unlink(slot);
+   index_erase(node(slot).order.order_id);
+   free_slot(slot);
+   hdr_->order_count--;
+}
+
+// NULL_SLOT when the arena is full
+uint32_t mapped_orderbook::insert_order(const order_t& order) {
+   uint32_t slot = alloc_slot();
+   if (slot == NULL_SLOT) {
+      return NULL_SLOT;
+   }
+   mapped_order_node_t& n = node(slot);
+   n.order = order;
+   n.price = order.price;
+   n.in_use = 1;
+   link_tail(slot);
+   index_insert(order.order_id, slot);
+   hdr_->order_count++;
+   return slot;
+}
+
+// to the back of the new level, even at the same price
+void mapped_orderbook::requeue(uint32_t slot, const order_t& new_order) {
+   mapped_order_node_t& n = node(slot);
+   unlink(slot);
+   char order_id[ ORDER_ID_LEN ];
+   std::memcpy(order_id, n.order.order_id, ORDER_ID_LEN);
+   n.order = new_order;
+   std::memcpy(n.order.order_id, order_id, ORDER_ID_LEN); // index stays keyed by id
+   n.price = new_order.price;
+   link_tail(slot);
+}
+
+void mapped_orderbook::update_best_bid_on_cancel(uint32_t price) {
+   if (price == hdr_->best_bid) {
+      while (hdr_->best_bid > 0 && bids_[ hdr_->best_bid ].count == 0) {
+         hdr_->best_bid--;
+      }
+   }
+}
+
+void mapped_orderbook::update_best_ask_on_cancel(uint32_t price) {
+   if (price == hdr_->best_ask) {
+      while (hdr_->best_ask <= MAX_PRICE && asks_[ hdr_->best_ask ].count == 0) {
+         hdr_->best_ask++;
+      }
+   }
+}
+
+/*
+   Public API
+*/
+bool mapped_orderbook::contains(const order_id_key& id) const {
+   return index_find(id.order_id) != NULL_SLOT;
+}
+
+size_t mapped_orderbook::order_count() const {
+   return hdr_->order_count;
+}
+
+size_t mapped_orderbook::level_qty(order_side side, uint32_t price) const {
+   if (price > MAX_PRICE) {
+      return 0;
+   }
+   return (side == order_side::BUY ? bids_[ price ] : asks_[ price ]).total_qty;
+}
+
+std::optional<uint32_t> mapped_orderbook::best_bid() const {
+   if (bids_[ hdr_->best_bid ].count == 0) {
+      return std::nullopt;
+   }
+   return hdr_->best_bid;
+}
+
+std::optional<uint32_t> mapped_orderbook::best_ask() const {
+   if (hdr_->best_ask > MAX_PRICE || asks_[ hdr_->best_ask ].count == 0) {
+      return std::nullopt;
+   }
+   return hdr_->best_ask;
+}
+
+order_result mapped_orderbook::add(const order_t& order) {
+   if (index_find(order.order_id) != NULL_SLOT) {
+      return order_result::DUPLICATE_ID;
+   }
+   if (order.side != static_cast<uint8_t>(order_side::BUY) && order.side != static_cast<uint8_t>(order_side::SELL)) {
+      return order_result::INVALID_SIDE;
+   }
+   if (order.price > MAX_PRICE) {
+      return order_result::INVALID_PRICE;
+   }
+
+   begin_mutation();
+   if (insert_order(order) == NULL_SLOT) {
+      end_mutation();
+      return order_result::BOOK_FULL;
+   }
+
+   log_event_t event {
+      order.timestamp,
+      order.order_id,
+      log_event_kind::ADD,
+      order.price,
+      order.qty,
+      static_cast<order_side>(order.side),
+      order.ticker
+   };
+   log_event(event);
+   end_mutation();
+
+   return order_result::SUCCESS;
+}
+
+order_result mapped_orderbook::modify(const order_id_key& id, const order_t& new_order) {
+   uint32_t slot = index_find(id.order_id);
+   if (slot == NULL_SLOT) {
+      return order_result::ORDER_NOT_FOUND;
+   }
+   if (new_order.price > MAX_PRICE) {
+      return order_result::INVALID_PRICE;
+   }
+   order_side new_side = static_cast<order_side>(new_order.side);
+   if (new_side != order_side::BUY && new_side != order_side::SELL) {
+      return order_result::INVALID_SIDE;
+   }
+
+   begin_mutation();
+   const order_t old_order = node(slot).order;
+   requeue(slot, new_order);
+
+   log_event_t event;
+   event.timestamp = new_order.timestamp;
+   std::memcpy(event.order_id, new_order.order_id, ORDER_ID_LEN);
+   event.kind    = log_event_kind::MODIFY;
+   event.price   = new_order.price;
+   event.qty     = new_order.qty;
+   event.side    = new_side;
+   std::memcpy(event.ticker, new_order.ticker, TICKER_LEN);
+
+   std::memcpy(event.order_id_secondary, old_order.order_id, ORDER_ID_LEN);
+   event.price_secondary = old_order.price;
+   event.qty_secondary   = old_order.qty;
+   event.side_secondary  = static_cast<order_side>(old_order.side);
+
+   log_event(event);
+   end_mutation();
+
+   return order_result::SUCCESS;
+}
+
+order_result mapped_orderbook::cancel(const order_id_key& id) {
+   uint32_t slot = index_find(id.order_id);
+   if (slot == NULL_SLOT) {
+      return order_result::ORDER_NOT_FOUND;
+   }
+
+   begin_mutation();
+   const order_t stored_order = node(slot).order;
+   remove_order(slot);
+
+   log_event_t event {
+      stored_order.timestamp,
+      stored_order.order_id,
+      log_event_kind::CANCEL,
+      stored_order.price,
+      stored_order.qty,
+      static_cast<order_side>(stored_order.side),
+      stored_order.ticker
+   };
+   log_event(event);
+   end_mutation();
+
+   return order_result::SUCCESS;
+}
+
+void mapped_orderbook::execute() {
+   begin_mutation();
+
+   while (best_bid().has_value() && best_ask().has_value() &&
+          hdr_->best_bid >= hdr_->best_ask) {
+      uint32_t bid_price = hdr_->best_bid;
+      uint32_t ask_price = hdr_->best_ask;
+      uint32_t bid_slot = bids_[ bid_price ].head;
+      uint32_t ask_slot = asks_[ ask_price ].head;
+
+      order_t& bid_order = node(bid_slot).order;
+      order_t& ask_order = node(ask_slot).order;
+
+      size_t match_qty = (bid_order.qty < ask_order.qty ? bid_order.qty : ask_order.qty);
+
+      bid_order.qty -= match_qty;
+      ask_order.qty -= match_qty;
+      bids_[ bid_price ].total_qty -= match_qty;
+      asks_[ ask_price ].total_qty -= match_qty;
+
+      log_event_t match_event;
+      match_event.timestamp = clock_->now();
+      match_event.ts_clock = clock_;
+      match_event.kind = log_event_kind::MATCH;
+
+      std::memcpy(match_event.order_id, bid_order.order_id, ORDER_ID_LEN);
+      std::memcpy(match_event.ticker, bid_order.ticker, TICKER_LEN);
+      match_event.price = bid_price;
+      match_event.qty = match_qty;
+      match_event.side = order_side::BUY;
+
+      std::memcpy(match_event.order_id_secondary, ask_order.order_id, ORDER_ID_LEN);
+      match_event.price_secondary = ask_price;
+      match_event.qty_secondary = match_qty;
+      match_event.side_secondary = order_side::SELL;
+
+      log_event(match_event);
+
+      if (bid_order.qty == 0) {
+         remove_order(bid_slot);
+      }
+      if (ask_order.qty == 0) {
+         remove_order(ask_slot);
+      }
+   }
+
+   end_mutation();
+}
+
+/*
+   Snapshots
+*/
+void mapped_orderbook::capture_snapshot(const char* ticker, std::vector<char>& out) const {
+   // upper bound: at most one level header per order
+   out.resize(sizeof(snapshot_header_t) + hdr_->order_count * (sizeof(snapshot_level_t) + sizeof(order_t)));
+
+   char* cursor = out.data() + sizeof(snapshot_header_t);
+   uint32_t level_count = 0;
+
+   auto emit_level = [&](order_side side, uint32_t price, const mapped_level_t& level) {
+      snapshot_level_t hdr {};
+      hdr.side = static_cast<uint8_t>(side);
+      hdr.price = price;
+      hdr.order_count = level.count;
+      hdr.total_qty = level.total_qty;
+      std::memcpy(cursor, &hdr, sizeof(hdr));
+      cursor += sizeof(hdr);
+
+      for (uint32_t slot = level.head; slot != NULL_SLOT; slot = node(slot).next) {
+         std::memcpy(cursor, &node(slot).order, sizeof(order_t));
+         cursor += sizeof(order_t);
+      }
+      level_count++;
+   };
+
+   if (best_bid().has_value()) {
+      for (uint32_t p = hdr_->best_bid + 1; p-- > 0;) {
+         if (bids_[ p ].count != 0) {
+            emit_level(order_side::BUY, p, bids_[ p ]);
+         }
+      }
+   }
+   if (best_ask().has_value()) {
+      for (uint32_t p = hdr_->best_ask; p <= MAX_PRICE; p++) {
+         if (asks_[ p ].count != 0) {
+            emit_level(order_side::SELL, p, asks_[ p ]);
+         }
+      }
+   }
+
+   snapshot_header_t header {};
+   std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+   header.version = SNAPSHOT_VERSION;
+   std::memcpy(header.ticker, ticker, TICKER_LEN);
+   header.last_sequence = hdr_->journal_sequence;
+   header.order_count = hdr_->order_count;
+   header.level_count = level_count;
+   header.order_size = sizeof(order_t);
+   std::memcpy(out.data(), &header, sizeof(header));
+
+   out.resize(static_cast<size_t>(cursor - out.data()));
+}
+
+uint64_t mapped_orderbook::load_snapshot(const char* data, size_t len) {
+   if (hdr_->order_count != 0) {
+      throw std::logic_error("load_snapshot() requires an empty book");
+   }
+
+   snapshot_header_t header = read_snapshot_header(data, len);
+   if (header.order_count > hdr_->capacity) {
+      throw std::runtime_error("Snapshot does not fit mapped book: " + path_);
+   }
+
+   // a corrupt image throws with the mutation still open, so the file is refused on reopen
+   begin_mutation();
+   read_snapshot_levels(data, len, header, MAX_PRICE, [&](const snapshot_level_t& lvl, const char* orders) {
+      for (uint64_t i = 0; i < lvl.order_count; i++) {
+         order_t o;
+         std::memcpy(&o, orders + i * sizeof(order_t), sizeof(order_t));
+         o.side = lvl.side;
+         o.price = lvl.price;
+         if (insert_order(o) == NULL_SLOT) {
+            throw std::runtime_error("Snapshot does not fit mapped book: " + path_);
+         }
+      }
+   });
+   hdr_->journal_sequence = header.last_sequence;
+   end_mutation();
+
+   return header.last_sequence;
+}
+
+/*
+   Replay fast path. Same mutations as the public API, so a replayed book
+   ends with the same queues as the one that wrote the journal.
+*/
+void mapped_orderbook::replay_add(const order_t& order) {
+   begin_mutation();
+   insert_order(order);
+   end_mutation();
+}
+
+void mapped_orderbook::replay_modify(const order_id_key& id, const order_t& new_order) {
+   uint32_t slot = index_find(id.order_id);
+   if (slot == NULL_SLOT) {
+      return;
+   }
+   begin_mutation();
+   requeue(slot, new_order);
+   end_mutation();
+}
+
+void mapped_orderbook::replay_cancel(const order_id_key& id) {
+   uint32_t slot = index_find(id.order_id);
+   if (slot == NULL_SLOT) {
+      return;
+   }
+   begin_mutation();
+   remove_order(slot);
+   end_mutation();
+}
+
+void mapped_orderbook::replay_fill(const order_id_key& id, size_t qty) {
+   uint32_t slot = index_find(id.order_id);
+   if (slot == NULL_SLOT) {
+      return;
+   }
+   begin_mutation();
+   mapped_order_node_t& n = node(slot);
+   if (n.order.qty > qty) {
+      n.order.qty -= qty;
+      level_for(static_cast<order_side>(n.order.side), n.price).total_qty -= qty;
+   } else {
+      remove_order(slot);
+   }
+   end_mutation();
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "orderbook.h"
+
+/*
+   File-backed order storage for mapped_orderbook.
+
+   Everything lives in one MAP_SHARED region: a header, the two price
+   ladders, a fixed order arena and an open-addressing order index. Links
+   are 1-based arena slot numbers (0 = null) rather than pointers, so the
+   file can be remapped at any address by a restarted process.
+*/
+
+constexpr char MAPPED_BOOK_MAGIC[8] = { 'O','B','M','M','A','P','0','1' };
+constexpr uint32_t MAPPED_BOOK_VERSION = 1;
+
+struct mapped_book_header_t {
+   char magic[8];
+   uint32_t version;
+   uint32_t max_price;
+
+   uint64_t capacity;          // arena slots
+   uint64_t index_slots;       // power of two
+   uint64_t bids_offset;
+   uint64_t asks_offset;
+   uint64_t arena_offset;
+   uint64_t index_offset;
+   uint64_t file_size;
+
+   /*
+      mutation_sequence is bumped before and committed_sequence after each
+      mutation; a mismatch on open means the writer died mid-update.
+   */
+   uint64_t mutation_sequence;
+   uint64_t committed_sequence;
+   uint64_t journal_sequence;  // last journal sequence this book logged
+
+   uint64_t order_count;
+   uint32_t best_bid;
+   uint32_t best_ask;
+   uint32_t free_head;
+   uint32_t next_unused;
+};
+
+struct mapped_level_t {
+   uint32_t head;
+   uint32_t tail;
+   uint64_t count;
+   uint64_t total_qty;
+};
+
+struct mapped_order_node_t {
+   order_t order;
+   uint32_t prev;
+   uint32_t next;
+   uint32_t price;
+   uint8_t in_use;
+   uint8_t reserved[7];
+};
+
+static_assert(sizeof(mapped_order_node_t) == 64, "mapped_order_node_t should be one cache line");
+
+enum class mapped_open_status : uint8_t {
+   CREATED=0,      // new file, empty book
+   RESUMED=1,      // existing file validated, state restored as-is
+};
+
+/*
+   Matching engine over mapped storage, with orderbook's add, modify,
+   cancel and execute and the same event logging, but its own queues:
+   orders at a level are kept in arrival order in an intrusive doubly
+   linked list, where orderbook's may reuse a departed order's slot. A
+   modify re-queues the order at the back of its new level, as
+   orderbook's erase and re-insert does.
+
+   Throws std::runtime_error when a file exists but fails validation
+   (bad magic/version/layout, or a torn mutation). Recover into a new
+   mapped_orderbook rather than an orderbook, so the queues come back the
+   same: remove the file, load_snapshot() the last image this book's
+   capture_snapshot() wrote, then apply the journal after it with
+   journal_replayer::replay_file_into().
+*/
+class mapped_orderbook final {
+public:
+   mapped_orderbook(const std::string& path, size_t capacity,
+                    logger* log_instance = nullptr, clock_source* clock = nullptr);
+   ~mapped_orderbook();
+
+   mapped_orderbook(const mapped_orderbook&) = delete;
+   mapped_orderbook& operator=(const mapped_orderbook&) = delete;
+
+   order_result add(const order_t& order);
+   order_result modify(const order_id_key& id, const order_t& new_order);
+   order_result cancel(const order_id_key& id);
+   void execute();
+
+   std::optional<uint32_t> best_bid() const;
+   std::optional<uint32_t> best_ask() const;
+   bool contains(const order_id_key& id) const;
+   size_t order_count() const;
+   size_t level_qty(order_side side, uint32_t price) const;
+
+   mapped_open_status open_status() const { return status_; }
+   uint64_t sequence() const { return hdr_->committed_sequence; }
+   uint64_t last_sequence() const { return hdr_->journal_sequence; }
+   size_t capacity() const { return hdr_->capacity; }
+
+   // msync the region; only needed for durability across power loss
+   void sync();
+
+   /*
+      Snapshots in the format of includes/snapshot.h, levels in queue
+      order. capture_snapshot() copies the whole book in one call;
+      load_snapshot() fills an empty book and returns the image's last
+      journal sequence. Throws std::runtime_error on a corrupt image or
+      one with more orders than the capacity.
+   */
+   void capture_snapshot(const char* ticker, std::vector<char>& out) const;
+   uint64_t load_snapshot(const char* data, size_t len);
+
+   // replay fast path: the public API's mutations without validation or logging
+   void replay_add(const order_t& order);
+   void replay_modify(const order_id_key& id, const order_t& new_order);
+   void replay_cancel(const order_id_key& id);
+   void replay_fill(const order_id_key& id, size_t qty);
+
+private:
+   std::string path_;
+   int fd_ = -1;
+   char* base_ = nullptr;
+   size_t size_ = 0;
+   mapped_open_status status_ = mapped_open_status::CREATED;
+
+   mapped_book_header_t* hdr_ = nullptr;
+   mapped_level_t* bids_ = nullptr;
+   mapped_level_t* asks_ = nullptr;
+   mapped_order_node_t* arena_ = nullptr;   // slot n lives at arena_[n - 1]
+   uint32_t* index_ = nullptr;
+
+   logger* log_ = nullptr;
+   clock_source* clock_ = nullptr;
+
+   static size_t layout(size_t capacity, mapped_book_header_t& hdr);
+   void bind_sections();
+   void validate(size_t capacity) const;
+
+   // the bump lands before the mutation's writes and the commit after them
+   void begin_mutation() {
+      std::atomic_ref<uint64_t>(hdr_->mutation_sequence).store(hdr_->mutation_sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+   }
+   void end_mutation() {
+      std::atomic_ref<uint64_t>(hdr_->committed_sequence).store(hdr_->mutation_sequence, std::memory_order_release);
+   }
+
+   mapped_order_node_t& node(uint32_t slot) { return arena_[ slot - 1 ]; }
+   const mapped_order_node_t& node(uint32_t slot) const { return arena_[ slot - 1 ]; }
+   mapped_level_t& level_for(order_side side, uint32_t price) {
+      return side == order_side::BUY ? bids_[ price ] : asks_[ price ];
+   }
+
+   uint32_t alloc_slot();
+   void free_slot(uint32_t slot);
+
+   uint32_t index_find(const char* order_id) const;
+   void index_insert(const char* order_id, uint32_t slot);
+   void index_erase(const char* order_id);
+
+   void link_tail(uint32_t slot);
+   void unlink(uint32_t slot);
+   void remove_order(uint32_t slot);
+   uint32_t insert_order(const order_t& order);
+   void requeue(uint32_t slot, const order_t& new_order);
+
+   void update_best_bid_on_cancel(uint32_t price);
+   void update_best_ask_on_cancel(uint32_t price);
+
+   void log_event(const log_event_t& event);
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../includes/spsc_ring.h"
+#include "../includes/types.h"
+
+/*
+   Incremental L2 market data: one delta per price level whose total qty
+   or order count changed, carrying the level's new state (an emptied
+   level has order_count 0).
+
+   The book marks levels as add, modify, cancel, reduce and execute touch
+   them and hands the marked levels to its l2_publisher at the end of the
+   call, or at the end of an l2 batch (orderbook::begin_l2_batch()), so a
+   level touched many times in one message or batch yields one delta.
+   Nothing is scanned: the marks are the work list.
+
+   Deltas go into an spsc_ring the caller owns, which may live in shared
+   memory. A full ring drops the delta; sequence numbers still advance,
+   so a consumer that sees a gap rebuilds from a snapshot. The last delta
+   of each flush has L2_END_OF_BATCH set: the book is consistent there.
+*/
+
+static constexpr uint8_t L2_END_OF_BATCH = 1;
+
+struct l2_delta_t {
+   uint64_t sequence;        // per publisher, from 1
+   uint64_t total_qty;
+   uint32_t price;
+   uint32_t order_count;
+   uint32_t instrument;      // as given to the publisher
+   uint8_t side;             // order_side
+   uint8_t flags;
+   uint16_t reserved;
+};
+static_assert(sizeof(l2_delta_t) == 32, "l2_delta_t is a fixed wire layout");
+
+static constexpr size_t L2_RING_SLOTS = 1 << 16;
+using l2_ring = spsc_ring<l2_delta_t, L2_RING_SLOTS>;
+
+struct l2_publisher_stats_t {
+   uint64_t deltas = 0;      // written to the ring
+   uint64_t batches = 0;
+   uint64_t dropped = 0;     // ring full
+};
+
+// Producer side; call from the book's matching thread only.
+class l2_publisher {
+public:
+   l2_publisher(l2_ring& ring, uint32_t instrument) : ring_(&ring), instrument_(instrument) {}
+
+   void publish(order_side side, uint32_t price, uint64_t total_qty, uint64_t order_count, bool end_of_batch) {
+      l2_delta_t d;
+      d.sequence = ++sequence_;
+      d.total_qty = total_qty;
+      d.price = price;
+      d.order_count = static_cast<uint32_t>(order_count);
+      d.instrument = instrument_;
+      d.side = static_cast<uint8_t>(side);
+      d.flags = end_of_batch ? L2_END_OF_BATCH : 0;
+      d.reserved = 0;
+      if (ring_->try_push(d)) {
+         stats_.deltas++;
+      } else {
+         stats_.dropped++;
+      }
+      if (end_of_batch) {
+         stats_.batches++;
+      }
+   }
+
+   uint64_t sequence() const { return sequence_; }
+   const l2_publisher_stats_t& stats() const { return stats_; }
+
+private:
+   l2_ring* ring_;
+   uint32_t instrument_;
+   uint64_t sequence_ = 0;
+   l2_publisher_stats_t stats_;
+};
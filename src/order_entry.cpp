@@ -0,0 +1,109 @@
+#include "order_entry.h"
+
+#include <cstring>
+#include <optional>
+
+void order_entry::enter(uint64_t session, uint64_t token, const order_t& order) {
+   orderbook& ob = book_for(order.ticker);
+   order_id_key key = order_key(session, token);
+
+   order_t o = order;
+   std::memcpy(o.order_id, key.order_id, ORDER_ID_LEN);
+   o.timestamp = ob.clock()->now();
+   o.status = static_cast<uint8_t>(order_status::NEW);
+
+   order_result r = ob.add(o);
+   if (r != order_result::SUCCESS) {
+      reports_.rejected(session, token, r);
+      return;
+   }
+   reports_.accepted(session, token, o.timestamp);
+   match(ob, key);
+}
+
+void order_entry::cancel(uint64_t session, uint64_t token, const char* ticker) {
+   order_result r = book_for(ticker).cancel(order_key(session, token));
+   if (r != order_result::SUCCESS) {
+      reports_.rejected(session, token, r);
+      return;
+   }
+   reports_.canceled(session, token);
+}
+
+void order_entry::replace(uint64_t session, uint64_t token, const char* ticker, size_t qty, uint32_t price) {
+   orderbook& ob = book_for(ticker);
+   order_id_key key = order_key(session, token);
+
+   std::optional<order_t> current = ob.find(key);
+   order_result r = order_result::ORDER_NOT_FOUND;
+   if (current) {
+      order_t o = *current;
+      o.qty = qty;
+      o.price = price;
+      o.timestamp = ob.clock()->now();
+      r = ob.modify(key, o);
+   }
+   if (r != order_result::SUCCESS) {
+      reports_.rejected(session, token, r);
+      return;
+   }
+   reports_.replaced(session, token, qty, price);
+   match(ob, key);
+}
+
+void order_entry::match(orderbook& ob, const order_id_key& aggressor) {
+   aggressor_id_ = aggressor.order_id;
+   ob.execute();
+   aggressor_id_ = nullptr;
+}
+
+void order_entry::on_fill(const order_t& bid, const order_t& ask, size_t qty) {
+   match_number_++;
+
+   // trades at the resting order's price
+   bool bid_aggressed = aggressor_id_ && std::memcmp(aggressor_id_, bid.order_id, ORDER_ID_LEN) == 0;
+   uint32_t price = bid_aggressed ? ask.price : bid.price;
+
+   for (const order_t* o : { &bid, &ask }) {
+      reports_.executed(session_of(o->order_id), token_of(o->order_id), o->timestamp, match_number_, qty, price);
+   }
+}
+
+orderbook& order_entry::book_for(const char* ticker) {
+   uint32_t key = ticker_key(ticker);
+   auto it = books_.find(key);
+   if (it == books_.end()) {
+      auto ob = std::make_unique<orderbook>(log_);
+      ob->set_fill_listener(this);
+      it = books_.emplace(key, std::move(ob)).first;
+   }
+   return *it->second;
+}
+
+orderbook* order_entry::book(const char* ticker) {
+   auto it = books_.find(ticker_key(ticker));
+   return it == books_.end() ? nullptr : it->second.get();
+}
+
+order_id_key order_entry::order_key(uint64_t session, uint64_t token) {
+   uint32_t low = static_cast<uint32_t>(session);
+   uint32_t high = static_cast<uint32_t>(session >> 32);
+   order_id_key key;
+   std::memcpy(key.order_id, &low, sizeof(low));
+   std::memcpy(key.order_id + 4, &token, sizeof(token));
+   std::memcpy(key.order_id + 12, &high, sizeof(high));
+   return key;
+}
+
+uint64_t order_entry::session_of(const char* order_id) {
+   uint32_t low, high;
+   std::memcpy(&low, order_id, sizeof(low));
+   std::memcpy(&high, order_id + 12, sizeof(high));
+   return static_cast<uint64_t>(high) << 32 | low;
+}
+
+uint64_t order_entry::token_of(const char* order_id) {
+   uint64_t token;
+   std::memcpy(&token, order_id + 4, sizeof(token));
+   return token;
+}
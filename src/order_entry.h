@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "orderbook.h"
+
+/*
+   Replies order_entry makes to its transport. session is the key the
+   transport passed in; the transport maps it back to a connection and
+   drops reports for one it no longer has.
+*/
+class order_entry_reports {
+public:
+   virtual ~order_entry_reports() = default;
+   virtual void accepted(uint64_t session, uint64_t token, uint64_t timestamp) = 0;
+   virtual void rejected(uint64_t session, uint64_t token, order_result reason) = 0;
+   virtual void canceled(uint64_t session, uint64_t token) = 0;
+   virtual void replaced(uint64_t session, uint64_t token, size_t qty, uint32_t price) = 0;
+
+   // once per side of a fill; timestamp is that side's order's
+   virtual void executed(uint64_t session, uint64_t token, uint64_t timestamp, uint64_t match_number,
+                         size_t qty, uint32_t price) = 0;
+};
+
+/*
+   Order entry shared by the transports (gateway, shm_engine): one
+   orderbook per ticker, created on first use, and the book calls behind
+   enter / cancel / replace.
+
+   Orders are keyed in the book by (session, token): the low 32 bits of
+   session, the token, then the high 32 bits, so tokens only need to be
+   unique per session and a transport can fold a generation into the
+   high half. Enter and replace are acknowledged before they match, so
+   the executions they cause follow the ACCEPTED / REPLACED. A fill
+   trades at the resting order's price. Single-threaded; call from the
+   thread that owns the books.
+*/
+class order_entry final : private fill_listener {
+public:
+   explicit order_entry(order_entry_reports& reports, logger* log = nullptr)
+      : reports_(reports), log_(log) {}
+
+   order_entry(const order_entry&) = delete;
+   order_entry& operator=(const order_entry&) = delete;
+
+   // order_id, timestamp and status are assigned here
+   void enter(uint64_t session, uint64_t token, const order_t& order);
+   void cancel(uint64_t session, uint64_t token, const char* ticker);
+   void replace(uint64_t session, uint64_t token, const char* ticker, size_t qty, uint32_t price);
+
+   orderbook* book(const char* ticker);
+   uint64_t fills() const { return match_number_; }
+
+   static order_id_key order_key(uint64_t session, uint64_t token);
+   static uint64_t session_of(const char* order_id);
+   static uint64_t token_of(const char* order_id);
+
+private:
+   order_entry_reports& reports_;
+   logger* log_;
+   uint64_t match_number_ = 0;
+
+   std::unordered_map<uint32_t, std::unique_ptr<orderbook>> books_;
+
+   // the order execute() is currently matching on behalf of
+   const char* aggressor_id_ = nullptr;
+
+   orderbook& book_for(const char* ticker);
+   void match(orderbook& ob, const order_id_key& aggressor);
+   void on_fill(const order_t& bid, const order_t& ask, size_t qty) override;
+};
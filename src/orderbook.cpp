@@ -1,32 +1,259 @@
 #include "orderbook.h"
+#include "l3_feed.h"
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <optional>
+#include <stdexcept>
 #include <sys/types.h>
-#include <chrono>
 
-static inline uint64_t get_current_time_ns() {
-   using namespace std::chrono;
-   return static_cast<uint64_t>(
-      duration_cast<nanoseconds>(
-         steady_clock::now().time_since_epoch()
-      ).count()
-   );
+bool orderbook::contains(const order_id_key& id) const {
+   return (state_->order_id_lookup.find(id) != state_->order_id_lookup.end());
 }
 
-bool orderbook::contains(const order_id_key& id) const {
-   return (order_id_lookup_.find(id) != order_id_lookup_.end());
+// republishes the touch if any of its prices, quantities or counts moved
+void orderbook::publish_top() {
+   top_of_book_t top;
+   if (!level_empty(order_side::BUY, best_bid_price_)) {
+      const price_level& level = level_at(state_->bid_slots[ best_bid_price_ ]);
+      top.bid_price = best_bid_price_;
+      top.bid_qty = level.total_qty;
+      top.bid_orders = static_cast<uint32_t>(level.orders.size());
+   }
+   if (best_ask_price_ <= MAX_PRICE && !level_empty(order_side::SELL, best_ask_price_)) {
+      const price_level& level = level_at(state_->ask_slots[ best_ask_price_ ]);
+      top.ask_price = best_ask_price_;
+      top.ask_qty = level.total_qty;
+      top.ask_orders = static_cast<uint32_t>(level.orders.size());
+   }
+
+   top_of_book_t& published = state_->published_top;
+   if (top.bid_price == published.bid_price && top.bid_qty == published.bid_qty &&
+       top.bid_orders == published.bid_orders && top.ask_price == published.ask_price &&
+       top.ask_qty == published.ask_qty && top.ask_orders == published.ask_orders) {
+      return;
+   }
+   top.sequence = published.sequence + 1;
+   top.journal_sequence = last_sequence_;
+   published = top;
+   top_->store(top);
+}
+
+void orderbook::set_l2_publisher(l2_publisher* publisher) {
+   if (l2_ && !state_->l2_marks.empty()) {
+      flush_l2();
+   }
+   l2_ = publisher;
+   if (l2_) {
+      // each level is marked at most once per flush, so this never grows on the matching path
+      state_->l2_marks.reserve(MAX_LEVELS);
+   }
+}
+
+void orderbook::end_l2_batch() {
+   if (l2_batch_depth_ && --l2_batch_depth_ == 0 && !state_->l2_marks.empty()) {
+      flush_l2();
+   }
+}
+
+inline void orderbook::publish_market_data() {
+   publish_top();
+   if (!state_->l2_marks.empty() && l2_batch_depth_ == 0) {
+      flush_l2();
+   }
 }
 
-void orderbook::log_event(const log_event_t& event)
+inline void orderbook::mark_l2(order_side side, uint32_t price, price_level& level) {
+   if (l2_ && !level.l2_dirty) {
+      level.l2_dirty = true;
+      state_->l2_marks.push_back({ price, side });
+   }
+}
+
+// one delta per marked level, read from the level as it is now
+void orderbook::flush_l2() {
+   std::vector<book_state::l2_mark_t>& marks = state_->l2_marks;
+   for (size_t i = 0; i < marks.size(); i++) {
+      const book_state::l2_mark_t& m = marks[ i ];
+      price_level& level = level_at((m.side == order_side::BUY ? state_->bid_slots : state_->ask_slots)[ m.price ]);
+      level.l2_dirty = false;
+      if (l2_) {
+         l2_->publish(m.side, m.price, level.total_qty, level.orders.size(), i + 1 == marks.size());
+      }
+   }
+   marks.clear();
+}
+
+// the order behind `it` in its level, i.e. the one it is queued in front of
+const order_t* orderbook::next_in_queue(order_side side, uint32_t price, order_hive::iterator it) {
+   const price_level& level = level_for(side, price);
+   ++it;
+   return it == level.orders.end() ? nullptr : &*it;
+}
+
+void orderbook::log_event(const log_event_t& event, const order_t* queued_before)
 {
    if (log_) {
-      log_->push(event);
+      last_sequence_ = log_->push(event);
+   }
+   if (l3_) {
+      l3_->on_event(event, queued_before);
+   }
+}
+
+/*
+   Public entry points. When built with ORDERBOOK_LATENCY_STATS and/or
+   ORDERBOOK_PERF_COUNTERS each call is bracketed by a probe; otherwise
+   they forward directly and the compiler folds them away.
+*/
+#ifdef ORDERBOOK_INSTRUMENTED
+void orderbook::probe_begin(probe_t& probe) {
+#ifdef ORDERBOOK_PERF_COUNTERS
+   perf_->counters().read(probe.counters);
+#endif
+   probe.ticks = tsc_clock::read_ticks();
+}
+
+void orderbook::probe_end(latency_op op, order_result result, const probe_t& probe) {
+   uint64_t ticks = tsc_clock::read_ticks() - probe.ticks;
+#ifdef ORDERBOOK_PERF_COUNTERS
+   perf_sample_t after;
+   perf_counter_group& group = perf_->counters();
+   group.read(after);
+   perf_->per_op[ static_cast<size_t>(op) ].add(probe.counters, after, group.read_overhead());
+#endif
+#ifdef ORDERBOOK_LATENCY_STATS
+   latency_->record(op, static_cast<uint8_t>(result), ticks);
+#else
+   (void)result;
+   (void)ticks;
+#endif
+}
+#endif
+
+#ifdef ORDERBOOK_ALLOC_CHECK
+namespace {
+   // reports allocations made during one core call of a reserved book
+   class alloc_check_scope {
+   public:
+      alloc_check_scope(bool armed, const char* op) : armed_(armed), op_(op) {}
+      ~alloc_check_scope() {
+         uint64_t n = armed_ ? allocations_.allocations() : 0;
+         if (n) {
+            alloc_tracker::on_violation.load(std::memory_order_relaxed)(op_, n);
+         }
+      }
+
+   private:
+      bool armed_;
+      const char* op_;
+      alloc_scope allocations_;
+   };
+}
+   #define ORDERBOOK_ALLOC_CHECK_SCOPE(op) alloc_check_scope alloc_check(alloc_check_, op)
+#else
+   #define ORDERBOOK_ALLOC_CHECK_SCOPE(op) ((void)0)
+#endif
+
+std::unique_ptr<orderbook> orderbook::create(int numa_node, logger* log_instance, clock_source* clock) {
+   if (numa_node < 0) {
+      numa_node = current_numa_node();
    }
+   book_memory::node_scope scope(numa_node);
+   std::unique_ptr<orderbook> book(new orderbook(log_instance, clock));
+   book->numa_node_ = numa_node;
+   return book;
+}
+
+order_result orderbook::add(const order_t& order) {
+   ORDERBOOK_ALLOC_CHECK_SCOPE("add");
+#ifdef ORDERBOOK_INSTRUMENTED
+   probe_t probe;
+   probe_begin(probe);
+   order_result r = add_impl(order);
+   publish_market_data();
+   probe_end(latency_op::ADD, r, probe);
+   return r;
+#else
+   order_result r = add_impl(order);
+   publish_market_data();
+   return r;
+#endif
+}
+
+order_result orderbook::modify(const order_id_key& id, const order_t& new_order) {
+   ORDERBOOK_ALLOC_CHECK_SCOPE("modify");
+#ifdef ORDERBOOK_INSTRUMENTED
+   probe_t probe;
+   probe_begin(probe);
+   order_result r = modify_impl(id, new_order);
+   publish_market_data();
+   probe_end(latency_op::MODIFY, r, probe);
+   return r;
+#else
+   order_result r = modify_impl(id, new_order);
+   publish_market_data();
+   return r;
+#endif
+}
+
+order_result orderbook::cancel(const order_id_key& id) {
+   ORDERBOOK_ALLOC_CHECK_SCOPE("cancel");
+#ifdef ORDERBOOK_INSTRUMENTED
+   probe_t probe;
+   probe_begin(probe);
+   order_result r = cancel_impl(id);
+   publish_market_data();
+   probe_end(latency_op::CANCEL, r, probe);
+   return r;
+#else
+   order_result r = cancel_impl(id);
+   publish_market_data();
+   return r;
+#endif
+}
+
+order_result orderbook::reduce(const order_id_key& id, size_t qty) {
+   ORDERBOOK_ALLOC_CHECK_SCOPE("reduce");
+#ifdef ORDERBOOK_INSTRUMENTED
+   probe_t probe;
+   probe_begin(probe);
+   order_result r = reduce_impl(id, qty);
+   publish_market_data();
+   probe_end(latency_op::REDUCE, r, probe);
+   return r;
+#else
+   order_result r = reduce_impl(id, qty);
+   publish_market_data();
+   return r;
+#endif
+}
+
+// EXECUTE is recorded as SUCCESS when anything filled, NO_MATCH otherwise
+void orderbook::execute() {
+   ORDERBOOK_ALLOC_CHECK_SCOPE("execute");
+#ifdef ORDERBOOK_INSTRUMENTED
+   probe_t probe;
+   probe_begin(probe);
+   size_t fills = execute_impl();
+   publish_market_data();
+   probe_end(latency_op::EXECUTE, fills ? order_result::SUCCESS : order_result::NO_MATCH, probe);
+#else
+   execute_impl();
+   publish_market_data();
+#endif
+}
+
+std::optional<order_t> orderbook::find(const order_id_key& id) const {
+   auto it = state_->order_id_lookup.find(id);
+   if (it == state_->order_id_lookup.end()) {
+      return std::nullopt;
+   }
+   return *(it->second.location_in_hive);
 }
 
 std::optional<uint32_t> orderbook::best_bid() const {
-   if (best_bid_price_ == 0 && bids_[0].orders.empty()) {
+   if (best_bid_price_ == 0 && level_empty(order_side::BUY, 0)) {
       return std::nullopt;
    } else {
       return std::optional<uint32_t>(best_bid_price_);
@@ -34,18 +261,18 @@ std::optional<uint32_t> orderbook::best_bid() const {
 }
 
 std::optional<uint32_t> orderbook::best_ask() const {
-   if (best_ask_price_ > MAX_PRICE || asks_[best_ask_price_].orders.empty()) {
+   if (best_ask_price_ > MAX_PRICE || level_empty(order_side::SELL, best_ask_price_)) {
       return std::nullopt;
    } else {
       return best_ask_price_;
    }
 }
 
-order_result orderbook::add(const order_t& order) {
+order_result orderbook::add_impl(const order_t& order) {
    order_id_key key;
    std::memcpy(key.order_id, order.order_id, ORDER_ID_LEN);
 
-   if (order_id_lookup_.contains(key)) {
+   if (state_->order_id_lookup.contains(key)) {
       return order_result::DUPLICATE_ID;
    }
    
@@ -53,27 +280,16 @@ order_result orderbook::add(const order_t& order) {
       return order_result::INVALID_SIDE;
    }
 
-   order_side side = static_cast<order_side>(order.side);
-
    if (order.price > MAX_PRICE) {
       return order_result::INVALID_PRICE;
    }
 
-   price_level& level = (side == order_side::BUY ? bids_[order.price] : asks_[order.price]);
-
-   auto it = level.orders.insert(order);
-   level.total_qty += order.qty;
-
+   // hive blocks and index growth come from this book's node
+   book_memory::node_scope numa(numa_node_);
    order_location loc;
    loc.price = order.price;
-   loc.location_in_hive = it;
-   order_id_lookup_[key] = loc;
-
-   if (side == order_side::BUY) {
-      update_best_bid_on_insert(order.price);
-   } else {
-      update_best_ask_on_insert(order.price);
-   }
+   loc.location_in_hive = insert_resting(order);
+   state_->order_id_lookup[key] = loc;
 
    log_event_t event {
       order.timestamp,
@@ -81,21 +297,22 @@ order_result orderbook::add(const order_t& order) {
       log_event_kind::ADD,
       order.price,
       order.qty,
-      static_cast<order_side>(order.side)
+      static_cast<order_side>(order.side),
+      order.ticker
    };
-   log_event(event);
+   log_event(event, l3_ ? next_in_queue(static_cast<order_side>(order.side), order.price, loc.location_in_hive)
+                        : nullptr);
 
    return order_result::SUCCESS;
 }
 
-order_result orderbook::modify(const order_id_key& id, const order_t& new_order) {
-   auto it_lookup = order_id_lookup_.find(id);
-   if (it_lookup == order_id_lookup_.end()) {
+order_result orderbook::modify_impl(const order_id_key& id, const order_t& new_order) {
+   auto it_lookup = state_->order_id_lookup.find(id);
+   if (it_lookup == state_->order_id_lookup.end()) {
       return order_result::ORDER_NOT_FOUND;
    }
 
    order_location& loc = it_lookup->second;
-   const order_t& old_order = *(loc.location_in_hive);
 
    if (new_order.price > MAX_PRICE) {
       return order_result::INVALID_PRICE;
@@ -105,50 +322,10 @@ order_result orderbook::modify(const order_id_key& id, const order_t& new_order)
       return order_result::INVALID_SIDE;
    }
 
-   if ((old_order.price != new_order.price) || (old_order.side != new_order.side)) {
-      price_level& old_level =
-         (static_cast<order_side>(old_order.side) == order_side::BUY
-            ? bids_[old_order.price]
-            : asks_[old_order.price]);
-      old_level.total_qty -= old_order.qty;
-      old_level.orders.erase(loc.location_in_hive);
-
-      if (old_level.orders.empty()) {
-         old_level.total_qty = 0;
-         if (old_order.side == static_cast<uint8_t>(order_side::BUY)) {
-            update_best_bid_on_cancel(old_order.price);
-         } else {
-            update_best_ask_on_cancel(old_order.price);
-         }
-      }
-
-      price_level& new_level =
-         (new_side == order_side::BUY ? bids_[new_order.price] : asks_[new_order.price]);
-      plf::hive<order_t>::iterator new_it = new_level.orders.insert(new_order);
-      new_level.total_qty += new_order.qty;
-
-      if (new_side == order_side::BUY) {
-         update_best_bid_on_insert(new_order.price);
-      } else {
-         update_best_ask_on_insert(new_order.price);
-      }
-
-      loc.price = new_order.price;
-      loc.location_in_hive = new_it;
-   } else {
-      price_level& level =
-         (static_cast<order_side>(old_order.side) == order_side::BUY
-            ? bids_[old_order.price]
-            : asks_[old_order.price]);
-
-      level.total_qty -= old_order.qty;
-      level.orders.erase(loc.location_in_hive);
-
-      auto new_it = level.orders.insert(new_order);
-      level.total_qty += new_order.qty;
-
-      loc.location_in_hive = new_it;
-   }
+   // copy: the hive slot is freed (and may be reused) by modify_resting()
+   const order_t old_order = *(loc.location_in_hive);
+   book_memory::node_scope numa(numa_node_);
+   modify_resting(loc, old_order, new_order);
 
    log_event_t event;
    event.timestamp = new_order.timestamp;
@@ -157,45 +334,34 @@ order_result orderbook::modify(const order_id_key& id, const order_t& new_order)
    event.price   = new_order.price;
    event.qty     = new_order.qty;
    event.side    = static_cast<order_side>(new_order.side);
+   std::memcpy(event.ticker, new_order.ticker, TICKER_LEN);
 
    std::memcpy(event.order_id_secondary, old_order.order_id, ORDER_ID_LEN);
    event.price_secondary = old_order.price;
    event.qty_secondary   = old_order.qty;
    event.side_secondary  = static_cast<order_side>(old_order.side);
 
-   log_event(event);
+   log_event(event, l3_ ? next_in_queue(new_side, new_order.price, loc.location_in_hive) : nullptr);
 
    return order_result::SUCCESS;
 }
 
-order_result orderbook::cancel(const order_id_key& id) {
-   auto it_lookup = order_id_lookup_.find(id);
-   if (it_lookup == order_id_lookup_.end()) {
+order_result orderbook::cancel_impl(const order_id_key& id) {
+   auto it_lookup = state_->order_id_lookup.find(id);
+   if (it_lookup == state_->order_id_lookup.end()) {
       return order_result::ORDER_NOT_FOUND;
    }
 
    order_location& loc = it_lookup->second;
-   const order_t& stored_order = *(loc.location_in_hive);
-   order_side side = static_cast<order_side>(stored_order.side);
 
    if (loc.price > MAX_PRICE) {
       return order_result::INVALID_PRICE;
    }
 
-   price_level& level = (side == order_side::BUY ? bids_[loc.price] : asks_[loc.price]);
-   level.total_qty -= stored_order.qty;
-   level.orders.erase(loc.location_in_hive);
-
-   if (level.orders.empty()) {
-      level.total_qty = 0;
-      if (side == order_side::BUY) {
-         update_best_bid_on_cancel(loc.price);
-      } else {
-         update_best_ask_on_cancel(loc.price);
-      }
-   }
-
-   order_id_lookup_.erase(it_lookup);
+   // copy: erase_resting() frees the hive slot
+   const order_t stored_order = *(loc.location_in_hive);
+   erase_resting(loc);
+   state_->order_id_lookup.erase(it_lookup);
 
    log_event_t event {
       stored_order.timestamp,
@@ -203,25 +369,71 @@ order_result orderbook::cancel(const order_id_key& id) {
       log_event_kind::CANCEL,
       stored_order.price,
       stored_order.qty,
-      static_cast<order_side>(stored_order.side)
+      static_cast<order_side>(stored_order.side),
+      stored_order.ticker
    };
    log_event(event);
 
    return order_result::SUCCESS;
 }
 
-void orderbook::execute() {
+order_result orderbook::reduce_impl(const order_id_key& id, size_t qty) {
+   auto it_lookup = state_->order_id_lookup.find(id);
+   if (it_lookup == state_->order_id_lookup.end()) {
+      return order_result::ORDER_NOT_FOUND;
+   }
+   order_location& loc = it_lookup->second;
+   order_t& resting = *(loc.location_in_hive);
+
+   if (qty >= resting.qty) {
+      return cancel_impl(id);
+   }
+
+   log_event_t event;
+   event.timestamp = resting.timestamp;
+   std::memcpy(event.order_id, resting.order_id, ORDER_ID_LEN);
+   event.kind    = log_event_kind::MODIFY;
+   event.price   = resting.price;
+   event.qty     = resting.qty - qty;
+   event.side    = static_cast<order_side>(resting.side);
+   std::memcpy(event.ticker, resting.ticker, TICKER_LEN);
+
+   std::memcpy(event.order_id_secondary, resting.order_id, ORDER_ID_LEN);
+   event.price_secondary = resting.price;
+   event.qty_secondary   = resting.qty;
+   event.side_secondary  = static_cast<order_side>(resting.side);
+
+   before_level_change(static_cast<order_side>(resting.side), loc.price);
+   resting.qty -= qty;
+   price_level& level = level_for(static_cast<order_side>(resting.side), loc.price);
+   level.total_qty -= qty;
+   mark_l2(static_cast<order_side>(resting.side), loc.price, level);
+
+   log_event(event, l3_ ? next_in_queue(static_cast<order_side>(resting.side), loc.price, loc.location_in_hive)
+                        : nullptr);
+   return order_result::SUCCESS;
+}
+
+// returns the number of fills
+size_t orderbook::execute_impl() {
+   // raw clock ticks; the logger converts to ns when it writes the record
+   size_t fills = 0;
+   uint64_t execute_timestamp = 0;
+   bool have_timestamp = false;
+
    while (best_bid_price_ >= best_ask_price_) {
-      if (bids_[best_bid_price_].orders.empty() ||
-          asks_[best_ask_price_].orders.empty()) {
+      if (level_empty(order_side::BUY, best_bid_price_) ||
+          level_empty(order_side::SELL, best_ask_price_)) {
          break;
       }
 
-      price_level& bid_level = bids_[best_bid_price_];
-      price_level& ask_level = asks_[best_ask_price_];
+      before_level_change(order_side::BUY, best_bid_price_);
+      before_level_change(order_side::SELL, best_ask_price_);
+      price_level& bid_level = level_at(state_->bid_slots[best_bid_price_]);
+      price_level& ask_level = level_at(state_->ask_slots[best_ask_price_]);
 
-      plf::hive<order_t>::iterator bid_it = bid_level.orders.begin();
-      plf::hive<order_t>::iterator ask_it = ask_level.orders.begin();
+      order_hive::iterator bid_it = bid_level.orders.begin();
+      order_hive::iterator ask_it = ask_level.orders.begin();
 
       if (bid_it == bid_level.orders.end() || ask_it == ask_level.orders.end()) {
          break;
@@ -238,14 +450,21 @@ void orderbook::execute() {
       ask_order.qty -= match_qty;
       bid_level.total_qty -= match_qty;
       ask_level.total_qty -= match_qty;
+      mark_l2(order_side::BUY, best_bid_price_, bid_level);
+      mark_l2(order_side::SELL, best_ask_price_, ask_level);
 
-      uint64_t match_timestamp = get_current_time_ns();
+      if (!have_timestamp || match_ts_mode_ == match_timestamp::PER_FILL) {
+         execute_timestamp = clock_->now();
+         have_timestamp = true;
+      }
 
       log_event_t match_event;
-      match_event.timestamp = match_timestamp;
+      match_event.timestamp = execute_timestamp;
+      match_event.ts_clock = clock_;
       match_event.kind = log_event_kind::MATCH;
 
       std::memcpy(match_event.order_id, bid_order.order_id, ORDER_ID_LEN);
+      std::memcpy(match_event.ticker, bid_order.ticker, TICKER_LEN);
       match_event.price = best_bid_price_;
       match_event.qty = match_qty;
       match_event.side = order_side::BUY;
@@ -256,13 +475,18 @@ void orderbook::execute() {
       match_event.side_secondary = order_side::SELL;
 
       log_event(match_event);
+      fills++;
+
+      if (fill_listener_) {
+         fill_listener_->on_fill(bid_order, ask_order, match_qty);
+      }
 
       if (bid_order.qty == 0) {
          order_id_key bid_key;
          std::memcpy(bid_key.order_id, bid_order.order_id, ORDER_ID_LEN);
 
          bid_level.orders.erase(bid_it);
-         order_id_lookup_.erase(bid_key);
+         state_->order_id_lookup.erase(bid_key);
       }
 
       if (ask_order.qty == 0) {
@@ -270,7 +494,7 @@ void orderbook::execute() {
          std::memcpy(ask_key.order_id, ask_order.order_id, ORDER_ID_LEN);
 
          ask_level.orders.erase(ask_it);
-         order_id_lookup_.erase(ask_key);
+         state_->order_id_lookup.erase(ask_key);
       }
 
       if (bid_level.orders.empty()) {
@@ -282,6 +506,444 @@ void orderbook::execute() {
          update_best_ask_on_cancel(best_ask_price_);
       }
    }
+   return fills;
+}
+
+void orderbook::capture_snapshot(const char* ticker, std::vector<char>& out) {
+   begin_snapshot(ticker, out);
+   snapshot_step(SIZE_MAX);
+}
+
+void orderbook::begin_snapshot(const char* ticker, std::vector<char>& out) {
+   book_state::capture_t& c = state_->capture;
+   if (c.out) {
+      throw std::logic_error("begin_snapshot() while a capture is in progress");
+   }
+   c.orders = state_->order_id_lookup.size();
+   // upper bound: at most one level header per order. Only grown, so a
+   // reused buffer is not cleared again
+   size_t bound = sizeof(snapshot_header_t) + c.orders * (sizeof(snapshot_level_t) + sizeof(order_t));
+   if (out.size() < bound) {
+      out.resize(bound);
+   }
+   c.out = &out;
+   c.used = sizeof(snapshot_header_t);
+   c.sequence = last_sequence_;
+   c.levels = 0;
+   c.epoch++;
+   c.bid_prices = best_bid().has_value() ? best_bid_price_ + 1 : 0;
+   c.next_ask = best_ask().has_value() ? best_ask_price_ : MAX_PRICE + 1;
+   std::memcpy(c.ticker, ticker, TICKER_LEN);
+}
+
+bool orderbook::snapshot_step(size_t budget) {
+   book_state::capture_t& c = state_->capture;
+   if (!c.out) {
+      return true;
+   }
+
+   // a level already copied (it changed since the capture began) is skipped; one that
+   // was not is still as it stood then
+   size_t work = 0;
+   while (work < budget && c.bid_prices > 0) {
+      uint32_t p = --c.bid_prices;
+      work++;
+      level_slot slot = state_->bid_slots[p];
+      if (slot != 0 && level_at(slot).snapshot_epoch != c.epoch) {
+         price_level& level = level_at(slot);
+         work += level.orders.size();
+         capture_level(order_side::BUY, p, level);
+      }
+   }
+   while (work < budget && c.next_ask <= MAX_PRICE) {
+      uint32_t p = c.next_ask++;
+      work++;
+      level_slot slot = state_->ask_slots[p];
+      if (slot != 0 && level_at(slot).snapshot_epoch != c.epoch) {
+         price_level& level = level_at(slot);
+         work += level.orders.size();
+         capture_level(order_side::SELL, p, level);
+      }
+   }
+   if (c.bid_prices > 0 || c.next_ask <= MAX_PRICE) {
+      return false;
+   }
+
+   snapshot_header_t header {};
+   std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+   header.version = SNAPSHOT_VERSION;
+   std::memcpy(header.ticker, c.ticker, TICKER_LEN);
+   header.last_sequence = c.sequence;
+   header.order_count = c.orders;
+   header.level_count = c.levels;
+   header.order_size = sizeof(order_t);
+   std::memcpy(c.out->data(), &header, sizeof(header));
+
+   c.out->resize(c.used);
+   c.out = nullptr;
+   return true;
+}
+
+// copies a level into the capture in progress as it stands, once; an empty one adds no record
+void orderbook::capture_level(order_side side, uint32_t price, price_level& level) {
+   book_state::capture_t& c = state_->capture;
+   level.snapshot_epoch = c.epoch;
+   if (level.orders.empty()) {
+      return;
+   }
+
+   char* cursor = c.out->data() + c.used;
+   snapshot_level_t hdr {};
+   hdr.side = static_cast<uint8_t>(side);
+   hdr.price = price;
+   hdr.order_count = level.orders.size();
+   hdr.total_qty = level.total_qty;
+   std::memcpy(cursor, &hdr, sizeof(hdr));
+   cursor += sizeof(hdr);
+
+   for (const order_t& o : level.orders) {
+      std::memcpy(cursor, &o, sizeof(order_t));
+      cursor += sizeof(order_t);
+   }
+   c.used = static_cast<size_t>(cursor - c.out->data());
+   c.levels++;
+}
+
+uint64_t orderbook::load_snapshot(const char* data, size_t len) {
+   if (!state_->order_id_lookup.empty()) {
+      throw std::logic_error("load_snapshot() requires an empty book");
+   }
+
+   snapshot_header_t header = read_snapshot_header(data, len);
+
+   book_memory::node_scope numa(numa_node_);
+   state_->order_id_lookup.reserve(header.order_count);
+
+   read_snapshot_levels(data, len, header, MAX_PRICE, [&](const snapshot_level_t& lvl, const char* orders) {
+      order_side side = static_cast<order_side>(lvl.side);
+      price_level& level = level_for(side, lvl.price);
+      level.orders.reserve(lvl.order_count);
+
+      for (uint64_t i = 0; i < lvl.order_count; i++) {
+         order_t o;
+         std::memcpy(&o, orders + i * sizeof(order_t), sizeof(order_t));
+
+         order_id_key key;
+         std::memcpy(key.order_id, o.order_id, ORDER_ID_LEN);
+
+         order_location loc;
+         loc.price = lvl.price;
+         loc.location_in_hive = level.orders.insert(o);
+         state_->order_id_lookup[key] = loc;
+      }
+      level.total_qty = lvl.total_qty;
+
+      if (side == order_side::BUY) {
+         update_best_bid_on_insert(lvl.price);
+      } else {
+         update_best_ask_on_insert(lvl.price);
+      }
+   });
+
+   last_sequence_ = header.last_sequence;
+   publish_market_data();
+   return last_sequence_;
+}
+
+/*
+   Replay fast path. Same book mutations as the public API, in the same
+   order, so a replayed book ends with identical level contents and queue
+   positions; validation and logging are skipped.
+*/
+void orderbook::replay_add(const order_t& order) {
+   order_id_key key;
+   std::memcpy(key.order_id, order.order_id, ORDER_ID_LEN);
+
+   book_memory::node_scope numa(numa_node_);
+   order_location loc;
+   loc.price = order.price;
+   loc.location_in_hive = insert_resting(order);
+   state_->order_id_lookup[key] = loc;
+   publish_market_data();
+}
+
+void orderbook::replay_modify(const order_id_key& id, const order_t& new_order) {
+   auto it_lookup = state_->order_id_lookup.find(id);
+   if (it_lookup == state_->order_id_lookup.end()) {
+      return;
+   }
+   const order_t old_order = *(it_lookup->second.location_in_hive);
+   book_memory::node_scope numa(numa_node_);
+   modify_resting(it_lookup->second, old_order, new_order);
+   publish_market_data();
+}
+
+void orderbook::replay_cancel(const order_id_key& id) {
+   auto it_lookup = state_->order_id_lookup.find(id);
+   if (it_lookup == state_->order_id_lookup.end()) {
+      return;
+   }
+   erase_resting(it_lookup->second);
+   state_->order_id_lookup.erase(it_lookup);
+   publish_market_data();
+}
+
+void orderbook::replay_fill(const order_id_key& id, size_t qty) {
+   auto it_lookup = state_->order_id_lookup.find(id);
+   if (it_lookup == state_->order_id_lookup.end()) {
+      return;
+   }
+   order_location& loc = it_lookup->second;
+   order_t& resting = *(loc.location_in_hive);
+
+   if (resting.qty > qty) {
+      before_level_change(static_cast<order_side>(resting.side), loc.price);
+      resting.qty -= qty;
+      price_level& level = level_for(static_cast<order_side>(resting.side), loc.price);
+      level.total_qty -= qty;
+      mark_l2(static_cast<order_side>(resting.side), loc.price, level);
+   } else {
+      erase_resting(loc);
+      state_->order_id_lookup.erase(it_lookup);
+   }
+   publish_market_data();
+}
+
+void orderbook::reserve(const book_capacity_t& capacity) {
+   book_memory::node_scope numa(numa_node_);
+   state_->order_id_lookup.reserve(capacity.orders);
+   if (capacity.orders_per_level) {
+      uint32_t hi = std::min(capacity.max_price, MAX_PRICE);
+      for (uint32_t price = capacity.min_price; price <= hi; price++) {
+         level_for(order_side::BUY, price).orders.reserve(capacity.orders_per_level);
+         level_for(order_side::SELL, price).orders.reserve(capacity.orders_per_level);
+      }
+   }
+   alloc_check_ = true;
+}
+
+void orderbook::warmup(const warmup_options_t& options) {
+   if (!state_->order_id_lookup.empty()) {
+      throw std::logic_error("warmup() requires an empty book");
+   }
+   book_memory::node_scope numa(numa_node_);
+
+   // at least three prices wide, and never past the ladders
+   uint32_t lo = std::min(options.min_price, MAX_PRICE);
+   uint32_t hi = std::min(std::max(lo + 2, std::min(options.max_price, MAX_PRICE)), MAX_PRICE);
+   lo = std::min(lo, hi - 2);
+   uint32_t mid = lo + (hi - lo) / 2;
+   {
+      std::unique_ptr<orderbook> scratch(new orderbook(nullptr, clock_));
+      scratch->numa_node_ = numa_node_;
+      scratch->match_ts_mode_ = match_ts_mode_;
+
+      // same mix as a busy session: mostly resting adds, some cancels and
+      // modifies, and a crossing order with execute() every tenth call
+      uint64_t rng = 0x9E3779B97F4A7C15ULL;
+      uint64_t next_id = 0;
+      std::vector<order_id_key> live;
+      live.reserve(1024);
+      auto make = [&](order_side side, uint32_t price, size_t qty) {
+         order_id_key key;
+         std::memset(key.order_id, 0, ORDER_ID_LEN);
+         std::memcpy(key.order_id, "WARMUP", 6);
+         uint64_t id = ++next_id;
+         std::memcpy(key.order_id + 8, &id, sizeof(id));
+         return order_t(0, key.order_id, "WARM", order_kind::LMT, side, order_status::NEW, price, qty, false);
+      };
+      for (size_t i = 0; i < options.operations; i++) {
+         rng ^= rng >> 12;
+         rng ^= rng << 25;
+         rng ^= rng >> 27;
+         uint64_t r = rng * 0x2545F4914F6CDD1DULL;
+         order_side side = (r & 1) ? order_side::BUY : order_side::SELL;
+         uint32_t spread = static_cast<uint32_t>((r >> 8) % (mid - lo));
+         uint32_t price = side == order_side::BUY ? mid - 1 - spread : mid + 1 + spread;
+         switch ((r >> 32) % 10) {
+            case 6:
+            case 7:
+               if (!live.empty()) {
+                  size_t victim = static_cast<size_t>((r >> 40) % live.size());
+                  scratch->cancel(live[ victim ]);
+                  live[ victim ] = live.back();
+                  live.pop_back();
+                  break;
+               }
+               [[fallthrough]];
+            case 8:
+               if (!live.empty()) {
+                  const order_id_key& key = live[ static_cast<size_t>((r >> 40) % live.size()) ];
+                  if (std::optional<order_t> o = scratch->find(key)) {
+                     o->qty = 1 + (r >> 48) % 20;
+                     scratch->modify(key, *o);
+                  }
+                  break;
+               }
+               [[fallthrough]];
+            case 9: {
+               order_t o = make(side, side == order_side::BUY ? hi : lo, 5);
+               scratch->add(o);
+               scratch->execute();
+               order_id_key key;
+               std::memcpy(key.order_id, o.order_id, ORDER_ID_LEN);
+               scratch->cancel(key);   // whatever did not fill
+               break;
+            }
+            default: {
+               order_t o = make(side, price, 1 + (r >> 48) % 20);
+               if (scratch->add(o) == order_result::SUCCESS && live.size() < 1024) {
+                  order_id_key key;
+                  std::memcpy(key.order_id, o.order_id, ORDER_ID_LEN);
+                  live.push_back(key);
+               }
+               break;
+            }
+         }
+      }
+   }
+
+   // build the band's levels now so the first orders there don't carve chunks
+   for (uint32_t price = lo; price <= hi; price++) {
+      level_for(order_side::BUY, price);
+      level_for(order_side::SELL, price);
+   }
+
+   // fault in both slot ladders; a slot is written by the first order at its price
+   for (size_t price = 0; price <= MAX_PRICE; price++) {
+      volatile level_slot& bid = state_->bid_slots[ price ];
+      volatile level_slot& ask = state_->ask_slots[ price ];
+      bid = bid;
+      ask = ask;
+   }
+
+   // a reserved table is allocated but its slots are not faulted in; fill and clear it once
+   size_t expected = std::max(options.expected_orders, options.capacity.orders);
+   state_->order_id_lookup.reserve(expected);
+   order_location nowhere {};
+   for (uint64_t i = 0; i < expected; i++) {
+      order_id_key key;
+      std::memset(key.order_id, 0, ORDER_ID_LEN);
+      std::memcpy(key.order_id, &i, sizeof(i));
+      state_->order_id_lookup.emplace(key, nowhere);
+   }
+   state_->order_id_lookup.clear();
+
+   if (options.capacity.orders) {
+      reserve(options.capacity);
+   }
+}
+
+size_t orderbook::order_count() const {
+   return state_->order_id_lookup.size();
+}
+
+size_t orderbook::level_qty(order_side side, uint32_t price) const {
+   if (price > MAX_PRICE) {
+      return 0;
+   }
+   level_slot slot = (side == order_side::BUY ? state_->bid_slots : state_->ask_slots)[price];
+   return slot ? level_at(slot).total_qty : 0;
+}
+
+inline price_level& orderbook::level_at(level_slot slot) {
+   uint32_t index = slot - 1u;
+   return state_->level_chunks[index / LEVEL_CHUNK]->levels[index % LEVEL_CHUNK];
+}
+
+inline const price_level& orderbook::level_at(level_slot slot) const {
+   uint32_t index = slot - 1u;
+   return state_->level_chunks[index / LEVEL_CHUNK]->levels[index % LEVEL_CHUNK];
+}
+
+inline bool orderbook::level_empty(order_side side, uint32_t price) const {
+   level_slot slot = (side == order_side::BUY ? state_->bid_slots : state_->ask_slots)[price];
+   return slot == 0 || level_at(slot).orders.empty();
+}
+
+// the caller's node_scope decides where a new chunk lands
+level_slot orderbook::materialise_level() {
+   uint32_t index = state_->level_count++;
+   std::unique_ptr<level_chunk>& chunk = state_->level_chunks[index / LEVEL_CHUNK];
+   if (!chunk) {
+      chunk.reset(new level_chunk());
+   }
+   // a level built during a capture was empty when it began
+   chunk->levels[index % LEVEL_CHUNK].snapshot_epoch = state_->capture.epoch;
+   return static_cast<level_slot>(index + 1);
+}
+
+// called before a level's orders or qty change, so a capture in progress keeps the old level
+inline void orderbook::before_level_change(order_side side, uint32_t price) {
+   if (state_->capture.out) [[unlikely]] {
+      level_slot slot = (side == order_side::BUY ? state_->bid_slots : state_->ask_slots)[price];
+      if (slot != 0 && level_at(slot).snapshot_epoch != state_->capture.epoch) {
+         capture_level(side, price, level_at(slot));
+      }
+   }
+}
+
+inline price_level& orderbook::level_for(order_side side, uint32_t price) {
+   level_slot& slot = (side == order_side::BUY ? state_->bid_slots : state_->ask_slots)[price];
+   if (slot == 0) [[unlikely]] {
+      slot = materialise_level();
+   }
+   return level_at(slot);
+}
+
+order_hive::iterator orderbook::insert_resting(const order_t& order) {
+   order_side side = static_cast<order_side>(order.side);
+   before_level_change(side, order.price);
+   price_level& level = level_for(side, order.price);
+
+   auto it = level.orders.insert(order);
+   level.total_qty += order.qty;
+   mark_l2(side, order.price, level);
+
+   if (side == order_side::BUY) {
+      update_best_bid_on_insert(order.price);
+   } else {
+      update_best_ask_on_insert(order.price);
+   }
+   return it;
+}
+
+void orderbook::erase_resting(const order_location& loc) {
+   order_side side = static_cast<order_side>(loc.location_in_hive->side);
+   before_level_change(side, loc.price);
+   price_level& level = level_for(side, loc.price);
+
+   level.total_qty -= loc.location_in_hive->qty;
+   level.orders.erase(loc.location_in_hive);
+   mark_l2(side, loc.price, level);
+
+   if (level.orders.empty()) {
+      level.total_qty = 0;
+      if (side == order_side::BUY) {
+         update_best_bid_on_cancel(loc.price);
+      } else {
+         update_best_ask_on_cancel(loc.price);
+      }
+   }
+}
+
+void orderbook::modify_resting(order_location& loc, const order_t& old_order, const order_t& new_order) {
+   if ((old_order.price != new_order.price) || (old_order.side != new_order.side)) {
+      erase_resting(loc);
+      loc.location_in_hive = insert_resting(new_order);
+      loc.price = new_order.price;
+   } else {
+      // same level: no touch update needed, the level never stays empty
+      before_level_change(static_cast<order_side>(old_order.side), old_order.price);
+      price_level& level = level_for(static_cast<order_side>(old_order.side), old_order.price);
+
+      level.total_qty -= old_order.qty;
+      level.orders.erase(loc.location_in_hive);
+
+      loc.location_in_hive = level.orders.insert(new_order);
+      level.total_qty += new_order.qty;
+      mark_l2(static_cast<order_side>(old_order.side), old_order.price, level);
+   }
 }
 
 inline void orderbook::update_best_bid_on_insert(uint32_t price) {
@@ -298,10 +960,10 @@ inline void orderbook::update_best_ask_on_insert(uint32_t price) {
 
 inline void orderbook::update_best_bid_on_cancel(uint32_t price) {
    if (price == best_bid_price_) {
-      while (best_bid_price_ > 0 && bids_[best_bid_price_].orders.empty()) {
+      while (best_bid_price_ > 0 && level_empty(order_side::BUY, best_bid_price_)) {
          best_bid_price_--;
       }
-      if (bids_[best_bid_price_].orders.empty()) {
+      if (level_empty(order_side::BUY, best_bid_price_)) {
          best_bid_price_ = 0;
       }
    }
@@ -310,7 +972,7 @@ inline void orderbook::update_best_bid_on_cancel(uint32_t price) {
 inline void orderbook::update_best_ask_on_cancel(uint32_t price) {
    if (price == best_ask_price_) {
       while (best_ask_price_ <= MAX_PRICE &&
-             asks_[best_ask_price_].orders.empty()) {
+             level_empty(order_side::SELL, best_ask_price_)) {
          best_ask_price_++;
       }
       if (best_ask_price_ > MAX_PRICE) {
@@ -9,10 +9,26 @@
 #include <array>
 #include <optional>
 #include <atomic>
+#include <memory>
+#include <vector>
 
+#include "../includes/alloc_tracker.h"
+#include "../includes/book_memory.h"
+#include "../includes/clock.h"
 #include "../includes/logger.h"
 #include "../includes/plf_hive.h"
 #include "../includes/robin_hood.h"
+#include "../includes/seqlock.h"
+#include "../includes/snapshot.h"
+#include "latency_stats.h"
+#include "market_data.h"
+#include "perf_stats.h"
+
+#if defined(ORDERBOOK_LATENCY_STATS) || defined(ORDERBOOK_PERF_COUNTERS)
+   #define ORDERBOOK_INSTRUMENTED
+#endif
+
+class l3_feed;
 
 static constexpr uint32_t MAX_PRICE = 20000;
 
@@ -22,50 +38,229 @@ enum class order_result : uint8_t {
    ORDER_NOT_FOUND=20,
    INVALID_SIDE=30,
    INVALID_PRICE=40,
-   NO_MATCH=50
+   NO_MATCH=50,
+   BOOK_FULL=60
+};
+
+// how often execute() reads the clock for MATCH timestamps
+enum class match_timestamp : uint8_t {
+   PER_FILL=0,
+   PER_EXECUTE=1
+};
+
+/*
+   Told about every fill execute() makes, after the quantities are
+   decremented and before filled orders leave the book. Runs on the
+   matching thread inside execute(); keep it cheap.
+*/
+class fill_listener {
+public:
+   virtual ~fill_listener() = default;
+   virtual void on_fill(const order_t& bid, const order_t& ask, size_t qty) = 0;
+};
+
+/*
+   What orderbook::reserve() pre-sizes. Within it, add, modify, cancel,
+   reduce and execute never allocate: the id index holds `orders` without
+   rehashing and every level in [min_price, max_price] on both sides has
+   room for orders_per_level resting orders in a single hive block (at
+   most 8192; an emptied single-block hive keeps its block).
+*/
+struct book_capacity_t {
+   size_t orders = 0;
+   uint32_t min_price = 0;
+   uint32_t max_price = 0;
+   size_t orders_per_level = 0;
+};
+
+/*
+   What orderbook::warmup() does before a book sees real flow: pushes
+   `operations` synthetic adds, modifies, cancels and crossing executes
+   through a scratch book in [min_price, max_price], then pre-sizes this
+   book's id index for expected_orders and, if capacity.orders is set,
+   reserve()s it.
+*/
+struct warmup_options_t {
+   size_t operations = 20000;
+   uint32_t min_price = MAX_PRICE / 2 - 100;
+   uint32_t max_price = MAX_PRICE / 2 + 100;
+   size_t expected_orders = 100000;
+   book_capacity_t capacity;
+};
+
+/*
+   The touch as other threads see it (orderbook::top_of_book()). A side
+   with no orders has orders == 0 and price/qty 0. `sequence` counts the
+   touch changes published so far; journal_sequence is the book's
+   last_sequence() when this one was.
+*/
+struct top_of_book_t {
+   uint64_t sequence = 0;
+   uint64_t journal_sequence = 0;
+   uint64_t bid_qty = 0;
+   uint64_t ask_qty = 0;
+   uint32_t bid_price = 0;
+   uint32_t ask_price = 0;
+   uint32_t bid_orders = 0;
+   uint32_t ask_orders = 0;
+
+   bool has_bid() const { return bid_orders != 0; }
+   bool has_ask() const { return ask_orders != 0; }
 };
 
+// order storage per price level; blocks come from book_memory
+using order_hive = plf::hive<order_t, book_allocator<order_t>>;
+
 struct order_location {
    uint32_t price;
-   plf::hive<order_t>::iterator location_in_hive;
+   order_hive::iterator location_in_hive;
 };
 
+// the book's id index; its table and nodes come from book_memory
+using order_index = robin_hood::unordered_map< order_id_key, order_location, order_id_hasher,
+                                               std::equal_to<order_id_key>, 80, book_raw_allocator >;
+
 struct price_level {
-   plf::hive<order_t> orders;
+   order_hive orders;
    size_t total_qty = 0;
+   bool l2_dirty = false;   // queued in book_state::l2_marks
+   uint32_t snapshot_epoch = 0;   // == book_state::capture.epoch once in the capture in progress
+};
+
+/*
+   Price levels are built on first use. Each ladder price holds a
+   level_slot: 0 while that price has never had an order, otherwise 1 +
+   the level's index in the book's level pool. The pool grows in
+   fixed-size chunks from book_memory and never moves or gives back a
+   level, so an emptied level keeps its hive blocks for the next order at
+   that price.
+*/
+using level_slot = uint16_t;
+
+static constexpr size_t LEVEL_CHUNK = 64;
+static constexpr size_t MAX_LEVELS = 2 * (MAX_PRICE + 1);
+static_assert(MAX_LEVELS < UINT16_MAX, "level_slot cannot index every level");
+
+struct level_chunk {
+   price_level levels[ LEVEL_CHUNK ];
+
+   static void* operator new(size_t bytes) { return book_memory::instance().allocate(bytes); }
+   static void operator delete(void* p) noexcept { book_memory::instance().deallocate(p); }
 };
 
+class book_fork;
+
 class orderbook final {
+   friend class book_fork;
 
 private:
-   std::array< price_level, MAX_PRICE + 1 > bids_;
-   std::array< price_level, MAX_PRICE + 1 > asks_;
+   /*
+      Everything that scales with the ladder or the order count, held in
+      one book_memory block so that moving or swapping a book only moves
+      pointers and a few scalars.
+   */
+   struct book_state {
+      std::array< level_slot, MAX_PRICE + 1 > bid_slots {};
+      std::array< level_slot, MAX_PRICE + 1 > ask_slots {};
+      std::array< std::unique_ptr<level_chunk>, (MAX_LEVELS + LEVEL_CHUNK - 1) / LEVEL_CHUNK > level_chunks;
+      uint32_t level_count = 0;
+
+      order_index order_id_lookup;
+
+      top_of_book_t published_top;   // writer's copy of what top_of_book() holds
+
+      // levels changed since the last L2 flush, each once
+      struct l2_mark_t {
+         uint32_t price;
+         order_side side;
+      };
+      std::vector<l2_mark_t> l2_marks;
+
+      // the incremental snapshot in progress, if any (see begin_snapshot())
+      struct capture_t {
+         std::vector<char>* out = nullptr;   // set while a capture runs
+         size_t used = 0;                    // bytes of *out written so far
+         uint64_t orders = 0;                // resting orders when it began
+         uint64_t sequence = 0;              // last_sequence_ when it began
+         uint32_t levels = 0;                // level records written
+         uint32_t epoch = 0;                 // levels already copied carry this
+         uint32_t bid_prices = 0;            // bid prices left to walk, from the old best bid down
+         uint32_t next_ask = MAX_PRICE + 1;  // next ask price to walk, up from the old best ask
+         char ticker[ TICKER_LEN ] {};
+      };
+      capture_t capture;
+
+      static void* operator new(size_t bytes) { return book_memory::instance().allocate(bytes); }
+      static void operator delete(void* p) noexcept { book_memory::instance().deallocate(p); }
+   };
+
+   std::unique_ptr<book_state> state_ { new book_state() };
+
+   // its own cache line, away from the matching state that readers would otherwise bounce
+   std::unique_ptr< seqlock<top_of_book_t> > top_ = std::make_unique< seqlock<top_of_book_t> >();
 
    uint32_t best_bid_price_ = 0;
    uint32_t best_ask_price_ = MAX_PRICE + 1;
 
-   robin_hood::unordered_map< order_id_key, order_location, order_id_hasher > order_id_lookup_;
-
    logger* log_ = nullptr;
+   clock_source* clock_ = nullptr;
+   uint64_t last_sequence_ = 0;
+   match_timestamp match_ts_mode_ = match_timestamp::PER_FILL;
+   fill_listener* fill_listener_ = nullptr;
+   l2_publisher* l2_ = nullptr;
+   l3_feed* l3_ = nullptr;
+   int numa_node_ = NUMA_LOCAL;
+   uint32_t l2_batch_depth_ = 0;
+   bool alloc_check_ = false;
+
+#ifdef ORDERBOOK_LATENCY_STATS
+   // heap-held so the book stays movable (atomics are not)
+   std::unique_ptr<orderbook_latency_stats> latency_ = std::make_unique<orderbook_latency_stats>();
+#endif
+#ifdef ORDERBOOK_PERF_COUNTERS
+   std::unique_ptr<orderbook_perf_stats> perf_ = std::make_unique<orderbook_perf_stats>();
+#endif
 
 public:
    // not default constructable
    orderbook() = delete;
 
-   explicit orderbook(logger* log_instance = nullptr) {
+   explicit orderbook(logger* log_instance = nullptr, clock_source* clock = nullptr) {
       log_ = log_instance;
+      clock_ = clock ? clock : &default_clock();
    }
 
    // non-copyable
    orderbook(const orderbook&) = delete;
    orderbook& operator=(const orderbook&) = delete;
 
-   // moveable
-   orderbook(orderbook&& other) = default;
+   // moveable in O(1); a moved-from book may only be destroyed or assigned to
+   orderbook(orderbook&& other) noexcept = default;
    orderbook& operator=(orderbook&& other) noexcept = default;
 
    ~orderbook() = default;
 
+   void swap(orderbook& other) noexcept {
+      orderbook tmp(std::move(other));
+      other = std::move(*this);
+      *this = std::move(tmp);
+   }
+   friend void swap(orderbook& a, orderbook& b) noexcept { a.swap(b); }
+
+   // heap-allocated books sit in book_memory next to their state
+   static void* operator new(size_t bytes) { return book_memory::instance().allocate(bytes); }
+   static void operator delete(void* p) noexcept { book_memory::instance().deallocate(p); }
+
+   /*
+      Heap-allocates a book whose ladders, levels, order hives and id index all
+      come from `numa_node`'s book_memory pool, whichever thread drives it
+      later. NUMA_LOCAL takes the node of the calling thread, so call it
+      from the pinned shard thread. Without book_memory config.numa the
+      node is only recorded.
+   */
+   static std::unique_ptr<orderbook> create(int numa_node, logger* log_instance = nullptr,
+                                            clock_source* clock = nullptr);
+
    /*
       Core functionality
    */
@@ -74,16 +269,193 @@ public:
    order_result cancel(const order_id_key& id);
    void execute();
 
+   /*
+      Reduces a resting order by qty in place, keeping its time priority;
+      the order is removed once nothing is left. For fills and partial
+      cancels reported by an external venue. Journalled as a MODIFY to
+      the remaining qty (or a CANCEL).
+   */
+   order_result reduce(const order_id_key& id, size_t qty);
+
    std::optional<uint32_t> best_bid() const;
    std::optional<uint32_t> best_ask() const;
    bool contains(const order_id_key& id) const;
+   std::optional<order_t> find(const order_id_key& id) const;
+
+   /*
+      Pre-sizes the index and the ladder band in `capacity` so the core
+      calls stop allocating, and arms the allocation check: in builds
+      with ORDERBOOK_ALLOC_CHECK, a reserved book whose add, modify,
+      cancel, reduce or execute allocates on the calling thread (fill
+      listener included) reports it to alloc_tracker::on_violation, which
+      aborts by default. Growing past the capacity is such a violation.
+   */
+   void reserve(const book_capacity_t& capacity);
+
+   /*
+      Readies an empty book so its first real orders run at steady-state
+      latency: trains the branch predictors and i-cache on a scratch book
+      that shares this book's allocators (its blocks are freed back to
+      them warm), materialises the levels in [min_price, max_price], faults
+      in both slot ladders and pre-sizes the index. Logs nothing, calls no
+      fill listener and leaves this book exactly as it was. Throws
+      std::logic_error on a non-empty book.
+   */
+   void warmup(const warmup_options_t& options = {});
+   void set_allocation_check(bool enabled) { alloc_check_ = enabled; }
+   bool allocation_check() const { return alloc_check_; }
+
+   size_t order_count() const;
+   size_t level_qty(order_side side, uint32_t price) const;
+
+   // price levels built so far, both sides; emptied levels stay built
+   size_t level_count() const { return state_->level_count; }
+
+   /*
+      The touch for any number of reader threads: best bid/ask price,
+      level qty and order count, republished under a seqlock at the end
+      of every add, modify, cancel, reduce, execute, replay call or
+      snapshot load that changed it. Readers never block the matching
+      thread; try_load() is wait-free, load() retries a torn read. The
+      record stays put when the book is moved.
+   */
+   const seqlock<top_of_book_t>& top_of_book() const { return *top_; }
+
+   // journal sequence of the last event this book logged (or loaded from a snapshot)
+   uint64_t last_sequence() const { return last_sequence_; }
+
+   // nullptr unless built with ORDERBOOK_LATENCY_STATS
+   orderbook_latency_stats* latency_stats() const {
+#ifdef ORDERBOOK_LATENCY_STATS
+      return latency_.get();
+#else
+      return nullptr;
+#endif
+   }
+
+   // nullptr unless built with ORDERBOOK_PERF_COUNTERS
+   const orderbook_perf_stats* perf_stats() const {
+#ifdef ORDERBOOK_PERF_COUNTERS
+      return perf_.get();
+#else
+      return nullptr;
+#endif
+   }
+
+   void set_match_timestamp(match_timestamp mode) { match_ts_mode_ = mode; }
+   void set_fill_listener(fill_listener* listener) { fill_listener_ = listener; }
+
+   /*
+      L2 market data (src/market_data.h). With a publisher set, each level
+      that add, modify, cancel, reduce, execute or a replay call changed
+      is published once, with its new state, when that call returns.
+      Between begin_l2_batch() and the matching end_l2_batch() (they nest)
+      the deltas are held back and coalesced until the outermost end.
+      nullptr stops publishing; pending deltas go to the old publisher.
+   */
+   void set_l2_publisher(l2_publisher* publisher);
+   void begin_l2_batch() { l2_batch_depth_++; }
+   void end_l2_batch();
+
+   /*
+      L3 order-by-order market data (src/l3_feed.h): every add, modify,
+      cancel, reduce and fill is encoded onto the feed's channel as it is
+      logged, with the queue position it leaves the order in. nullptr stops
+      it; replay calls and snapshot loads are not published.
+   */
+   void set_l3_feed(l3_feed* feed) { l3_ = feed; }
+   clock_source* clock() const { return clock_; }
+   int numa_node() const { return numa_node_; }
+
+   /*
+      O(1) copy-on-write view of this book for what-if simulation; see
+      src/book_fork.h. This book must not change while the fork is used.
+   */
+   book_fork fork() const;
+
+   /*
+      Snapshots. capture_snapshot() copies every resting order into `out`
+      in one call (reuse the buffer and steady-state captures don't
+      allocate); do the file I/O with write_snapshot_file() on another
+      thread.
+
+      A deep book is better captured in steps between messages:
+      begin_snapshot(), then snapshot_step() until it returns true, with
+      the book trading in between. Each step copies levels until about
+      `budget` orders and ladder prices have been visited; a level that
+      is about to change is copied first, whole, so the image is the
+      book as it stood at begin_snapshot() and carries that journal
+      sequence. `out` must outlive the capture. One capture at a time;
+      a second begin throws std::logic_error.
+
+      load_snapshot() bulk-builds an empty book and returns the image's
+      last journal sequence. Throws std::runtime_error on a truncated or
+      corrupt image.
+   */
+   void capture_snapshot(const char* ticker, std::vector<char>& out);
+   void begin_snapshot(const char* ticker, std::vector<char>& out);
+   bool snapshot_step(size_t budget);
+   bool snapshot_in_progress() const { return state_->capture.out != nullptr; }
+   uint64_t load_snapshot(const char* data, size_t len);
+
+   /*
+      Replay fast path: no validation, no logging. Only for events this
+      book type itself journalled (see journal_replayer).
+   */
+   void replay_add(const order_t& order);
+   void replay_modify(const order_id_key& id, const order_t& new_order);
+   void replay_cancel(const order_id_key& id);
+   void replay_fill(const order_id_key& id, size_t qty);
 
 private:
+   order_result add_impl(const order_t& order);
+   order_result modify_impl(const order_id_key& id, const order_t& new_order);
+   order_result cancel_impl(const order_id_key& id);
+   order_result reduce_impl(const order_id_key& id, size_t qty);
+   size_t execute_impl();
+
+#ifdef ORDERBOOK_INSTRUMENTED
+   struct probe_t {
+      uint64_t ticks = 0;
+#ifdef ORDERBOOK_PERF_COUNTERS
+      perf_sample_t counters;
+#endif
+   };
+   void probe_begin(probe_t& probe);
+   void probe_end(latency_op op, order_result result, const probe_t& probe);
+#endif
+
+   price_level& level_for(order_side side, uint32_t price);
+
+   // nullptr while nothing has rested at that price
+   const price_level* find_level(order_side side, uint32_t price) const {
+      level_slot slot = (side == order_side::BUY ? state_->bid_slots : state_->ask_slots)[ price ];
+      if (slot == 0) {
+         return nullptr;
+      }
+      uint32_t index = slot - 1u;
+      return &state_->level_chunks[ index / LEVEL_CHUNK ]->levels[ index % LEVEL_CHUNK ];
+   }
+   price_level& level_at(level_slot slot);
+   const price_level& level_at(level_slot slot) const;
+   bool level_empty(order_side side, uint32_t price) const;
+   level_slot materialise_level();
+   void before_level_change(order_side side, uint32_t price);
+   void capture_level(order_side side, uint32_t price, price_level& level);
+   order_hive::iterator insert_resting(const order_t& order);
+   void erase_resting(const order_location& loc);
+   void modify_resting(order_location& loc, const order_t& old_order, const order_t& new_order);
+
    void update_best_bid_on_insert(uint32_t price);
    void update_best_ask_on_insert(uint32_t price);
    void update_best_bid_on_cancel(uint32_t price);
    void update_best_ask_on_cancel(uint32_t price);
 
-   void log_event(const log_event_t& event);
+   void publish_top();
+   void publish_market_data();
+   void mark_l2(order_side side, uint32_t price, price_level& level);
+   void flush_l2();
+   const order_t* next_in_queue(order_side side, uint32_t price, order_hive::iterator it);
+   void log_event(const log_event_t& event, const order_t* queued_before = nullptr);
 };
 
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "../includes/types.h"
+
+/*
+   Compact binary order-entry protocol, modelled on NASDAQ OUCH.
+
+   Every message starts with msg_header_t: total length in bytes
+   (including the header) and a one-byte type. All layouts are packed
+   and fixed; integers are little-endian so both ends can decode in place
+   with a memcpy. Clients name their orders with a 64-bit token that is
+   unique within the session. Unlike OUCH, cancel and replace repeat the
+   ticker, because the gateway keeps one book per symbol and no per-order
+   routing state.
+*/
+
+namespace ouch {
+
+   // inbound
+   constexpr char ENTER_ORDER   = 'O';
+   constexpr char CANCEL_ORDER  = 'X';
+   constexpr char REPLACE_ORDER = 'U';
+
+   // outbound
+   constexpr char ACCEPTED = 'A';
+   constexpr char REJECTED = 'J';
+   constexpr char CANCELED = 'C';
+   constexpr char REPLACED = 'R';
+   constexpr char EXECUTED = 'E';
+
+   constexpr char SIDE_BUY  = 'B';
+   constexpr char SIDE_SELL = 'S';
+
+   BEGIN_PACKED
+   PACKED_STRUCT msg_header_t {
+      uint16_t length;
+      char type;
+   };
+
+   PACKED_STRUCT enter_order_t {
+      msg_header_t header;
+      uint64_t token;
+      char side;
+      uint32_t qty;
+      char ticker[ TICKER_LEN ];
+      uint32_t price;
+   };
+
+   PACKED_STRUCT cancel_order_t {
+      msg_header_t header;
+      uint64_t token;
+      char ticker[ TICKER_LEN ];
+   };
+
+   PACKED_STRUCT replace_order_t {
+      msg_header_t header;
+      uint64_t token;
+      char ticker[ TICKER_LEN ];
+      uint32_t qty;
+      uint32_t price;
+   };
+
+   PACKED_STRUCT accepted_t {
+      msg_header_t header;
+      uint64_t token;
+      uint64_t timestamp;   // gateway clock ticks
+   };
+
+   PACKED_STRUCT rejected_t {
+      msg_header_t header;
+      uint64_t token;
+      uint8_t reason;       // order_result
+   };
+
+   PACKED_STRUCT canceled_t {
+      msg_header_t header;
+      uint64_t token;
+   };
+
+   PACKED_STRUCT replaced_t {
+      msg_header_t header;
+      uint64_t token;
+      uint32_t qty;
+      uint32_t price;
+   };
+
+   PACKED_STRUCT executed_t {
+      msg_header_t header;
+      uint64_t token;
+      uint32_t qty;
+      uint32_t price;
+      uint64_t match_number;
+   };
+   END_PACKED
+
+   constexpr uint16_t MAX_MESSAGE = 64;
+
+   template <typename msg_t>
+   inline msg_t make(char type) {
+      msg_t m;
+      std::memset(&m, 0, sizeof(m));
+      m.header.length = static_cast<uint16_t>(sizeof(msg_t));
+      m.header.type = type;
+      return m;
+   }
+
+   static inline uint16_t expected_length(char type) {
+      switch (type) {
+         case ENTER_ORDER:   return sizeof(enter_order_t);
+         case CANCEL_ORDER:  return sizeof(cancel_order_t);
+         case REPLACE_ORDER: return sizeof(replace_order_t);
+         case ACCEPTED:      return sizeof(accepted_t);
+         case REJECTED:      return sizeof(rejected_t);
+         case CANCELED:      return sizeof(canceled_t);
+         case REPLACED:      return sizeof(replaced_t);
+         case EXECUTED:      return sizeof(executed_t);
+         default:            return 0;
+      }
+   }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include "../includes/perf_counters.h"
+#include "latency_stats.h"
+
+/*
+   Per-operation hardware counters for orderbook, compiled in only when
+   ORDERBOOK_PERF_COUNTERS is defined (cmake -DORDERBOOK_PERF_COUNTERS=ON).
+
+   The counter group belongs to the thread that makes the first
+   instrumented call, so drive the book from one thread. Every call pays
+   two counter reads; use this for tuning runs, not latency numbers.
+   Totals are plain fields: read them from the matching thread or after
+   it has stopped.
+*/
+struct orderbook_perf_stats {
+   std::unique_ptr<perf_counter_group> group;
+   std::array<perf_totals_t, LATENCY_OPS> per_op;
+
+   perf_counter_group& counters() {
+      if (!group) {
+         group = std::make_unique<perf_counter_group>();
+      }
+      return *group;
+   }
+
+   const perf_totals_t& at(latency_op op) const { return per_op[ static_cast<size_t>(op) ]; }
+};
@@ -0,0 +1,277 @@
+#include "shm_transport.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+size_t shm::segment_size(uint32_t max_clients) {
+   return sizeof(segment_header_t) + static_cast<size_t>(max_clients) * sizeof(client_slot_t);
+}
+
+static void* map_segment(int fd, size_t size) {
+   void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+   return p == MAP_FAILED ? nullptr : p;
+}
+
+static shm::client_slot_t* slot_at(void* base, uint32_t i) {
+   char* first = static_cast<char*>(base) + sizeof(shm::segment_header_t);
+   return reinterpret_cast<shm::client_slot_t*>(first + static_cast<size_t>(i) * sizeof(shm::client_slot_t));
+}
+
+shm_engine::shm_engine(const shm_engine_config_t& config)
+   : config_(config),
+     entry_(*this, config_.log)
+{
+   if (config_.max_clients == 0) {
+      throw std::invalid_argument("shm_engine needs at least one client slot");
+   }
+   size_ = shm::segment_size(config_.max_clients);
+
+   // a segment left behind by an engine that died is reused, not trusted
+   fd_ = ::shm_open(config_.name.c_str(), O_CREAT | O_RDWR, 0600);
+   if (fd_ < 0) {
+      throw std::runtime_error("shm_open " + config_.name + ": " + std::strerror(errno));
+   }
+   if (::ftruncate(fd_, 0) != 0 || ::ftruncate(fd_, static_cast<off_t>(size_)) != 0 ||
+       !(base_ = map_segment(fd_, size_))) {
+      int err = errno;
+      ::close(fd_);
+      ::shm_unlink(config_.name.c_str());
+      throw std::runtime_error("shm segment " + config_.name + ": " + std::strerror(err));
+   }
+
+   header_ = new (base_) shm::segment_header_t();
+   header_->version = shm::SEGMENT_VERSION;
+   header_->max_clients = config_.max_clients;
+   header_->ring_slots = static_cast<uint32_t>(shm::RING_SLOTS);
+   header_->slot_size = static_cast<uint32_t>(sizeof(shm::client_slot_t));
+   for (uint32_t i = 0; i < config_.max_clients; i++) {
+      shm::client_slot_t* s = new (slot_at(base_, i)) shm::client_slot_t();
+      s->requests.init();
+      s->reports.init();
+      s->generation.store(0, std::memory_order_relaxed);
+      s->state.store(shm::FREE, std::memory_order_relaxed);
+   }
+   header_->engine_alive.store(1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+   std::memcpy(header_->magic, shm::SEGMENT_MAGIC, sizeof(shm::SEGMENT_MAGIC));
+}
+
+shm_engine::~shm_engine() {
+   header_->engine_alive.store(0, std::memory_order_release);
+   ::munmap(base_, size_);
+   ::close(fd_);
+   ::shm_unlink(config_.name.c_str());
+}
+
+shm::client_slot_t& shm_engine::slot(uint32_t i) {
+   return *slot_at(base_, i);
+}
+
+void shm_engine::run(const std::atomic<bool>& stop) {
+   idle_waiter waiter(config_.idle);
+   while (!stop.load(std::memory_order_relaxed)) {
+      if (poll()) {
+         waiter.reset();
+      } else {
+         waiter.idle();
+      }
+   }
+}
+
+size_t shm_engine::poll() {
+   size_t handled = 0;
+   for (uint32_t i = 0; i < config_.max_clients; i++) {
+      shm::client_slot_t& s = slot(i);
+      uint32_t state = s.state.load(std::memory_order_acquire);
+      if (state == shm::CLOSING) {
+         release(s);
+         continue;
+      }
+      if (state != shm::CONNECTED) {
+         continue;
+      }
+      shm::request_t req;
+      for (size_t n = 0; n < config_.poll_batch && s.requests.try_pop(req); n++) {
+         handle(i, s, req);
+         handled++;
+      }
+   }
+   stats_.requests += handled;
+   return handled;
+}
+
+void shm_engine::handle(uint32_t slot_index, shm::client_slot_t& s, const shm::request_t& req) {
+   uint64_t session = static_cast<uint64_t>(s.generation.load(std::memory_order_relaxed)) << 32 | slot_index;
+   switch (req.type) {
+      case shm::ENTER:
+         entry_.enter(session, req.token, req.order);
+         break;
+      case shm::CANCEL:
+         entry_.cancel(session, req.token, req.order.ticker);
+         break;
+      case shm::REPLACE:
+         entry_.replace(session, req.token, req.order.ticker, req.order.qty, req.order.price);
+         break;
+      default:
+         // no order_result fits; the client sees no report for the token
+         stats_.protocol_errors++;
+         break;
+   }
+}
+
+// The departed client no longer touches the rings; reset them for the next owner.
+void shm_engine::release(shm::client_slot_t& s) {
+   s.requests.init();
+   s.reports.init();
+   s.generation.fetch_add(1, std::memory_order_relaxed);
+   s.state.store(shm::FREE, std::memory_order_release);
+}
+
+// session is (generation << 32 | slot); reports for an earlier owner of the slot are dropped
+void shm_engine::send(uint64_t session, const shm::report_t& r) {
+   uint32_t slot_index = static_cast<uint32_t>(session);
+   if (slot_index >= config_.max_clients) {
+      return;
+   }
+   shm::client_slot_t& s = slot(slot_index);
+   if (s.state.load(std::memory_order_acquire) != shm::CONNECTED ||
+       s.generation.load(std::memory_order_relaxed) != static_cast<uint32_t>(session >> 32)) {
+      return;
+   }
+   if (s.reports.try_push(r)) {
+      stats_.reports++;
+   } else {
+      stats_.reports_dropped++;
+   }
+}
+
+void shm_engine::accepted(uint64_t session, uint64_t token, uint64_t timestamp) {
+   shm::report_t ack = {};
+   ack.type = shm::ACCEPTED;
+   ack.token = token;
+   ack.timestamp = timestamp;
+   send(session, ack);
+}
+
+void shm_engine::rejected(uint64_t session, uint64_t token, order_result reason) {
+   shm::report_t rej = {};
+   rej.type = shm::REJECTED;
+   rej.reason = static_cast<uint8_t>(reason);
+   rej.token = token;
+   send(session, rej);
+}
+
+void shm_engine::canceled(uint64_t session, uint64_t token) {
+   shm::report_t ack = {};
+   ack.type = shm::CANCELED;
+   ack.token = token;
+   send(session, ack);
+}
+
+void shm_engine::replaced(uint64_t session, uint64_t token, size_t qty, uint32_t price) {
+   shm::report_t ack = {};
+   ack.type = shm::REPLACED;
+   ack.token = token;
+   ack.qty = qty;
+   ack.price = price;
+   send(session, ack);
+}
+
+void shm_engine::executed(uint64_t session, uint64_t token, uint64_t timestamp, uint64_t match_number,
+                          size_t qty, uint32_t price) {
+   shm::report_t ex = {};
+   ex.type = shm::EXECUTED;
+   ex.token = token;
+   ex.timestamp = timestamp;
+   ex.match_number = match_number;
+   ex.qty = qty;
+   ex.price = price;
+   send(session, ex);
+}
+
+shm_client::shm_client(const std::string& name) {
+   fd_ = ::shm_open(name.c_str(), O_RDWR, 0);
+   if (fd_ < 0) {
+      throw std::runtime_error("shm_open " + name + ": " + std::strerror(errno));
+   }
+   struct stat st;
+   if (::fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(shm::segment_header_t)) {
+      ::close(fd_);
+      throw std::runtime_error("shm segment " + name + " is not initialised");
+   }
+   size_ = static_cast<size_t>(st.st_size);
+   if (!(base_ = map_segment(fd_, size_))) {
+      int err = errno;
+      ::close(fd_);
+      throw std::runtime_error("mmap " + name + ": " + std::strerror(err));
+   }
+
+   header_ = static_cast<shm::segment_header_t*>(base_);
+   std::atomic_thread_fence(std::memory_order_acquire);
+   if (std::memcmp(header_->magic, shm::SEGMENT_MAGIC, sizeof(shm::SEGMENT_MAGIC)) != 0 ||
+       header_->version != shm::SEGMENT_VERSION ||
+       header_->ring_slots != shm::RING_SLOTS ||
+       header_->slot_size != sizeof(shm::client_slot_t) ||
+       shm::segment_size(header_->max_clients) > size_) {
+      ::munmap(base_, size_);
+      ::close(fd_);
+      throw std::runtime_error("shm segment " + name + " has an incompatible layout");
+   }
+
+   for (uint32_t i = 0; i < header_->max_clients; i++) {
+      shm::client_slot_t* s = slot_at(base_, i);
+      // the engine reset the rings before it stored FREE
+      uint32_t expected = shm::FREE;
+      if (s->state.compare_exchange_strong(expected, shm::CONNECTED, std::memory_order_acq_rel)) {
+         slot_ = s;
+         index_ = i;
+         return;
+      }
+   }
+   ::munmap(base_, size_);
+   ::close(fd_);
+   throw std::runtime_error("shm segment " + name + " has no free client slot");
+}
+
+shm_client::~shm_client() {
+   slot_->state.store(shm::CLOSING, std::memory_order_release);
+   ::munmap(base_, size_);
+   ::close(fd_);
+}
+
+bool shm_client::engine_alive() const {
+   return header_->engine_alive.load(std::memory_order_acquire) != 0;
+}
+
+bool shm_client::enter(uint64_t token, const order_t& order) {
+   shm::request_t req;
+   req.type = shm::ENTER;
+   req.token = token;
+   req.order = order;
+   return slot_->requests.try_push(req);
+}
+
+bool shm_client::cancel(uint64_t token, const char* ticker) {
+   shm::request_t req = {};
+   req.type = shm::CANCEL;
+   req.token = token;
+   std::memcpy(req.order.ticker, ticker, TICKER_LEN);
+   return slot_->requests.try_push(req);
+}
+
+bool shm_client::replace(uint64_t token, const char* ticker, size_t qty, uint32_t price) {
+   shm::request_t req = {};
+   req.type = shm::REPLACE;
+   req.token = token;
+   std::memcpy(req.order.ticker, ticker, TICKER_LEN);
+   req.order.qty = qty;
+   req.order.price = price;
+   return slot_->requests.try_push(req);
+}
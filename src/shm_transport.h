@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "order_entry.h"
+#include "../includes/spsc_ring.h"
+#include "../includes/thread_affinity.h"
+
+/*
+   Shared-memory order entry for clients on the same host.
+
+   The engine creates a POSIX shared-memory segment (/dev/shm/<name>)
+   holding a header and a fixed number of client slots. Each slot is a
+   pair of SPSC rings of fixed 64-byte messages: requests from the client
+   and reports back from the engine. A request carries an order_t as the
+   client laid it out, so entering an order is one copy into the ring and
+   no encoding on either side. The engine thread polls every connected
+   slot; nothing is allocated or copied through the kernel per message.
+
+   A client claims a FREE slot by CAS to CONNECTED and hands it back by
+   storing CLOSING. Only the engine touches a slot's rings outside
+   CONNECTED: on its next poll() it resets a CLOSING slot's rings, bumps
+   the generation and stores FREE, so a new owner never races the engine
+   over ring indices still in use. Book calls go through order_entry with
+   (slot, generation) as the session, so a later owner of the slot never
+   sees executions for orders left behind by an earlier one.
+*/
+
+namespace shm {
+
+   constexpr char SEGMENT_MAGIC[8] = { 'O','B','S','H','M','0','0','1' };
+   constexpr uint32_t SEGMENT_VERSION = 2;
+   constexpr size_t RING_SLOTS = 4096;
+
+   enum request_type : uint8_t { ENTER = 1, CANCEL = 2, REPLACE = 3 };
+   enum report_type : uint8_t { ACCEPTED = 1, REJECTED = 2, CANCELED = 3, REPLACED = 4, EXECUTED = 5 };
+   enum slot_state : uint32_t { FREE = 0, CONNECTED = 1, CLOSING = 2 };
+
+   /*
+      ENTER uses the whole order (order_id, timestamp and status are
+      assigned by the engine); CANCEL only order.ticker; REPLACE
+      order.ticker, order.qty and order.price.
+   */
+   struct alignas(64) request_t {
+      uint8_t type;
+      uint8_t reserved[ 7 ];
+      uint64_t token;
+      order_t order;
+   };
+
+   struct alignas(64) report_t {
+      uint8_t type;
+      uint8_t reason;        // order_result, for REJECTED
+      uint8_t reserved[ 6 ];
+      uint64_t token;
+      uint64_t timestamp;    // engine clock ticks
+      uint64_t match_number; // EXECUTED
+      uint64_t qty;          // EXECUTED, REPLACED
+      uint32_t price;        // EXECUTED, REPLACED
+   };
+
+   static_assert(sizeof(request_t) == 64, "shm::request_t layout changed");
+   static_assert(sizeof(report_t) == 64, "shm::report_t layout changed");
+
+   using request_ring = spsc_ring<request_t, RING_SLOTS>;
+   using report_ring = spsc_ring<report_t, RING_SLOTS>;
+
+   struct client_slot_t {
+      alignas(64) std::atomic<uint32_t> state;
+      std::atomic<uint32_t> generation;   // written by the engine only
+      request_ring requests;
+      report_ring reports;
+   };
+
+   struct alignas(64) segment_header_t {
+      char magic[ 8 ];       // written last by the engine
+      uint32_t version;
+      uint32_t max_clients;
+      uint32_t ring_slots;
+      uint32_t slot_size;
+      std::atomic<uint32_t> engine_alive;
+   };
+
+   size_t segment_size(uint32_t max_clients);
+}
+
+struct shm_engine_config_t {
+   std::string name = "/orderbook-shm";   // shm_open name, leading '/'
+   uint32_t max_clients = 8;
+   size_t poll_batch = 64;                // requests taken from one client per pass
+   idle_strategy idle = idle_strategy::BUSY_POLL;   // between passes that find nothing
+   logger* log = nullptr;
+};
+
+struct shm_engine_stats_t {
+   uint64_t requests = 0;
+   uint64_t reports = 0;
+   uint64_t reports_dropped = 0;          // client report ring full
+   uint64_t protocol_errors = 0;
+   uint64_t fills = 0;
+};
+
+/*
+   Engine side: owns the segment (created on construction, unlinked on
+   destruction) and the books. Single-threaded like gateway; call poll()
+   or run() from the thread that owns the books. A client that lets its
+   report ring fill up loses reports rather than stalling the engine.
+*/
+class shm_engine final : private order_entry_reports {
+public:
+   explicit shm_engine(const shm_engine_config_t& config = {});
+   ~shm_engine() override;
+
+   shm_engine(const shm_engine&) = delete;
+   shm_engine& operator=(const shm_engine&) = delete;
+
+   // One pass over every connected client; returns the number of requests handled.
+   size_t poll();
+
+   // poll() until `stop` is set.
+   void run(const std::atomic<bool>& stop);
+
+   shm_engine_stats_t stats() const {
+      shm_engine_stats_t s = stats_;
+      s.fills = entry_.fills();
+      return s;
+   }
+   const std::string& name() const { return config_.name; }
+   orderbook* book(const char* ticker) { return entry_.book(ticker); }
+
+private:
+   shm_engine_config_t config_;
+   int fd_ = -1;
+   void* base_ = nullptr;
+   size_t size_ = 0;
+   shm::segment_header_t* header_ = nullptr;
+   shm_engine_stats_t stats_;
+   order_entry entry_;
+
+   shm::client_slot_t& slot(uint32_t i);
+   void handle(uint32_t slot_index, shm::client_slot_t& s, const shm::request_t& req);
+   void release(shm::client_slot_t& s);
+   void send(uint64_t session, const shm::report_t& r);
+
+   void accepted(uint64_t session, uint64_t token, uint64_t timestamp) override;
+   void rejected(uint64_t session, uint64_t token, order_result reason) override;
+   void canceled(uint64_t session, uint64_t token) override;
+   void replaced(uint64_t session, uint64_t token, size_t qty, uint32_t price) override;
+   void executed(uint64_t session, uint64_t token, uint64_t timestamp, uint64_t match_number,
+                 size_t qty, uint32_t price) override;
+};
+
+/*
+   Client side: maps an engine's segment and claims one slot for the
+   lifetime of the object. The submit calls return false when the
+   request ring is full; poll() returns false when no report is waiting.
+   A slot given back is free again after the engine's next poll().
+   One thread per client object.
+*/
+class shm_client {
+public:
+   explicit shm_client(const std::string& name = "/orderbook-shm");
+   ~shm_client();
+
+   shm_client(const shm_client&) = delete;
+   shm_client& operator=(const shm_client&) = delete;
+
+   bool enter(uint64_t token, const order_t& order);
+   bool cancel(uint64_t token, const char* ticker);
+   bool replace(uint64_t token, const char* ticker, size_t qty, uint32_t price);
+
+   bool poll(shm::report_t& out) { return slot_->reports.try_pop(out); }
+
+   uint32_t slot_index() const { return index_; }
+   bool engine_alive() const;
+
+private:
+   int fd_ = -1;
+   void* base_ = nullptr;
+   size_t size_ = 0;
+   shm::segment_header_t* header_ = nullptr;
+   shm::client_slot_t* slot_ = nullptr;
+   uint32_t index_ = 0;
+};
@@ -0,0 +1,177 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../includes/alloc_tracker.h"
+#include "../src/orderbook.h"
+#include "test_orders.h"
+
+static const test_orders factory { 'A', "ALLC" };
+
+// records violations instead of aborting, for the duration of a case
+struct violation_recorder {
+    static inline std::string last_op;
+    static inline uint64_t count = 0;
+
+    violation_recorder() {
+        last_op.clear();
+        count = 0;
+        alloc_tracker::on_violation.store(&record);
+    }
+    ~violation_recorder() { alloc_tracker::on_violation.store(alloc_tracker::abort_on_violation); }
+
+    static void record(const char* op, uint64_t) {
+        last_op = op;
+        count++;
+    }
+};
+
+static book_capacity_t band_capacity()
+{
+    book_capacity_t c;
+    c.orders = 4096;
+    c.min_price = 90;
+    c.max_price = 110;
+    c.orders_per_level = 256;
+    return c;
+}
+
+TEST_CASE("alloc_tracker: hooks count heap allocations per thread", "[alloc]")
+{
+    REQUIRE(alloc_tracker::hooks_installed());
+
+    // volatile, so the compiler cannot elide the malloc/free and new/delete pairs
+    alloc_scope scope;
+    void* volatile p = std::malloc(100);
+    int* volatile q = new int(7);
+    REQUIRE(scope.heap_allocations() == 2);
+    REQUIRE(scope.pool_allocations() == 0);
+
+    alloc_scope quiet;
+    int x = *q + 1;
+    REQUIRE(x == 8);
+    REQUIRE(quiet.allocations() == 0);
+    std::free(p);
+    delete q;
+}
+
+TEST_CASE("alloc_tracker: a reserved book runs add/modify/cancel/execute without allocating", "[alloc]")
+{
+    violation_recorder violations;
+    auto book = std::make_unique<orderbook>(nullptr);
+    book->reserve(band_capacity());
+    REQUIRE(book->allocation_check());
+
+    // steady churn inside the band: resting adds, same- and cross-level modifies,
+    // cancels, and crossing orders that execute
+    uint64_t allocations = 0;
+    uint64_t next = 1;
+    std::vector<uint64_t> live;
+    live.reserve(256);
+    for (int round = 0; round < 2000; round++) {
+        uint32_t offset = static_cast<uint32_t>(round % 5);
+        uint64_t bid_id = next++;
+        uint64_t ask_id = next++;
+        uint64_t cross_id = next++;
+        order_t bid = factory.make(bid_id, order_side::BUY, 95 + offset, 10);
+        order_t ask = factory.make(ask_id, order_side::SELL, 101 + offset, 10);
+
+        alloc_scope scope;
+        book->add(bid);
+        book->add(ask);
+        book->modify(factory.id(bid_id), factory.make(bid_id, order_side::BUY, 99 - offset, 7));
+        if (round % 3 == 0) {
+            book->add(factory.make(cross_id, order_side::BUY, 101 + offset, 4));   // crosses
+            book->execute();
+        }
+        if (round % 2 == 0) {
+            book->cancel(factory.id(ask_id));
+        }
+        allocations += scope.allocations();
+
+        // bound the resting orders (filled and cancelled ones just miss) so no level outgrows its reservation
+        live.push_back(bid_id);
+        live.push_back(ask_id);
+        while (live.size() > 120) {
+            book->cancel(factory.id(live.front()));
+            live.erase(live.begin());
+        }
+    }
+
+    REQUIRE(allocations == 0);
+    REQUIRE(violations.count == 0);
+    REQUIRE(book->order_count() > 0);
+}
+
+TEST_CASE("alloc_tracker: growing past the reservation is reported", "[alloc]")
+{
+    violation_recorder violations;
+    auto book = std::make_unique<orderbook>(nullptr);
+
+    // not reserved: allocating is allowed and not reported
+    REQUIRE(book->add(factory.make(1, order_side::BUY, 500, 10)) == order_result::SUCCESS);
+    REQUIRE(violations.count == 0);
+
+    book->reserve(band_capacity());
+    REQUIRE(book->add(factory.make(2, order_side::BUY, 95, 10)) == order_result::SUCCESS);
+    REQUIRE(violations.count == 0);
+
+    // outside the reserved band: the level's hive needs a block
+    REQUIRE(book->add(factory.make(3, order_side::SELL, 600, 10)) == order_result::SUCCESS);
+    REQUIRE(violations.count == 1);
+    REQUIRE(violations.last_op == "add");
+
+    book->set_allocation_check(false);
+    REQUIRE(book->add(factory.make(4, order_side::SELL, 700, 10)) == order_result::SUCCESS);
+    REQUIRE(violations.count == 1);
+}
+
+TEST_CASE("alloc_tracker: an l2 batch across hundreds of levels does not allocate", "[alloc]")
+{
+    violation_recorder violations;
+    auto ring = std::make_unique<l2_ring>();
+    ring->init();
+    l2_publisher publisher(*ring, 1);
+
+    auto book = std::make_unique<orderbook>(nullptr);
+    book_capacity_t capacity;
+    capacity.orders = 1024;
+    capacity.min_price = 100;
+    capacity.max_price = 400;
+    capacity.orders_per_level = 4;
+    book->reserve(capacity);
+    book->set_l2_publisher(&publisher);
+
+    // 150 bid and 150 ask levels, all marked before one flush
+    book->begin_l2_batch();
+    uint64_t n = 1;
+    for (uint32_t price = 100; price < 250; price++) {
+        REQUIRE(book->add(factory.make(n++, order_side::BUY, price, 10)) == order_result::SUCCESS);
+        REQUIRE(book->add(factory.make(n++, order_side::SELL, price + 151, 10)) == order_result::SUCCESS);
+    }
+    book->end_l2_batch();
+
+    REQUIRE(violations.count == 0);
+    REQUIRE(publisher.stats().deltas == 300);
+    REQUIRE(publisher.stats().batches == 1);
+}
+
+TEST_CASE("alloc_tracker: pooled book memory is counted without touching malloc", "[alloc]")
+{
+    book_memory_config_t c;
+    c.pages = page_kind::SMALL;
+    c.reserve_bytes = 8 << 20;
+    book_memory::instance().configure(c);
+
+    alloc_scope scope;
+    void* p = book_memory::instance().allocate(200);
+    book_memory::instance().deallocate(p);
+    REQUIRE(scope.pool_allocations() == 1);
+    REQUIRE(scope.heap_allocations() == 0);
+
+    book_memory::instance().configure({});
+}
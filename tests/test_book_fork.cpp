@@ -0,0 +1,184 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "../src/book_fork.h"
+#include "test_orders.h"
+
+static const test_orders factory { 'F', "FORK" };
+
+// bids 95..99 and asks 101..105, three orders of 10 per level
+static void build(orderbook& book)
+{
+    uint64_t n = 1;
+    for (uint32_t l = 0; l < 5; l++) {
+        for (int k = 0; k < 3; k++) {
+            book.add(factory.make(n++, order_side::BUY, 99 - l, 10));
+            book.add(factory.make(n++, order_side::SELL, 101 + l, 10));
+        }
+    }
+}
+
+struct fill_record : fill_listener {
+    struct fill_t {
+        order_id_key bid;
+        order_id_key ask;
+        size_t qty;
+    };
+    std::vector<fill_t> fills;
+
+    void on_fill(const order_t& bid, const order_t& ask, size_t qty) override {
+        fill_t f;
+        std::memcpy(f.bid.order_id, bid.order_id, ORDER_ID_LEN);
+        std::memcpy(f.ask.order_id, ask.order_id, ORDER_ID_LEN);
+        f.qty = qty;
+        fills.push_back(f);
+    }
+};
+
+TEST_CASE("book_fork: a fresh fork reads through to the base", "[fork]")
+{
+    auto base = std::make_unique<orderbook>(nullptr);
+    build(*base);
+
+    book_fork fork = base->fork();
+    REQUIRE(fork.touched_levels() == 0);
+    REQUIRE(fork.order_count() == 30);
+    REQUIRE(fork.best_bid().value() == 99);
+    REQUIRE(fork.best_ask().value() == 101);
+    REQUIRE(fork.level_qty(order_side::SELL, 103) == 30);
+    REQUIRE(fork.contains(factory.id(1)));
+    REQUIRE(fork.find(factory.id(2))->price == 101);
+    REQUIRE_FALSE(fork.contains(factory.id(999)));
+
+    auto empty = std::make_unique<orderbook>(nullptr);
+    book_fork nothing = empty->fork();
+    REQUIRE_FALSE(nothing.best_bid().has_value());
+    REQUIRE_FALSE(nothing.best_ask().has_value());
+}
+
+TEST_CASE("book_fork: a sweep on the fork matches the real book and leaves the base alone", "[fork]")
+{
+    auto base = std::make_unique<orderbook>(nullptr);
+    auto real = std::make_unique<orderbook>(nullptr);
+    build(*base);
+    build(*real);
+
+    fill_record fork_fills, real_fills;
+    book_fork fork = base->fork();
+    fork.set_fill_listener(&fork_fills);
+    real->set_fill_listener(&real_fills);
+
+    // takes 101 and 102 and half of 103
+    order_t sweep = factory.make(100, order_side::BUY, 103, 75);
+    REQUIRE(fork.add(sweep) == order_result::SUCCESS);
+    REQUIRE(real->add(sweep) == order_result::SUCCESS);
+    REQUIRE(fork.execute() == 8);
+    real->execute();
+
+    REQUIRE(fork_fills.fills.size() == real_fills.fills.size());
+    for (size_t i = 0; i < real_fills.fills.size(); i++) {
+        REQUIRE(fork_fills.fills[i].bid == real_fills.fills[i].bid);
+        REQUIRE(fork_fills.fills[i].ask == real_fills.fills[i].ask);
+        REQUIRE(fork_fills.fills[i].qty == real_fills.fills[i].qty);
+    }
+    REQUIRE(fork.order_count() == real->order_count());
+    REQUIRE(fork.best_ask() == real->best_ask());
+    REQUIRE(fork.best_bid() == real->best_bid());
+    for (uint32_t p = 95; p <= 105; p++) {
+        REQUIRE(fork.level_qty(order_side::BUY, p) == real->level_qty(order_side::BUY, p));
+        REQUIRE(fork.level_qty(order_side::SELL, p) == real->level_qty(order_side::SELL, p));
+    }
+
+    // overlays only where the sweep went: asks 101..103 and the aggressor's 103 bid
+    REQUIRE(fork.touched_levels() == 4);
+
+    // the partly filled queue head at 103 shows its fork-side qty; filled orders are gone
+    REQUIRE(fork.find(factory.id(16))->qty == 5);
+    REQUIRE_FALSE(fork.contains(factory.id(14)));
+    REQUIRE(fork.cancel(factory.id(16)) == order_result::SUCCESS);
+    REQUIRE(fork.level_qty(order_side::SELL, 103) == 10);
+
+    // the base is exactly as built
+    REQUIRE(base->find(factory.id(16))->qty == 10);
+    REQUIRE(base->order_count() == 30);
+    REQUIRE(base->best_ask().value() == 101);
+    REQUIRE(base->level_qty(order_side::SELL, 101) == 30);
+    REQUIRE(base->level_qty(order_side::SELL, 103) == 30);
+    REQUIRE_FALSE(base->contains(factory.id(100)));
+}
+
+TEST_CASE("book_fork: cancel, modify and re-add of base orders stay in the fork", "[fork]")
+{
+    auto base = std::make_unique<orderbook>(nullptr);
+    build(*base);
+    book_fork fork = base->fork();
+
+    // cancel a base order: it disappears from the fork only
+    REQUIRE(fork.cancel(factory.id(1)) == order_result::SUCCESS);
+    REQUIRE_FALSE(fork.contains(factory.id(1)));
+    REQUIRE(base->contains(factory.id(1)));
+    REQUIRE(fork.level_qty(order_side::BUY, 99) == 20);
+    REQUIRE(fork.cancel(factory.id(1)) == order_result::ORDER_NOT_FOUND);
+    REQUIRE(fork.order_count() == 29);
+
+    // the id is free again in the fork, still taken in the base
+    REQUIRE(fork.add(factory.make(1, order_side::BUY, 50, 5)) == order_result::SUCCESS);
+    REQUIRE(fork.find(factory.id(1))->price == 50);
+    REQUIRE(base->find(factory.id(1))->price == 99);
+    REQUIRE(fork.add(factory.make(2, order_side::SELL, 101, 5)) == order_result::DUPLICATE_ID);
+
+    // move a base order to a new price and side
+    order_t moved = factory.make(4, order_side::SELL, 110, 7);
+    REQUIRE(fork.modify(factory.id(4), moved) == order_result::SUCCESS);
+    REQUIRE(fork.level_qty(order_side::SELL, 101) == 20);
+    REQUIRE(fork.level_qty(order_side::SELL, 110) == 7);
+    REQUIRE(fork.find(factory.id(4))->price == 110);
+    REQUIRE(base->level_qty(order_side::SELL, 101) == 30);
+    REQUIRE(base->level_qty(order_side::SELL, 110) == 0);
+
+    // same-level modify keeps the level's total right
+    order_t smaller = factory.make(3, order_side::BUY, 99, 4);
+    REQUIRE(fork.modify(factory.id(3), smaller) == order_result::SUCCESS);
+    REQUIRE(fork.level_qty(order_side::BUY, 99) == 14);
+    REQUIRE(fork.modify(factory.id(999), smaller) == order_result::ORDER_NOT_FOUND);
+    REQUIRE(fork.modify(factory.id(3), factory.make(3, order_side::BUY, MAX_PRICE + 1, 4)) == order_result::INVALID_PRICE);
+
+    // emptying the best levels walks the touch through base and copied levels alike
+    for (uint64_t n : { 3, 5 }) {
+        REQUIRE(fork.cancel(factory.id(n)) == order_result::SUCCESS);
+    }
+    REQUIRE(fork.level_qty(order_side::BUY, 99) == 0);
+    REQUIRE(fork.best_bid().value() == 98);
+    for (uint64_t n : { 2, 6 }) {
+        REQUIRE(fork.cancel(factory.id(n)) == order_result::SUCCESS);
+    }
+    REQUIRE(fork.best_ask().value() == 102);
+    REQUIRE(base->best_bid().value() == 99);
+    REQUIRE(base->best_ask().value() == 101);
+    REQUIRE(base->order_count() == 30);
+}
+
+TEST_CASE("book_fork: forks of one base are independent", "[fork]")
+{
+    auto base = std::make_unique<orderbook>(nullptr);
+    build(*base);
+
+    book_fork a = base->fork();
+    book_fork b = base->fork();
+    REQUIRE(a.add(factory.make(200, order_side::SELL, 95, 1000)) == order_result::SUCCESS);
+    a.execute();
+    REQUIRE_FALSE(a.best_bid().has_value());
+    REQUIRE(a.best_ask().value() == 95);
+
+    REQUIRE(b.best_bid().value() == 99);
+    REQUIRE(b.order_count() == 30);
+    REQUIRE(b.touched_levels() == 0);
+
+    // forks move like books
+    book_fork c = std::move(a);
+    REQUIRE(c.best_ask().value() == 95);
+    REQUIRE(c.order_count() == 16);
+}
@@ -0,0 +1,279 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/orderbook.h"
+#include "test_orders.h"
+
+// book_memory is process-wide; each case sets the mode it needs and restores SYSTEM.
+struct memory_mode {
+    explicit memory_mode(const book_memory_config_t& c) { book_memory::instance().configure(c); }
+    ~memory_mode() { book_memory::instance().configure({}); }
+};
+
+static const test_orders factory { 'T', "MEMT" };
+
+TEST_CASE("book memory: pooled blocks are aligned, reused and counted", "[book_memory]")
+{
+    book_memory_config_t c;
+    c.pages = page_kind::SMALL;
+    c.reserve_bytes = 1 << 20;
+    memory_mode mode(c);
+
+    book_memory& m = book_memory::instance();
+    book_memory_stats_t before = m.stats();
+    REQUIRE(before.requested == page_kind::SMALL);
+    REQUIRE(before.mapped_bytes >= (1u << 20));
+
+    void* a = m.allocate(100);
+    void* b = m.allocate(100);
+    REQUIRE(reinterpret_cast<uintptr_t>(a) % 16 == 0);
+    REQUIRE(a != b);
+    std::memset(a, 0xAB, 100);
+    REQUIRE(m.stats().in_use_bytes > before.in_use_bytes);
+
+    m.deallocate(a);
+    REQUIRE(m.allocate(110) == a);   // same size class (128 with header) comes back off the free list
+    m.deallocate(a);
+    m.deallocate(b);
+    REQUIRE(m.stats().in_use_bytes == before.in_use_bytes);
+
+    // larger than a chunk: gets its own mapping
+    void* big = m.allocate(8 << 20);
+    std::memset(big, 1, 8 << 20);
+    REQUIRE(m.stats().late_chunks > before.late_chunks);
+    m.deallocate(big);
+}
+
+TEST_CASE("book memory: threads allocate and free through their own caches", "[book_memory]")
+{
+    book_memory_config_t c;
+    c.pages = page_kind::SMALL;
+    c.reserve_bytes = 4 << 20;
+    memory_mode mode(c);
+    book_memory& m = book_memory::instance();
+    book_memory_stats_t before = m.stats();
+
+    // each thread churns its own blocks, and frees half of its neighbour's
+    constexpr int THREADS = 4;
+    constexpr int BLOCKS = 2000;
+    std::vector<std::vector<void*>> blocks(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < 5; round++) {
+                for (int i = 0; i < BLOCKS; i++) {
+                    blocks[ t ].push_back(m.allocate(static_cast<size_t>(32 + (i % 7) * 48)));
+                    std::memset(blocks[ t ].back(), t, 32);
+                }
+                for (int i = 0; i < BLOCKS / 2; i++) {
+                    m.deallocate(blocks[ t ].back());
+                    blocks[ t ].pop_back();
+                }
+            }
+        });
+    }
+    for (std::thread& th : threads) {
+        th.join();
+    }
+    REQUIRE(m.stats().in_use_bytes > before.in_use_bytes);
+    REQUIRE(m.stats().allocations == before.allocations + THREADS * 5 * BLOCKS);
+
+    threads.clear();
+    std::atomic<int> clobbered { 0 };
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t] {
+            for (void* p : blocks[ (t + 1) % THREADS ]) {
+                clobbered += static_cast<unsigned char*>(p)[ 0 ] != static_cast<unsigned char>((t + 1) % THREADS);
+                m.deallocate(p);
+            }
+        });
+    }
+    for (std::thread& th : threads) {
+        th.join();
+    }
+    REQUIRE(clobbered == 0);
+    // the exited threads' caches went back to the pool and their counts were kept
+    REQUIRE(m.stats().in_use_bytes == before.in_use_bytes);
+
+    // and their blocks are handed out again rather than carved
+    uint64_t carved = m.stats().peak_bytes;
+    std::vector<void*> again;
+    for (int i = 0; i < 1000; i++) {
+        again.push_back(m.allocate(80));
+    }
+    REQUIRE(m.stats().peak_bytes == carved);
+    for (void* p : again) {
+        m.deallocate(p);
+    }
+}
+
+TEST_CASE("book memory: only the book's index draws robin_hood tables from the pool", "[book_memory]")
+{
+    book_memory_config_t c;
+    c.pages = page_kind::SMALL;
+    c.reserve_bytes = 4 << 20;
+    memory_mode mode(c);
+
+    {
+        alloc_scope scope;
+        robin_hood::unordered_map<uint64_t, uint64_t> plain;
+        robin_hood::unordered_node_map<uint32_t, std::vector<int>> nodes;
+        for (uint64_t i = 0; i < 5000; i++) {
+            plain[ i ] = i;
+            nodes[ static_cast<uint32_t>(i) ].push_back(1);
+        }
+        REQUIRE(scope.pool_allocations() == 0);
+    }
+
+    auto ob = std::make_unique<orderbook>(nullptr);
+    alloc_scope scope;
+    for (uint64_t n = 1; n <= 5000; n++) {
+        REQUIRE(ob->add(factory.make(n, order_side::BUY, 100, 10)) == order_result::SUCCESS);
+    }
+    REQUIRE(scope.pool_allocations() > 0);
+}
+
+TEST_CASE("book memory: huge pages fall back when the kernel has none", "[book_memory]")
+{
+    page_mapping_t p = map_book_pages(1 << 21, page_kind::HUGE_1G, true, false);
+    REQUIRE(p.base != nullptr);
+    REQUIRE(p.bytes >= (1u << 21));
+    std::memset(p.base, 0, p.bytes);
+    ::munmap(p.base, p.bytes);
+
+    book_memory_config_t c;
+    c.pages = page_kind::HUGE_2M;
+    c.reserve_bytes = 4 << 20;
+    memory_mode mode(c);
+    book_memory_stats_t s = book_memory::instance().stats();
+    REQUIRE(s.chunks >= 1);
+    REQUIRE((s.backing == page_kind::HUGE_2M || s.fallbacks > 0));
+}
+
+TEST_CASE("book memory: books run on pooled transparent huge pages", "[book_memory]")
+{
+    book_memory_config_t c;
+    c.pages = page_kind::TRANSPARENT;
+    c.reserve_bytes = 16 << 20;
+    memory_mode mode(c);
+
+    uint64_t in_use = book_memory::instance().stats().in_use_bytes;
+    {
+        auto ob = std::make_unique<orderbook>(nullptr);
+        REQUIRE(book_memory::instance().stats().in_use_bytes >= in_use + sizeof(orderbook));
+
+        for (uint64_t n = 1; n <= 5000; n++) {
+            REQUIRE(ob->add(factory.make(n, order_side::BUY, static_cast<uint32_t>(100 + n % 50), 10)) == order_result::SUCCESS);
+        }
+        REQUIRE(ob->order_count() == 5000);
+        REQUIRE(ob->best_bid() == 149u);
+        for (uint64_t n = 1; n <= 5000; n += 2) {
+            order_t o = factory.make(n, order_side::BUY, 0, 10);
+            order_id_key key;
+            std::memcpy(key.order_id, o.order_id, ORDER_ID_LEN);
+            REQUIRE(ob->cancel(key) == order_result::SUCCESS);
+        }
+        REQUIRE(ob->order_count() == 2500);
+    }
+    REQUIRE(book_memory::instance().stats().in_use_bytes == in_use);
+}
+
+TEST_CASE("book memory: system mode still frees pooled blocks", "[book_memory]")
+{
+    void* pooled;
+    {
+        book_memory_config_t c;
+        c.pages = page_kind::SMALL;
+        memory_mode mode(c);
+        pooled = book_memory::instance().allocate(256);
+    }
+    REQUIRE(book_memory::instance().config().pages == page_kind::SYSTEM);
+    void* plain = book_memory::instance().allocate(256);
+    book_memory::instance().deallocate(plain);
+    book_memory::instance().deallocate(pooled);
+}
+
+TEST_CASE("book memory: numa pools keep each book on its node", "[book_memory][numa]")
+{
+    book_memory_config_t c;
+    c.numa = true;
+    c.reserve_bytes = 1 << 20;
+    book_memory_stats_t before = book_memory::instance().stats();   // stats are cumulative
+    memory_mode mode(c);
+
+    book_memory& m = book_memory::instance();
+    REQUIRE(m.config().pages == page_kind::SMALL);   // numa needs a pool; SYSTEM is upgraded
+    REQUIRE(m.allocation_node() == current_numa_node());
+
+    int node = current_numa_node();
+    auto book = orderbook::create(NUMA_LOCAL);
+    REQUIRE(book->numa_node() == node);
+    for (uint64_t i = 1; i <= 1000; i++) {
+        REQUIRE(book->add(factory.make(i, i & 1 ? order_side::BUY : order_side::SELL, i & 1 ? 90 : 110, 10)) == order_result::SUCCESS);
+    }
+
+    book_memory_stats_t s = m.stats();
+    size_t n = static_cast<size_t>(node);
+    REQUIRE(s.node_mapped_bytes[ n ] - before.node_mapped_bytes[ n ] == s.mapped_bytes - before.mapped_bytes);
+    REQUIRE(s.numa_bind_failures == before.numa_bind_failures);
+
+    // every pooled page the book touched is resident on its node
+    std::vector<uint64_t> per_node;
+    std::vector<page_mapping_t> maps = m.mappings();
+    for (size_t i = 0; i < maps.size(); i++) {
+        const page_mapping_t& p = maps[ i ];
+        if (p.node == NUMA_LOCAL) {
+            continue;   // mapped by earlier cases without numa
+        }
+        REQUIRE(p.node == node);
+        numa_page_nodes(p.base, p.bytes, page_bytes(p.kind), per_node);
+    }
+    REQUIRE(per_node.size() > n);
+    uint64_t elsewhere = 0;
+    for (size_t k = 0; k < per_node.size(); k++) {
+        elsewhere += k == n ? 0 : per_node[ k ];
+    }
+    REQUIRE(per_node[ n ] > 0);
+    REQUIRE(elsewhere == 0);
+}
+
+TEST_CASE("book memory: node_scope routes allocations and nests", "[book_memory][numa]")
+{
+    book_memory_config_t c;
+    c.numa = true;
+    memory_mode mode(c);
+    book_memory& m = book_memory::instance();
+
+    {
+        book_memory::node_scope outer(0);
+        REQUIRE(m.allocation_node() == 0);
+        {
+            book_memory::node_scope unset(NUMA_LOCAL);   // leaves the outer choice alone
+            REQUIRE(m.allocation_node() == 0);
+        }
+        void* p = m.allocate(64);
+        REQUIRE(m.stats().node_mapped_bytes[ 0 ] > 0);
+        m.deallocate(p);
+    }
+    REQUIRE(m.allocation_node() == current_numa_node());
+
+    // a node beyond MAX_NUMA_NODES shares the unbound pool rather than failing
+    book_memory::node_scope far(MAX_NUMA_NODES + 3);
+    void* q = m.allocate(64);
+    std::memset(q, 0, 64);
+    m.deallocate(q);
+}
+
+TEST_CASE("numa: topology helpers agree with the running CPU", "[numa]")
+{
+    int nodes = numa_node_count();
+    REQUIRE(nodes >= 1);
+    REQUIRE(current_numa_node() >= 0);
+    REQUIRE(current_numa_node() < nodes);
+    REQUIRE(numa_node_of_cpu(-1) == 0);
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "../src/flow_driver.h"
+#include "../src/flow_generator.h"
+#include "../src/orderbook.h"
+
+TEST_CASE("flow_generator: same seed produces the same stream", "[flow]")
+{
+    flow_config_t config;
+    config.seed = 42;
+
+    std::vector<flow_msg_t> a, b;
+    flow_generator(config).generate(20000, a);
+    flow_generator(config).generate(20000, b);
+
+    REQUIRE(a.size() == b.size());
+    REQUIRE(std::memcmp(a.data(), b.data(), a.size() * sizeof(flow_msg_t)) == 0);
+
+    config.seed = 43;
+    std::vector<flow_msg_t> c;
+    flow_generator(config).generate(20000, c);
+    REQUIRE(std::memcmp(a.data(), c.data(), a.size() * sizeof(flow_msg_t)) != 0);
+}
+
+TEST_CASE("flow_generator: mix follows the configured weights", "[flow]")
+{
+    flow_config_t config;
+    config.target_live_orders = 1000;
+
+    std::vector<flow_msg_t> msgs;
+    flow_generator gen(config);
+    gen.generate(100000, msgs);
+
+    // shares are measured once the book has filled to its target depth
+    size_t counts[3] = {};
+    for (size_t i = 0; i < msgs.size(); i++) {
+        const flow_msg_t& m = msgs[i];
+        REQUIRE(m.kind < 3);
+        REQUIRE(m.order.price >= config.min_price);
+        REQUIRE(m.order.price <= config.max_price);
+        if (i >= msgs.size() / 2) {
+            counts[m.kind]++;
+        }
+    }
+    double total = config.add_weight + config.aggressive_weight + config.cancel_weight + config.modify_weight;
+    double measured = static_cast<double>(msgs.size() - msgs.size() / 2);
+    auto share = [&](flow_msg_kind kind) { return counts[static_cast<int>(kind)] / measured; };
+    auto near = [](double observed, double expected) { return observed > expected - 0.02 && observed < expected + 0.02; };
+
+    REQUIRE(near(share(flow_msg_kind::ADD), (config.add_weight + config.aggressive_weight) / total));
+    REQUIRE(near(share(flow_msg_kind::CANCEL), config.cancel_weight / total));
+    REQUIRE(near(share(flow_msg_kind::MODIFY), config.modify_weight / total));
+    REQUIRE(share(flow_msg_kind::CANCEL) + share(flow_msg_kind::MODIFY) > 0.88);
+    REQUIRE(gen.live_orders() < 3 * config.target_live_orders);
+}
+
+TEST_CASE("flow_generator: file round trip and replay through orderbook", "[flow]")
+{
+    const char* path = "test_flow_generator.bin";
+    flow_config_t config;
+    config.seed = 7;
+
+    std::vector<flow_msg_t> msgs;
+    flow_generator(config).generate(5000, msgs);
+    write_flow_file(path, config, msgs);
+
+    std::vector<flow_msg_t> loaded = read_flow_file(path);
+    std::remove(path);
+    REQUIRE(loaded.size() == msgs.size());
+    REQUIRE(std::memcmp(loaded.data(), msgs.data(), msgs.size() * sizeof(flow_msg_t)) == 0);
+
+    auto ob = std::make_unique<orderbook>(nullptr);
+    size_t callbacks = 0;
+    flow_run_stats_t stats = drive_flow(*ob, loaded.data(), loaded.size(),
+        [&](flow_msg_kind, uint64_t, order_result) { callbacks++; });
+
+    REQUIRE(stats.messages == loaded.size());
+    REQUIRE(callbacks == loaded.size());
+    REQUIRE(stats.rejected < stats.messages);
+}
@@ -0,0 +1,183 @@
+#include <catch2/catch_all.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/gateway.h"
+
+/**
+ * Blocking loopback client that collects whole reply frames.
+ */
+class test_session {
+public:
+    explicit test_session(uint16_t port) {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        REQUIRE(::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    }
+
+    ~test_session() { ::close(fd_); }
+
+    template <typename msg_t>
+    void send(const msg_t& m) {
+        REQUIRE(::send(fd_, &m, sizeof(m), 0) == static_cast<ssize_t>(sizeof(m)));
+    }
+
+    void send_raw(const void* data, size_t len) {
+        REQUIRE(::send(fd_, data, len, 0) == static_cast<ssize_t>(len));
+    }
+
+    void enter(uint64_t token, char side, uint32_t qty, uint32_t price) {
+        auto m = ouch::make<ouch::enter_order_t>(ouch::ENTER_ORDER);
+        m.token = token;
+        m.side = side;
+        m.qty = qty;
+        std::memcpy(m.ticker, "TEST", TICKER_LEN);
+        m.price = price;
+        send(m);
+    }
+
+    // next reply frame (type + bytes)
+    std::vector<char> next() {
+        while (true) {
+            if (buf_.size() >= sizeof(ouch::msg_header_t)) {
+                ouch::msg_header_t h;
+                std::memcpy(&h, buf_.data(), sizeof(h));
+                if (buf_.size() >= h.length) {
+                    std::vector<char> msg(buf_.begin(), buf_.begin() + h.length);
+                    buf_.erase(buf_.begin(), buf_.begin() + h.length);
+                    return msg;
+                }
+            }
+            char tmp[512];
+            ssize_t n = ::recv(fd_, tmp, sizeof(tmp), 0);
+            if (n <= 0) {
+                return {};
+            }
+            buf_.insert(buf_.end(), tmp, tmp + n);
+        }
+    }
+
+    template <typename msg_t>
+    msg_t next_as(char type) {
+        std::vector<char> raw = next();
+        REQUIRE(raw.size() == sizeof(msg_t));
+        msg_t m;
+        std::memcpy(&m, raw.data(), sizeof(m));
+        REQUIRE(m.header.type == type);
+        return m;
+    }
+
+private:
+    int fd_ = -1;
+    std::vector<char> buf_;
+};
+
+struct running_gateway {
+    std::unique_ptr<gateway> gw = std::make_unique<gateway>();
+    std::atomic<bool> stop{false};
+    std::thread loop{[this] { gw->run(stop); }};
+
+    ~running_gateway() {
+        stop.store(true);
+        loop.join();
+    }
+};
+
+TEST_CASE("gateway: accepts, executes and cancels across sessions", "[gateway]")
+{
+    running_gateway g;
+    test_session buyer(g.gw->port());
+    test_session seller(g.gw->port());
+
+    buyer.enter(1, ouch::SIDE_BUY, 100, 500);
+    auto ack = buyer.next_as<ouch::accepted_t>(ouch::ACCEPTED);
+    REQUIRE(ack.token == 1);
+
+    // same token on another session is a different order
+    seller.enter(1, ouch::SIDE_SELL, 30, 499);
+    REQUIRE(seller.next_as<ouch::accepted_t>(ouch::ACCEPTED).token == 1);
+
+    auto sell_fill = seller.next_as<ouch::executed_t>(ouch::EXECUTED);
+    REQUIRE(sell_fill.qty == 30);
+    REQUIRE(sell_fill.price == 500);   // resting bid's price
+
+    auto buy_fill = buyer.next_as<ouch::executed_t>(ouch::EXECUTED);
+    REQUIRE(buy_fill.token == 1);
+    REQUIRE(buy_fill.qty == 30);
+    REQUIRE(buy_fill.match_number == sell_fill.match_number);
+
+    auto replace = ouch::make<ouch::replace_order_t>(ouch::REPLACE_ORDER);
+    replace.token = 1;
+    std::memcpy(replace.ticker, "TEST", TICKER_LEN);
+    replace.qty = 50;
+    replace.price = 490;
+    buyer.send(replace);
+    auto replaced = buyer.next_as<ouch::replaced_t>(ouch::REPLACED);
+    REQUIRE(replaced.qty == 50);
+
+    auto cancel = ouch::make<ouch::cancel_order_t>(ouch::CANCEL_ORDER);
+    cancel.token = 1;
+    std::memcpy(cancel.ticker, "TEST", TICKER_LEN);
+    buyer.send(cancel);
+    REQUIRE(buyer.next_as<ouch::canceled_t>(ouch::CANCELED).token == 1);
+
+    buyer.send(cancel);
+    auto rej = buyer.next_as<ouch::rejected_t>(ouch::REJECTED);
+    REQUIRE(rej.reason == static_cast<uint8_t>(order_result::ORDER_NOT_FOUND));
+
+    buyer.enter(2, 'Z', 1, 1);
+    REQUIRE(buyer.next_as<ouch::rejected_t>(ouch::REJECTED).reason ==
+            static_cast<uint8_t>(order_result::INVALID_SIDE));
+}
+
+TEST_CASE("gateway: pipelined frames split across writes", "[gateway]")
+{
+    running_gateway g;
+    test_session s(g.gw->port());
+
+    std::vector<char> stream;
+    for (uint64_t t = 1; t <= 200; t++) {
+        auto m = ouch::make<ouch::enter_order_t>(ouch::ENTER_ORDER);
+        m.token = t;
+        m.side = ouch::SIDE_BUY;
+        m.qty = 1;
+        std::memcpy(m.ticker, "PIPE", TICKER_LEN);
+        m.price = static_cast<uint32_t>(t);
+        const char* p = reinterpret_cast<const char*>(&m);
+        stream.insert(stream.end(), p, p + sizeof(m));
+    }
+    // odd-sized chunks so frames straddle recv() boundaries
+    for (size_t off = 0; off < stream.size(); off += 37) {
+        s.send_raw(stream.data() + off, std::min<size_t>(37, stream.size() - off));
+    }
+
+    for (uint64_t t = 1; t <= 200; t++) {
+        REQUIRE(s.next_as<ouch::accepted_t>(ouch::ACCEPTED).token == t);
+    }
+}
+
+TEST_CASE("gateway: malformed frame closes the session", "[gateway]")
+{
+    running_gateway g;
+    test_session s(g.gw->port());
+
+    ouch::msg_header_t bad { 5, 'O' };
+    char frame[5] = {};
+    std::memcpy(frame, &bad, sizeof(bad));
+    s.send_raw(frame, sizeof(frame));
+
+    REQUIRE(s.next().empty());
+}
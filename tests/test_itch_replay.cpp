@@ -0,0 +1,193 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/itch_replay.h"
+
+/**
+ * Builds ITCH 5.0 frames ([be16 length][message]) in memory.
+ */
+class itch_writer {
+public:
+    std::string data;
+
+    void stock_directory(uint16_t locate, const char* stock) {
+        std::string m = header('R', locate, 0);
+        put_alpha(m, stock, 8);
+        m.append(39 - m.size(), ' ');
+        frame(m);
+    }
+
+    void add(uint16_t locate, uint64_t ref, char side, uint32_t shares, const char* stock, uint32_t price, bool mpid = false) {
+        std::string m = header(mpid ? 'F' : 'A', locate, 1000);
+        put(m, ref, 8);
+        m.push_back(side);
+        put(m, shares, 4);
+        put_alpha(m, stock, 8);
+        put(m, price, 4);
+        if (mpid) {
+            put_alpha(m, "MPID", 4);
+        }
+        frame(m);
+    }
+
+    void executed(uint16_t locate, uint64_t ref, uint32_t shares) {
+        std::string m = header('E', locate, 2000);
+        put(m, ref, 8);
+        put(m, shares, 4);
+        put(m, 77, 8);
+        frame(m);
+    }
+
+    void cancel(uint16_t locate, uint64_t ref, uint32_t shares) {
+        std::string m = header('X', locate, 3000);
+        put(m, ref, 8);
+        put(m, shares, 4);
+        frame(m);
+    }
+
+    void remove(uint16_t locate, uint64_t ref) {
+        std::string m = header('D', locate, 4000);
+        put(m, ref, 8);
+        frame(m);
+    }
+
+    void replace(uint16_t locate, uint64_t old_ref, uint64_t new_ref, uint32_t shares, uint32_t price) {
+        std::string m = header('U', locate, 5000);
+        put(m, old_ref, 8);
+        put(m, new_ref, 8);
+        put(m, shares, 4);
+        put(m, price, 4);
+        frame(m);
+    }
+
+    void system_event() {
+        std::string m = header('S', 0, 0);
+        m.push_back('O');
+        frame(m);
+    }
+
+private:
+    static void put(std::string& m, uint64_t v, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) {
+            m.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+        }
+    }
+
+    static void put_alpha(std::string& m, const char* s, size_t len) {
+        size_t n = std::strlen(s);
+        for (size_t i = 0; i < len; i++) {
+            m.push_back(i < n ? s[i] : ' ');
+        }
+    }
+
+    static std::string header(char type, uint16_t locate, uint64_t ts) {
+        std::string m(1, type);
+        put(m, locate, 2);
+        put(m, 0, 2);
+        put(m, ts, 6);
+        return m;
+    }
+
+    void frame(const std::string& m) {
+        put(data, m.size(), 2);
+        data += m;
+    }
+};
+
+TEST_CASE("itch_replayer: maps order messages onto the book", "[itch]")
+{
+    itch_writer w;
+    w.system_event();
+    w.stock_directory(7, "AAPL");
+    w.add(7, 1, 'B', 100, "AAPL", 1500000);        // $150.00 -> 15000
+    w.add(7, 2, 'S', 200, "AAPL", 1501000, true);  // F message
+    w.add(7, 3, 'B', 50, "AAPL", 1499000);
+    w.executed(7, 1, 40);
+    w.cancel(7, 2, 50);
+    w.remove(7, 3);
+    w.replace(7, 2, 4, 120, 1502000);
+    w.executed(7, 99, 1);                           // unknown ref
+
+    itch_replayer replayer;
+    itch_replay_stats_t stats = replayer.replay(w.data.data(), w.data.size());
+
+    REQUIRE(stats.messages == 10);
+    REQUIRE(stats.book_messages == 8);
+    REQUIRE(stats.applied == 7);
+    REQUIRE(stats.unknown_order == 1);
+    REQUIRE(stats.truncated == 0);
+    REQUIRE(stats.books == 1);
+    REQUIRE(stats.count[static_cast<size_t>(itch_kind::ADD)] == 3);
+    REQUIRE(stats.latency[static_cast<size_t>(itch_kind::ADD)].count() == 3);
+
+    orderbook* ob = replayer.book(7);
+    REQUIRE(ob != nullptr);
+    REQUIRE(replayer.book("AAPL") == ob);
+
+    REQUIRE(ob->best_bid() == 15000);
+    REQUIRE(ob->level_qty(order_side::BUY, 15000) == 60);
+    REQUIRE(!ob->contains(itch_replayer::key_for(3)));
+
+    REQUIRE(!ob->contains(itch_replayer::key_for(2)));
+    REQUIRE(ob->contains(itch_replayer::key_for(4)));
+    REQUIRE(ob->best_ask() == 15020);
+    REQUIRE(ob->level_qty(order_side::SELL, 15020) == 120);
+    REQUIRE(ob->level_qty(order_side::SELL, 15010) == 0);
+}
+
+TEST_CASE("itch_replayer: symbol filter, price range and truncated frames", "[itch]")
+{
+    itch_writer w;
+    w.add(1, 10, 'B', 100, "MSFT", 3000000);   // $300 -> 30000, beyond MAX_PRICE
+    w.add(1, 11, 'B', 100, "MSFT", 1000000);
+    w.add(2, 20, 'S', 100, "IBM", 1000000);
+    w.executed(1, 10, 10);                       // its add was rejected
+    w.executed(2, 20, 10);                       // filtered symbol
+    w.data.push_back('\0');                      // half a length prefix
+
+    itch_replay_options_t options;
+    options.symbols = { "MSFT" };
+    itch_replayer replayer(options);
+    itch_replay_stats_t stats = replayer.replay(w.data.data(), w.data.size());
+
+    REQUIRE(stats.messages == 5);
+    REQUIRE(stats.book_messages == 3);
+    REQUIRE(stats.rejected == 1);
+    REQUIRE(stats.unknown_order == 1);
+    REQUIRE(stats.truncated == 1);
+    REQUIRE(replayer.book(2) == nullptr);
+    REQUIRE(replayer.book(1)->order_count() == 1);
+}
+
+TEST_CASE("itch_replayer: replays an mmap'ed file", "[itch]")
+{
+    const char* path = "test_itch_replay.itch";
+    itch_writer w;
+    for (uint64_t i = 1; i <= 1000; i++) {
+        w.add(3, i, (i & 1) ? 'B' : 'S', 10, "QQQ", (i & 1) ? 990000 : 1010000);
+    }
+    for (uint64_t i = 1; i <= 1000; i += 2) {
+        w.remove(3, i);
+    }
+
+    std::FILE* f = std::fopen(path, "wb");
+    REQUIRE(f != nullptr);
+    std::fwrite(w.data.data(), 1, w.data.size(), f);
+    std::fclose(f);
+
+    itch_replayer replayer;
+    itch_replay_stats_t stats = replayer.replay_file(path);
+    std::remove(path);
+
+    REQUIRE(stats.messages == 1500);
+    REQUIRE(stats.applied == 1500);
+    REQUIRE(stats.messages_per_sec() > 0);
+    REQUIRE(replayer.book(3)->order_count() == 500);
+    REQUIRE(!replayer.book(3)->best_bid().has_value());
+    REQUIRE(replayer.book(3)->best_ask() == 10100);
+}
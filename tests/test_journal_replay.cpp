@@ -0,0 +1,372 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../includes/logger.h"
+#include "../src/orderbook.h"
+#include "../src/journal_replay.h"
+#include "test_orders.h"
+
+/**
+ * Drives a live book through a seeded mix of add/modify/cancel/execute.
+ * Returns every ID ever used so the replayed book can be probed.
+ */
+static std::vector<order_id_key> drive_book(orderbook& ob, const char* ticker, char prefix, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<order_id_key> ids;
+
+    for (uint64_t n = 0; n < 3000; n++) {
+        int action = static_cast<int>(rng() % 10);
+
+        if (action < 5 || ids.empty()) {
+            order_id_key k = make_test_id(prefix, n);
+            order_side side = (rng() % 2) ? order_side::BUY : order_side::SELL;
+            uint32_t price = side == order_side::BUY ? 990 + rng() % 15 : 1000 + rng() % 15;
+            order_t o(n, k.order_id, ticker, order_kind::LMT, side, order_status::NEW, price, 1 + rng() % 50, false);
+            if (ob.add(o) == order_result::SUCCESS) {
+                ids.push_back(k);
+            }
+        } else if (action < 7) {
+            const order_id_key& k = ids[ rng() % ids.size() ];
+            order_side side = (rng() % 2) ? order_side::BUY : order_side::SELL;
+            uint32_t price = side == order_side::BUY ? 990 + rng() % 15 : 1000 + rng() % 15;
+            order_t o(n, k.order_id, ticker, order_kind::LMT, side, order_status::NEW, price, 1 + rng() % 50, false);
+            ob.modify(k, o);
+        } else if (action < 9) {
+            ob.cancel(ids[ rng() % ids.size() ]);
+        } else {
+            ob.execute();
+        }
+    }
+    ob.execute();
+    return ids;
+}
+
+static void require_same_book(const orderbook& live, const orderbook& replayed, const std::vector<order_id_key>& ids)
+{
+    REQUIRE(live.order_count() == replayed.order_count());
+    REQUIRE(live.best_bid() == replayed.best_bid());
+    REQUIRE(live.best_ask() == replayed.best_ask());
+
+    for (uint32_t p = 0; p <= MAX_PRICE; p++) {
+        REQUIRE(live.level_qty(order_side::BUY, p) == replayed.level_qty(order_side::BUY, p));
+        REQUIRE(live.level_qty(order_side::SELL, p) == replayed.level_qty(order_side::SELL, p));
+    }
+    for (const auto& k : ids) {
+        REQUIRE(live.contains(k) == replayed.contains(k));
+    }
+}
+
+/**
+ * The level records of a snapshot image, keyed by side and price, as raw bytes.
+ */
+static std::map<std::pair<uint8_t, uint32_t>, std::string> level_records(const std::vector<char>& image)
+{
+    std::map<std::pair<uint8_t, uint32_t>, std::string> records;
+    snapshot_header_t header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    const char* cursor = image.data() + sizeof(header);
+    for (uint32_t l = 0; l < header.level_count; l++) {
+        snapshot_level_t lvl;
+        std::memcpy(&lvl, cursor, sizeof(lvl));
+        size_t bytes = sizeof(lvl) + lvl.order_count * sizeof(order_t);
+        records[{ uint8_t(lvl.side), uint32_t(lvl.price) }] = std::string(cursor, bytes);
+        cursor += bytes;
+    }
+    REQUIRE(cursor == image.data() + image.size());
+    return records;
+}
+
+static void round_trip(log_format format, const std::string& path, size_t threads)
+{
+    std::unique_ptr<orderbook> book_a, book_b;
+    std::vector<order_id_key> ids_a, ids_b;
+
+    {
+        logger_config_t cfg;
+        cfg.format = format;
+        logger log(path, cfg);
+
+        // heap-allocated so the live state outlives the logger, which flushes on destruction
+        book_a = std::make_unique<orderbook>(&log);
+        book_b = std::make_unique<orderbook>(&log);
+        ids_a = drive_book(*book_a, "AAAA", 'A', 7);
+        ids_b = drive_book(*book_b, "BBBB", 'B', 11);
+    }
+
+    REQUIRE(book_a->order_count() > 0);
+    REQUIRE(book_b->order_count() > 0);
+
+    replay_options_t opts;
+    opts.threads = threads;
+    journal_replayer replayer(opts);
+    replay_stats_t stats = replayer.replay_file(path);
+
+    REQUIRE(stats.books == 2);
+    REQUIRE(stats.applied == stats.records);
+    REQUIRE(stats.last_sequence == stats.records);
+
+    REQUIRE(replayer.book("AAAA") != nullptr);
+    REQUIRE(replayer.book("BBBB") != nullptr);
+    require_same_book(*book_a, *replayer.book("AAAA"), ids_a);
+    require_same_book(*book_b, *replayer.book("BBBB"), ids_b);
+}
+
+TEST_CASE("journal_replayer: binary journal rebuilds identical books", "[journal][replay]")
+{
+    round_trip(log_format::BINARY, "../logs/test_journal_replay.bin", 1);
+}
+
+TEST_CASE("journal_replayer: text journal rebuilds identical books", "[journal][replay]")
+{
+    round_trip(log_format::TEXT, "../logs/test_journal_replay.log", 1);
+}
+
+TEST_CASE("journal_replayer: text journal keeps IDs holding any byte", "[journal][replay]")
+{
+    const std::string path = "../logs/test_journal_replay_binary_ids.log";
+    std::vector<order_id_key> ids;
+    {
+        logger log(path);   // default config writes text
+        orderbook ob(&log);
+        for (int i = 0; i < 20; i++) {
+            // 'A', i covers NUL, newline (0x0a) and carriage return (0x0d)
+            order_id_key k{};
+            k.order_id[0] = 'A';
+            k.order_id[1] = static_cast<char>(i);
+            order_t o(i, k.order_id, "BINI", order_kind::LMT, order_side::BUY, order_status::NEW,
+                      900 + i, 10, false);
+            REQUIRE(ob.add(o) == order_result::SUCCESS);
+            ids.push_back(k);
+        }
+    }
+
+    journal_replayer replayer;
+    replay_stats_t stats = replayer.replay_file(path);
+
+    REQUIRE(stats.records == 20);
+    REQUIRE(stats.malformed == 0);
+    orderbook* book = replayer.book("BINI");
+    REQUIRE(book != nullptr);
+    REQUIRE(book->order_count() == 20);
+    for (const auto& k : ids) {
+        REQUIRE(book->contains(k));
+    }
+}
+
+TEST_CASE("journal_replayer: a malformed text line fails replay unless allowed", "[journal][replay]")
+{
+    const std::string path = "../logs/test_journal_replay_malformed.log";
+    {
+        logger log(path);
+        orderbook ob(&log);
+        order_id_key k = make_test_id('M', 1);
+        order_t o(1, k.order_id, "MALF", order_kind::LMT, order_side::BUY, order_status::NEW, 900, 10, false);
+        REQUIRE(ob.add(o) == order_result::SUCCESS);
+    }
+    {
+        std::ofstream out(path, std::ios::app);
+        out << "TIMESTAMP=2 KIND=0 PRICE=901\n";
+    }
+
+    journal_replayer strict;
+    REQUIRE_THROWS(strict.replay_file(path));
+
+    replay_options_t opts;
+    opts.allow_malformed = true;
+    journal_replayer lenient(opts);
+    replay_stats_t stats = lenient.replay_file(path);
+    REQUIRE(stats.records == 1);
+    REQUIRE(stats.malformed == 1);
+}
+
+TEST_CASE("journal_replayer: sharded replay matches single-threaded", "[journal][replay]")
+{
+    // force the parallel path regardless of journal size
+    std::vector<journal_record_t> records;
+    for (uint64_t n = 0; n < (1 << 17); n++) {
+        journal_record_t rec{};
+        rec.sequence = n + 1;
+        rec.kind = static_cast<uint8_t>(n % 3 == 2 ? log_event_kind::CANCEL : log_event_kind::ADD);
+        rec.side = static_cast<uint8_t>(n % 2 ? order_side::SELL : order_side::BUY);
+        char ticker[4] = { 'S', 'Y', 'M', static_cast<char>('A' + n % 8) };
+        std::memcpy(rec.ticker, ticker, TICKER_LEN);
+        order_id_key id = make_test_id('P', n % 3 == 2 ? n - 2 : n);
+        std::memcpy(rec.order_id, id.order_id, ORDER_ID_LEN);
+        rec.price = static_cast<uint32_t>(rec.side == static_cast<uint8_t>(order_side::BUY) ? 900 : 1100) + n % 50;
+        rec.qty = 1 + n % 9;
+        records.push_back(rec);
+    }
+
+    replay_options_t serial_opts;
+    serial_opts.threads = 1;
+    journal_replayer serial(serial_opts);
+    serial.replay(records.data(), records.size());
+
+    replay_options_t parallel_opts;
+    parallel_opts.threads = 4;
+    journal_replayer parallel(parallel_opts);
+    replay_stats_t stats = parallel.replay(records.data(), records.size());
+
+    REQUIRE(stats.threads == 4);
+    REQUIRE(stats.books == 8);
+    for (auto& [key, book] : serial.books()) {
+        char ticker[4];
+        std::memcpy(ticker, &key, TICKER_LEN);
+        orderbook* other = parallel.book(ticker);
+        REQUIRE(other != nullptr);
+        REQUIRE(book->order_count() == other->order_count());
+        REQUIRE(book->best_bid() == other->best_bid());
+        REQUIRE(book->best_ask() == other->best_ask());
+    }
+}
+
+TEST_CASE("orderbook: snapshot round trip preserves levels and priority", "[snapshot]")
+{
+    auto live = std::make_unique<orderbook>(nullptr);
+    std::vector<order_id_key> ids = drive_book(*live, "SNAP", 'S', 23);
+    REQUIRE(live->order_count() > 0);
+
+    std::vector<char> image;
+    live->capture_snapshot("SNAP", image);
+
+    auto loaded = std::make_unique<orderbook>(nullptr);
+    loaded->load_snapshot(image.data(), image.size());
+    require_same_book(*live, *loaded, ids);
+
+    // priority is preserved: the same aggressive order fills the same resting orders
+    order_id_key id = make_test_id('X', 1);
+    order_t sweep(1, id.order_id, "SNAP", order_kind::LMT, order_side::SELL, order_status::NEW, 990, 40, false);
+    REQUIRE(live->add(sweep) == order_result::SUCCESS);
+    REQUIRE(loaded->add(sweep) == order_result::SUCCESS);
+    live->execute();
+    loaded->execute();
+    require_same_book(*live, *loaded, ids);
+
+    // a second load into a non-empty book is refused
+    REQUIRE_THROWS(loaded->load_snapshot(image.data(), image.size()));
+}
+
+TEST_CASE("orderbook: a stepped snapshot is the book as it stood when it began", "[snapshot]")
+{
+    auto live = std::make_unique<orderbook>(nullptr);
+    std::vector<order_id_key> ids = drive_book(*live, "STEP", 'S', 41);
+    REQUIRE(live->order_count() > 0);
+
+    std::vector<char> expected;
+    live->capture_snapshot("STEP", expected);
+
+    std::vector<char> image;
+    live->begin_snapshot("STEP", image);
+    REQUIRE(live->snapshot_in_progress());
+    REQUIRE_THROWS(live->begin_snapshot("STEP", image));
+
+    // trade between steps: every kind of change, on levels both copied and not yet copied
+    std::mt19937 rng(43);
+    size_t steps = 0;
+    uint64_t n = 0;
+    while (!live->snapshot_step(32)) {
+        steps++;
+        for (int i = 0; i < 4; i++, n++) {
+            order_side side = (rng() % 2) ? order_side::BUY : order_side::SELL;
+            uint32_t price = side == order_side::BUY ? 990 + rng() % 15 : 1000 + rng() % 15;
+            switch (rng() % 5) {
+                case 0: {
+                    order_id_key id = make_test_id('N', n);
+                    order_t o(n, id.order_id, "STEP", order_kind::LMT, side, order_status::NEW, price, 1 + rng() % 50, false);
+                    live->add(o);
+                    break;
+                }
+                case 1: {
+                    const order_id_key& k = ids[ rng() % ids.size() ];
+                    order_t o(n, k.order_id, "STEP", order_kind::LMT, side, order_status::NEW, price, 1 + rng() % 50, false);
+                    live->modify(k, o);
+                    break;
+                }
+                case 2:
+                    live->cancel(ids[ rng() % ids.size() ]);
+                    break;
+                case 3:
+                    live->reduce(ids[ rng() % ids.size() ], 1);
+                    break;
+                default:
+                    live->execute();
+            }
+        }
+    }
+    REQUIRE(steps > 1);
+    REQUIRE_FALSE(live->snapshot_in_progress());
+
+    // same levels with the same queues, whatever order they were copied in
+    REQUIRE(std::memcmp(image.data(), expected.data(), sizeof(snapshot_header_t)) == 0);
+    REQUIRE(level_records(image) == level_records(expected));
+
+    auto loaded = std::make_unique<orderbook>(nullptr);
+    auto reference = std::make_unique<orderbook>(nullptr);
+    loaded->load_snapshot(image.data(), image.size());
+    reference->load_snapshot(expected.data(), expected.size());
+    require_same_book(*reference, *loaded, ids);
+}
+
+TEST_CASE("orderbook: load_snapshot rejects corrupt level records", "[snapshot]")
+{
+    auto live = std::make_unique<orderbook>(nullptr);
+    drive_book(*live, "BAD0", 'B', 47);
+    std::vector<char> image;
+    live->capture_snapshot("BAD0", image);
+
+    // an order count that would wrap when scaled to bytes, and an empty level
+    for (uint64_t bad_count : { UINT64_MAX / sizeof(order_t) + 2, uint64_t(0) }) {
+        std::vector<char> corrupt = image;
+        char* level_at = corrupt.data() + sizeof(snapshot_header_t);
+        snapshot_level_t first;
+        std::memcpy(&first, level_at, sizeof(first));
+        first.order_count = bad_count;
+        std::memcpy(level_at, &first, sizeof(first));
+
+        auto loaded = std::make_unique<orderbook>(nullptr);
+        REQUIRE_THROWS(loaded->load_snapshot(corrupt.data(), corrupt.size()));
+    }
+}
+
+TEST_CASE("journal_replayer: snapshot plus journal tail recovers the book", "[snapshot][replay]")
+{
+    const std::string journal_path = "../logs/test_snapshot_tail.bin";
+    const std::string snapshot_path = "../logs/test_snapshot_tail.snap";
+
+    std::unique_ptr<orderbook> live;
+    std::vector<order_id_key> ids, tail_ids;
+    uint64_t snapshot_sequence = 0;
+
+    {
+        logger_config_t cfg;
+        cfg.format = log_format::BINARY;
+        logger log(journal_path, cfg);
+
+        live = std::make_unique<orderbook>(&log);
+        ids = drive_book(*live, "TAIL", 'T', 31);
+
+        std::vector<char> image;
+        live->capture_snapshot("TAIL", image);
+        snapshot_sequence = live->last_sequence();
+        write_snapshot_file(snapshot_path, image);
+
+        tail_ids = drive_book(*live, "TAIL", 'U', 37);
+    }
+    ids.insert(ids.end(), tail_ids.begin(), tail_ids.end());
+
+    journal_replayer replayer;
+    REQUIRE(replayer.load_snapshot_file(snapshot_path) == snapshot_sequence);
+    replay_stats_t stats = replayer.replay_file(journal_path);
+
+    REQUIRE(stats.applied < stats.records);
+    REQUIRE(replayer.book("TAIL") != nullptr);
+    require_same_book(*live, *replayer.book("TAIL"), ids);
+}
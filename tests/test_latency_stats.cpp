@@ -0,0 +1,110 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "../includes/latency_histogram.h"
+#include "../src/orderbook.h"
+#include "test_orders.h"
+
+static const test_orders factory { 'L', "LATS" };
+
+TEST_CASE("latency_histogram: bucket bounds are contiguous and bounded", "[latency]")
+{
+    for (size_t i = 0; i + 1 < LATENCY_BUCKETS; i++) {
+        REQUIRE(latency_bucket_upper(i) + 1 == latency_bucket_lower(i + 1));
+        REQUIRE(latency_bucket(latency_bucket_lower(i)) == i);
+        REQUIRE(latency_bucket(latency_bucket_upper(i)) == i);
+    }
+
+    // relative bucket width stays within 1/16
+    for (uint64_t v : {17ULL, 1000ULL, 123456ULL, 987654321ULL}) {
+        size_t b = latency_bucket(v);
+        double width = static_cast<double>(latency_bucket_upper(b) - latency_bucket_lower(b) + 1);
+        REQUIRE(width / static_cast<double>(v) <= 1.0 / 16.0);
+    }
+
+    REQUIRE(latency_bucket(~0ULL) == LATENCY_BUCKETS - 1);
+}
+
+TEST_CASE("latency_histogram: percentiles from recorded values", "[latency]")
+{
+    auto h = std::make_unique<latency_histogram>();
+    for (uint64_t v = 1; v <= 1000; v++) {
+        h->record(v);
+    }
+
+    latency_histogram_snapshot snap;
+    h->snapshot(snap);
+    REQUIRE(snap.count() == 1000);
+    REQUIRE(snap.sum == 500500);
+
+    uint64_t p50 = snap.value_at(0.5);
+    REQUIRE(p50 >= 500);
+    REQUIRE(p50 <= 500 + 500 / 16);
+    REQUIRE(snap.max() >= 1000);
+    REQUIRE(snap.max() <= 1000 + 1000 / 16);
+}
+
+TEST_CASE("orderbook: latency stats per operation and result code", "[latency]")
+{
+    auto ob = std::make_unique<orderbook>(nullptr);
+    REQUIRE(ob->latency_stats() != nullptr);
+
+    REQUIRE(ob->add(factory.make(1, order_side::BUY, 100, 10)) == order_result::SUCCESS);
+    REQUIRE(ob->add(factory.make(1, order_side::BUY, 100, 10)) == order_result::DUPLICATE_ID);
+    REQUIRE(ob->add(factory.make(2, order_side::SELL, 101, 10)) == order_result::SUCCESS);
+    REQUIRE(ob->cancel(factory.id(99)) == order_result::ORDER_NOT_FOUND);
+    REQUIRE(ob->modify(factory.id(2), factory.make(2, order_side::SELL, 100, 5)) == order_result::SUCCESS);
+    ob->execute();
+    ob->execute();
+
+    auto snap = std::make_unique<orderbook_latency_snapshot>();
+    ob->latency_stats()->snapshot(*snap);
+
+    REQUIRE(snap->at(latency_op::ADD, static_cast<uint8_t>(order_result::SUCCESS)).count() == 2);
+    REQUIRE(snap->at(latency_op::ADD, static_cast<uint8_t>(order_result::DUPLICATE_ID)).count() == 1);
+    REQUIRE(snap->at(latency_op::CANCEL, static_cast<uint8_t>(order_result::ORDER_NOT_FOUND)).count() == 1);
+    REQUIRE(snap->at(latency_op::MODIFY, static_cast<uint8_t>(order_result::SUCCESS)).count() == 1);
+    REQUIRE(snap->at(latency_op::EXECUTE, static_cast<uint8_t>(order_result::SUCCESS)).count() == 1);
+    REQUIRE(snap->at(latency_op::EXECUTE, static_cast<uint8_t>(order_result::NO_MATCH)).count() == 1);
+    REQUIRE(snap->total(latency_op::ADD).count() == 3);
+    REQUIRE(snap->ns_per_tick > 0);
+}
+
+TEST_CASE("orderbook: scrape returns deltas while the book keeps running", "[latency]")
+{
+    auto ob = std::make_unique<orderbook>(nullptr);
+    auto snap = std::make_unique<orderbook_latency_snapshot>();
+
+    constexpr uint64_t N = 20000;
+    std::atomic<bool> done{false};
+    uint64_t scraped = 0;
+
+    std::thread monitor([&] {
+        auto local = std::make_unique<orderbook_latency_snapshot>();
+        while (!done.load(std::memory_order_acquire)) {
+            ob->latency_stats()->scrape(*local);
+            scraped += local->total(latency_op::ADD).count();
+        }
+        ob->latency_stats()->scrape(*local);
+        scraped += local->total(latency_op::ADD).count();
+    });
+
+    for (uint64_t i = 1; i <= N; i++) {
+        ob->add(factory.make(i, order_side::BUY, static_cast<uint32_t>(1 + i % 500), 1));
+    }
+    done.store(true, std::memory_order_release);
+    monitor.join();
+
+    // every sample is seen by exactly one scrape
+    REQUIRE(scraped == N);
+
+    ob->latency_stats()->scrape(*snap);
+    REQUIRE(snap->total(latency_op::ADD).count() == 0);
+
+    ob->latency_stats()->snapshot(*snap);
+    REQUIRE(snap->total(latency_op::ADD).count() == N);
+}
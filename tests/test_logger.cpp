@@ -0,0 +1,173 @@
+#include <catch2/catch_all.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../includes/bounded_queue.h"
+#include "../includes/logger.h"
+
+/**
+ * Helper to build a minimal ADD event with a numbered ID.
+ */
+log_event_t make_event(uint64_t n)
+{
+    char id[ORDER_ID_LEN];
+    std::memset(id, '0', ORDER_ID_LEN);
+    std::memcpy(id, "LOGQ", 4);
+    id[ORDER_ID_LEN - 1] = static_cast<char>('0' + (n % 10));
+
+    return log_event_t(n, id, log_event_kind::ADD, 100, 1, order_side::BUY);
+}
+
+/**
+ * Sequence numbers of a binary journal's records, in file order.
+ */
+static std::vector<uint64_t> journal_sequences(const std::string& path)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    journal_file_header_t header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    REQUIRE(in.good());
+
+    std::vector<uint64_t> out;
+    journal_record_t rec;
+    while (in.read(reinterpret_cast<char*>(&rec), sizeof(rec))) {
+        out.push_back(rec.sequence);
+    }
+    return out;
+}
+
+TEST_CASE("bounded_queue: FIFO order and full/empty", "[logger][queue]")
+{
+    bounded_queue<int> q(4);
+    REQUIRE(q.capacity() == 4);
+
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(q.try_enqueue(i));
+    }
+    // full
+    REQUIRE_FALSE(q.try_enqueue(99));
+    REQUIRE(q.size_approx() == 4);
+
+    int v = -1;
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(q.try_dequeue(v));
+        REQUIRE(v == i);
+    }
+    // empty
+    REQUIRE_FALSE(q.try_dequeue(v));
+
+    // wraps around the ring
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(q.try_enqueue(i));
+        REQUIRE(q.try_dequeue(v));
+        REQUIRE(v == i);
+    }
+}
+
+TEST_CASE("bounded_queue: capacity rounds up to power of two", "[logger][queue]")
+{
+    bounded_queue<int> q(5);
+    REQUIRE(q.capacity() == 8);
+}
+
+TEST_CASE("logger: DROP policy accounts for every event", "[logger]")
+{
+    logger_config_t cfg;
+    cfg.queue_capacity = 2;
+    cfg.on_full = overflow_policy::DROP;
+
+    logger_stats_t s;
+    {
+        logger log("../logs/test_logger_drop.log", cfg);
+        for (uint64_t i = 0; i < 5000; i++) {
+            log.push(make_event(i));
+        }
+        s = log.stats();
+    }
+
+    REQUIRE(s.enqueued + s.dropped == 5000);
+    REQUIRE(s.spilled == 0);
+    REQUIRE(s.high_water_mark <= 2);
+}
+
+TEST_CASE("logger: BLOCK policy never drops", "[logger]")
+{
+    logger_config_t cfg;
+    cfg.queue_capacity = 4;
+    cfg.on_full = overflow_policy::BLOCK;
+
+    logger_stats_t s;
+    {
+        logger log("../logs/test_logger_block.log", cfg);
+        for (uint64_t i = 0; i < 2000; i++) {
+            log.push(make_event(i));
+        }
+        s = log.stats();
+    }
+
+    REQUIRE(s.enqueued == 2000);
+    REQUIRE(s.dropped == 0);
+    REQUIRE(s.high_water_mark <= 4);
+}
+
+TEST_CASE("logger: SPILL policy diverts instead of dropping and keeps FIFO order", "[logger]")
+{
+    const std::string path = "../logs/test_logger_spill.bin";
+    logger_config_t cfg;
+    cfg.queue_capacity = 2;
+    cfg.on_full = overflow_policy::SPILL;
+    cfg.spill_capacity = 1 << 15;
+    cfg.format = log_format::BINARY;
+
+    logger_stats_t s;
+    {
+        logger log(path, cfg);
+        for (uint64_t i = 0; i < 20000; i++) {
+            log.push(make_event(i));
+        }
+        s = log.stats();
+    }
+
+    REQUIRE(s.dropped == 0);
+    REQUIRE(s.enqueued == 20000);
+    REQUIRE(s.spilled > 0);
+
+    // every switch between the ring and the spill ring keeps the order they were pushed in
+    std::vector<uint64_t> seqs = journal_sequences(path);
+    REQUIRE(seqs.size() == 20000);
+    for (size_t i = 0; i < seqs.size(); i++) {
+        REQUIRE(seqs[i] == i + 1);
+    }
+}
+
+TEST_CASE("logger: SPIN policy waits for the writer and never drops", "[logger]")
+{
+    const std::string path = "../logs/test_logger_spin.bin";
+    logger_config_t cfg;
+    cfg.queue_capacity = 2;
+    cfg.on_full = overflow_policy::SPIN;
+    cfg.format = log_format::BINARY;
+
+    logger_stats_t s;
+    {
+        logger log(path, cfg);
+        for (uint64_t i = 0; i < 20000; i++) {
+            log.push(make_event(i));
+        }
+        s = log.stats();
+    }
+
+    REQUIRE(s.enqueued == 20000);
+    REQUIRE(s.dropped == 0);
+    REQUIRE(s.spilled == 0);
+    REQUIRE(s.full_waits > 0);
+    REQUIRE(s.high_water_mark <= 2);
+
+    std::vector<uint64_t> seqs = journal_sequences(path);
+    REQUIRE(seqs.size() == 20000);
+    for (size_t i = 0; i < seqs.size(); i++) {
+        REQUIRE(seqs[i] == i + 1);
+    }
+}
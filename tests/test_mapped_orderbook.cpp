@@ -0,0 +1,324 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../includes/logger.h"
+#include "../includes/snapshot.h"
+#include "../src/orderbook.h"
+#include "../src/mapped_orderbook.h"
+#include "../src/journal_replay.h"
+#include "test_orders.h"
+
+static const test_orders factory { 'M', "MMAP" };
+
+TEST_CASE("mapped_orderbook: matches orderbook on add/modify/cancel flow", "[mapped]")
+{
+    const char* path = "../logs/test_mapped_parity.book";
+    std::remove(path);
+
+    auto reference = std::make_unique<orderbook>(nullptr);
+    mapped_orderbook mapped(path, 1 << 15);
+    REQUIRE(mapped.open_status() == mapped_open_status::CREATED);
+
+    std::mt19937 rng(5);
+    std::vector<order_id_key> ids;
+    for (uint64_t n = 0; n < 20000; n++) {
+        int action = static_cast<int>(rng() % 10);
+        if (action < 5 || ids.empty()) {
+            order_id_key k = make_test_id('P', n);
+            order_side side = (rng() % 2) ? order_side::BUY : order_side::SELL;
+            uint32_t price = side == order_side::BUY ? 500 + rng() % 100 : 601 + rng() % 100;
+            order_t o = factory.make(k, side, price, 1 + rng() % 100);
+            order_result r = reference->add(o);
+            REQUIRE(mapped.add(o) == r);
+            if (r == order_result::SUCCESS) {
+                ids.push_back(k);
+            }
+        } else if (action < 7) {
+            const order_id_key& k = ids[ rng() % ids.size() ];
+            order_side side = (rng() % 2) ? order_side::BUY : order_side::SELL;
+            uint32_t price = side == order_side::BUY ? 500 + rng() % 100 : 601 + rng() % 100;
+            order_t o = factory.make(k, side, price, 1 + rng() % 100);
+            REQUIRE(mapped.modify(k, o) == reference->modify(k, o));
+        } else {
+            const order_id_key& k = ids[ rng() % ids.size() ];
+            REQUIRE(mapped.cancel(k) == reference->cancel(k));
+        }
+    }
+
+    REQUIRE(mapped.order_count() == reference->order_count());
+    REQUIRE(mapped.best_bid() == reference->best_bid());
+    REQUIRE(mapped.best_ask() == reference->best_ask());
+    for (uint32_t p = 0; p <= MAX_PRICE; p++) {
+        REQUIRE(mapped.level_qty(order_side::BUY, p) == reference->level_qty(order_side::BUY, p));
+        REQUIRE(mapped.level_qty(order_side::SELL, p) == reference->level_qty(order_side::SELL, p));
+    }
+    for (const auto& k : ids) {
+        REQUIRE(mapped.contains(k) == reference->contains(k));
+    }
+}
+
+/**
+ * One step of a seeded add/modify/cancel/execute flow over a narrow price band.
+ */
+template <typename Book>
+static void flow_step(Book& ob, std::mt19937& rng, std::vector<order_id_key>& ids, char prefix, uint64_t n)
+{
+    int action = static_cast<int>(rng() % 10);
+    order_side side = (rng() % 2) ? order_side::BUY : order_side::SELL;
+    uint32_t price = side == order_side::BUY ? 990 + rng() % 15 : 1000 + rng() % 15;
+    size_t qty = 1 + rng() % 50;
+
+    if (action < 5 || ids.empty()) {
+        order_id_key k = make_test_id(prefix, n);
+        if (ob.add(factory.make(k, side, price, qty)) == order_result::SUCCESS) {
+            ids.push_back(k);
+        }
+    } else if (action < 7) {
+        const order_id_key& k = ids[ rng() % ids.size() ];
+        ob.modify(k, factory.make(k, side, price, qty));
+    } else if (action < 9) {
+        ob.cancel(ids[ rng() % ids.size() ]);
+    } else {
+        ob.execute();
+    }
+}
+
+// level records only: the header's journal sequence differs between a live and a rebuilt book
+static std::vector<char> image_levels(const mapped_orderbook& ob)
+{
+    std::vector<char> image;
+    ob.capture_snapshot("MMAP", image);
+    snapshot_header_t header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    REQUIRE(header.order_count == ob.order_count());
+    return std::vector<char>(image.begin() + sizeof(header), image.end());
+}
+
+TEST_CASE("mapped_orderbook: executes like orderbook when queue order cannot differ", "[mapped][execute]")
+{
+    const char* path = "../logs/test_mapped_parity_execute.book";
+    std::remove(path);
+
+    auto reference = std::make_unique<orderbook>(nullptr);
+    mapped_orderbook mapped(path, 1 << 12);
+
+    // at most one order per level, so only price priority and fill sizes decide the outcome
+    std::mt19937 rng(17);
+    std::vector<order_id_key> ids;
+    for (uint64_t n = 0; n < 20000; n++) {
+        int action = static_cast<int>(rng() % 10);
+        order_side side = (rng() % 2) ? order_side::BUY : order_side::SELL;
+        uint32_t price = 980 + rng() % 40;
+        size_t qty = 1 + rng() % 50;
+
+        if (action < 5 || ids.empty()) {
+            if (reference->level_qty(side, price) == 0) {
+                order_id_key k = make_test_id('E', n);
+                REQUIRE(mapped.add(factory.make(k, side, price, qty)) == reference->add(factory.make(k, side, price, qty)));
+                ids.push_back(k);
+            }
+        } else if (action < 7) {
+            const order_id_key& k = ids[ rng() % ids.size() ];
+            if (reference->level_qty(side, price) == 0) {
+                REQUIRE(mapped.modify(k, factory.make(k, side, price, qty)) == reference->modify(k, factory.make(k, side, price, qty)));
+            }
+        } else if (action < 8) {
+            const order_id_key& k = ids[ rng() % ids.size() ];
+            REQUIRE(mapped.cancel(k) == reference->cancel(k));
+        } else {
+            mapped.execute();
+            reference->execute();
+            REQUIRE(mapped.order_count() == reference->order_count());
+            REQUIRE(mapped.best_bid() == reference->best_bid());
+            REQUIRE(mapped.best_ask() == reference->best_ask());
+        }
+    }
+
+    for (uint32_t p = 980; p < 1020; p++) {
+        REQUIRE(mapped.level_qty(order_side::BUY, p) == reference->level_qty(order_side::BUY, p));
+        REQUIRE(mapped.level_qty(order_side::SELL, p) == reference->level_qty(order_side::SELL, p));
+    }
+    for (const auto& k : ids) {
+        REQUIRE(mapped.contains(k) == reference->contains(k));
+    }
+}
+
+TEST_CASE("mapped_orderbook: a same-price modify goes to the back of the level", "[mapped]")
+{
+    const char* path = "../logs/test_mapped_requeue.book";
+    std::remove(path);
+    mapped_orderbook ob(path, 64);
+
+    REQUIRE(ob.add(factory.make(make_test_id('B', 1), order_side::BUY, 100, 5)) == order_result::SUCCESS);
+    REQUIRE(ob.add(factory.make(make_test_id('B', 2), order_side::BUY, 100, 5)) == order_result::SUCCESS);
+    REQUIRE(ob.modify(make_test_id('B', 1), factory.make(make_test_id('B', 1), order_side::BUY, 100, 4)) == order_result::SUCCESS);
+    REQUIRE(ob.add(factory.make(make_test_id('S', 1), order_side::SELL, 100, 5)) == order_result::SUCCESS);
+
+    ob.execute();
+
+    REQUIRE_FALSE(ob.contains(make_test_id('B', 2)));
+    REQUIRE(ob.contains(make_test_id('B', 1)));
+    REQUIRE(ob.level_qty(order_side::BUY, 100) == 4);
+}
+
+TEST_CASE("mapped_orderbook: snapshot plus journal tail rebuilds the same queues", "[mapped][restart][snapshot]")
+{
+    const char* path = "../logs/test_mapped_live.book";
+    const char* rebuilt_path = "../logs/test_mapped_rebuilt.book";
+    const std::string journal_path = "../logs/test_mapped_recover.bin";
+    const std::string snapshot_path = "../logs/test_mapped_recover.snap";
+    std::remove(path);
+    std::remove(rebuilt_path);
+
+    std::mt19937 rng(29);
+    std::vector<order_id_key> ids;
+    uint64_t snapshot_sequence = 0;
+    {
+        logger_config_t cfg;
+        cfg.format = log_format::BINARY;
+        logger log(journal_path, cfg);
+        mapped_orderbook live(path, 1 << 12, &log);
+
+        uint64_t n = 0;
+        for (; n < 3000; n++) {
+            flow_step(live, rng, ids, 'L', n);
+        }
+        std::vector<char> image;
+        live.capture_snapshot("MMAP", image);
+        snapshot_sequence = live.last_sequence();
+        write_snapshot_file(snapshot_path, image);
+
+        for (; n < 6000; n++) {
+            flow_step(live, rng, ids, 'L', n);
+        }
+    }
+
+    // reopened without a logger, as it stood when the journal closed
+    mapped_orderbook live(path, 1 << 12);
+    REQUIRE(live.open_status() == mapped_open_status::RESUMED);
+
+    mapped_orderbook rebuilt(rebuilt_path, 1 << 12);
+    std::vector<char> image = read_snapshot_file(snapshot_path);
+    REQUIRE(rebuilt.load_snapshot(image.data(), image.size()) == snapshot_sequence);
+    replay_stats_t stats = journal_replayer::replay_file_into(journal_path, "MMAP", rebuilt, snapshot_sequence);
+    REQUIRE(stats.applied > 0);
+    REQUIRE(stats.applied < stats.records);
+
+    REQUIRE(live.order_count() > 0);
+    REQUIRE(image_levels(rebuilt) == image_levels(live));
+
+    // the same flow from here fills the same orders
+    std::mt19937 rng_live(31), rng_rebuilt(31);
+    std::vector<order_id_key> ids_live = ids, ids_rebuilt = ids;
+    for (uint64_t n = 0; n < 3000; n++) {
+        flow_step(live, rng_live, ids_live, 'T', n);
+        flow_step(rebuilt, rng_rebuilt, ids_rebuilt, 'T', n);
+    }
+    REQUIRE(image_levels(rebuilt) == image_levels(live));
+    for (const auto& k : ids_live) {
+        REQUIRE(live.contains(k) == rebuilt.contains(k));
+    }
+}
+
+TEST_CASE("mapped_orderbook: execute() fills in FIFO order", "[mapped][execute]")
+{
+    const char* path = "../logs/test_mapped_execute.book";
+    std::remove(path);
+    mapped_orderbook ob(path, 64);
+
+    REQUIRE(ob.add(factory.make(make_test_id('B', 1), order_side::BUY, 100, 5)) == order_result::SUCCESS);
+    REQUIRE(ob.add(factory.make(make_test_id('B', 2), order_side::BUY, 100, 5)) == order_result::SUCCESS);
+    REQUIRE(ob.add(factory.make(make_test_id('B', 3), order_side::BUY, 99, 5)) == order_result::SUCCESS);
+    REQUIRE(ob.add(factory.make(make_test_id('S', 1), order_side::SELL, 99, 7)) == order_result::SUCCESS);
+
+    ob.execute();
+
+    // B1 filled first, B2 partially, B3 untouched
+    REQUIRE_FALSE(ob.contains(make_test_id('B', 1)));
+    REQUIRE(ob.contains(make_test_id('B', 2)));
+    REQUIRE(ob.contains(make_test_id('B', 3)));
+    REQUIRE_FALSE(ob.contains(make_test_id('S', 1)));
+    REQUIRE(ob.level_qty(order_side::BUY, 100) == 3);
+    REQUIRE(ob.best_bid().value() == 100);
+    REQUIRE_FALSE(ob.best_ask().has_value());
+}
+
+TEST_CASE("mapped_orderbook: reopening the file resumes without replay", "[mapped][restart]")
+{
+    const char* path = "../logs/test_mapped_restart.book";
+    std::remove(path);
+
+    uint64_t seq = 0;
+    {
+        mapped_orderbook ob(path, 1024);
+        for (uint64_t n = 0; n < 100; n++) {
+            order_side side = n % 2 ? order_side::SELL : order_side::BUY;
+            uint32_t price = side == order_side::BUY ? 900 + n % 10 : 1000 + n % 10;
+            REQUIRE(ob.add(factory.make(make_test_id('R', n), side, price, 10)) == order_result::SUCCESS);
+        }
+        REQUIRE(ob.cancel(make_test_id('R', 0)) == order_result::SUCCESS);
+        seq = ob.sequence();
+    }
+
+    mapped_orderbook ob(path, 1024);
+    REQUIRE(ob.open_status() == mapped_open_status::RESUMED);
+    REQUIRE(ob.sequence() == seq);
+    REQUIRE(ob.order_count() == 99);
+    REQUIRE_FALSE(ob.contains(make_test_id('R', 0)));
+    REQUIRE(ob.contains(make_test_id('R', 99)));
+    REQUIRE(ob.best_bid().value() == 908);
+    REQUIRE(ob.best_ask().value() == 1001);
+
+    // keeps trading on the restored state
+    REQUIRE(ob.add(factory.make(make_test_id('R', 0), order_side::SELL, 908, 100)) == order_result::SUCCESS);
+    ob.execute();
+    REQUIRE(ob.best_bid().value() == 906);
+}
+
+TEST_CASE("mapped_orderbook: rejects mismatched or torn files", "[mapped][restart]")
+{
+    const char* path = "../logs/test_mapped_validate.book";
+    std::remove(path);
+
+    {
+        mapped_orderbook ob(path, 256);
+        REQUIRE(ob.add(factory.make(make_test_id('V', 1), order_side::BUY, 10, 1)) == order_result::SUCCESS);
+    }
+
+    // different capacity => different layout
+    REQUIRE_THROWS(mapped_orderbook(path, 512));
+
+    // simulate a writer that died between begin and end of a mutation
+    {
+        std::FILE* f = std::fopen(path, "r+b");
+        REQUIRE(f != nullptr);
+        mapped_book_header_t hdr;
+        REQUIRE(std::fread(&hdr, sizeof(hdr), 1, f) == 1);
+        hdr.mutation_sequence++;
+        std::fseek(f, 0, SEEK_SET);
+        REQUIRE(std::fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+        std::fclose(f);
+    }
+    REQUIRE_THROWS(mapped_orderbook(path, 256));
+}
+
+TEST_CASE("mapped_orderbook: capacity is enforced and slots are reused", "[mapped]")
+{
+    const char* path = "../logs/test_mapped_capacity.book";
+    std::remove(path);
+    mapped_orderbook ob(path, 4);
+
+    for (uint64_t n = 0; n < 4; n++) {
+        REQUIRE(ob.add(factory.make(make_test_id('C', n), order_side::BUY, 50, 1)) == order_result::SUCCESS);
+    }
+    REQUIRE(ob.add(factory.make(make_test_id('C', 4), order_side::BUY, 50, 1)) == order_result::BOOK_FULL);
+
+    REQUIRE(ob.cancel(make_test_id('C', 2)) == order_result::SUCCESS);
+    REQUIRE(ob.add(factory.make(make_test_id('C', 4), order_side::BUY, 50, 1)) == order_result::SUCCESS);
+    REQUIRE(ob.order_count() == 4);
+    REQUIRE(ob.level_qty(order_side::BUY, 50) == 4);
+}
@@ -0,0 +1,525 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../src/l3_feed.h"
+#include "../src/market_data.h"
+#include "../src/orderbook.h"
+#include "test_orders.h"
+
+static const test_orders factory { 'M', "MKTD" };
+
+static std::vector<l2_delta_t> drain(l2_ring& ring)
+{
+    std::vector<l2_delta_t> out;
+    l2_delta_t d;
+    while (ring.try_pop(d)) {
+        out.push_back(d);
+    }
+    return out;
+}
+
+struct l2_fixture {
+    std::unique_ptr<l2_ring> ring = std::make_unique<l2_ring>();
+    std::unique_ptr<l2_publisher> publisher;
+    std::unique_ptr<orderbook> book = std::make_unique<orderbook>(nullptr);
+
+    l2_fixture() {
+        ring->init();
+        publisher = std::make_unique<l2_publisher>(*ring, 7);
+        book->set_l2_publisher(publisher.get());
+    }
+};
+
+TEST_CASE("l2: each call publishes the levels it changed", "[l2]")
+{
+    l2_fixture f;
+
+    REQUIRE(f.book->add(factory.make(1, order_side::BUY, 100, 10)) == order_result::SUCCESS);
+    std::vector<l2_delta_t> d = drain(*f.ring);
+    REQUIRE(d.size() == 1);
+    REQUIRE(d[0].sequence == 1);
+    REQUIRE(d[0].instrument == 7);
+    REQUIRE(d[0].side == static_cast<uint8_t>(order_side::BUY));
+    REQUIRE(d[0].price == 100);
+    REQUIRE(d[0].total_qty == 10);
+    REQUIRE(d[0].order_count == 1);
+    REQUIRE(d[0].flags == L2_END_OF_BATCH);
+
+    // rejected calls change nothing and publish nothing
+    REQUIRE(f.book->add(factory.make(1, order_side::BUY, 100, 10)) == order_result::DUPLICATE_ID);
+    REQUIRE(f.book->cancel(factory.id(99)) == order_result::ORDER_NOT_FOUND);
+    REQUIRE(drain(*f.ring).empty());
+
+    // a price-changing modify touches two levels in one batch
+    REQUIRE(f.book->modify(factory.id(1), factory.make(1, order_side::BUY, 101, 4)) == order_result::SUCCESS);
+    d = drain(*f.ring);
+    REQUIRE(d.size() == 2);
+    REQUIRE(d[0].price == 100);
+    REQUIRE(d[0].order_count == 0);
+    REQUIRE(d[0].total_qty == 0);
+    REQUIRE(d[0].flags == 0);
+    REQUIRE(d[1].price == 101);
+    REQUIRE(d[1].total_qty == 4);
+    REQUIRE(d[1].flags == L2_END_OF_BATCH);
+
+    REQUIRE(f.book->reduce(factory.id(1), 1) == order_result::SUCCESS);
+    d = drain(*f.ring);
+    REQUIRE(d.size() == 1);
+    REQUIRE(d[0].total_qty == 3);
+    REQUIRE(d[0].order_count == 1);
+}
+
+TEST_CASE("l2: a sweep publishes every level it touched once", "[l2]")
+{
+    l2_fixture f;
+    uint64_t n = 1;
+    for (uint32_t price = 101; price <= 103; price++) {
+        for (int k = 0; k < 3; k++) {
+            f.book->add(factory.make(n++, order_side::SELL, price, 10));
+        }
+    }
+    drain(*f.ring);
+
+    // takes all of 101 and 102 and one order at 103: seven fills
+    REQUIRE(f.book->add(factory.make(n++, order_side::BUY, 103, 70)) == order_result::SUCCESS);
+    drain(*f.ring);
+    f.book->execute();
+    std::vector<l2_delta_t> d = drain(*f.ring);
+
+    REQUIRE(d.size() == 4);
+    std::map<std::pair<uint8_t, uint32_t>, l2_delta_t> by_level;
+    for (const l2_delta_t& delta : d) {
+        by_level[{ delta.side, delta.price }] = delta;
+    }
+    REQUIRE(by_level.size() == 4);
+    uint8_t buy = static_cast<uint8_t>(order_side::BUY);
+    uint8_t sell = static_cast<uint8_t>(order_side::SELL);
+    REQUIRE(by_level[{ buy, 103 }].order_count == 0);
+    REQUIRE(by_level[{ sell, 101 }].order_count == 0);
+    REQUIRE(by_level[{ sell, 102 }].order_count == 0);
+    REQUIRE(by_level[{ sell, 103 }].order_count == 2);
+    REQUIRE(by_level[{ sell, 103 }].total_qty == 20);
+    REQUIRE(d.back().flags == L2_END_OF_BATCH);
+    for (size_t i = 1; i < d.size(); i++) {
+        REQUIRE(d[i].sequence == d[i - 1].sequence + 1);
+    }
+}
+
+TEST_CASE("l2: batches coalesce a burst into one delta per level", "[l2]")
+{
+    l2_fixture f;
+
+    f.book->begin_l2_batch();
+    for (uint64_t n = 1; n <= 5; n++) {
+        f.book->add(factory.make(n, order_side::SELL, 200, 10));
+    }
+    f.book->begin_l2_batch();   // nested: still held
+    f.book->cancel(factory.id(3));
+    f.book->add(factory.make(6, order_side::BUY, 150, 1));
+    f.book->cancel(factory.id(6));
+    f.book->end_l2_batch();
+    REQUIRE(drain(*f.ring).empty());
+    f.book->end_l2_batch();
+
+    std::vector<l2_delta_t> d = drain(*f.ring);
+    REQUIRE(d.size() == 2);
+    REQUIRE(d[0].price == 200);
+    REQUIRE(d[0].order_count == 4);
+    REQUIRE(d[0].total_qty == 40);
+    REQUIRE(d[1].price == 150);
+    REQUIRE(d[1].order_count == 0);
+    REQUIRE(d[1].flags == L2_END_OF_BATCH);
+    REQUIRE(f.publisher->stats().batches == 1);
+}
+
+TEST_CASE("l2: a consumer rebuilds the book from deltas alone", "[l2]")
+{
+    l2_fixture f;
+    std::map<std::pair<uint8_t, uint32_t>, uint64_t> levels;
+
+    uint64_t rng = 12345;
+    auto next = [&] {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    };
+    std::vector<uint64_t> live;
+    for (uint64_t n = 1; n <= 20000; n++) {
+        uint64_t r = next();
+        if (r % 10 < 6 || live.empty()) {
+            order_side side = (r >> 8) & 1 ? order_side::BUY : order_side::SELL;
+            uint32_t price = side == order_side::BUY ? 90 + static_cast<uint32_t>((r >> 16) % 12)
+                                                     : 99 + static_cast<uint32_t>((r >> 16) % 12);
+            f.book->add(factory.make(n, side, price, 1 + (r >> 32) % 20));
+            f.book->execute();
+            live.push_back(n);
+        } else if (r % 10 < 8) {
+            size_t i = static_cast<size_t>((r >> 20) % live.size());
+            f.book->cancel(factory.id(live[i]));
+            live[i] = live.back();
+            live.pop_back();
+        } else {
+            size_t i = static_cast<size_t>((r >> 20) % live.size());
+            f.book->reduce(factory.id(live[i]), 1);
+        }
+        for (const l2_delta_t& d : drain(*f.ring)) {
+            levels[{ d.side, d.price }] = d.total_qty;
+        }
+    }
+
+    REQUIRE(f.publisher->stats().dropped == 0);
+    for (uint32_t price = 80; price <= 120; price++) {
+        for (order_side side : { order_side::BUY, order_side::SELL }) {
+            auto it = levels.find({ static_cast<uint8_t>(side), price });
+            uint64_t qty = it == levels.end() ? 0 : it->second;
+            REQUIRE(qty == f.book->level_qty(side, price));
+        }
+    }
+}
+
+TEST_CASE("l2: a full ring drops deltas and leaves a sequence gap", "[l2]")
+{
+    l2_fixture f;
+    size_t total = L2_RING_SLOTS + 10;
+    for (uint64_t n = 1; n <= total; n++) {
+        f.book->add(factory.make(n, order_side::BUY, static_cast<uint32_t>(n % 2 ? 100 : 101), 1));
+    }
+    REQUIRE(f.publisher->stats().dropped == 10);
+    REQUIRE(f.publisher->stats().deltas == L2_RING_SLOTS);
+    REQUIRE(f.publisher->sequence() == total);
+
+    l2_delta_t d;
+    uint64_t last = 0;
+    while (f.ring->try_pop(d)) {
+        last = d.sequence;
+    }
+    REQUIRE(last == L2_RING_SLOTS);
+
+    // publishing continues once the consumer catches up
+    f.book->add(factory.make(total + 1, order_side::BUY, 100, 1));
+    REQUIRE(f.ring->try_pop(d));
+    REQUIRE(d.sequence == total + 1);
+
+    // detaching stops publishing
+    f.book->set_l2_publisher(nullptr);
+    f.book->add(factory.make(total + 2, order_side::BUY, 100, 1));
+    REQUIRE_FALSE(f.ring->try_pop(d));
+}
+
+static std::vector<l3_frame_t> drain(l3_ring& ring)
+{
+    std::vector<l3_frame_t> out;
+    l3_frame_t f;
+    while (ring.try_pop(f)) {
+        out.push_back(f);
+    }
+    return out;
+}
+
+static uint16_t template_of(const l3_frame_t& f)
+{
+    return l3_header(f).template_id;
+}
+
+struct l3_fixture {
+    std::unique_ptr<l3_ring> ring = std::make_unique<l3_ring>();
+    std::unique_ptr<l3_ring_channel> channel;
+    std::unique_ptr<l3_feed> feed;
+    std::unique_ptr<orderbook> book = std::make_unique<orderbook>(nullptr);
+
+    l3_fixture() {
+        ring->init();
+        channel = std::make_unique<l3_ring_channel>(*ring);
+        feed = std::make_unique<l3_feed>(*channel, 9);
+        book->set_l3_feed(feed.get());
+    }
+};
+
+// rebuilds every level's queue from frames alone
+struct l3_consumer {
+    struct resting_t {
+        uint8_t side;
+        uint32_t price;
+        uint64_t qty;
+    };
+    std::map<std::string, resting_t> orders;
+    std::map<std::pair<uint8_t, uint32_t>, std::list<std::string>> queues;
+    uint64_t last_sequence = 0;
+    uint64_t adds_mid_queue = 0;
+
+    static std::string id_of(const char* id) { return std::string(id, ORDER_ID_LEN); }
+
+    void place(const char* id, const char* before, uint8_t side, uint32_t price, uint64_t qty) {
+        std::list<std::string>& q = queues[{ side, price }];
+        auto at = q.end();
+        if (before[0] != '\0') {
+            for (at = q.begin(); at != q.end() && *at != id_of(before); ++at) {
+            }
+            REQUIRE(at != q.end());
+        }
+        q.insert(at, id_of(id));
+        orders[id_of(id)] = { side, price, qty };
+    }
+
+    void remove(const std::string& id) {
+        auto it = orders.find(id);
+        REQUIRE(it != orders.end());
+        queues[{ it->second.side, it->second.price }].remove(id);
+        orders.erase(it);
+    }
+
+    void apply(const l3_frame_t& f) {
+        const l3_message_header_t& h = l3_header(f);
+        REQUIRE(h.schema_id == L3_SCHEMA_ID);
+        REQUIRE(h.version == L3_SCHEMA_VERSION);
+        switch (static_cast<l3_template>(h.template_id)) {
+            case l3_template::ADD: {
+                const l3_add_t& m = l3_block<l3_add_t>(f);
+                check_sequence(m.sequence);
+                adds_mid_queue += m.queued_before[0] != '\0';
+                place(m.order_id, m.queued_before, m.side, m.price, m.qty);
+                break;
+            }
+            case l3_template::MODIFY: {
+                const l3_modify_t& m = l3_block<l3_modify_t>(f);
+                check_sequence(m.sequence);
+                remove(id_of(m.order_id));
+                place(m.order_id, m.queued_before, m.side, m.price, m.qty);
+                break;
+            }
+            case l3_template::DELETE: {
+                const l3_delete_t& m = l3_block<l3_delete_t>(f);
+                check_sequence(m.sequence);
+                remove(id_of(m.order_id));
+                break;
+            }
+            case l3_template::EXECUTED: {
+                const l3_executed_t& m = l3_block<l3_executed_t>(f);
+                check_sequence(m.sequence);
+                resting_t& r = orders.at(id_of(m.order_id));
+                REQUIRE(r.qty >= m.qty);
+                r.qty -= m.qty;
+                if (r.qty == 0) {
+                    remove(id_of(m.order_id));
+                }
+                break;
+            }
+        }
+    }
+
+    void check_sequence(uint64_t sequence) {
+        REQUIRE(sequence == last_sequence + 1);
+        last_sequence = sequence;
+    }
+};
+
+TEST_CASE("l3: one message per order event, in a fixed layout", "[l3]")
+{
+    l3_fixture f;
+
+    REQUIRE(f.book->add(factory.make(1, order_side::BUY, 100, 10)) == order_result::SUCCESS);
+    REQUIRE(f.book->add(factory.make(2, order_side::BUY, 100, 5)) == order_result::SUCCESS);
+    std::vector<l3_frame_t> m = drain(*f.ring);
+    REQUIRE(m.size() == 2);
+    REQUIRE(l3_header(m[0]).block_length == sizeof(l3_add_t));
+    REQUIRE(template_of(m[0]) == static_cast<uint16_t>(l3_template::ADD));
+    const l3_add_t& add = l3_block<l3_add_t>(m[1]);
+    REQUIRE(add.sequence == 2);
+    REQUIRE(std::memcmp(add.order_id, factory.id(2).order_id, ORDER_ID_LEN) == 0);
+    REQUIRE(add.queued_before[0] == '\0');
+    REQUIRE(add.qty == 5);
+    REQUIRE(add.price == 100);
+    REQUIRE(add.instrument == 9);
+    REQUIRE(add.side == static_cast<uint8_t>(order_side::BUY));
+
+    // rejected calls publish nothing
+    REQUIRE(f.book->add(factory.make(1, order_side::BUY, 100, 10)) == order_result::DUPLICATE_ID);
+    REQUIRE(f.book->cancel(factory.id(99)) == order_result::ORDER_NOT_FOUND);
+    REQUIRE(drain(*f.ring).empty());
+
+    // a reduce keeps the order where it was: still in front of order 2
+    REQUIRE(f.book->reduce(factory.id(1), 4) == order_result::SUCCESS);
+    m = drain(*f.ring);
+    REQUIRE(m.size() == 1);
+    REQUIRE(template_of(m[0]) == static_cast<uint16_t>(l3_template::MODIFY));
+    REQUIRE(l3_block<l3_modify_t>(m[0]).qty == 6);
+    REQUIRE(std::memcmp(l3_block<l3_modify_t>(m[0]).queued_before, factory.id(2).order_id, ORDER_ID_LEN) == 0);
+
+    REQUIRE(f.book->add(factory.make(3, order_side::SELL, 100, 8)) == order_result::SUCCESS);
+    drain(*f.ring);
+    f.book->execute();
+    m = drain(*f.ring);
+    // order 1 fills 6, then order 2 fills 2: two fills, two sides each
+    REQUIRE(m.size() == 4);
+    const l3_executed_t& bid = l3_block<l3_executed_t>(m[0]);
+    const l3_executed_t& ask = l3_block<l3_executed_t>(m[1]);
+    REQUIRE(template_of(m[0]) == static_cast<uint16_t>(l3_template::EXECUTED));
+    REQUIRE(std::memcmp(bid.order_id, factory.id(1).order_id, ORDER_ID_LEN) == 0);
+    REQUIRE(bid.side == static_cast<uint8_t>(order_side::BUY));
+    REQUIRE(std::memcmp(ask.order_id, factory.id(3).order_id, ORDER_ID_LEN) == 0);
+    REQUIRE(ask.side == static_cast<uint8_t>(order_side::SELL));
+    REQUIRE(bid.qty == 6);
+    REQUIRE(bid.match_number == 1);
+    REQUIRE(ask.match_number == 1);
+    REQUIRE(l3_block<l3_executed_t>(m[3]).match_number == 2);
+    REQUIRE(l3_block<l3_executed_t>(m[3]).qty == 2);
+    REQUIRE(f.feed->match_count() == 2);
+
+    REQUIRE(f.book->cancel(factory.id(2)) == order_result::SUCCESS);
+    m = drain(*f.ring);
+    REQUIRE(m.size() == 1);
+    REQUIRE(template_of(m[0]) == static_cast<uint16_t>(l3_template::DELETE));
+    REQUIRE(l3_block<l3_delete_t>(m[0]).qty == 3);
+    REQUIRE(l3_block<l3_delete_t>(m[0]).sequence == f.channel->sequence());
+
+    f.book->set_l3_feed(nullptr);
+    f.book->add(factory.make(4, order_side::BUY, 100, 1));
+    REQUIRE(drain(*f.ring).empty());
+}
+
+struct fill_order_recorder final : fill_listener {
+    std::vector<std::string> bids;
+    std::vector<std::string> asks;
+    void on_fill(const order_t& bid, const order_t& ask, size_t) override {
+        if (bids.empty() || bids.back() != std::string(bid.order_id, ORDER_ID_LEN)) {
+            bids.emplace_back(bid.order_id, ORDER_ID_LEN);
+        }
+        if (asks.empty() || asks.back() != std::string(ask.order_id, ORDER_ID_LEN)) {
+            asks.emplace_back(ask.order_id, ORDER_ID_LEN);
+        }
+    }
+};
+
+TEST_CASE("l3: a consumer rebuilds exact queues from messages alone", "[l3]")
+{
+    l3_fixture f;
+    l3_consumer consumer;
+
+    uint64_t rng = 777;
+    auto next = [&] {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    };
+    std::vector<uint64_t> live;
+    uint64_t n = 1;
+    for (; n <= 20000; n++) {
+        uint64_t r = next();
+        if (r % 10 < 5 || live.empty()) {
+            order_side side = (r >> 8) & 1 ? order_side::BUY : order_side::SELL;
+            uint32_t price = side == order_side::BUY ? 90 + static_cast<uint32_t>((r >> 16) % 12)
+                                                     : 99 + static_cast<uint32_t>((r >> 16) % 12);
+            f.book->add(factory.make(n, side, price, 1 + (r >> 32) % 20));
+            f.book->execute();
+            live.push_back(n);
+        } else if (r % 10 < 7) {
+            size_t i = static_cast<size_t>((r >> 20) % live.size());
+            f.book->cancel(factory.id(live[i]));
+            live[i] = live.back();
+            live.pop_back();
+        } else if (r % 10 < 8) {
+            // moves to another level or rejoins this one
+            size_t i = static_cast<size_t>((r >> 20) % live.size());
+            std::optional<order_t> o = f.book->find(factory.id(live[i]));
+            if (o) {
+                uint32_t price = o->price + ((r >> 40) % 3) - 1;
+                f.book->modify(factory.id(live[i]), factory.make(live[i], static_cast<order_side>(o->side), price, o->qty));
+                f.book->execute();
+            }
+        } else {
+            size_t i = static_cast<size_t>((r >> 20) % live.size());
+            f.book->reduce(factory.id(live[i]), 1);
+        }
+        for (const l3_frame_t& frame : drain(*f.ring)) {
+            consumer.apply(frame);
+        }
+    }
+    REQUIRE(f.channel->stats().dropped == 0);
+    REQUIRE(consumer.orders.size() == f.book->order_count());
+    // freed slots were reused, so appending every add would have got the queues wrong
+    REQUIRE(consumer.adds_mid_queue > 0);
+
+    // the book's real priority: sweep each side and note the order fills come in
+    f.book->set_l3_feed(nullptr);
+    fill_order_recorder fills;
+    f.book->set_fill_listener(&fills);
+    f.book->add(factory.make(n++, order_side::SELL, 0, 1000000));
+    f.book->execute();
+    std::vector<std::string> expected_bids;
+    for (auto it = consumer.queues.rbegin(); it != consumer.queues.rend(); ++it) {
+        if (it->first.first == static_cast<uint8_t>(order_side::BUY)) {
+            expected_bids.insert(expected_bids.end(), it->second.begin(), it->second.end());
+        }
+    }
+    REQUIRE(fills.bids == expected_bids);
+
+    f.book->cancel(factory.id(n - 1));
+    fills.asks.clear();
+    f.book->add(factory.make(n++, order_side::BUY, MAX_PRICE, 1000000));
+    f.book->execute();
+    std::vector<std::string> expected_asks;
+    for (const auto& [level, queue] : consumer.queues) {
+        if (level.first == static_cast<uint8_t>(order_side::SELL)) {
+            expected_asks.insert(expected_asks.end(), queue.begin(), queue.end());
+        }
+    }
+    REQUIRE(fills.asks == expected_asks);
+}
+
+TEST_CASE("l3: a file channel keeps the frames it had room for", "[l3]")
+{
+    const std::string path = "../logs/test_l3_feed.bin";
+    uint64_t sequence = 0;
+    {
+        l3_file_channel channel(path, 4);
+        l3_feed feed(channel, 3);
+        orderbook book(nullptr);
+        book.set_l3_feed(&feed);
+        for (uint64_t n = 1; n <= 6; n++) {
+            book.add(factory.make(n, order_side::SELL, 200, 10));
+        }
+        REQUIRE(channel.frames() == 4);
+        REQUIRE(channel.stats().messages == 4);
+        REQUIRE(channel.stats().dropped == 2);
+        sequence = channel.sequence();
+    }
+    REQUIRE(sequence == 6);
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    REQUIRE(static_cast<size_t>(in.tellg()) == 4 * sizeof(l3_frame_t));
+    in.seekg(0);
+    for (uint64_t i = 1; i <= 4; i++) {
+        l3_frame_t frame;
+        in.read(reinterpret_cast<char*>(frame.bytes), sizeof(frame.bytes));
+        REQUIRE(template_of(frame) == static_cast<uint16_t>(l3_template::ADD));
+        REQUIRE(l3_block<l3_add_t>(frame).sequence == i);
+        REQUIRE(l3_block<l3_add_t>(frame).instrument == 3);
+    }
+}
+
+TEST_CASE("l3: a full ring drops messages and leaves a sequence gap", "[l3]")
+{
+    l3_fixture f;
+    size_t total = L3_RING_SLOTS + 3;
+    for (uint64_t n = 1; n <= total; n++) {
+        f.book->add(factory.make(n, order_side::BUY, static_cast<uint32_t>(100 + n % 50), 1));
+    }
+    REQUIRE(f.channel->stats().dropped == 3);
+    REQUIRE(f.channel->stats().messages == L3_RING_SLOTS);
+    REQUIRE(drain(*f.ring).size() == L3_RING_SLOTS);
+
+    f.book->cancel(factory.id(1));
+    std::vector<l3_frame_t> m = drain(*f.ring);
+    REQUIRE(m.size() == 1);
+    REQUIRE(l3_block<l3_delete_t>(m[0]).sequence == total + 1);
+}
@@ -2,6 +2,12 @@
 
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
 #include "../includes/logger.h"
 #include "../includes/concurrentqueue.h"
 #include "../includes/plf_hive.h"
@@ -587,3 +593,374 @@ TEST_CASE("Orderbook: boundary test at max price", "[orderbook][boundary]")
     );
     REQUIRE(ob.add(sinv) == order_result::INVALID_PRICE);
 }
+
+TEST_CASE("Orderbook: execute() timestamp per fill vs per execute", "[orderbook][execute][clock]")
+{
+    /*
+      Three resting BUYs at 100 (qty=1 each) swept by one SELL of qty=3
+      produce three fills. With PER_FILL the clock is read once per fill,
+      with PER_EXECUTE once for the whole sweep.
+    */
+    // static: the shared logger may still hold MATCH events stamped by these clocks
+    static virtual_clock per_fill_clk(5000);
+    static virtual_clock per_execute_clk(5000);
+
+    auto run_sweep = [](virtual_clock& clk, match_timestamp mode) {
+        orderbook ob(g_test_logger, &clk);
+        ob.set_match_timestamp(mode);
+
+        char IDB[16] = { 'C','L','K','-','B','U','Y','-','0','0','0','0','0','0','0','0' };
+        for (int i = 0; i < 3; i++) {
+            IDB[15] = static_cast<char>('1' + i);
+            REQUIRE(ob.add(make_order(10ULL + i, IDB, "ABCD", order_kind::LMT, order_side::BUY,
+                                      order_status::NEW, 100, 1, false)) == order_result::SUCCESS);
+        }
+        char IDS[16] = { 'C','L','K','-','S','E','L','L','0','0','0','0','0','0','0','1' };
+        REQUIRE(ob.add(make_order(20ULL, IDS, "ABCD", order_kind::LMT, order_side::SELL,
+                                  order_status::NEW, 100, 3, false)) == order_result::SUCCESS);
+
+        ob.execute();
+
+        REQUIRE_FALSE(ob.best_bid().has_value());
+        REQUIRE_FALSE(ob.best_ask().has_value());
+        return clk.reads();
+    };
+
+    REQUIRE(run_sweep(per_fill_clk, match_timestamp::PER_FILL) == 3);
+    REQUIRE(run_sweep(per_execute_clk, match_timestamp::PER_EXECUTE) == 1);
+}
+
+TEST_CASE("Orderbook: warmup() leaves the book untouched and ready", "[orderbook][warmup]")
+{
+    auto ob = std::make_unique<orderbook>(g_test_logger);
+    uint64_t logged = g_test_logger->stats().enqueued;
+
+    warmup_options_t options;
+    options.operations = 5000;
+    options.min_price = 900;
+    options.max_price = 1100;
+    options.expected_orders = 1000;
+    ob->warmup(options);
+
+    // nothing journalled, nothing resting, no best prices, not reserved
+    REQUIRE(g_test_logger->stats().enqueued == logged);
+    REQUIRE(ob->order_count() == 0);
+    REQUIRE(ob->last_sequence() == 0);
+    REQUIRE_FALSE(ob->best_bid().has_value());
+    REQUIRE_FALSE(ob->best_ask().has_value());
+    REQUIRE_FALSE(ob->allocation_check());
+    REQUIRE(ob->level_count() == 2 * 201);
+
+    char ID_W[16] = { 'W','A','R','M','E','D','-','U','P','-','T','E','S','T','0','1' };
+    REQUIRE(ob->add(make_order(1ULL, ID_W, "WARM", order_kind::LMT, order_side::BUY,
+                               order_status::NEW, 1000, 10, false)) == order_result::SUCCESS);
+    REQUIRE(ob->best_bid().value() == 1000);
+    REQUIRE(ob->level_qty(order_side::BUY, 1000) == 10);
+
+    // only empty books can be warmed up
+    REQUIRE_THROWS(ob->warmup(options));
+
+    // with a capacity the book ends up reserved
+    auto reserved = std::make_unique<orderbook>(nullptr);
+    options.capacity.orders = 1000;
+    options.capacity.min_price = 900;
+    options.capacity.max_price = 1100;
+    options.capacity.orders_per_level = 16;
+    reserved->warmup(options);
+    REQUIRE(reserved->allocation_check());
+    REQUIRE(reserved->order_count() == 0);
+}
+
+TEST_CASE("Orderbook: warmup() keeps a band at the top of the ladder in range", "[orderbook][warmup]")
+{
+    // the three-price minimum band is shifted down rather than run past MAX_PRICE
+    warmup_options_t options;
+    options.operations = 2000;
+    options.min_price = MAX_PRICE;
+    options.max_price = MAX_PRICE;
+    options.expected_orders = 100;
+
+    auto ob = std::make_unique<orderbook>(nullptr);
+    ob->warmup(options);
+    REQUIRE(ob->order_count() == 0);
+    REQUIRE(ob->level_count() == 2 * 3);
+
+    options.min_price = MAX_PRICE + 50;
+    options.max_price = MAX_PRICE + 100;
+    auto past_end = std::make_unique<orderbook>(nullptr);
+    past_end->warmup(options);
+    REQUIRE(past_end->level_count() == 2 * 3);
+
+    char ID_T[16] = { 'W','A','R','M','-','T','O','P','-','O','F','-','L','A','D','R' };
+    REQUIRE(ob->add(make_order(1ULL, ID_T, "WARM", order_kind::LMT, order_side::SELL,
+                               order_status::NEW, MAX_PRICE, 10, false)) == order_result::SUCCESS);
+    REQUIRE(ob->best_ask().value() == MAX_PRICE);
+}
+
+TEST_CASE("Orderbook: price levels are built on first use", "[orderbook][levels]")
+{
+    auto ob = std::make_unique<orderbook>(nullptr);
+    REQUIRE(ob->level_count() == 0);
+    REQUIRE(ob->level_qty(order_side::BUY, 100) == 0);
+    REQUIRE_FALSE(ob->best_bid().has_value());
+
+    char ID_1[16] = { 'L','A','Z','Y','-','L','E','V','E','L','-','0','0','0','0','1' };
+    char ID_2[16] = { 'L','A','Z','Y','-','L','E','V','E','L','-','0','0','0','0','2' };
+    char ID_3[16] = { 'L','A','Z','Y','-','L','E','V','E','L','-','0','0','0','0','3' };
+    REQUIRE(ob->add(make_order(1ULL, ID_1, "LAZY", order_kind::LMT, order_side::BUY,
+                               order_status::NEW, 100, 10, false)) == order_result::SUCCESS);
+    REQUIRE(ob->add(make_order(2ULL, ID_2, "LAZY", order_kind::LMT, order_side::BUY,
+                               order_status::NEW, 100, 5, false)) == order_result::SUCCESS);
+    REQUIRE(ob->add(make_order(3ULL, ID_3, "LAZY", order_kind::LMT, order_side::SELL,
+                               order_status::NEW, MAX_PRICE, 7, false)) == order_result::SUCCESS);
+    REQUIRE(ob->level_count() == 2);
+    REQUIRE(ob->level_qty(order_side::BUY, 100) == 15);
+    REQUIRE(ob->best_ask().value() == MAX_PRICE);
+
+    // an emptied level stays built and is reused at the same price
+    order_id_key key;
+    std::memcpy(key.order_id, ID_3, ORDER_ID_LEN);
+    REQUIRE(ob->cancel(key) == order_result::SUCCESS);
+    REQUIRE_FALSE(ob->best_ask().has_value());
+    REQUIRE(ob->add(make_order(4ULL, ID_3, "LAZY", order_kind::LMT, order_side::SELL,
+                               order_status::NEW, MAX_PRICE, 3, false)) == order_result::SUCCESS);
+    REQUIRE(ob->level_count() == 2);
+
+    // moving a modify to a new price builds that level only; crossing and execute() see it
+    order_t moved = make_order(5ULL, ID_1, "LAZY", order_kind::LMT, order_side::BUY,
+                               order_status::NEW, MAX_PRICE, 10, false);
+    std::memcpy(key.order_id, ID_1, ORDER_ID_LEN);
+    REQUIRE(ob->modify(key, moved) == order_result::SUCCESS);
+    REQUIRE(ob->level_count() == 3);
+    ob->execute();
+    REQUIRE(ob->level_qty(order_side::SELL, MAX_PRICE) == 0);
+    REQUIRE(ob->level_qty(order_side::BUY, MAX_PRICE) == 7);
+    REQUIRE(ob->best_bid().value() == MAX_PRICE);
+    REQUIRE_FALSE(ob->best_ask().has_value());
+
+    // more levels than one pool chunk
+    auto wide = std::make_unique<orderbook>(nullptr);
+    for (uint32_t p = 1; p <= 3 * LEVEL_CHUNK; p++) {
+        char id[16] = { 'W','I','D','E','-','0','0','0','0','0','0','0','0','0','0','0' };
+        id[13] = static_cast<char>('0' + p / 100);
+        id[14] = static_cast<char>('0' + (p / 10) % 10);
+        id[15] = static_cast<char>('0' + p % 10);
+        REQUIRE(wide->add(make_order(p, id, "WIDE", order_kind::LMT, order_side::BUY,
+                                     order_status::NEW, p, p, false)) == order_result::SUCCESS);
+    }
+    REQUIRE(wide->level_count() == 3 * LEVEL_CHUNK);
+    for (uint32_t p = 1; p <= 3 * LEVEL_CHUNK; p++) {
+        REQUIRE(wide->level_qty(order_side::BUY, p) == p);
+    }
+    REQUIRE(wide->best_bid().value() == 3 * LEVEL_CHUNK);
+}
+
+TEST_CASE("Orderbook: books move and swap in O(1) and live in vectors", "[orderbook][move]")
+{
+    static_assert(std::is_nothrow_move_constructible_v<orderbook>);
+    static_assert(std::is_nothrow_move_assignable_v<orderbook>);
+    static_assert(std::is_nothrow_swappable_v<orderbook>);
+    // ladders, levels and index are behind the state pointer
+    REQUIRE(sizeof(orderbook) <= 128);
+
+    auto id_for = [](uint32_t n) {
+        order_id_key key;
+        std::memset(key.order_id, '0', ORDER_ID_LEN);
+        std::memcpy(key.order_id, "MOVE", 4);
+        key.order_id[13] = static_cast<char>('0' + n / 100);
+        key.order_id[14] = static_cast<char>('0' + (n / 10) % 10);
+        key.order_id[15] = static_cast<char>('0' + n % 10);
+        return key;
+    };
+
+    // no reserve(): every reallocation moves all the books
+    std::vector<orderbook> books;
+    for (uint32_t n = 0; n < 100; n++) {
+        books.emplace_back(nullptr);
+        order_id_key key = id_for(n);
+        REQUIRE(books.back().add(make_order(n, key.order_id, "MOVE", order_kind::LMT, order_side::BUY,
+                                            order_status::NEW, 1000 + n, 10, false)) == order_result::SUCCESS);
+    }
+
+    // rebalance: reverse the whole set; resting orders stay reachable through their ids
+    std::reverse(books.begin(), books.end());
+    for (uint32_t i = 0; i < 100; i++) {
+        uint32_t n = 99 - i;
+        REQUIRE(books[i].best_bid().value() == 1000 + n);
+        REQUIRE(books[i].contains(id_for(n)));
+    }
+
+    swap(books[0], books[1]);
+    REQUIRE(books[0].best_bid().value() == 1098);
+    REQUIRE(books[1].best_bid().value() == 1099);
+    REQUIRE(books[0].cancel(id_for(98)) == order_result::SUCCESS);
+    REQUIRE_FALSE(books[0].best_bid().has_value());
+
+    orderbook moved(std::move(books[2]));
+    REQUIRE(moved.level_qty(order_side::BUY, 1097) == 10);
+    REQUIRE(moved.cancel(id_for(97)) == order_result::SUCCESS);
+    books[2] = std::move(moved);
+    REQUIRE(books[2].order_count() == 0);
+}
+
+TEST_CASE("Orderbook: top_of_book() publishes every touch change", "[orderbook][top]")
+{
+    auto ob = std::make_unique<orderbook>(nullptr);
+    const seqlock<top_of_book_t>& top = ob->top_of_book();
+    REQUIRE(reinterpret_cast<uintptr_t>(&top) % 64 == 0);
+
+    top_of_book_t t = top.load();
+    REQUIRE(t.sequence == 0);
+    REQUIRE_FALSE(t.has_bid());
+    REQUIRE_FALSE(t.has_ask());
+
+    char ID_B1[16] = { 'T','O','P','-','O','F','-','B','O','O','K','-','0','0','0','1' };
+    char ID_B2[16] = { 'T','O','P','-','O','F','-','B','O','O','K','-','0','0','0','2' };
+    char ID_B3[16] = { 'T','O','P','-','O','F','-','B','O','O','K','-','0','0','0','3' };
+    char ID_S1[16] = { 'T','O','P','-','O','F','-','B','O','O','K','-','0','0','0','4' };
+    REQUIRE(ob->add(make_order(1ULL, ID_B1, "TOPB", order_kind::LMT, order_side::BUY,
+                               order_status::NEW, 100, 10, false)) == order_result::SUCCESS);
+    REQUIRE(ob->add(make_order(2ULL, ID_B2, "TOPB", order_kind::LMT, order_side::BUY,
+                               order_status::NEW, 100, 5, false)) == order_result::SUCCESS);
+    t = top.load();
+    REQUIRE(t.sequence == 2);
+    REQUIRE(t.bid_price == 100);
+    REQUIRE(t.bid_qty == 15);
+    REQUIRE(t.bid_orders == 2);
+    REQUIRE_FALSE(t.has_ask());
+
+    // behind the touch: nothing republished
+    uint64_t version = top.version();
+    REQUIRE(ob->add(make_order(3ULL, ID_B3, "TOPB", order_kind::LMT, order_side::BUY,
+                               order_status::NEW, 90, 7, false)) == order_result::SUCCESS);
+    REQUIRE(top.version() == version);
+
+    REQUIRE(ob->add(make_order(4ULL, ID_S1, "TOPB", order_kind::LMT, order_side::SELL,
+                               order_status::NEW, 100, 15, false)) == order_result::SUCCESS);
+    ob->execute();
+    t = top.load();
+    REQUIRE(t.sequence == 4);
+    REQUIRE(t.bid_price == 90);
+    REQUIRE(t.bid_qty == 7);
+    REQUIRE(t.bid_orders == 1);
+    REQUIRE_FALSE(t.has_ask());
+
+    // the record stays where it is when the book moves
+    orderbook moved(std::move(*ob));
+    REQUIRE(&moved.top_of_book() == &top);
+    order_id_key key;
+    std::memcpy(key.order_id, ID_B3, ORDER_ID_LEN);
+    REQUIRE(moved.cancel(key) == order_result::SUCCESS);
+    REQUIRE_FALSE(top.load().has_bid());
+}
+
+TEST_CASE("Orderbook: readers never see a torn top of book", "[orderbook][top]")
+{
+    // every order is qty 10 and the bid and ask levels always hold the same count,
+    // so any consistent snapshot has qty == 10 * orders on both sides and equal counts
+    auto ob = std::make_unique<orderbook>(nullptr);
+    const seqlock<top_of_book_t>& top = ob->top_of_book();
+
+    std::atomic<bool> done { false };
+    std::atomic<uint64_t> torn { 0 };
+    std::atomic<uint64_t> reads { 0 };
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_acquire)) {
+                top_of_book_t t;
+                if (!top.try_load(t)) {
+                    continue;
+                }
+                reads.fetch_add(1, std::memory_order_relaxed);
+                if (t.bid_qty != 10ull * t.bid_orders || t.ask_qty != 10ull * t.ask_orders ||
+                    (t.sequence % 2 == 0 && t.bid_orders != t.ask_orders)) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    auto id_for = [](char side, uint32_t n) {
+        order_id_key key;
+        std::memset(key.order_id, '0', ORDER_ID_LEN);
+        key.order_id[0] = side;
+        for (int i = 15; i > 0 && n; i--, n /= 10) {
+            key.order_id[i] = static_cast<char>('0' + (n % 10));
+        }
+        return key;
+    };
+    for (uint32_t n = 1; n <= 50000; n++) {
+        uint32_t depth = n % 8;
+        order_id_key bid = id_for('B', n);
+        order_id_key ask = id_for('S', n);
+        ob->add(make_order(n, bid.order_id, "TORN", order_kind::LMT, order_side::BUY,
+                           order_status::NEW, 100, 10, false));
+        ob->add(make_order(n, ask.order_id, "TORN", order_kind::LMT, order_side::SELL,
+                           order_status::NEW, 200, 10, false));
+        if (depth == 7) {
+            for (uint32_t k = n - 7; k <= n; k++) {
+                ob->cancel(id_for('B', k));
+                ob->cancel(id_for('S', k));
+            }
+        }
+        if (n % 4096 == 0) {
+            std::this_thread::yield();   // let the readers run on a single CPU
+        }
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& t : readers) {
+        t.join();
+    }
+
+    REQUIRE(torn.load() == 0);
+    REQUIRE(reads.load() > 0);
+}
+
+TEST_CASE("tsc_clock: converts ticks close to CLOCK_MONOTONIC", "[clock]")
+{
+    tsc_clock clk;
+
+    uint64_t t0 = clk.now();
+    uint64_t m0 = monotonic_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t t1 = clk.now();
+    uint64_t m1 = monotonic_ns();
+
+    REQUIRE(t1 > t0);
+
+    uint64_t tsc_elapsed = clk.to_ns(t1) - clk.to_ns(t0);
+    uint64_t mono_elapsed = m1 - m0;
+    uint64_t diff = tsc_elapsed > mono_elapsed ? tsc_elapsed - mono_elapsed : mono_elapsed - tsc_elapsed;
+
+    // within 5% of the reference clock
+    REQUIRE(diff * 20 < mono_elapsed);
+
+    clk.recalibrate();
+    REQUIRE(clk.to_ns(clk.now()) >= clk.to_ns(t1));
+}
+
+TEST_CASE("tsc_clock: recalibrating never steps converted time backwards", "[clock]")
+{
+    // a 1ms interval makes to_ns() recalibrate itself throughout the loop
+    tsc_clock clk(1000000ULL);
+
+    uint64_t last = clk.to_ns(clk.now());
+    uint64_t m0 = monotonic_ns();
+    size_t backwards = 0;
+    while (monotonic_ns() - m0 < 50000000ULL) {
+        uint64_t ns = clk.to_ns(clk.now());
+        backwards += ns < last;
+        last = ns;
+        if (ns % 7 == 0) {
+            clk.recalibrate();
+        }
+    }
+    REQUIRE(backwards == 0);
+
+    // and the slew keeps it on CLOCK_MONOTONIC
+    uint64_t mono = monotonic_ns();
+    uint64_t conv = clk.to_ns(clk.now());
+    uint64_t diff = conv > mono ? conv - mono : mono - conv;
+    REQUIRE(diff < 1000000ULL);
+}
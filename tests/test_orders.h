@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "../includes/types.h"
+
+/**
+ * Builds the 16-byte order ID "<prefix><zero-padded n>".
+ */
+static inline order_id_key make_test_id(char prefix, uint64_t n)
+{
+    order_id_key k;
+    std::memset(k.order_id, '0', ORDER_ID_LEN);
+    k.order_id[0] = prefix;
+    for (int i = ORDER_ID_LEN - 1; i > 0 && n; i--, n /= 10) {
+        k.order_id[i] = static_cast<char>('0' + (n % 10));
+    }
+    return k;
+}
+
+/**
+ * Numbered limit orders for one test file: IDs from make_test_id() with
+ * the file's prefix, on the file's ticker. Order n is timestamped n.
+ */
+struct test_orders {
+    char prefix;
+    const char* ticker;
+
+    order_id_key id(uint64_t n) const { return make_test_id(prefix, n); }
+
+    order_t make(uint64_t n, order_side side, uint32_t price, size_t qty) const
+    {
+        return make(id(n), side, price, qty, n);
+    }
+
+    // under an ID the caller already has, e.g. the replacement in a modify
+    order_t make(const order_id_key& k, order_side side, uint32_t price, size_t qty, uint64_t timestamp = 1) const
+    {
+        return order_t(timestamp, k.order_id, ticker, order_kind::LMT, side, order_status::NEW, price, qty, false);
+    }
+};
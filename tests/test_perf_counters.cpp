@@ -0,0 +1,82 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <memory>
+
+#include "../includes/perf_counters.h"
+#include "../src/orderbook.h"
+#include "test_orders.h"
+
+static const test_orders factory { 'P', "PERF" };
+
+TEST_CASE("perf_counter_group: reads are monotonic or cleanly unavailable", "[perf]")
+{
+    perf_counter_group group;
+    perf_sample_t a, b;
+
+    if (!group.available()) {
+        // containers without a PMU or with perf_event_paranoid locked down
+        REQUIRE_FALSE(group.read(a));
+        for (uint64_t v : a.values) {
+            REQUIRE(v == 0);
+        }
+        REQUIRE(std::strlen(group.unavailable_reason()) > 0);
+        return;
+    }
+
+    REQUIRE(group.read(a));
+    volatile uint64_t acc = 0;
+    for (int i = 0; i < 100000; i++) {
+        acc = acc + static_cast<uint64_t>(i);
+    }
+    REQUIRE(group.read(b));
+
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        REQUIRE(b.values[i] >= a.values[i]);
+    }
+    if (group.has(perf_counter::INSTRUCTIONS)) {
+        REQUIRE(b.values[static_cast<size_t>(perf_counter::INSTRUCTIONS)] -
+                a.values[static_cast<size_t>(perf_counter::INSTRUCTIONS)] >= 100000);
+    }
+}
+
+TEST_CASE("perf_totals_t: subtracts read overhead and normalises per op", "[perf]")
+{
+    perf_totals_t t;
+    perf_sample_t before, after, overhead;
+    after.values[0] = 1000;
+    after.values[1] = 5;
+    overhead.values[0] = 100;
+    overhead.values[1] = 10;
+
+    t.add(before, after, overhead, 10);
+    REQUIRE(t.ops == 10);
+    REQUIRE(t.per_op(0) == 90.0);
+    REQUIRE(t.per_op(1) == 0.0);
+}
+
+TEST_CASE("orderbook: perf instrumentation counts calls per operation", "[perf]")
+{
+    auto ob = std::make_unique<orderbook>(nullptr);
+    REQUIRE(ob->perf_stats() != nullptr);
+
+    for (uint64_t i = 1; i <= 100; i++) {
+        ob->add(factory.make(i, order_side::BUY, 100, 1));
+    }
+    ob->add(factory.make(1000, order_side::SELL, 100, 50));
+    ob->execute();
+    ob->cancel(order_id_key{});
+
+    const orderbook_perf_stats* perf = ob->perf_stats();
+    REQUIRE(perf->at(latency_op::ADD).ops == 101);
+    REQUIRE(perf->at(latency_op::EXECUTE).ops == 1);
+    REQUIRE(perf->at(latency_op::CANCEL).ops == 1);
+    REQUIRE(perf->at(latency_op::MODIFY).ops == 0);
+
+    REQUIRE(perf->group != nullptr);
+    if (perf->group->available() && perf->group->has(perf_counter::INSTRUCTIONS)) {
+        // a 50-fill execute does far more work than one add
+        REQUIRE(perf->at(latency_op::EXECUTE).per_op(static_cast<size_t>(perf_counter::INSTRUCTIONS)) >
+                perf->at(latency_op::ADD).per_op(static_cast<size_t>(perf_counter::INSTRUCTIONS)));
+    }
+}
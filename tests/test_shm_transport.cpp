@@ -0,0 +1,183 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "../src/shm_transport.h"
+
+// Engine and clients on one thread: each step is request push, poll(), report pop.
+static shm_engine_config_t test_config(uint32_t max_clients = 4) {
+    shm_engine_config_t c;
+    c.name = "/orderbook-test-shm-" + std::to_string(::getpid());
+    c.max_clients = max_clients;
+    return c;
+}
+
+static order_t test_order(order_side side, uint32_t price, size_t qty) {
+    // the client keys the order itself; the id it carries in is ignored
+    char id[ ORDER_ID_LEN ] = {};
+    return order_t(0, id, "TEST", order_kind::LMT, side, order_status::NEW, price, qty, false);
+}
+
+static shm::report_t next_report(shm_client& c) {
+    shm::report_t r;
+    REQUIRE(c.poll(r));
+    return r;
+}
+
+TEST_CASE("spsc_ring: wraps and reports full / empty", "[shm]")
+{
+    auto ring = std::make_unique<spsc_ring<uint64_t, 8>>();
+    ring->init();
+
+    uint64_t v;
+    REQUIRE_FALSE(ring->try_pop(v));
+    for (uint64_t round = 0; round < 3; round++) {
+        for (uint64_t i = 0; i < 8; i++) {
+            REQUIRE(ring->try_push(round * 8 + i));
+        }
+        REQUIRE_FALSE(ring->try_push(99));
+        REQUIRE(ring->size_approx() == 8);
+        for (uint64_t i = 0; i < 8; i++) {
+            REQUIRE(ring->try_pop(v));
+            REQUIRE(v == round * 8 + i);
+        }
+        REQUIRE_FALSE(ring->try_pop(v));
+    }
+}
+
+TEST_CASE("shm transport: accepts, executes and cancels across clients", "[shm]")
+{
+    shm_engine engine(test_config());
+    shm_client buyer(engine.name());
+    shm_client seller(engine.name());
+    REQUIRE(buyer.slot_index() != seller.slot_index());
+    REQUIRE(buyer.engine_alive());
+
+    REQUIRE(buyer.enter(1, test_order(order_side::BUY, 500, 100)));
+    REQUIRE(engine.poll() == 1);
+    auto ack = next_report(buyer);
+    REQUIRE(ack.type == shm::ACCEPTED);
+    REQUIRE(ack.token == 1);
+
+    // same token on another client is a different order
+    REQUIRE(seller.enter(1, test_order(order_side::SELL, 499, 30)));
+    engine.poll();
+    REQUIRE(next_report(seller).type == shm::ACCEPTED);
+
+    auto sell_fill = next_report(seller);
+    REQUIRE(sell_fill.type == shm::EXECUTED);
+    REQUIRE(sell_fill.qty == 30);
+    REQUIRE(sell_fill.price == 500);   // resting bid's price
+
+    auto buy_fill = next_report(buyer);
+    REQUIRE(buy_fill.type == shm::EXECUTED);
+    REQUIRE(buy_fill.token == 1);
+    REQUIRE(buy_fill.match_number == sell_fill.match_number);
+
+    REQUIRE(buyer.replace(1, "TEST", 50, 490));
+    engine.poll();
+    auto replaced = next_report(buyer);
+    REQUIRE(replaced.type == shm::REPLACED);
+    REQUIRE(replaced.qty == 50);
+    REQUIRE(engine.book("TEST")->best_bid() == 490u);
+
+    REQUIRE(buyer.cancel(1, "TEST"));
+    REQUIRE(buyer.cancel(1, "TEST"));
+    REQUIRE(engine.poll() == 2);
+    REQUIRE(next_report(buyer).type == shm::CANCELED);
+    auto rej = next_report(buyer);
+    REQUIRE(rej.type == shm::REJECTED);
+    REQUIRE(rej.reason == static_cast<uint8_t>(order_result::ORDER_NOT_FOUND));
+
+    shm::report_t none;
+    REQUIRE_FALSE(buyer.poll(none));
+    REQUIRE(engine.stats().fills == 1);
+}
+
+TEST_CASE("shm transport: a reclaimed slot does not inherit old fills", "[shm]")
+{
+    shm_engine engine(test_config(1));
+    {
+        shm_client first(engine.name());
+        REQUIRE(first.enter(7, test_order(order_side::BUY, 100, 10)));
+        engine.poll();
+        REQUIRE(next_report(first).type == shm::ACCEPTED);
+    }
+
+    // the slot is CLOSING until the engine resets it
+    REQUIRE_THROWS(shm_client(engine.name()));
+    REQUIRE(engine.poll() == 0);
+
+    shm_client second(engine.name());
+    REQUIRE(second.slot_index() == 0);
+    REQUIRE_THROWS(shm_client(engine.name()));   // the only slot is taken
+
+    // token 7 is free again for the new owner and trades with the old order
+    REQUIRE(second.enter(7, test_order(order_side::SELL, 100, 10)));
+    engine.poll();
+    REQUIRE(next_report(second).type == shm::ACCEPTED);
+    auto fill = next_report(second);
+    REQUIRE(fill.type == shm::EXECUTED);
+    REQUIRE(fill.token == 7);
+
+    shm::report_t none;
+    REQUIRE_FALSE(second.poll(none));   // the first owner's half of the fill is dropped
+}
+
+TEST_CASE("shm transport: slots change owners while the engine runs", "[shm]")
+{
+    shm_engine engine(test_config(2));
+    std::atomic<bool> stop{false};
+    std::thread engine_thread([&] { engine.run(stop); });
+
+    // every churned order trades against this one, so the engine is in on_fill for the slot as it is released
+    shm_client maker(engine.name());
+    REQUIRE(maker.enter(1, test_order(order_side::SELL, 100, 1000000)));
+
+    size_t stale = 0;
+    for (uint64_t token = 1; token <= 300; token++) {
+        std::unique_ptr<shm_client> client;
+        while (!client) {
+            try {
+                client = std::make_unique<shm_client>(engine.name());
+            } catch (const std::runtime_error&) {
+                std::this_thread::yield();   // the engine has not reset the slot yet
+            }
+        }
+        REQUIRE(client->enter(token, test_order(order_side::BUY, 100, 1)));
+
+        // a report for any other token was left in the rings by an earlier owner
+        shm::report_t r;
+        bool accepted = false;
+        while (!accepted) {
+            if (client->poll(r)) {
+                stale += r.token != token;
+                accepted = r.token == token && r.type == shm::ACCEPTED;
+            }
+        }
+        // every other pass leaves before the fill report has been read
+        if (token % 2) {
+            while (!client->poll(r)) {
+            }
+            stale += r.token != token;
+            REQUIRE(r.type == shm::EXECUTED);
+        }
+    }
+
+    stop.store(true);
+    engine_thread.join();
+    REQUIRE(stale == 0);
+    REQUIRE(engine.stats().protocol_errors == 0);
+}
+
+TEST_CASE("shm transport: missing segment throws", "[shm]")
+{
+    REQUIRE_THROWS(shm_client("/orderbook-test-shm-missing"));
+}
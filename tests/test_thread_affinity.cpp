@@ -0,0 +1,98 @@
+#include <catch2/catch_all.hpp>
+
+#include <sched.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../includes/logger.h"
+#include "../includes/thread_affinity.h"
+
+static bool mentions(const std::vector<std::string>& lines, const std::string& text) {
+    for (const std::string& l : lines) {
+        if (l.find(text) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST_CASE("thread placement: pins the calling thread", "[affinity]")
+{
+    int cpu = sched_getcpu();
+    REQUIRE(cpu >= 0);
+
+    std::thread t([cpu] {
+        thread_placement_t p;
+        p.cpu = cpu;
+        placement_result_t r = apply_thread_placement(p, "ob-test");
+        REQUIRE(r.pinned);
+        REQUIRE(r.error.empty());
+        REQUIRE(sched_getcpu() == cpu);
+    });
+    t.join();
+}
+
+TEST_CASE("thread placement: unusable settings are reported, not fatal", "[affinity]")
+{
+    std::thread t([] {
+        thread_placement_t p;
+        p.cpu = CPU_SETSIZE - 1;
+        placement_result_t r = apply_thread_placement(p);
+        REQUIRE_FALSE(r.pinned);
+        REQUIRE(r.error.find("cannot pin") != std::string::npos);
+
+        thread_placement_t none;
+        placement_result_t untouched = apply_thread_placement(none);
+        REQUIRE_FALSE(untouched.pinned);
+        REQUIRE_FALSE(untouched.realtime);
+        REQUIRE(untouched.error.empty());
+    });
+    t.join();
+}
+
+TEST_CASE("thread placement: warns about shared CPUs", "[affinity]")
+{
+    orderbook_config_t c;
+    c.idle = idle_strategy::BUSY_POLL;
+    c.matching.cpu = 0;
+    c.matching.fifo_priority = 10;
+    c.logger.cpu = 0;
+    c.io.push_back({ 1, 0 });
+
+    std::vector<std::string> w = placement_warnings(c);
+    REQUIRE(mentions(w, "matching and logger share CPU 0"));
+    REQUIRE(mentions(w, "starve"));
+
+    orderbook_config_t apart;
+    REQUIRE(placement_warnings(apart).empty());
+}
+
+TEST_CASE("thread placement: idle strategies parse and back off", "[affinity]")
+{
+    idle_strategy s;
+    REQUIRE(parse_idle_strategy("busy-poll", s));
+    REQUIRE(s == idle_strategy::BUSY_POLL);
+    REQUIRE(parse_idle_strategy("block", s));
+    REQUIRE(std::string(idle_strategy_name(s)) == "block");
+    REQUIRE_FALSE(parse_idle_strategy("nap", s));
+
+    // spins, yields, then sleeps at most max_sleep_ns per call
+    idle_waiter w(idle_strategy::BLOCK, 2000);
+    uint64_t start = monotonic_ns();
+    for (int i = 0; i < 400; i++) {
+        w.idle();
+    }
+    REQUIRE(monotonic_ns() - start < 1000000000ULL);
+    w.reset();
+    w.idle();
+}
+
+TEST_CASE("thread placement: logger applies its thread placement", "[affinity]")
+{
+    logger_config_t lc;
+    lc.thread.cpu = sched_getcpu();
+    logger log("../logs/test_thread_affinity.log", lc);
+    REQUIRE(log.placement().pinned);
+}